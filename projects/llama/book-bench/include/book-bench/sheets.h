@@ -0,0 +1,56 @@
+/// @file
+/// 基准测试用的工作表生成器。同样的参数总是生成同样的工作表，以便不同版本之间比较。
+
+#pragma once
+
+#include "book/worksheet.h"
+#include <cstdint>
+
+namespace llama::bench
+{
+
+/// 确定性的伪随机数发生器（splitmix64）
+class SplitMix64
+{
+  public:
+    explicit SplitMix64(uint64_t seed) : m_state{seed}
+    {
+    }
+
+    uint64_t Next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// 返回 [lo, hi] 区间内的整数
+    uint32_t Range(uint32_t lo, uint32_t hi)
+    {
+        return lo + uint32_t(Next() % (uint64_t(hi) - lo + 1));
+    }
+
+  private:
+    uint64_t m_state;
+};
+
+/// 在 `sheet` 的前 `rows` 行、前 `columns` 列填上数字。
+/// 每个单元格以 `density` 的百分比概率是数字，其余一半是文本一半留空；`density` 为 100 时是整块的数字。
+inline void FillNumbers(Worksheet &sheet, uint32_t rows, uint32_t columns, uint32_t density, uint64_t seed = 0)
+{
+    SplitMix64 rng{seed};
+    for (uint32_t c = 0; c < columns; c++)
+    {
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            uint32_t dice = rng.Range(0, 99);
+            if (dice < density)
+                sheet.SetNumber(row, c, double(rng.Range(0, 1000000)) / 100);
+            else if (dice % 2 == 0)
+                sheet.SetText(row, c, "n/a");
+        }
+    }
+}
+
+} // namespace llama::bench
@@ -0,0 +1,8 @@
+list(APPEND SOURCE_LIST "src/aggregate_bench.cpp")
+list(APPEND SOURCE_LIST "src/lookup_bench.cpp")
+list(APPEND SOURCE_LIST "src/main.cpp")
+list(APPEND SOURCE_LIST "src/snapshot_bench.cpp")
+list(APPEND SOURCE_LIST "src/sort_bench.cpp")
+list(APPEND SOURCE_LIST "src/workbook_proto_bench.cpp")
+list(APPEND SOURCE_LIST "include/book-bench/sheets.h")
+list(APPEND TEST_SOURCE_LIST "test/sheets.cpp")
@@ -0,0 +1,89 @@
+// 区域聚合：逐个单元格读取的循环，和直接处理列存储的向量化内核对比；多列时再加上线程池。
+#include "book-bench/sheets.h"
+#include "book/workbook.h"
+#include "foundation/thread_pool.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <memory>
+
+using namespace llama;
+
+namespace
+{
+
+constexpr uint32_t kRows = 1 << 20;
+constexpr uint32_t kColumns = 8;
+
+// 按数字的百分比缓存生成好的工作簿，同一个参数的几个基准共用
+Worksheet &SheetWithDensity(uint32_t density)
+{
+    static std::unique_ptr<Workbook> books[101];
+    if (!books[density])
+    {
+        books[density] = std::make_unique<Workbook>();
+        bench::FillNumbers(books[density]->AddSheet("data"), kRows, kColumns, density, density);
+    }
+    return books[density]->Sheet(0);
+}
+
+void Densities(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"density", "columns"});
+    for (int density : {100, 50, 5})
+    {
+        b->Args({density, 1})->Args({density, kColumns});
+    }
+}
+
+} // namespace
+
+static void BM_AggregateNaive(benchmark::State &state)
+{
+    Worksheet &sheet = SheetWithDensity(uint32_t(state.range(0)));
+    uint32_t columns = uint32_t(state.range(1));
+    for (auto _ : state)
+    {
+        RangeAggregate result;
+        for (uint32_t c = 0; c < columns; c++)
+        {
+            for (uint32_t row = 0; row < kRows; row++)
+            {
+                CellValue value = sheet.Get(row, c);
+                if (value.Type() != CellType::Number)
+                    continue;
+                result.sum += value.AsNumber();
+                result.min = std::min(result.min, value.AsNumber());
+                result.max = std::max(result.max, value.AsNumber());
+                result.count++;
+            }
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kRows * columns);
+}
+BENCHMARK(BM_AggregateNaive)->Apply(Densities)->Unit(benchmark::kMillisecond);
+
+static void BM_AggregateKernel(benchmark::State &state)
+{
+    Worksheet &sheet = SheetWithDensity(uint32_t(state.range(0)));
+    uint32_t columns = uint32_t(state.range(1));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sheet.Aggregate({0, 0, kRows - 1, columns - 1}));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kRows * columns);
+}
+BENCHMARK(BM_AggregateKernel)->Apply(Densities)->Unit(benchmark::kMillisecond);
+
+static void BM_AggregateParallel(benchmark::State &state)
+{
+    Worksheet &sheet = SheetWithDensity(uint32_t(state.range(0)));
+    uint32_t columns = uint32_t(state.range(1));
+    static ThreadPool pool;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sheet.Aggregate({0, 0, kRows - 1, columns - 1}, &pool));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kRows * columns);
+}
+BENCHMARK(BM_AggregateParallel)->Apply(Densities)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,104 @@
+// 按值查找：逐行扫描一列，和用列上的哈希索引、有序索引对比。
+#include "book-bench/sheets.h"
+#include "book/workbook.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+
+using namespace llama;
+
+namespace
+{
+
+constexpr uint32_t kRows = 1 << 20;
+
+// 第 0 列是互不相同的编号文本，第 1 列是数字
+Workbook &Book()
+{
+    static std::unique_ptr<Workbook> book;
+    if (!book)
+    {
+        book = std::make_unique<Workbook>();
+        Worksheet &sheet = book->AddSheet("data");
+        bench::SplitMix64 rng{1};
+        for (uint32_t row = 0; row < kRows; row++)
+        {
+            sheet.SetText(row, 0, "id" + std::to_string(row));
+            sheet.SetNumber(row, 1, double(rng.Range(0, 1000000)) / 100);
+        }
+    }
+    return *book;
+}
+
+} // namespace
+
+static void BM_LookupScan(benchmark::State &state)
+{
+    Workbook &book = Book();
+    Worksheet const &sheet = book.Sheet(0);
+    bench::SplitMix64 rng{2};
+    for (auto _ : state)
+    {
+        CellValue key = CellValue::String(*book.Strings().Find("id" + std::to_string(rng.Range(0, kRows - 1))));
+        CellValue result;
+        for (uint32_t row = 0; row < sheet.RowCount(); row++)
+        {
+            if (sheet.Get(row, 0) == key)
+            {
+                result = sheet.Get(row, 1);
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LookupScan)->Unit(benchmark::kMicrosecond);
+
+static void BM_LookupIndexed(benchmark::State &state)
+{
+    Workbook &book = Book();
+    bench::SplitMix64 rng{2};
+    book.Lookup(0, 0, "id0", 1);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(book.Lookup(0, 0, "id" + std::to_string(rng.Range(0, kRows - 1)), 1));
+    }
+}
+BENCHMARK(BM_LookupIndexed)->Unit(benchmark::kMicrosecond);
+
+static void BM_LookupIndexedAfterEdit(benchmark::State &state)
+{
+    Workbook &book = Book();
+    Worksheet &sheet = book.Sheet(0);
+    bench::SplitMix64 rng{3};
+    for (auto _ : state)
+    {
+        // 每次查找之前改一个单元格，索引要先赶上这次编辑
+        uint32_t row = rng.Range(0, kRows - 1);
+        sheet.SetText(row, 0, "id" + std::to_string(row));
+        benchmark::DoNotOptimize(book.Lookup(0, 0, "id" + std::to_string(rng.Range(0, kRows - 1)), 1));
+    }
+}
+BENCHMARK(BM_LookupIndexedAfterEdit)->Unit(benchmark::kMicrosecond);
+
+static void BM_RangeScan(benchmark::State &state)
+{
+    Worksheet const &sheet = Book().Sheet(0);
+    for (auto _ : state)
+    {
+        size_t count = 0;
+        sheet.FindColumn(1)->ForEachNumber([&](uint32_t, double number) { count += number >= 100 && number <= 101; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+BENCHMARK(BM_RangeScan)->Unit(benchmark::kMicrosecond);
+
+static void BM_RangeIndexed(benchmark::State &state)
+{
+    Worksheet const &sheet = Book().Sheet(0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sheet.FindRowsBetween(1, 100, 101).size());
+    }
+}
+BENCHMARK(BM_RangeIndexed)->Unit(benchmark::kMicrosecond);
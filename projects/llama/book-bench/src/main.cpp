@@ -0,0 +1,26 @@
+// 默认以 JSON 输出到标准输出，方便存档后和其他版本比较。
+// 需要表格时加 --benchmark_format=console ；也可以用 --benchmark_out=<file> 另存一份。
+#include <benchmark/benchmark.h>
+#include <string_view>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    std::vector<char *> args(argv, argv + argc);
+    bool has_format = false;
+    for (char *arg : args)
+    {
+        has_format |= std::string_view{arg}.starts_with("--benchmark_format");
+    }
+    static char json_format[] = "--benchmark_format=json";
+    if (!has_format)
+        args.insert(args.begin() + 1, json_format);
+
+    int count = int(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
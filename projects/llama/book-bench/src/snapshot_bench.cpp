@@ -0,0 +1,91 @@
+// 快照和版本：编辑中的工作簿取快照、存成版本的代价，和复制整个工作簿对比。
+#include "book-bench/sheets.h"
+#include "book/snapshot_store.h"
+#include "book/workbook.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+
+using namespace llama;
+
+namespace
+{
+
+constexpr uint32_t kRows = 1 << 20;
+
+// 一个 4 列的工作表，数字和文本各半
+std::unique_ptr<Workbook> MakeBook()
+{
+    auto book = std::make_unique<Workbook>();
+    Worksheet &sheet = book->AddSheet("data");
+    bench::SplitMix64 rng{1};
+    for (uint32_t row = 0; row < kRows; row++)
+    {
+        sheet.SetNumber(row, 0, double(rng.Range(0, 1000000)) / 100);
+        sheet.SetNumber(row, 1, double(row));
+        sheet.SetText(row, 2, "k" + std::to_string(rng.Range(0, 5000)));
+        sheet.SetText(row, 3, "v" + std::to_string(row % 977));
+    }
+    return book;
+}
+
+Workbook &Book()
+{
+    static std::unique_ptr<Workbook> book = MakeBook();
+    return *book;
+}
+
+} // namespace
+
+static void BM_SnapshotAndEdit(benchmark::State &state)
+{
+    Workbook &book = Book();
+    Worksheet &sheet = book.Sheet(0);
+    bench::SplitMix64 rng{2};
+    for (auto _ : state)
+    {
+        // 取快照之后写一个单元格：只复制被写到的那一块
+        WorkbookSnapshot snapshot = book.Snapshot();
+        sheet.SetNumber(rng.Range(0, kRows - 1), 0, 1);
+        benchmark::DoNotOptimize(snapshot.Sheet(0).RowCount());
+    }
+}
+BENCHMARK(BM_SnapshotAndEdit)->Unit(benchmark::kMicrosecond);
+
+static void BM_CopyAndEdit(benchmark::State &state)
+{
+    Workbook &book = Book();
+    bench::SplitMix64 rng{2};
+    for (auto _ : state)
+    {
+        // 不用快照时，要在编辑的同时读就只能逐个单元格复制出一份
+        Worksheet const &source = book.Sheet(0);
+        Worksheet target{source.Name(), book.Strings()};
+        for (uint32_t column = 0; column < source.ColumnCount(); column++)
+        {
+            source.FindColumn(column)->ForEach([&](uint32_t row, CellValue value) { target.Set(row, column, value); });
+        }
+        book.Sheet(0).SetNumber(rng.Range(0, kRows - 1), 0, 1);
+        benchmark::DoNotOptimize(target.RowCount());
+    }
+}
+BENCHMARK(BM_CopyAndEdit)->Unit(benchmark::kMillisecond);
+
+static void BM_StoreVersion(benchmark::State &state)
+{
+    Workbook &book = Book();
+    ObjectStore store;
+    StoreSnapshot(book.Snapshot(), store);
+    bench::SplitMix64 rng{3};
+    for (auto _ : state)
+    {
+        // 每个版本改几个单元格，只有改过的块需要重新哈希和存放
+        for (int i = 0; i < 8; i++)
+        {
+            book.Sheet(0).SetNumber(rng.Range(0, kRows - 1), 1, -1);
+        }
+        benchmark::DoNotOptimize(StoreSnapshot(book.Snapshot(), store));
+    }
+    state.counters["objects"] = double(store.Size());
+}
+BENCHMARK(BM_StoreVersion)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,90 @@
+// 排序：千万行的区域按文本和数字两个键排序，和对行号做 std::stable_sort 对比；再加上线程池。
+#include "book-bench/sheets.h"
+#include "book/sort.h"
+#include "book/workbook.h"
+#include "foundation/thread_pool.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+constexpr uint32_t kRows = 10000000;
+
+// 第 0 列是一万种文本，第 1 列是数字
+Workbook &Book()
+{
+    static std::unique_ptr<Workbook> book;
+    if (!book)
+    {
+        book = std::make_unique<Workbook>();
+        Worksheet &sheet = book->AddSheet("data");
+        bench::SplitMix64 rng{1};
+        for (uint32_t row = 0; row < kRows; row++)
+        {
+            sheet.SetText(row, 0, "customer" + std::to_string(rng.Range(0, 9999)));
+            sheet.SetNumber(row, 1, double(rng.Range(0, 100000000)) / 100);
+        }
+    }
+    return *book;
+}
+
+ThreadPool &Pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+const SortKey kKeys[] = {{0}, {1, true}};
+
+} // namespace
+
+static void BM_SortStableSort(benchmark::State &state)
+{
+    Workbook &book = Book();
+    Worksheet const &sheet = book.Sheet(0);
+    for (auto _ : state)
+    {
+        // 逐个单元格读取、按文本比较的朴素做法
+        std::vector<uint32_t> rows(kRows);
+        std::iota(rows.begin(), rows.end(), 0);
+        std::stable_sort(rows.begin(), rows.end(), [&](uint32_t a, uint32_t b) {
+            if (int order = sheet.Text(a, 0).compare(sheet.Text(b, 0)))
+                return order < 0;
+            return sheet.Get(a, 1).AsNumber() > sheet.Get(b, 1).AsNumber();
+        });
+        benchmark::DoNotOptimize(rows.data());
+    }
+}
+BENCHMARK(BM_SortStableSort)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+static void BM_SortRadix(benchmark::State &state)
+{
+    Worksheet const &sheet = Book().Sheet(0);
+    for (auto _ : state)
+    {
+        RowOrder order{0, kRows - 1};
+        order.Sort(sheet, kKeys);
+        benchmark::DoNotOptimize(order.Rows().data());
+    }
+}
+BENCHMARK(BM_SortRadix)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+static void BM_SortRadixParallel(benchmark::State &state)
+{
+    Worksheet const &sheet = Book().Sheet(0);
+    for (auto _ : state)
+    {
+        RowOrder order{0, kRows - 1};
+        order.Sort(sheet, kKeys, &Pool());
+        benchmark::DoNotOptimize(order.Rows().data());
+    }
+    state.counters["threads"] = double(Pool().ThreadCount());
+}
+BENCHMARK(BM_SortRadixParallel)->Unit(benchmark::kMillisecond)->Iterations(3);
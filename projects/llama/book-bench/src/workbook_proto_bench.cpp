@@ -0,0 +1,78 @@
+// workbook.proto 的读写：多个工作表时串行处理和在线程池上按工作表并行处理对比。
+#include "book-bench/sheets.h"
+#include "book/workbook_proto.h"
+#include "foundation/thread_pool.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+
+using namespace llama;
+
+namespace
+{
+
+constexpr uint32_t kSheets = 16;
+constexpr uint32_t kRows = 1 << 15;
+constexpr uint32_t kColumns = 4;
+
+Workbook const &Book()
+{
+    static std::unique_ptr<Workbook> book;
+    if (!book)
+    {
+        book = std::make_unique<Workbook>();
+        for (uint32_t s = 0; s < kSheets; s++)
+        {
+            bench::FillNumbers(book->AddSheet("sheet" + std::to_string(s)), kRows, kColumns, 80, s);
+        }
+    }
+    return *book;
+}
+
+std::string const &Encoded()
+{
+    static std::string const bytes = [] {
+        std::ostringstream out;
+        WriteWorkbookProto(Book(), out);
+        return std::move(out).str();
+    }();
+    return bytes;
+}
+
+ThreadPool *PoolFor(benchmark::State const &state)
+{
+    static ThreadPool pool;
+    return state.range(0) ? &pool : nullptr;
+}
+
+} // namespace
+
+static void BM_WorkbookProtoRead(benchmark::State &state)
+{
+    std::string const &bytes = Encoded();
+    ThreadPool *pool = PoolFor(state);
+    for (auto _ : state)
+    {
+        Workbook book;
+        ReadWorkbookProto(std::as_bytes(std::span{bytes.data(), bytes.size()}), book, pool);
+        benchmark::DoNotOptimize(book.SheetCount());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * bytes.size()));
+}
+BENCHMARK(BM_WorkbookProtoRead)->ArgName("parallel")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_WorkbookProtoWrite(benchmark::State &state)
+{
+    Workbook const &book = Book();
+    ThreadPool *pool = PoolFor(state);
+    for (auto _ : state)
+    {
+        std::ostringstream out;
+        WriteWorkbookProto(book, out, pool);
+        benchmark::DoNotOptimize(out.tellp());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * Encoded().size()));
+}
+BENCHMARK(BM_WorkbookProtoWrite)->ArgName("parallel")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
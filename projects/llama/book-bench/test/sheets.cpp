@@ -0,0 +1,34 @@
+#include "book-bench/sheets.h"
+#include "book/workbook.h"
+#include <gtest/gtest.h>
+
+using namespace llama;
+
+TEST(SheetsTest, FillIsDeterministic)
+{
+    Workbook book;
+    Worksheet &a = book.AddSheet("a");
+    Worksheet &b = book.AddSheet("b");
+    bench::FillNumbers(a, 5000, 3, 60, 1);
+    bench::FillNumbers(b, 5000, 3, 60, 1);
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        for (uint32_t row = 0; row < 5000; row++)
+        {
+            ASSERT_EQ(a.Get(row, c), b.Get(row, c));
+        }
+    }
+}
+
+TEST(SheetsTest, FillHonorsDensity)
+{
+    Workbook book;
+    Worksheet &dense = book.AddSheet("dense");
+    Worksheet &sparse = book.AddSheet("sparse");
+    bench::FillNumbers(dense, 10000, 2, 100);
+    bench::FillNumbers(sparse, 10000, 2, 10);
+    EXPECT_EQ(dense.Aggregate({0, 0, 9999, 1}).count, 20000);
+    size_t count = sparse.Aggregate({0, 0, 9999, 1}).count;
+    EXPECT_GT(count, 1500);
+    EXPECT_LT(count, 2500);
+}
@@ -0,0 +1,52 @@
+/// @file
+/// 区域上的数字聚合：求和、计数、最小值、最大值和平均值。
+
+#pragma once
+#include "book/column.h"
+#include "book/config.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace llama
+{
+
+/// 一组数字的聚合结果。文本、布尔值和空单元格都不算在内，和常见电子表格的 `SUM` 、`COUNT` 等一致。
+struct RangeAggregate
+{
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    size_t count = 0;
+
+    /// 平均值。没有数字时为 NaN 。
+    double Average() const
+    {
+        return count ? sum / double(count) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    /// 合并另一部分的结果
+    void Merge(RangeAggregate const &other)
+    {
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        count += other.count;
+    }
+};
+
+/// 聚合一块里第 `begin` 到 `end - 1` 行的数字，结果合并进 `out` 。
+///
+/// 直接处理块的数字数组，按位图整字跳过没有数字的行；整字都是数字时不看位图。
+/// 运行时选择 AVX2 或标量实现。求和的顺序和逐个相加不同，结果可能差几个最低位。
+/// NaN 让和变成 NaN ，但不参与最小值和最大值，两种实现相同。
+LLAMA_BOOK_API void AggregateChunk(ColumnChunkView const &chunk, uint32_t begin, uint32_t end, RangeAggregate &out);
+
+/// 同 `AggregateChunk` ，总是用标量实现。用来和向量化的实现对照。
+LLAMA_BOOK_API void AggregateChunkScalar(ColumnChunkView const &chunk, uint32_t begin, uint32_t end,
+                                         RangeAggregate &out);
+
+/// 聚合一列里第 `first_row` 到 `last_row` 行（包含）的数字，结果合并进 `out` 。
+LLAMA_BOOK_API void AggregateColumn(Column const &column, uint32_t first_row, uint32_t last_row, RangeAggregate &out);
+
+} // namespace llama
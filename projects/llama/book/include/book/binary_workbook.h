@@ -0,0 +1,156 @@
+/// @file
+/// 工作簿的原生二进制格式：按需映射，延迟加载工作表。
+
+#pragma once
+#include "book/cell.h"
+#include "book/column.h"
+#include "book/config.h"
+#include "book/workbook.h"
+#include "foundation/exceptions.h"
+#include "foundation/mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace llama
+{
+
+class MappedWorkbook;
+
+/// 映射的文件里的一列。只是几个指针，按值传递。
+class LLAMA_BOOK_API MappedColumn
+{
+  public:
+    /// 块数
+    size_t ChunkCount() const
+    {
+        return m_chunk_count;
+    }
+
+    /// 第 `index` 块，直接指向映射的文件。没有单元格的块为空视图。
+    /// @exception 如果 `index` 不小于 `ChunkCount()` ，抛出 `ExceptionKind::IndexOutofRange`
+    /// @exception 如果块的位置不在文件里或者内容不一致（例如一行同时标成两种类型），
+    /// 抛出 `ExceptionKind::InvalidFileFormat`
+    ColumnChunkView Chunk(size_t index) const;
+
+    /// 第 `row` 行的值。超出范围时为空。字符串的编号属于 `MappedWorkbook` 。
+    CellValue Get(uint32_t row) const
+    {
+        size_t index = row / ColumnChunk::kRows;
+        if (index >= m_chunk_count)
+            return CellValue{};
+        ColumnChunkView chunk = Chunk(index);
+        return chunk ? chunk.Get(row % ColumnChunk::kRows) : CellValue{};
+    }
+
+  private:
+    friend class MappedSheet;
+
+    std::span<const std::byte> m_file;
+    const std::byte *m_chunk_offsets = nullptr;
+    size_t m_chunk_count = 0;
+};
+
+/// 映射的文件里的一张工作表。只是几个指针，按值传递，不能比 `MappedWorkbook` 活得久。
+class LLAMA_BOOK_API MappedSheet
+{
+  public:
+    std::string_view Name() const
+    {
+        return m_name;
+    }
+
+    /// 列数的上界
+    uint32_t ColumnCount() const
+    {
+        return m_column_count;
+    }
+
+    /// 第 `column` 列。超出范围时是没有块的空列。
+    /// @exception 如果列的位置不在文件里，抛出 `ExceptionKind::InvalidFileFormat`
+    MappedColumn Column(uint32_t column) const;
+
+    /// 单元格 (`row`, `column`) 的值。字符串的编号属于 `MappedWorkbook` 。
+    CellValue Get(uint32_t row, uint32_t column) const
+    {
+        return Column(column).Get(row);
+    }
+
+    /// 字符串单元格的内容，直接指向映射的文件。不是字符串时为空。
+    std::string_view Text(uint32_t row, uint32_t column) const;
+
+  private:
+    friend class MappedWorkbook;
+
+    MappedWorkbook const *m_book = nullptr;
+    std::string_view m_name;
+    uint32_t m_column_count = 0;
+    const std::byte *m_columns = nullptr;
+};
+
+/// 以原生二进制格式存放的工作簿，通过内存映射读取。
+///
+/// 文件由文件头、字符串表、每个工作表的目录和按 64 字节对齐的列块组成。列块的布局和内存里的
+/// `ColumnChunk` 相同，所以读取时不解析也不复制：`MappedSheet` 和 `MappedColumn` 直接返回指向映射区域的
+/// `ColumnChunkView` 。打开文件只读文件头、检查各个目录的范围，耗时和文件大小无关；
+/// 之后只有真正读到的工作表和列才会被操作系统换入内存。
+///
+/// 需要修改时用 `Load` 或 `LoadSheet` 把工作表复制成普通的 `Worksheet` 。
+/// @note 只支持小端序的机器。
+class LLAMA_BOOK_API MappedWorkbook
+{
+  public:
+    /// 打开文件 `path` 。
+    /// @exception 如果文件无法读取，抛出 `ExceptionKind::IoError`
+    /// @exception 如果不是工作簿文件或者已经损坏，抛出 `ExceptionKind::InvalidFileFormat`
+    explicit MappedWorkbook(std::filesystem::path const &path);
+
+    size_t SheetCount() const
+    {
+        return m_sheet_count;
+    }
+
+    /// 第 `index` 个工作表。
+    /// @exception 如果 `index` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    MappedSheet Sheet(size_t index) const;
+
+    /// 名为 `name` 的工作表
+    std::optional<MappedSheet> FindSheet(std::string_view name) const;
+
+    size_t StringCount() const
+    {
+        return m_string_count;
+    }
+
+    /// 编号为 `id` 的字符串，直接指向映射的文件。
+    /// @exception 如果编号不存在，抛出 `ExceptionKind::IndexOutofRange`
+    std::string_view String(StringId id) const;
+
+    /// 把整个工作簿复制到内存里。
+    Workbook Load() const;
+
+    /// 把第 `index` 个工作表复制到 `book` 里，追加在最后，字符串放进 `book` 的字符串池。
+    /// @exception 如果 `index` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    /// @exception 如果 `book` 里已经有同名的工作表，抛出 `ExceptionKind::ElementAlreadyExists`
+    Worksheet &LoadSheet(size_t index, Workbook &book) const;
+
+  private:
+    friend class MappedSheet;
+
+    MappedFile m_file;
+    size_t m_sheet_count = 0;
+    const std::byte *m_sheets = nullptr;
+    size_t m_string_count = 0;
+    const std::byte *m_string_offsets = nullptr;
+    const char *m_string_data = nullptr;
+};
+
+/// 把 `book` 以原生二进制格式写到 `path` 。先写临时文件，成功后再换上，不会留下写了一半的文件。
+/// 换上之前把临时文件写到磁盘，换上之后同步所在的目录，所以返回之后断电也不会丢失或者损坏。
+/// @exception 如果写入失败，抛出 `ExceptionKind::IoError`
+LLAMA_BOOK_API void SaveBinaryWorkbook(Workbook const &book, std::filesystem::path const &path);
+
+} // namespace llama
@@ -1,4 +1,5 @@
 #pragma once
+#include "book/workbook.h"
 namespace llama
 {
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+/// @file
+/// 单元格的值。
+
+#pragma once
+#include "foundation/enums.h"
+#include <cassert>
+#include <cstdint>
+
+namespace llama
+{
+
+/// 字符串池里字符串的编号
+using StringId = uint32_t;
+
+/// 单元格的值：空、数字、布尔值，或者字符串池里的字符串。只有 16 字节，按值传递。
+class CellValue
+{
+  public:
+    /// 空单元格
+    constexpr CellValue() : m_type{CellType::Empty}, m_number{0}
+    {
+    }
+
+    static constexpr CellValue Number(double value)
+    {
+        CellValue cell;
+        cell.m_type = CellType::Number;
+        cell.m_number = value;
+        return cell;
+    }
+
+    static constexpr CellValue Bool(bool value)
+    {
+        CellValue cell;
+        cell.m_type = CellType::Bool;
+        cell.m_boolean = value;
+        return cell;
+    }
+
+    /// 字符串 `id` 。字符串本身在工作簿的字符串池里。
+    static constexpr CellValue String(StringId id)
+    {
+        CellValue cell;
+        cell.m_type = CellType::String;
+        cell.m_string = id;
+        return cell;
+    }
+
+    constexpr CellType Type() const
+    {
+        return m_type;
+    }
+
+    constexpr bool Empty() const
+    {
+        return m_type == CellType::Empty;
+    }
+
+    constexpr double AsNumber() const
+    {
+        assert(m_type == CellType::Number);
+        return m_number;
+    }
+
+    constexpr bool AsBool() const
+    {
+        assert(m_type == CellType::Bool);
+        return m_boolean;
+    }
+
+    constexpr StringId AsString() const
+    {
+        assert(m_type == CellType::String);
+        return m_string;
+    }
+
+    constexpr bool operator==(CellValue const &other) const
+    {
+        if (m_type != other.m_type)
+            return false;
+        switch (m_type)
+        {
+        case CellType::Number:
+            return m_number == other.m_number;
+        case CellType::Bool:
+            return m_boolean == other.m_boolean;
+        case CellType::String:
+            return m_string == other.m_string;
+        default:
+            return true;
+        }
+    }
+
+  private:
+    CellType m_type;
+    union {
+        double m_number;
+        bool m_boolean;
+        StringId m_string;
+    };
+};
+
+/// 矩形的单元格区域。首尾的行和列都包含在内。
+struct CellRange
+{
+    uint32_t first_row = 0;
+    uint32_t first_column = 0;
+    uint32_t last_row = 0;
+    uint32_t last_column = 0;
+};
+
+} // namespace llama
@@ -0,0 +1,293 @@
+/// @file
+/// 按列分块存放的单元格。
+
+#pragma once
+#include "book/cell.h"
+#include "book/config.h"
+#include "foundation/hash.h"
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace llama
+{
+
+/// 一块单元格的只读视图。可以指向 `ColumnChunk` ，也可以直接指向映射的文件，格式相同。
+/// 四张位图各 `ColumnChunk::kWords` 个字；没有数字或字符串时对应的数组为空。整个视图为空表示这一块没有单元格。
+struct ColumnChunkView
+{
+    uint64_t const *number_bits = nullptr;
+    uint64_t const *bool_bits = nullptr;
+    uint64_t const *bool_values = nullptr;
+    uint64_t const *string_bits = nullptr;
+    double const *numbers = nullptr;
+    StringId const *strings = nullptr;
+
+    explicit operator bool() const
+    {
+        return number_bits != nullptr;
+    }
+
+    /// 第 `slot` 行的值
+    CellValue Get(uint32_t slot) const
+    {
+        uint32_t word = slot / 64;
+        uint64_t bit = uint64_t{1} << (slot % 64);
+        if (number_bits[word] & bit)
+            return CellValue::Number(numbers[slot]);
+        if (string_bits[word] & bit)
+            return CellValue::String(strings[slot]);
+        if (bool_bits[word] & bit)
+            return CellValue::Bool(bool_values[word] & bit);
+        return CellValue{};
+    }
+};
+
+/// 一列里连续 `kRows` 行的单元格，按类型分开存放。
+///
+/// 每种类型一张位图记录哪些行是这种类型；数字和字符串编号各放在一个定长数组里，
+/// 第一次出现这种类型时才分配，布尔值直接放在位图里。一列全是数字时，每个单元格只占 8 字节多一点。
+///
+/// 不是数字的行在数字数组里是 0 ，所以求和之类的计算可以直接处理整个数组，不必先看位图；字符串编号数组也一样。
+class LLAMA_BOOK_API ColumnChunk
+{
+  public:
+    /// 每块的行数
+    static constexpr uint32_t kRows = 4096;
+    /// 每张位图的字数
+    static constexpr uint32_t kWords = kRows / 64;
+
+    ColumnChunk() = default;
+
+    /// 复制 `view` 里的单元格
+    explicit ColumnChunk(ColumnChunkView const &view);
+
+    ColumnChunk(ColumnChunk const &other) : ColumnChunk{other.View()}
+    {
+    }
+
+    ColumnChunk &operator=(ColumnChunk const &) = delete;
+
+    /// 第 `slot` 行的值
+    CellValue Get(uint32_t slot) const
+    {
+        return View().Get(slot);
+    }
+
+    ColumnChunkView View() const
+    {
+        return {m_number_bits, m_bool_bits, m_bool_values, m_string_bits, m_numbers.get(), m_strings.get()};
+    }
+
+    /// 把第 `slot` 行设为 `value` 。`value` 为空时清除这一行。
+    void Set(uint32_t slot, CellValue value);
+
+    /// 非空的单元格数
+    uint32_t Count() const
+    {
+        return m_count;
+    }
+
+    /// 数字单元格的位图
+    uint64_t const *NumberBits() const
+    {
+        return m_number_bits;
+    }
+
+    /// 布尔单元格的位图，以及它们的值
+    uint64_t const *BoolBits() const
+    {
+        return m_bool_bits;
+    }
+
+    uint64_t const *BoolValues() const
+    {
+        return m_bool_values;
+    }
+
+    /// 字符串单元格的位图
+    uint64_t const *StringBits() const
+    {
+        return m_string_bits;
+    }
+
+    /// `kRows` 个数字。还没有出现过数字时为空。
+    double const *Numbers() const
+    {
+        return m_numbers.get();
+    }
+
+    /// `kRows` 个字符串编号。还没有出现过字符串时为空。
+    StringId const *Strings() const
+    {
+        return m_strings.get();
+    }
+
+    /// 把每个字符串单元格的编号 `id` 换成 `map(id)` 。用于把单元格搬到另一个字符串池。
+    template <typename F> void RemapStrings(F &&map)
+    {
+        m_hashed.store(false, std::memory_order_relaxed);
+        for (uint32_t word = 0; word < kWords; word++)
+        {
+            for (uint64_t bits = m_string_bits[word]; bits != 0; bits &= bits - 1)
+            {
+                uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                m_strings[slot] = map(m_strings[slot]);
+            }
+        }
+    }
+
+    /// 最后一个非空单元格的行号加一。没有单元格时为 0 。
+    uint32_t RowEnd() const;
+
+    /// 这一块占用的字节数
+    size_t MemoryUsage() const;
+
+    /// 单元格内容的 128 位哈希，单元格相同的块哈希相同，和数组是否分配过无关。
+    /// 算过一次之后缓存起来，直到下一次 `Set` ，所以共用的块只算一次。
+    /// @note 可以在多个线程上同时调用，只要没有线程在修改这一块
+    Hash ContentHash() const;
+
+  private:
+    // 清除第 slot 行，返回它原来是否非空
+    bool Erase(uint32_t word, uint64_t bit, uint32_t slot);
+
+  private:
+    uint64_t m_number_bits[kWords] = {};
+    uint64_t m_bool_bits[kWords] = {};
+    uint64_t m_bool_values[kWords] = {};
+    uint64_t m_string_bits[kWords] = {};
+    std::unique_ptr<double[]> m_numbers;
+    std::unique_ptr<StringId[]> m_strings;
+    uint32_t m_count = 0;
+    // ContentHash 的缓存。几个线程同时算出来的值相同，用原子变量只是为了不构成数据竞争
+    mutable std::atomic<uint64_t> m_hash1{0};
+    mutable std::atomic<uint64_t> m_hash2{0};
+    mutable std::atomic<bool> m_hashed{false};
+};
+
+/// 工作表的一列。行按 `ColumnChunk::kRows` 分块，块按行号直接索引，没有单元格的块不分配。
+/// 读写单元格都是 O(1) ；按列扫描时逐块顺序访问，用位图跳过空行。
+///
+/// 块可以在几列之间共用：复制一列只复制块的指针，写到共用的块时才把这一块复制一份（写时复制）。
+/// 共用的块从不修改，所以复制出来的列可以交给别的线程读。
+class LLAMA_BOOK_API Column
+{
+  public:
+    /// 第 `row` 行的值。超出范围时为空。
+    CellValue Get(uint32_t row) const
+    {
+        size_t index = row / ColumnChunk::kRows;
+        if (index >= m_chunks.size() || !m_chunks[index])
+            return CellValue{};
+        return m_chunks[index]->Get(row % ColumnChunk::kRows);
+    }
+
+    /// 把第 `row` 行设为 `value` 。`value` 为空时清除这一行，块空了就释放。
+    void Set(uint32_t row, CellValue value);
+
+    /// 非空的单元格数
+    size_t Count() const
+    {
+        return m_count;
+    }
+
+    /// 块数，也就是行数的上界除以 `ColumnChunk::kRows` 。
+    size_t ChunkCount() const
+    {
+        return m_chunks.size();
+    }
+
+    /// 第 `index` 块。没有单元格的块为空。
+    ColumnChunk const *Chunk(size_t index) const
+    {
+        return m_chunks[index].get();
+    }
+
+    /// 第 `index` 块，和这一列共用。没有单元格的块为空。
+    std::shared_ptr<ColumnChunk const> SharedChunk(size_t index) const
+    {
+        return m_chunks[index];
+    }
+
+    /// 换上第 `index` 块，原来的块被丢弃。`chunk` 为空或者没有单元格时清空这一块。
+    /// `chunk` 可以和别处共用，这一列写到它之前会先复制。
+    void SetChunk(size_t index, std::shared_ptr<ColumnChunk> chunk);
+
+    /// 取走第 `index` 块，这一块变空。超出范围或者没有单元格时为空。
+    /// 块还和别处共用时取走的是一份副本，所以总是可以直接修改。
+    std::shared_ptr<ColumnChunk> TakeChunk(size_t index);
+
+    /// 按行的顺序对每个非空单元格调用 `visit(row, value)` 。
+    template <typename F> void ForEach(F &&visit) const
+    {
+        for (size_t index = 0; index < m_chunks.size(); index++)
+        {
+            ColumnChunk const *chunk = m_chunks[index].get();
+            if (!chunk)
+                continue;
+            uint32_t base = uint32_t(index * ColumnChunk::kRows);
+            for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+            {
+                uint64_t bits = chunk->NumberBits()[word] | chunk->BoolBits()[word] | chunk->StringBits()[word];
+                for (; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                    visit(base + slot, chunk->Get(slot));
+                }
+            }
+        }
+    }
+
+    /// 按行的顺序对每个数字单元格调用 `visit(row, number)` 。
+    template <typename F> void ForEachNumber(F &&visit) const
+    {
+        for (size_t index = 0; index < m_chunks.size(); index++)
+        {
+            ColumnChunk const *chunk = m_chunks[index].get();
+            if (!chunk || !chunk->Numbers())
+                continue;
+            uint32_t base = uint32_t(index * ColumnChunk::kRows);
+            for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+            {
+                for (uint64_t bits = chunk->NumberBits()[word]; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                    visit(base + slot, chunk->Numbers()[slot]);
+                }
+            }
+        }
+    }
+
+    /// 按行的顺序对每个字符串单元格调用 `visit(row, id)` 。按文本比较或分组时直接用编号，不必取出字符串。
+    template <typename F> void ForEachString(F &&visit) const
+    {
+        for (size_t index = 0; index < m_chunks.size(); index++)
+        {
+            ColumnChunk const *chunk = m_chunks[index].get();
+            if (!chunk || !chunk->Strings())
+                continue;
+            uint32_t base = uint32_t(index * ColumnChunk::kRows);
+            for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+            {
+                for (uint64_t bits = chunk->StringBits()[word]; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                    visit(base + slot, chunk->Strings()[slot]);
+                }
+            }
+        }
+    }
+
+    /// 这一列占用的字节数
+    size_t MemoryUsage() const;
+
+  private:
+    std::vector<std::shared_ptr<ColumnChunk>> m_chunks;
+    size_t m_count = 0;
+};
+
+} // namespace llama
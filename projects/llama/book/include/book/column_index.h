@@ -0,0 +1,109 @@
+/// @file
+/// 工作表列上的二级索引。
+
+#pragma once
+#include "book/cell.h"
+#include "book/column.h"
+#include "book/config.h"
+#include "foundation/hash_table.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace llama
+{
+
+/// 一列上的索引，用于按值查找和按数字区间查找，不必扫描整列。由 `Worksheet` 在第一次查询时建立。
+///
+/// 相等查找用以单元格的值为键的 `HashTable` ，每个值对应按行号排好的行，查找是 O(1) 。
+/// 区间查找用按 (数字, 行号) 排序的若干小块，类似只有两层的 B+ 树，查找是 O(log n) ，插入删除只移动一块。
+/// 两种索引各自在第一次用到时才建立。
+///
+/// 编辑只追加到日志里，是 O(1) 的；下一次查询时再逐条并入索引。
+/// 逐条合并的代价超过重建时直接重建，所以一次查询最多花 O(n) 的时间赶上之前的编辑。
+/// @note 数字按值比较，`0` 和 `-0` 相同；NaN 不进索引。字符串按编号比较，也就是区分大小写。
+class LLAMA_BOOK_API ColumnIndex
+{
+  public:
+    /// 有序索引里的一项
+    struct NumberEntry
+    {
+        double number;
+        uint32_t row;
+    };
+
+    ColumnIndex() = default;
+
+    ColumnIndex(ColumnIndex const &) = delete;
+    ColumnIndex &operator=(ColumnIndex const &) = delete;
+
+    /// 记下第 `row` 行从 `before` 改成了 `after` 。
+    void Record(uint32_t row, CellValue before, CellValue after);
+
+    /// `column` 里等于 `value` 的行，按行号升序。`column` 必须是建立索引的那一列。
+    /// 返回的视图在下一次编辑或者查询之前有效。
+    std::span<const uint32_t> Find(Column const &column, CellValue value);
+
+    /// 对 `column` 里数字在 [`low`, `high`] 之间的每一项调用 `visit(NumberEntry)` ，
+    /// 按数字升序，数字相同的按行号升序。
+    template <typename F> void ForEachBetween(Column const &column, double low, double high, F &&visit)
+    {
+        EnsureSorted(column);
+        for (size_t block = FirstBlock(low); block < m_blocks.size(); block++)
+        {
+            std::vector<NumberEntry> const &entries = m_blocks[block];
+            for (size_t i = FirstEntry(entries, low); i < entries.size(); i++)
+            {
+                if (!(entries[i].number <= high))
+                    return;
+                visit(entries[i]);
+            }
+        }
+    }
+
+    /// 索引占用的字节数
+    size_t MemoryUsage() const;
+
+  private:
+    // 单元格的值作为哈希表的键。空单元格和 NaN 没有键
+    static std::optional<Hash> KeyOf(CellValue value);
+
+    // 把日志并入已经建立的索引
+    void Sync(Column const &column);
+    void EnsureHashed(Column const &column);
+    void EnsureSorted(Column const &column);
+    void BuildHashed(Column const &column);
+    void BuildSorted(Column const &column);
+
+    // 下面几个返回这次操作的代价，大约是移动的元素个数
+    size_t HashInsert(CellValue value, uint32_t row);
+    size_t HashErase(CellValue value, uint32_t row);
+    size_t SortedInsert(NumberEntry entry);
+    size_t SortedErase(NumberEntry entry);
+
+    // 第一个可能有不小于 low 的数字的块，以及块里第一个不小于 low 的数字
+    size_t FirstBlock(double low) const;
+    static size_t FirstEntry(std::vector<NumberEntry> const &entries, double low);
+
+  private:
+    struct Edit
+    {
+        uint32_t row;
+        CellValue before;
+        CellValue after;
+    };
+
+    std::vector<Edit> m_log;
+    // 建立索引时列里的单元格数，用来估计重建的代价
+    size_t m_cells = 0;
+
+    bool m_hashed = false;
+    HashTable<std::vector<uint32_t>> m_rows;
+
+    bool m_sorted = false;
+    std::vector<std::vector<NumberEntry>> m_blocks;
+};
+
+} // namespace llama
@@ -0,0 +1,8 @@
+#pragma once
+#include "foundation/config.h"
+
+#ifdef LLAMA_BOOK_EXPORT
+#define LLAMA_BOOK_API LLAMA_EXPORT_SYMBOL
+#else
+#define LLAMA_BOOK_API LLAMA_IMPORT_SYMBOL
+#endif
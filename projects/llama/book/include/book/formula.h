@@ -0,0 +1,211 @@
+/// @file
+/// 工作表的公式和增量重算。
+
+#pragma once
+#include "book/cell.h"
+#include "book/config.h"
+#include "book/worksheet.h"
+#include "foundation/hash_table.h"
+#include "foundation/thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace llama
+{
+
+/// 一张工作表上的公式，以及它们之间的依赖图。
+///
+/// 公式的写法和常见的电子表格相同，例如 `=A1*2+SUM(B1:B10)` 。支持数字、`TRUE` 、`FALSE` 、
+/// 单元格引用（`$` 可有可无）、区域（只能作为函数参数）、`+ - * / ^` 、比较运算，
+/// 以及函数 `SUM` 、`MIN` 、`MAX` 、`COUNT` 、`AVERAGE` 、`ABS` 、`IF` 。只能引用同一张工作表。
+/// 运算的优先级也和常见的电子表格相同，负号比乘方优先：`=-2^2` 是 4 ；乘方左结合：`=2^3^2` 是 64 。
+///
+/// 公式的结果直接写进工作表，所以读单元格的代码不需要知道哪些是公式。出错的结果是字符串
+/// `#VALUE!` 、`#DIV/0!` 、`#NUM!` ；循环引用上的公式，以及依赖它们的公式，结果是 `#CYCLE!` 。
+/// 引用出错单元格的公式得到同样的错误。是不是错误由公式自己记着，不看字符串的内容：
+/// 内容恰好是 `#DIV/0!` 的普通文本单元格仍然是文本，公式把它原样引用过来的结果也是文本。
+///
+/// 每个单元格记录引用它的公式；区域引用按列登记，修改时只检查这一列上的区域。
+/// 修改单元格或公式时沿着依赖图把受影响的公式标记为脏，`Recalculate` 只按拓扑顺序重算这些公式：
+/// 每一轮取出所有依赖都已算完的公式，互不依赖，足够多时在线程池上并行计算。
+/// 所以在很大的工作表上改一个单元格，重算的代价只和受影响的公式数有关。
+///
+/// @note 必须通过这个类修改工作表，或者直接修改之后调用 `MarkDirty` ，否则引用它的公式不会重算。
+/// @note 不是线程安全的。
+class LLAMA_BOOK_API FormulaEngine
+{
+  public:
+    /// 公式的编号
+    using FormulaId = uint32_t;
+
+    /// 管理 `sheet` 上的公式。`sheet` 和 `pool` 必须比它活得久。
+    /// @param pool 为空时所有公式都在调用 `Recalculate` 的线程上计算
+    explicit FormulaEngine(Worksheet &sheet, ThreadPool *pool = nullptr);
+
+    FormulaEngine(FormulaEngine const &) = delete;
+    FormulaEngine &operator=(FormulaEngine const &) = delete;
+
+    Worksheet &Sheet() const
+    {
+        return *m_sheet;
+    }
+
+    /// 把单元格 (`row`, `column`) 设为公式 `text` ，开头的 `=` 可以省略。结果在下一次 `Recalculate` 时算出。
+    /// @exception 如果公式写法有误，抛出 `ExceptionKind::BadArgument`
+    /// @exception 如果行或列超出上限，抛出 `ExceptionKind::IndexOutofRange`
+    void SetFormula(uint32_t row, uint32_t column, std::string_view text);
+
+    /// 把单元格 (`row`, `column`) 设为 `value` ，原来的公式被删除。
+    /// @exception 如果行或列超出上限，抛出 `ExceptionKind::IndexOutofRange`
+    void Set(uint32_t row, uint32_t column, CellValue value);
+
+    void SetNumber(uint32_t row, uint32_t column, double value)
+    {
+        Set(row, column, CellValue::Number(value));
+    }
+
+    void SetText(uint32_t row, uint32_t column, std::string_view text)
+    {
+        Set(row, column, CellValue::String(m_sheet->Strings().Intern(text)));
+    }
+
+    void Clear(uint32_t row, uint32_t column)
+    {
+        Set(row, column, CellValue{});
+    }
+
+    /// 单元格 (`row`, `column`) 被直接修改过，重算引用它的公式。
+    void MarkDirty(uint32_t row, uint32_t column);
+
+    /// 单元格 (`row`, `column`) 的公式。没有公式时为空。
+    std::string_view Formula(uint32_t row, uint32_t column) const;
+
+    /// 公式的个数
+    size_t FormulaCount() const
+    {
+        return m_formulas.size() - m_free.size();
+    }
+
+    /// 等待重算的公式数的上界
+    size_t DirtyCount() const
+    {
+        return m_dirty.size();
+    }
+
+    /// 重算所有脏的公式。
+    /// @return 重算的公式数
+    size_t Recalculate();
+
+  private:
+    enum class OpCode : uint8_t
+    {
+        Number,
+        Bool,
+        Cell,
+        Range,
+        Negate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Call,
+    };
+
+    // 逆波兰式的一条指令
+    struct Op
+    {
+        OpCode code;
+        uint8_t function;
+        uint16_t argc;
+        union {
+            double number;
+            struct
+            {
+                uint32_t row, column, last_row, last_column;
+            } ref;
+        };
+    };
+
+    struct Compiled
+    {
+        std::string text;
+        std::vector<Op> code;
+        // 求值栈需要的深度
+        size_t stack_size = 0;
+        uint64_t cell = 0;
+        bool live = false;
+        bool dirty = false;
+        // 工作表里的结果是错误，而不是内容相同的文本
+        bool error = false;
+    };
+
+    // 区域引用在一列上的部分
+    struct RangeDependency
+    {
+        uint32_t first_row;
+        uint32_t last_row;
+        FormulaId formula;
+    };
+
+    class Parser;
+    struct Value;
+
+    static uint64_t CellKey(uint32_t row, uint32_t column)
+    {
+        return (uint64_t{column} << 32) | row;
+    }
+
+    static Hash HashOf(uint64_t cell);
+
+    // 公式引用的单元格，去掉重复的，不包括区域
+    static std::vector<uint64_t> ReferencedCells(std::vector<Op> const &code);
+
+    // 登记或注销公式 id 对其它单元格的引用
+    void Link(FormulaId id);
+    void Unlink(FormulaId id);
+    void Remove(uint64_t cell);
+
+    // 把引用了 cell 的公式以及它们的下游都标记为脏
+    void MarkDependents(uint64_t cell);
+    void MarkFormulaDirty(FormulaId id);
+
+    template <typename F> void ForEachDependent(uint64_t cell, F &&visit) const;
+
+    Value Evaluate(Compiled const &formula) const;
+    Value Read(uint32_t row, uint32_t column) const;
+    // 单元格 cell 是公式算出的错误时，错误的种类
+    std::optional<uint32_t> ErrorIn(uint32_t row, uint32_t column, CellValue cell) const;
+    Value Aggregate(uint8_t function, Value const *args, size_t argc, std::vector<Op> const &code) const;
+    int Compare(Value const &a, Value const &b) const;
+    CellValue Store(Value const &value) const;
+
+  private:
+    Worksheet *m_sheet;
+    ThreadPool *m_pool;
+    std::vector<Compiled> m_formulas;
+    std::vector<FormulaId> m_free;
+    // 单元格到它的公式
+    HashTable<FormulaId> m_ids;
+    // 单元格到引用它的公式
+    HashTable<std::vector<FormulaId>> m_dependents;
+    // 每列上的区域引用
+    std::vector<std::vector<RangeDependency>> m_ranges;
+    std::vector<FormulaId> m_dirty;
+    // 重算期间每个脏公式还没算完的依赖数，其余时候全是 0
+    std::vector<uint32_t> m_pending;
+    // 各种错误的字符串编号
+    StringId m_errors[4];
+};
+
+} // namespace llama
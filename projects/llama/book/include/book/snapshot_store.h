@@ -0,0 +1,30 @@
+/// @file
+/// 把工作簿的快照按内容存进对象仓库，作为可以取回的版本。
+
+#pragma once
+#include "book/config.h"
+#include "book/workbook.h"
+#include "foundation/hash.h"
+#include "foundation/object.h"
+
+namespace llama
+{
+
+/// 把 `snapshot` 存进 `store` ，返回这个版本的哈希，也就是它的身份：内容相同的两个版本哈希相同。
+///
+/// 版本由四种对象组成：单元格块、工作表、每页 4096 个字符串的字符串页，以及引用它们的版本对象本身，
+/// 都以内容哈希为键。和之前存过的版本相同的块、工作表和写满的字符串页已经在仓库里，不会再存一份；
+/// 块的哈希缓存在块里，没有改过的块也不会再算。所以连续存放编辑中的工作簿时，每个版本只多占改过的那几块。
+/// 存入的块和快照共用，不复制。
+/// @note 版本对象不会自动成为根，需要保留的版本由调用者 `ObjectStore::AddRoot`
+LLAMA_BOOK_API Hash StoreSnapshot(WorkbookSnapshot const &snapshot, ObjectStore &store);
+
+/// 从 `store` 取回哈希为 `version` 的版本。单元格块和仓库共用，编辑时才复制。
+///
+/// 字符串按原来的编号放进新的字符串池。工作表的行数上界按块里的单元格重新计算，
+/// 所以可能比存放时的 `Worksheet::RowCount` 小。
+/// @exception 如果有对象不存在，抛出 `ExceptionKind::ElementDoesNotExist` ；
+/// 如果对象的类型或者内容不对，抛出 `ExceptionKind::InvalidArchive`
+LLAMA_BOOK_API Workbook LoadSnapshot(ObjectStore &store, Hash const &version);
+
+} // namespace llama
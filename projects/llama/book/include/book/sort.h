@@ -0,0 +1,110 @@
+/// @file
+/// 工作表区域的排序和筛选。
+
+#pragma once
+#include "book/cell.h"
+#include "book/config.h"
+#include "book/worksheet.h"
+#include "foundation/thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace llama
+{
+
+/// 排序的一个键：按第 `column` 列的值排序。
+struct SortKey
+{
+    uint32_t column = 0;
+    bool descending = false;
+};
+
+/// 工作表里一段行的排列：第 i 项是排在第 i 位的行的行号。排序和筛选只改变排列，不移动单元格。
+///
+/// 结果是惰性的：通过 `Get` 按新的顺序读单元格，只有调用 `Apply` 时才真的把单元格写回工作表。
+/// 所以同一个区域可以按不同的键反复排序、筛选，代价只和行数有关，和列数无关。
+///
+/// ```
+/// RowOrder order{1, sheet.RowCount() - 1};
+/// SortKey keys[] = {{2}, {0, true}};
+/// order.Sort(sheet, keys, &pool);
+/// order.Filter([&](uint32_t row) { return sheet.Get(row, 3).Type() == CellType::Number; });
+/// order.Apply(sheet, 0, 5);
+/// ```
+class LLAMA_BOOK_API RowOrder
+{
+  public:
+    /// 空的排列，不对应任何行
+    RowOrder() = default;
+
+    /// 第 `first_row` 到 `last_row` 行（包含），按原来的顺序。`first_row` 大于 `last_row` 时为空。
+    /// @exception 如果行号超出 `Worksheet::kMaxRows` ，抛出 `ExceptionKind::IndexOutofRange`
+    RowOrder(uint32_t first_row, uint32_t last_row);
+
+    uint32_t FirstRow() const
+    {
+        return m_first_row;
+    }
+
+    uint32_t LastRow() const
+    {
+        return m_last_row;
+    }
+
+    /// 排列里的行数。筛选之后可能比区域的行数少。
+    size_t Size() const
+    {
+        return m_rows.size();
+    }
+
+    /// 排在第 `index` 位的行的行号
+    uint32_t operator[](size_t index) const
+    {
+        return m_rows[index];
+    }
+
+    std::span<const uint32_t> Rows() const
+    {
+        return m_rows;
+    }
+
+    /// 排在第 `index` 位的行里第 `column` 列的值
+    CellValue Get(Worksheet const &sheet, size_t index, uint32_t column) const
+    {
+        return sheet.Get(m_rows[index], column);
+    }
+
+    /// 按 `keys` 对排列里的行做稳定排序：先比第一个键，相同时再比第二个，依此类推，全都相同时保持现在的顺序。
+    /// 所以先按次要的键排、再按主要的键排，和一次按两个键排的结果相同。
+    ///
+    /// 和常见电子表格一致，升序时数字在前，然后是文本、布尔值，空单元格总在最后；降序时除了空单元格都反过来。
+    /// 数字按值比较；文本按字节比较，也就是区分大小写。
+    ///
+    /// 每个键先按列逐块取出，变成可以按位比较的 64 位编码和一个类别，字符串换成按文本排序后的名次。
+    /// 然后从最后一个键开始，每个键做一遍基数排序，只处理编码里不全相同的字节，每遍 O(n) 。
+    /// 给了 `pool` 并且行数足够多时，切成几段在线程池上分别排序，再两两并行归并：
+    /// 每次归并按输出位置切成若干份，用二分查找定出每份的起点，所以最后几轮也能用上所有线程。
+    /// @exception 如果键的列号超出 `Worksheet::kMaxColumns` ，抛出 `ExceptionKind::IndexOutofRange`
+    void Sort(Worksheet const &sheet, std::span<const SortKey> keys, ThreadPool *pool = nullptr);
+
+    /// 只保留 `keep(row)` 为真的行，顺序不变。
+    template <typename F> void Filter(F &&keep)
+    {
+        std::erase_if(m_rows, [&](uint32_t row) { return !keep(row); });
+    }
+
+    /// 把单元格按排列写回工作表的第 `first_column` 到 `last_column` 列：排在第 i 位的行写到区域的第 i 行，
+    /// 筛选掉的行留下的空位在区域末尾清空。之后这个排列就不再对应工作表里的内容了。
+    /// @exception 如果列号超出 `Worksheet::kMaxColumns` ，抛出 `ExceptionKind::IndexOutofRange`
+    void Apply(Worksheet &sheet, uint32_t first_column, uint32_t last_column) const;
+
+  private:
+    // 首行大于末行时区域里没有行
+    uint32_t m_first_row = 1;
+    uint32_t m_last_row = 0;
+    std::vector<uint32_t> m_rows;
+};
+
+} // namespace llama
@@ -0,0 +1,89 @@
+/// @file
+/// 工作簿的字符串池。
+
+#pragma once
+#include "book/cell.h"
+#include "book/config.h"
+#include "foundation/hash_table.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace llama
+{
+
+/// 工作簿范围的字符串池。相同的字符串只存一份，单元格里只记它的编号。
+/// 编号从 0 开始连续分配，存放期间不会改变，所以比较两个字符串单元格是否相等、按文本分组都只需要比较编号。
+///
+/// 字符串的内容依次放进大块的缓冲区，不逐个分配；按编号查字符串是两次数组访问。
+/// 按内容查编号用以内容哈希为键的 `HashTable` ，每个字符串只多占一个槽位。
+/// 命中之后还要比较文本；哈希冲突时把键换成下一个探测键接着找，所以不同的字符串总是得到不同的编号。
+///
+/// 编号到字符串的表按页分配，页和字符串的内容都不会移动，页表换新的时候旧的也留着，
+/// 所以 `Get` 不加锁也可以和 `Intern` 同时调用，工作簿的快照在别的线程上读字符串时靠的就是这一点。
+/// @note 除了 `Get` 和 `Size` 可以和一个写的线程并发，不是线程安全的。
+class LLAMA_BOOK_API StringPool
+{
+  public:
+    /// 计算字符串哈希的函数
+    using Hasher = Hash (*)(std::string_view text);
+
+    StringPool() = default;
+
+    /// 用 `hasher` 代替默认的 128 位哈希，测试里用它制造冲突
+    explicit StringPool(Hasher hasher) : m_hasher{hasher}
+    {
+    }
+
+    StringPool(StringPool const &) = delete;
+    StringPool &operator=(StringPool const &) = delete;
+
+    /// 字符串 `text` 的编号。第一次出现时分配新的编号。
+    StringId Intern(std::string_view text);
+
+    /// 字符串 `text` 的编号。不在池里时为空，不会分配新的编号。
+    std::optional<StringId> Find(std::string_view text) const;
+
+    /// 编号为 `id` 的字符串。视图在字符串池销毁之前一直有效。
+    /// @exception 如果编号不存在，抛出 `ExceptionKind::IndexOutofRange`
+    std::string_view Get(StringId id) const;
+
+    /// 字符串的个数
+    size_t Size() const
+    {
+        return m_size.load(std::memory_order_acquire);
+    }
+
+    /// 字符串池占用的字节数
+    size_t MemoryUsage() const;
+
+  private:
+    // 默认的哈希函数
+    static Hash DefaultHash(std::string_view text);
+
+    // text 的编号。不在池里时为空，key 是第一个找不到的探测键，插入时就用它
+    std::optional<StringId> Lookup(std::string_view text, Hash &key) const;
+
+    // 把 text 复制到缓冲区里，返回指向副本的视图
+    std::string_view Store(std::string_view text);
+
+  private:
+    Hasher m_hasher = &DefaultHash;
+    // 缓冲区只追加不移动，视图一直有效
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char *m_cursor = nullptr;
+    size_t m_remaining = 0;
+    size_t m_allocated = 0;
+    // 编号到字符串的页。m_table 是当前的页表，指向 m_tables 的最后一张；旧的页表不释放，读者可能还在用
+    std::vector<std::unique_ptr<std::string_view[]>> m_pages;
+    std::vector<std::unique_ptr<std::string_view *[]>> m_tables;
+    size_t m_table_capacity = 0;
+    std::atomic<std::string_view *const *> m_table{nullptr};
+    std::atomic<size_t> m_size{0};
+    HashTable<StringId> m_ids;
+};
+
+} // namespace llama
@@ -1,10 +1,152 @@
+/// @file
+/// 工作簿。
+
 #pragma once
+#include "book/config.h"
+#include "book/string_pool.h"
+#include "book/worksheet.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace llama
 {
 
-class Workbook
+class WorkbookSnapshot;
+
+/// 工作簿：有序的一组工作表，以及它们共用的字符串池。
+/// @note 不是线程安全的。需要在编辑的同时从别的线程读时，给读的线程一个 `Snapshot` 。
+class LLAMA_BOOK_API Workbook
 {
+  public:
+    Workbook();
+    ~Workbook();
+
+    Workbook(Workbook const &) = delete;
+    Workbook &operator=(Workbook const &) = delete;
+    Workbook(Workbook &&) noexcept;
+    Workbook &operator=(Workbook &&) noexcept;
+
+    /// 在末尾添加名为 `name` 的空工作表。
+    /// @exception 如果同名的工作表已经存在，抛出 `ExceptionKind::ElementAlreadyExists`
+    Worksheet &AddSheet(std::string name);
+
+    /// 删除第 `index` 个工作表。之后的工作表依次前移。
+    /// @exception 如果 `index` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    void RemoveSheet(size_t index);
+
+    size_t SheetCount() const
+    {
+        return m_sheets.size();
+    }
+
+    /// 第 `index` 个工作表。
+    /// @exception 如果 `index` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    Worksheet &Sheet(size_t index);
+    Worksheet const &Sheet(size_t index) const;
+
+    /// 名为 `name` 的工作表。不存在时为空。
+    Worksheet *FindSheet(std::string_view name);
+
+    /// 第 `sheet` 个工作表上 `range` 里的数字的聚合结果，见 `Worksheet::Aggregate` 。
+    /// @exception 如果 `sheet` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    RangeAggregate Aggregate(size_t sheet, CellRange const &range, ThreadPool *pool = nullptr) const
+    {
+        return Sheet(sheet).Aggregate(range, pool);
+    }
+
+    /// 第 `sheet` 个工作表的第 `column` 列里等于 `value` 的行，见 `Worksheet::FindRows` 。
+    /// @exception 如果 `sheet` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    std::span<const uint32_t> FindRows(size_t sheet, uint32_t column, CellValue value) const
+    {
+        return Sheet(sheet).FindRows(column, value);
+    }
+
+    /// 第 `sheet` 个工作表的第 `column` 列里数字在 [`low`, `high`] 之间的行，见 `Worksheet::FindRowsBetween` 。
+    /// @exception 如果 `sheet` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    std::vector<uint32_t> FindRowsBetween(size_t sheet, uint32_t column, double low, double high) const
+    {
+        return Sheet(sheet).FindRowsBetween(column, low, high);
+    }
+
+    /// 精确查找，类似 `VLOOKUP(key, ..., FALSE)` ：第 `sheet` 个工作表的第 `key_column` 列里第一个等于 `key` 的行上，
+    /// 第 `result_column` 列的值。找不到时为空。用 `key_column` 上的哈希索引，不扫描整列。
+    /// @exception 如果 `sheet` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    CellValue Lookup(size_t sheet, uint32_t key_column, CellValue key, uint32_t result_column) const;
+
+    /// 按文本精确查找，区分大小写。字符串池里没有 `key` 时直接返回空，不会把它加进池里。
+    /// @exception 如果 `sheet` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    CellValue Lookup(size_t sheet, uint32_t key_column, std::string_view key, uint32_t result_column) const;
+
+    /// 当前内容的只读快照，不复制单元格。
+    ///
+    /// 每个工作表用 `Worksheet::Clone` 共用全部的块，所以快照的代价只和工作表的个数有关。
+    /// 之后的编辑只复制写到的块，快照一直看到拍下时的内容，可以在别的线程上读，不需要加锁。
+    /// 快照和工作簿共用字符串池，并让它活到快照销毁。
+    WorkbookSnapshot Snapshot() const;
+
+    StringPool &Strings()
+    {
+        return *m_strings;
+    }
+
+    StringPool const &Strings() const
+    {
+        return *m_strings;
+    }
+
+  private:
+    // 工作表记着字符串池的地址，单独分配，移动工作簿时地址不变
+    std::shared_ptr<StringPool> m_strings;
+    std::vector<std::unique_ptr<Worksheet>> m_sheets;
+};
+
+/// 工作簿某一时刻的只读快照，由 `Workbook::Snapshot` 创建。
+///
+/// 工作表和字符串池都只能读。几个线程可以同时读一个快照，也可以和工作簿的编辑同时进行；
+/// 但工作表的 `FindRows` 这类会建立索引的查询和其他调用之间仍然不能并发。
+class LLAMA_BOOK_API WorkbookSnapshot
+{
+  public:
+    WorkbookSnapshot(WorkbookSnapshot &&) noexcept = default;
+    WorkbookSnapshot &operator=(WorkbookSnapshot &&) noexcept = default;
+
+    size_t SheetCount() const
+    {
+        return m_sheets.size();
+    }
+
+    /// 第 `index` 个工作表。
+    /// @exception 如果 `index` 越界，抛出 `ExceptionKind::IndexOutofRange`
+    Worksheet const &Sheet(size_t index) const;
+
+    /// 名为 `name` 的工作表。不存在时为空。
+    Worksheet const *FindSheet(std::string_view name) const;
+
+    /// 字符串池。快照里的字符串编号都小于 `StringCount` ，池里之后加的字符串不属于这个快照。
+    StringPool const &Strings() const
+    {
+        return *m_strings;
+    }
+
+    /// 拍快照时字符串池里的字符串个数
+    size_t StringCount() const
+    {
+        return m_string_count;
+    }
+
+  private:
+    friend class Workbook;
+    WorkbookSnapshot() = default;
 
+  private:
+    std::shared_ptr<StringPool> m_strings;
+    size_t m_string_count = 0;
+    std::vector<std::unique_ptr<Worksheet>> m_sheets;
 };
 
-}
\ No newline at end of file
+} // namespace llama
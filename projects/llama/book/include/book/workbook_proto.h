@@ -0,0 +1,158 @@
+/// @file
+/// workbook.proto 格式的流式读写。
+
+#pragma once
+#include "book/cell.h"
+#include "book/config.h"
+#include "book/workbook.h"
+#include "foundation/archive.h"
+#include "foundation/exceptions.h"
+#include "foundation/thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string_view>
+
+namespace llama
+{
+
+/// workbook.proto 里的一个单元格。读到的字符串指向输入的缓冲区。
+struct ProtoCell
+{
+    uint32_t row = 0;
+    uint32_t column = 0;
+    CellType type = CellType::Empty;
+    double number = 0;
+    bool boolean = false;
+    std::string_view text;
+};
+
+/// 流式读取 workbook.proto 格式的工作簿。
+///
+/// 输入通常是映射的文件：读取器不复制数据，也不一次解析出所有单元格，
+/// 而是用 `NextSheet` 和 `NextCell` 逐个取出，内存占用和文件大小无关。
+/// 不认识的字段按 protobuf 的规则跳过。
+/// @exception 所有的 `Next` 在数据不完整时抛出 `ExceptionKind::InvalidArchive` ，
+/// 在不是 protobuf 编码时抛出 `ExceptionKind::InvalidFileFormat`
+class LLAMA_BOOK_API WorkbookProtoReader
+{
+  public:
+    /// `data` 必须比读取器和读到的字符串活得久
+    explicit WorkbookProtoReader(std::span<const std::byte> data);
+
+    /// 前进到下一个工作表。当前工作表里还没有读的单元格被跳过。
+    /// @return 是否还有工作表
+    bool NextSheet();
+
+    /// 当前工作表的名字
+    std::string_view SheetName() const
+    {
+        return m_sheet_name;
+    }
+
+    /// 当前工作表的编码，不包括外层的标签和长度。可以交给 `ReadSheetProto` 单独解析。
+    std::span<const std::byte> SheetBytes() const
+    {
+        return m_sheet_bytes;
+    }
+
+    /// 读出当前工作表的下一个单元格。
+    /// @return 是否还有单元格
+    bool NextCell(ProtoCell &cell);
+
+  private:
+    ArchiveReader m_workbook;
+    ArchiveReader m_sheet{{}};
+    std::span<const std::byte> m_sheet_bytes;
+    std::string_view m_sheet_name;
+};
+
+/// 流式写出 workbook.proto 格式的工作簿。
+///
+/// 单元格先攒在一个有上限的缓冲区里，满了就写到 `out` 。protobuf 要求工作表的长度写在内容前面，
+/// 所以 `BeginSheet` 先留出定长的位置，`EndSheet` 时再回去补上，不需要把整个工作表放在内存里。
+class LLAMA_BOOK_API WorkbookProtoWriter
+{
+  public:
+    /// 缓冲区达到这个大小时写到输出流
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    /// `out` 必须可以定位（`seekp`），例如文件或者字符串流。
+    explicit WorkbookProtoWriter(std::ostream &out);
+
+    WorkbookProtoWriter(WorkbookProtoWriter const &) = delete;
+    WorkbookProtoWriter &operator=(WorkbookProtoWriter const &) = delete;
+
+    /// 开始名为 `name` 的工作表。
+    /// @exception 如果上一个工作表还没有结束，抛出 `ExceptionKind::InvalidState`
+    void BeginSheet(std::string_view name);
+
+    /// 写出当前工作表的一个单元格。空单元格被忽略。
+    /// @exception 如果不在工作表里，抛出 `ExceptionKind::InvalidState`
+    void WriteCell(ProtoCell const &cell);
+
+    /// 原样写出已经编码好的若干个单元格，格式和 `WriteCell` 写出的相同：每个都是一个 `Sheet.cells` 字段。
+    /// 用来在别的线程上编码单元格，再按顺序写进来。
+    /// @exception 如果不在工作表里，抛出 `ExceptionKind::InvalidState`
+    /// @exception 如果写入失败，抛出 `ExceptionKind::IoError`
+    void WriteEncodedCells(std::span<const std::byte> cells);
+
+    /// 结束当前工作表，补上它的长度。
+    /// @exception 如果不在工作表里，抛出 `ExceptionKind::InvalidState`
+    /// @exception 如果写入失败，抛出 `ExceptionKind::IoError`
+    void EndSheet();
+
+    /// 把缓冲的数据写到输出流。
+    /// @exception 如果还有工作表没有结束，抛出 `ExceptionKind::InvalidState`
+    /// @exception 如果写入失败，抛出 `ExceptionKind::IoError`
+    void Finish();
+
+  private:
+    void FlushBuffer();
+
+  private:
+    std::ostream &m_out;
+    // 构造时输出流的位置，以及之后写到输出流的字节数
+    std::streampos m_base;
+    uint64_t m_flushed = 0;
+    ArchiveWriter m_buffer;
+    // 序列化单个单元格用
+    ArchiveWriter m_cell;
+
+    bool m_in_sheet = false;
+    // 当前工作表长度的位置，以及内容的起点，都相对于 m_base
+    uint64_t m_length_offset = 0;
+    uint64_t m_content_offset = 0;
+};
+
+/// 把 `SheetBytes` 取出的一个工作表的单元格写到 `sheet` 里。
+/// @exception 同 `WorkbookProtoReader::NextCell`
+LLAMA_BOOK_API void ReadSheetProto(std::span<const std::byte> bytes, Worksheet &sheet);
+
+/// 把 `data` 里 workbook.proto 格式的工作簿读到 `book` 里，工作表追加在已有的之后。
+///
+/// 给了 `pool` 时各个工作表在线程池上并行解析：每个任务把单元格读到自己的工作表和字符串池里，
+/// 互不加锁；全部解析完之后按文件里的顺序把字符串并入工作簿的字符串池，单元格整块搬过去。
+/// 合并时按每个工作表里字符串第一次出现的顺序分配编号，所以结果和串行读取完全相同，包括字符串的编号。
+/// @exception 同 `WorkbookProtoReader` ；工作表重名时抛出 `ExceptionKind::ElementAlreadyExists`
+/// @note 并行读取时先检查重名，再解析全部工作表，出错时不会添加任何工作表
+LLAMA_BOOK_API void ReadWorkbookProto(std::span<const std::byte> data, Workbook &book, ThreadPool *pool = nullptr);
+
+/// 通过内存映射读取文件 `path` 。
+/// @exception 如果文件无法读取，抛出 `ExceptionKind::IoError` ；其他同 `ReadWorkbookProto`
+LLAMA_BOOK_API Workbook LoadWorkbookProto(std::filesystem::path const &path, ThreadPool *pool = nullptr);
+
+/// 并行写出 workbook.proto 时，同时在内存里的编码最多的字节数
+inline constexpr size_t kProtoWriteBudget = 8 * 1024 * 1024;
+
+/// 把 `book` 写成 workbook.proto 格式。单元格按列、列内按行的顺序写出。
+///
+/// 给了 `pool` 时按列里的块切分，每次取一批块在线程池上并行编码到各自的缓冲区，再按顺序写到 `out` 。
+/// 一批块的编码按上界估计不超过 `kProtoWriteBudget` 字节（只有单独一块就超过时例外），
+/// 所以和串行写出一样，内存占用和工作表的大小无关。输出和串行写出的逐字节相同。
+/// @exception 如果写入失败，抛出 `ExceptionKind::IoError`
+LLAMA_BOOK_API void WriteWorkbookProto(Workbook const &book, std::ostream &out, ThreadPool *pool = nullptr);
+
+} // namespace llama
@@ -0,0 +1,179 @@
+/// @file
+/// 工作表。
+
+#pragma once
+#include "book/aggregate.h"
+#include "book/cell.h"
+#include "book/column.h"
+#include "book/column_index.h"
+#include "book/config.h"
+#include "book/string_pool.h"
+#include "foundation/exceptions.h"
+#include "foundation/thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace llama
+{
+
+/// 工作表：按列存放的单元格。
+///
+/// 每一列是一个 `Column` ，单元格按行分块存放，读写任意单元格都是 O(1) 。
+/// 字符串存放在工作簿的 `StringPool` 里，单元格里只有编号。
+/// @note 不是线程安全的。
+class LLAMA_BOOK_API Worksheet
+{
+  public:
+    /// 最大行数
+    static constexpr uint32_t kMaxRows = 1u << 28;
+    /// 最大列数
+    static constexpr uint32_t kMaxColumns = 1u << 14;
+
+    /// 由 `Workbook::AddSheet` 创建。`strings` 必须比工作表活得久。
+    Worksheet(std::string name, StringPool &strings);
+
+    Worksheet(Worksheet const &) = delete;
+    Worksheet &operator=(Worksheet const &) = delete;
+
+    /// 内容相同的副本，和这个工作表用同一个字符串池。
+    ///
+    /// 不复制单元格，是 O(1) 的：两者共用所有的块，之后哪一边写到某一块，就只复制这一块（写时复制）。
+    /// 所以副本可以交给别的线程读，这边照常编辑；两边都不会看到对方之后的修改。索引不复制。
+    /// @note 两边都写字符串时共用的字符串池不是线程安全的
+    std::unique_ptr<Worksheet> Clone() const;
+
+    std::string const &Name() const
+    {
+        return m_name;
+    }
+
+    /// 单元格 (`row`, `column`) 的值。超出已有的范围时为空。
+    CellValue Get(uint32_t row, uint32_t column) const
+    {
+        if (column >= m_cells->columns.size())
+            return CellValue{};
+        return m_cells->columns[column].Get(row);
+    }
+
+    /// 把单元格 (`row`, `column`) 设为 `value` 。`value` 为空时清除单元格。
+    /// @exception 如果行或列超出上限，抛出 `ExceptionKind::IndexOutofRange`
+    void Set(uint32_t row, uint32_t column, CellValue value);
+
+    void SetNumber(uint32_t row, uint32_t column, double value)
+    {
+        Set(row, column, CellValue::Number(value));
+    }
+
+    void SetBool(uint32_t row, uint32_t column, bool value)
+    {
+        Set(row, column, CellValue::Bool(value));
+    }
+
+    /// 把单元格设为字符串 `text` 。字符串放进工作簿的字符串池。
+    void SetText(uint32_t row, uint32_t column, std::string_view text)
+    {
+        Set(row, column, CellValue::String(m_strings->Intern(text)));
+    }
+
+    void Clear(uint32_t row, uint32_t column)
+    {
+        Set(row, column, CellValue{});
+    }
+
+    /// 字符串单元格的内容。不是字符串时为空。
+    std::string_view Text(uint32_t row, uint32_t column) const;
+
+    /// 第 `column` 列。没有单元格的列可能为空。
+    Column const *FindColumn(uint32_t column) const
+    {
+        return column < m_cells->columns.size() ? &m_cells->columns[column] : nullptr;
+    }
+
+    /// 换上第 `column` 列的第 `index` 块，用于从文件加载。块里的字符串编号必须属于这个工作表的字符串池。
+    /// @exception 如果行或列超出上限，抛出 `ExceptionKind::IndexOutofRange`
+    void SetChunk(uint32_t column, size_t index, std::shared_ptr<ColumnChunk> chunk);
+
+    /// 取走第 `column` 列的第 `index` 块，用于把单元格整块搬到别的工作表。行数的上界不变。
+    std::shared_ptr<ColumnChunk> TakeChunk(uint32_t column, size_t index);
+
+    /// 非空的单元格数
+    size_t CellCount() const;
+
+    /// 行数的上界：存放过单元格的最大行号加一。清除单元格不会让它变小。
+    uint32_t RowCount() const
+    {
+        return m_cells->row_count;
+    }
+
+    /// 列数的上界：存放过单元格的最大列号加一。
+    uint32_t ColumnCount() const
+    {
+        return uint32_t(m_cells->columns.size());
+    }
+
+    StringPool &Strings() const
+    {
+        return *m_strings;
+    }
+
+    /// `range` 里的数字的聚合结果。
+    ///
+    /// 按列和每列上连续的若干块切成任务，给了 `pool` 时在线程池上并行计算。
+    /// 各部分按固定的顺序合并，所以结果和是否并行、用几个线程无关。
+    RangeAggregate Aggregate(CellRange const &range, ThreadPool *pool = nullptr) const;
+
+    /// 第 `column` 列里等于 `value` 的行，按行号升序。
+    ///
+    /// 第一次查询时给这一列建立哈希索引，之后每次查找是 O(1) 。
+    /// 编辑过的单元格在下一次查询时并入索引，见 `ColumnIndex` 。
+    /// 返回的视图在下一次编辑或者查询之前有效。
+    /// @note 查询会建立和更新索引，所以即使是 const 的，也不能和其他调用并发
+    std::span<const uint32_t> FindRows(uint32_t column, CellValue value) const;
+
+    /// 第 `column` 列里数字在 [`low`, `high`] 之间的行，按数字升序，数字相同的按行号升序。
+    ///
+    /// 第一次查询时给这一列建立有序索引，之后每次查找是 O(log n) 加上结果的个数。
+    /// @note 同 `FindRows`
+    std::vector<uint32_t> FindRowsBetween(uint32_t column, double low, double high) const;
+
+    /// 丢掉所有的索引，释放它们占用的内存。之后的查询重新建立。
+    void DropIndexes()
+    {
+        m_indexes.clear();
+        m_indexes.shrink_to_fit();
+    }
+
+    /// 单元格占用的字节数，不包括字符串池和索引。
+    size_t MemoryUsage() const;
+
+    /// 索引占用的字节数
+    size_t IndexMemoryUsage() const;
+
+  private:
+    // 单元格和行数的上界。可以和别的工作表共用，写之前先用 Mutable 换成自己的
+    struct Cells
+    {
+        std::vector<Column> columns;
+        uint32_t row_count = 0;
+    };
+
+    // 要写单元格了：还和别处共用时先复制列表，块本身仍然共用，写到哪块时再复制哪块
+    Cells &Mutable();
+
+    // 第 column 列的索引，没有时建立。column 必须小于列数
+    ColumnIndex &IndexOf(uint32_t column) const;
+
+  private:
+    std::string m_name;
+    StringPool *m_strings;
+    std::shared_ptr<Cells> m_cells;
+    // 只有查询过的列才有索引。整块换掉单元格时直接丢掉这一列的索引
+    mutable std::vector<std::unique_ptr<ColumnIndex>> m_indexes;
+};
+
+} // namespace llama
@@ -1,5 +1,37 @@
+list(APPEND SOURCE_LIST "src/aggregate.cpp")
+list(APPEND SOURCE_LIST "src/binary_workbook.cpp")
 list(APPEND SOURCE_LIST "src/book.cpp")
+list(APPEND SOURCE_LIST "src/column.cpp")
+list(APPEND SOURCE_LIST "src/column_index.cpp")
+list(APPEND SOURCE_LIST "src/formula.cpp")
+list(APPEND SOURCE_LIST "src/snapshot_store.cpp")
+list(APPEND SOURCE_LIST "src/sort.cpp")
+list(APPEND SOURCE_LIST "src/string_pool.cpp")
+list(APPEND SOURCE_LIST "src/workbook.cpp")
+list(APPEND SOURCE_LIST "src/workbook_proto.cpp")
+list(APPEND SOURCE_LIST "src/worksheet.cpp")
+list(APPEND SOURCE_LIST "include/book/aggregate.h")
+list(APPEND SOURCE_LIST "include/book/binary_workbook.h")
 list(APPEND SOURCE_LIST "include/book/book.h")
+list(APPEND SOURCE_LIST "include/book/cell.h")
+list(APPEND SOURCE_LIST "include/book/column.h")
+list(APPEND SOURCE_LIST "include/book/column_index.h")
+list(APPEND SOURCE_LIST "include/book/config.h")
+list(APPEND SOURCE_LIST "include/book/formula.h")
+list(APPEND SOURCE_LIST "include/book/snapshot_store.h")
+list(APPEND SOURCE_LIST "include/book/sort.h")
+list(APPEND SOURCE_LIST "include/book/string_pool.h")
 list(APPEND SOURCE_LIST "include/book/workbook.h")
+list(APPEND SOURCE_LIST "include/book/workbook_proto.h")
+list(APPEND SOURCE_LIST "include/book/worksheet.h")
 list(APPEND PROTO_LIST "include/book/workbook.proto")
+list(APPEND TEST_SOURCE_LIST "test/aggregate_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/binary_workbook_test.cpp")
 list(APPEND TEST_SOURCE_LIST "test/book_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/column_index_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/column_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/formula_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/snapshot_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/sort_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/string_pool_test.cpp")
+list(APPEND TEST_SOURCE_LIST "test/workbook_proto_test.cpp")
@@ -0,0 +1,179 @@
+#include "book/aggregate.h"
+#include "foundation/cpu_features.h"
+#include <algorithm>
+#include <bit>
+
+namespace llama
+{
+
+namespace
+{
+
+constexpr uint64_t kAllRows = ~uint64_t{0};
+
+// 第 word 个字里落在 [begin, end) 的行
+uint64_t RowMask(uint32_t word, uint32_t begin, uint32_t end)
+{
+    uint32_t lo = std::max(begin, word * 64) - word * 64;
+    uint32_t hi = std::min(end, word * 64 + 64) - word * 64;
+    uint64_t mask = hi == 64 ? kAllRows : (uint64_t{1} << hi) - 1;
+    return mask & (kAllRows << lo);
+}
+
+/*  _____________________________  */
+/*             标 量               */
+/*  _____________________________  */
+
+void AggregateScalar(ColumnChunkView const &chunk, uint32_t begin, uint32_t end, RangeAggregate &out)
+{
+    for (uint32_t word = begin / 64; word < (end + 63) / 64; word++)
+    {
+        uint64_t bits = chunk.number_bits[word] & RowMask(word, begin, end);
+        if (bits == 0)
+            continue;
+        double const *numbers = chunk.numbers + size_t(word) * 64;
+        out.count += size_t(std::popcount(bits));
+        if (bits == kAllRows)
+        {
+            for (uint32_t i = 0; i < 64; i++)
+            {
+                out.sum += numbers[i];
+                out.min = std::min(out.min, numbers[i]);
+                out.max = std::max(out.max, numbers[i]);
+            }
+            continue;
+        }
+        for (; bits != 0; bits &= bits - 1)
+        {
+            double number = numbers[std::countr_zero(bits)];
+            out.sum += number;
+            out.min = std::min(out.min, number);
+            out.max = std::max(out.max, number);
+        }
+    }
+}
+
+#ifdef LLAMA_SIMD_X86
+
+/*  _____________________________  */
+/*             AVX2                */
+/*  _____________________________  */
+
+LLAMA_TARGET_AVX2 void AggregateAvx2(ColumnChunkView const &chunk, uint32_t begin, uint32_t end, RangeAggregate &out)
+{
+    const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d neg_inf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    const __m256i lane_bits = _mm256_setr_epi64x(1, 2, 4, 8);
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    __m256d min0 = inf, min1 = inf;
+    __m256d max0 = neg_inf, max1 = neg_inf;
+
+    for (uint32_t word = begin / 64; word < (end + 63) / 64; word++)
+    {
+        uint64_t bits = chunk.number_bits[word] & RowMask(word, begin, end);
+        if (bits == 0)
+            continue;
+        double const *numbers = chunk.numbers + size_t(word) * 64;
+        out.count += size_t(std::popcount(bits));
+        if (bits == kAllRows)
+        {
+            // 两组累加器交替使用，缩短加法的依赖链
+            for (uint32_t i = 0; i < 64; i += 8)
+            {
+                __m256d a = _mm256_loadu_pd(numbers + i);
+                __m256d b = _mm256_loadu_pd(numbers + i + 4);
+                sum0 = _mm256_add_pd(sum0, a);
+                sum1 = _mm256_add_pd(sum1, b);
+                // 有 NaN 时 min/max 返回第二个操作数，所以新的值放在前面：NaN 被跳过，和标量的 std::min 一致
+                min0 = _mm256_min_pd(a, min0);
+                min1 = _mm256_min_pd(b, min1);
+                max0 = _mm256_max_pd(a, max0);
+                max1 = _mm256_max_pd(b, max1);
+            }
+            continue;
+        }
+        // 每 4 行一组，把位图的 4 位展开成通道掩码
+        for (uint32_t i = 0; i < 64; i += 4)
+        {
+            uint64_t nibble = (bits >> i) & 0xF;
+            if (nibble == 0)
+                continue;
+            __m256d mask = _mm256_castsi256_pd(
+                _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(int64_t(nibble)), lane_bits), lane_bits));
+            __m256d value = _mm256_loadu_pd(numbers + i);
+            sum0 = _mm256_add_pd(sum0, _mm256_and_pd(value, mask));
+            min0 = _mm256_min_pd(_mm256_blendv_pd(inf, value, mask), min0);
+            max0 = _mm256_max_pd(_mm256_blendv_pd(neg_inf, value, mask), max0);
+        }
+    }
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(sum0, sum1));
+    out.sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_store_pd(lanes, _mm256_min_pd(min0, min1));
+    out.min = std::min({out.min, lanes[0], lanes[1], lanes[2], lanes[3]});
+    _mm256_store_pd(lanes, _mm256_max_pd(max0, max1));
+    out.max = std::max({out.max, lanes[0], lanes[1], lanes[2], lanes[3]});
+}
+
+#endif
+
+/*  _____________________________  */
+/*             分 派               */
+/*  _____________________________  */
+
+using Kernel = void (*)(ColumnChunkView const &, uint32_t, uint32_t, RangeAggregate &);
+
+Kernel SelectKernel()
+{
+#ifdef LLAMA_SIMD_X86
+    if (simd::HasAvx2())
+        return AggregateAvx2;
+#endif
+    return AggregateScalar;
+}
+
+// 第一次调用时检测 CPU ，之后不变
+Kernel ActiveKernel()
+{
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+} // namespace
+
+void AggregateChunk(ColumnChunkView const &chunk, uint32_t begin, uint32_t end, RangeAggregate &out)
+{
+    end = std::min(end, ColumnChunk::kRows);
+    if (!chunk || !chunk.numbers || begin >= end)
+        return;
+    ActiveKernel()(chunk, begin, end, out);
+}
+
+void AggregateChunkScalar(ColumnChunkView const &chunk, uint32_t begin, uint32_t end, RangeAggregate &out)
+{
+    end = std::min(end, ColumnChunk::kRows);
+    if (!chunk || !chunk.numbers || begin >= end)
+        return;
+    AggregateScalar(chunk, begin, end, out);
+}
+
+void AggregateColumn(Column const &column, uint32_t first_row, uint32_t last_row, RangeAggregate &out)
+{
+    constexpr uint32_t kRows = ColumnChunk::kRows;
+    if (first_row > last_row)
+        return;
+    size_t chunks = std::min<size_t>(last_row / kRows + 1, column.ChunkCount());
+    for (size_t index = first_row / kRows; index < chunks; index++)
+    {
+        ColumnChunk const *chunk = column.Chunk(index);
+        if (!chunk)
+            continue;
+        uint64_t base = index * kRows;
+        uint32_t begin = uint32_t(std::max<uint64_t>(first_row, base) - base);
+        uint32_t end = uint32_t(std::min<uint64_t>(uint64_t{last_row} + 1 - base, kRows));
+        AggregateChunk(chunk->View(), begin, end, out);
+    }
+}
+
+} // namespace llama
@@ -0,0 +1,436 @@
+#include "book/binary_workbook.h"
+#include "foundation/file_sync.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace llama
+{
+
+static_assert(std::endian::native == std::endian::little, "binary workbook format requires a little-endian host");
+
+namespace
+{
+
+// 文件布局，所有整数都是小端序：
+//
+//   文件头        kHeaderSize 字节，见下面的 kHeader* 偏移
+//   字符串表      string_count + 1 个 u64 偏移，然后是所有字符串的内容
+//   列块          每块 kAlignment 对齐：块头、四张位图、数字数组（可选）、字符串编号数组（可选）
+//   块表          每列 chunk_count 个 u64 ，为块的位置，0 表示空块
+//   列目录        每个工作表 column_count 项，每项 {u64 chunk_count, u64 chunk_table}
+//   工作表名
+//   工作表目录    sheet_count 项，每项 {u64 name, u64 name_size, u64 column_count, u64 column_directory}
+constexpr char kMagic[8] = {'L', 'L', 'B', 'O', 'O', 'K', '0', '1'};
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kHeaderSheetCount = 8;
+constexpr size_t kHeaderSheetDirectory = 16;
+constexpr size_t kHeaderStringCount = 24;
+constexpr size_t kHeaderStringOffsets = 32;
+constexpr size_t kHeaderStringData = 40;
+constexpr size_t kHeaderFileSize = 48;
+
+constexpr size_t kSheetEntrySize = 32;
+constexpr size_t kColumnEntrySize = 16;
+
+// 块头是 {u64 flags, u64 count} ，补齐到 kAlignment ，让后面的数组也对齐
+constexpr size_t kAlignment = 64;
+constexpr size_t kChunkHeaderSize = 64;
+constexpr size_t kBitmapSize = ColumnChunk::kWords * sizeof(uint64_t);
+constexpr size_t kNumbersSize = ColumnChunk::kRows * sizeof(double);
+constexpr size_t kStringsSize = ColumnChunk::kRows * sizeof(StringId);
+constexpr uint64_t kChunkHasNumbers = 1;
+constexpr uint64_t kChunkHasStrings = 2;
+
+uint64_t Load64(const std::byte *p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+[[noreturn]] void Corrupted(const char *what)
+{
+    throw Exception{ExceptionKind::InvalidFileFormat, what};
+}
+
+// 检查 [offset, offset + count * size) 在文件里，并且 offset 按 align 对齐
+const std::byte *Section(std::span<const std::byte> file, uint64_t offset, uint64_t count, uint64_t size,
+                         uint64_t align, const char *what)
+{
+    if (offset % align != 0 || offset > file.size() || count > (file.size() - offset) / size)
+        Corrupted(what);
+    return file.data() + offset;
+}
+
+class FileWriter
+{
+  public:
+    explicit FileWriter(std::filesystem::path const &path) : m_out{path, std::ios::binary | std::ios::trunc}
+    {
+        if (!m_out)
+            throw Exception{ExceptionKind::IoError, "cannot create workbook file"};
+    }
+
+    uint64_t Offset() const
+    {
+        return m_offset;
+    }
+
+    void Write(const void *data, size_t size)
+    {
+        m_out.write(static_cast<const char *>(data), std::streamsize(size));
+        m_offset += size;
+    }
+
+    void Write64(uint64_t value)
+    {
+        Write(&value, sizeof(value));
+    }
+
+    void Align(size_t align)
+    {
+        static constexpr char zeros[kAlignment] = {};
+        Write(zeros, (align - m_offset % align) % align);
+    }
+
+    void Patch(uint64_t offset, uint64_t value)
+    {
+        m_out.seekp(std::streamoff(offset));
+        m_out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        m_out.seekp(std::streamoff(m_offset));
+    }
+
+    void Close()
+    {
+        m_out.close();
+        if (!m_out)
+            throw Exception{ExceptionKind::IoError, "cannot write workbook file"};
+    }
+
+  private:
+    std::ofstream m_out;
+    uint64_t m_offset = 0;
+};
+
+void WriteChunk(FileWriter &out, ColumnChunk const &chunk)
+{
+    uint64_t flags = (chunk.Numbers() ? kChunkHasNumbers : 0) | (chunk.Strings() ? kChunkHasStrings : 0);
+    out.Align(kAlignment);
+    out.Write64(flags);
+    out.Write64(chunk.Count());
+    out.Align(kAlignment);
+    out.Write(chunk.NumberBits(), kBitmapSize);
+    out.Write(chunk.BoolBits(), kBitmapSize);
+    out.Write(chunk.BoolValues(), kBitmapSize);
+    out.Write(chunk.StringBits(), kBitmapSize);
+    if (chunk.Numbers())
+        out.Write(chunk.Numbers(), kNumbersSize);
+    if (chunk.Strings())
+        out.Write(chunk.Strings(), kStringsSize);
+}
+
+} // namespace
+
+ColumnChunkView MappedColumn::Chunk(size_t index) const
+{
+    if (index >= m_chunk_count)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    uint64_t offset = Load64(m_chunk_offsets + index * sizeof(uint64_t));
+    if (offset == 0)
+        return {};
+
+    const std::byte *p = Section(m_file, offset, 1, kChunkHeaderSize + 4 * kBitmapSize, kAlignment, "invalid chunk");
+    uint64_t flags = Load64(p);
+    size_t size = kChunkHeaderSize + 4 * kBitmapSize;
+    size += (flags & kChunkHasNumbers) ? kNumbersSize : 0;
+    size += (flags & kChunkHasStrings) ? kStringsSize : 0;
+    Section(m_file, offset, 1, size, kAlignment, "invalid chunk");
+
+    ColumnChunkView view;
+    p += kChunkHeaderSize;
+    view.number_bits = reinterpret_cast<uint64_t const *>(p);
+    view.bool_bits = reinterpret_cast<uint64_t const *>(p + kBitmapSize);
+    view.bool_values = reinterpret_cast<uint64_t const *>(p + 2 * kBitmapSize);
+    view.string_bits = reinterpret_cast<uint64_t const *>(p + 3 * kBitmapSize);
+    p += 4 * kBitmapSize;
+    if (flags & kChunkHasNumbers)
+    {
+        view.numbers = reinterpret_cast<double const *>(p);
+        p += kNumbersSize;
+    }
+    if (flags & kChunkHasStrings)
+        view.strings = reinterpret_cast<StringId const *>(p);
+
+    // 类型互斥，布尔值只能在布尔单元格上；位图标了数字或字符串却没有对应的数组时，读单元格会越界
+    for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+    {
+        uint64_t numbers = view.number_bits[word];
+        uint64_t bools = view.bool_bits[word];
+        uint64_t strings = view.string_bits[word];
+        bool overlap =
+            (numbers & bools) || (numbers & strings) || (bools & strings) || (view.bool_values[word] & ~bools);
+        if (overlap || (!view.numbers && numbers != 0) || (!view.strings && strings != 0))
+            Corrupted("invalid chunk");
+    }
+    return view;
+}
+
+MappedColumn MappedSheet::Column(uint32_t column) const
+{
+    MappedColumn result;
+    result.m_file = m_book->m_file.Bytes();
+    if (column >= m_column_count)
+        return result;
+
+    const std::byte *entry = m_columns + size_t(column) * kColumnEntrySize;
+    uint64_t chunk_count = Load64(entry);
+    uint64_t table = Load64(entry + 8);
+    if (chunk_count > Worksheet::kMaxRows / ColumnChunk::kRows)
+        Corrupted("invalid column");
+    result.m_chunk_offsets =
+        Section(result.m_file, table, chunk_count, sizeof(uint64_t), sizeof(uint64_t), "invalid column");
+    result.m_chunk_count = size_t(chunk_count);
+    return result;
+}
+
+std::string_view MappedSheet::Text(uint32_t row, uint32_t column) const
+{
+    CellValue value = Get(row, column);
+    if (value.Type() != CellType::String)
+        return {};
+    return m_book->String(value.AsString());
+}
+
+MappedWorkbook::MappedWorkbook(std::filesystem::path const &path) : m_file{path}
+{
+    std::span<const std::byte> file = m_file.Bytes();
+    if (file.size() < kHeaderSize || std::memcmp(file.data(), kMagic, sizeof(kMagic)) != 0)
+        Corrupted("not a binary workbook");
+    const std::byte *header = file.data();
+    if (Load64(header + kHeaderFileSize) != file.size())
+        Corrupted("truncated binary workbook");
+
+    uint64_t sheet_count = Load64(header + kHeaderSheetCount);
+    m_sheets = Section(file, Load64(header + kHeaderSheetDirectory), sheet_count, kSheetEntrySize, sizeof(uint64_t),
+                       "invalid sheet directory");
+    m_sheet_count = size_t(sheet_count);
+
+    uint64_t string_count = Load64(header + kHeaderStringCount);
+    if (string_count > UINT32_MAX)
+        Corrupted("invalid string table");
+    m_string_offsets = Section(file, Load64(header + kHeaderStringOffsets), string_count + 1, sizeof(uint64_t),
+                               sizeof(uint64_t), "invalid string table");
+    uint64_t string_data = Load64(header + kHeaderStringData);
+    uint64_t string_size = Load64(m_string_offsets + string_count * sizeof(uint64_t));
+    m_string_data = reinterpret_cast<const char *>(Section(file, string_data, string_size, 1, 1, "invalid string table"));
+    m_string_count = size_t(string_count);
+}
+
+MappedSheet MappedWorkbook::Sheet(size_t index) const
+{
+    if (index >= m_sheet_count)
+        throw Exception{ExceptionKind::IndexOutofRange};
+
+    std::span<const std::byte> file = m_file.Bytes();
+    const std::byte *entry = m_sheets + index * kSheetEntrySize;
+    uint64_t name_size = Load64(entry + 8);
+    uint64_t column_count = Load64(entry + 16);
+    if (column_count > Worksheet::kMaxColumns)
+        Corrupted("invalid sheet");
+
+    MappedSheet sheet;
+    sheet.m_book = this;
+    const std::byte *name = Section(file, Load64(entry), name_size, 1, 1, "invalid sheet");
+    sheet.m_name = {reinterpret_cast<const char *>(name), size_t(name_size)};
+    sheet.m_column_count = uint32_t(column_count);
+    sheet.m_columns = Section(file, Load64(entry + 24), column_count, kColumnEntrySize, sizeof(uint64_t), "invalid sheet");
+    return sheet;
+}
+
+std::optional<MappedSheet> MappedWorkbook::FindSheet(std::string_view name) const
+{
+    for (size_t i = 0; i < m_sheet_count; i++)
+    {
+        MappedSheet sheet = Sheet(i);
+        if (sheet.Name() == name)
+            return sheet;
+    }
+    return std::nullopt;
+}
+
+std::string_view MappedWorkbook::String(StringId id) const
+{
+    if (id >= m_string_count)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    uint64_t begin = Load64(m_string_offsets + size_t(id) * sizeof(uint64_t));
+    uint64_t end = Load64(m_string_offsets + (size_t(id) + 1) * sizeof(uint64_t));
+    uint64_t size = Load64(m_string_offsets + m_string_count * sizeof(uint64_t));
+    if (begin > end || end > size)
+        Corrupted("invalid string table");
+    return {m_string_data + begin, size_t(end - begin)};
+}
+
+Workbook MappedWorkbook::Load() const
+{
+    Workbook book;
+    for (size_t i = 0; i < m_sheet_count; i++)
+    {
+        LoadSheet(i, book);
+    }
+    return book;
+}
+
+Worksheet &MappedWorkbook::LoadSheet(size_t index, Workbook &book) const
+{
+    MappedSheet mapped = Sheet(index);
+    Worksheet &sheet = book.AddSheet(std::string{mapped.Name()});
+
+    // 只把用到的字符串放进目标的字符串池
+    constexpr StringId kUnmapped = UINT32_MAX;
+    std::vector<StringId> ids;
+    auto remap = [&](StringId id) {
+        if (ids.empty())
+            ids.assign(m_string_count, kUnmapped);
+        if (id >= m_string_count)
+            Corrupted("invalid string id");
+        if (ids[id] == kUnmapped)
+            ids[id] = book.Strings().Intern(String(id));
+        return ids[id];
+    };
+
+    for (uint32_t c = 0; c < mapped.ColumnCount(); c++)
+    {
+        MappedColumn column = mapped.Column(c);
+        for (size_t i = 0; i < column.ChunkCount(); i++)
+        {
+            ColumnChunkView view = column.Chunk(i);
+            if (!view)
+                continue;
+            auto chunk = std::make_unique<ColumnChunk>(view);
+            if (view.strings)
+                chunk->RemapStrings(remap);
+            sheet.SetChunk(c, i, std::move(chunk));
+        }
+    }
+    return sheet;
+}
+
+void SaveBinaryWorkbook(Workbook const &book, std::filesystem::path const &path)
+{
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    {
+        FileWriter out{temp};
+        char header[kHeaderSize] = {};
+        std::memcpy(header, kMagic, sizeof(kMagic));
+        out.Write(header, sizeof(header));
+
+        StringPool const &strings = book.Strings();
+        out.Patch(kHeaderStringCount, strings.Size());
+        out.Patch(kHeaderStringOffsets, out.Offset());
+        uint64_t string_size = 0;
+        for (StringId id = 0; id < strings.Size(); id++)
+        {
+            out.Write64(string_size);
+            string_size += strings.Get(id).size();
+        }
+        out.Write64(string_size);
+        out.Patch(kHeaderStringData, out.Offset());
+        for (StringId id = 0; id < strings.Size(); id++)
+        {
+            std::string_view text = strings.Get(id);
+            out.Write(text.data(), text.size());
+        }
+
+        // 块的位置，按工作表、列、块索引
+        std::vector<std::vector<std::vector<uint64_t>>> chunks(book.SheetCount());
+        for (size_t s = 0; s < book.SheetCount(); s++)
+        {
+            Worksheet const &sheet = book.Sheet(s);
+            chunks[s].resize(sheet.ColumnCount());
+            for (uint32_t c = 0; c < sheet.ColumnCount(); c++)
+            {
+                llama::Column const &column = *sheet.FindColumn(c);
+                chunks[s][c].resize(column.ChunkCount());
+                for (size_t i = 0; i < column.ChunkCount(); i++)
+                {
+                    if (ColumnChunk const *chunk = column.Chunk(i))
+                    {
+                        out.Align(kAlignment);
+                        chunks[s][c][i] = out.Offset();
+                        WriteChunk(out, *chunk);
+                    }
+                }
+            }
+        }
+
+        out.Align(sizeof(uint64_t));
+        std::vector<std::vector<uint64_t>> tables(book.SheetCount());
+        for (size_t s = 0; s < book.SheetCount(); s++)
+        {
+            for (auto const &column : chunks[s])
+            {
+                tables[s].push_back(out.Offset());
+                for (uint64_t offset : column)
+                {
+                    out.Write64(offset);
+                }
+            }
+        }
+
+        std::vector<uint64_t> directories;
+        for (size_t s = 0; s < book.SheetCount(); s++)
+        {
+            directories.push_back(out.Offset());
+            for (size_t c = 0; c < chunks[s].size(); c++)
+            {
+                out.Write64(chunks[s][c].size());
+                out.Write64(tables[s][c]);
+            }
+        }
+
+        std::vector<uint64_t> names;
+        for (size_t s = 0; s < book.SheetCount(); s++)
+        {
+            names.push_back(out.Offset());
+            out.Write(book.Sheet(s).Name().data(), book.Sheet(s).Name().size());
+        }
+
+        out.Align(sizeof(uint64_t));
+        out.Patch(kHeaderSheetCount, book.SheetCount());
+        out.Patch(kHeaderSheetDirectory, out.Offset());
+        for (size_t s = 0; s < book.SheetCount(); s++)
+        {
+            out.Write64(names[s]);
+            out.Write64(book.Sheet(s).Name().size());
+            out.Write64(chunks[s].size());
+            out.Write64(directories[s]);
+        }
+        out.Patch(kHeaderFileSize, out.Offset());
+        out.Close();
+    }
+
+    // 先把内容写到磁盘再改名，否则断电之后可能看到换上了、内容却不完整的文件
+    std::error_code error;
+    if (!SyncFile(temp))
+    {
+        std::filesystem::remove(temp, error);
+        throw Exception{ExceptionKind::IoError, "cannot sync workbook file"};
+    }
+    std::filesystem::rename(temp, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp, error);
+        throw Exception{ExceptionKind::IoError, "cannot replace workbook file"};
+    }
+    std::filesystem::path directory = path.parent_path();
+    if (!SyncDirectory(directory.empty() ? std::filesystem::path{"."} : directory))
+        throw Exception{ExceptionKind::IoError, "cannot sync workbook directory"};
+}
+
+} // namespace llama
@@ -0,0 +1,210 @@
+#include "book/column.h"
+#include "foundation/hasher.h"
+#include "foundation/pointers.h"
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace llama
+{
+
+ColumnChunk::ColumnChunk(ColumnChunkView const &view)
+{
+    std::copy_n(view.number_bits, kWords, m_number_bits);
+    std::copy_n(view.bool_bits, kWords, m_bool_bits);
+    std::copy_n(view.bool_values, kWords, m_bool_values);
+    std::copy_n(view.string_bits, kWords, m_string_bits);
+    if (view.numbers)
+    {
+        m_numbers = std::make_unique_for_overwrite<double[]>(kRows);
+        std::copy_n(view.numbers, kRows, m_numbers.get());
+    }
+    if (view.strings)
+    {
+        m_strings = std::make_unique_for_overwrite<StringId[]>(kRows);
+        std::copy_n(view.strings, kRows, m_strings.get());
+    }
+    for (uint32_t word = 0; word < kWords; word++)
+    {
+        m_count += uint32_t(std::popcount(m_number_bits[word] | m_bool_bits[word] | m_string_bits[word]));
+        // 视图里空着的位置不一定是 0 ，清掉以保持数组的约定
+        for (uint32_t slot = word * 64; slot < word * 64 + 64; slot++)
+        {
+            uint64_t bit = uint64_t{1} << (slot % 64);
+            if (m_numbers && !(m_number_bits[word] & bit))
+                m_numbers[slot] = 0;
+            if (m_strings && !(m_string_bits[word] & bit))
+                m_strings[slot] = 0;
+        }
+    }
+}
+
+void ColumnChunk::Set(uint32_t slot, CellValue value)
+{
+    uint32_t word = slot / 64;
+    uint64_t bit = uint64_t{1} << (slot % 64);
+    bool existed = Erase(word, bit, slot);
+    m_hashed.store(false, std::memory_order_relaxed);
+
+    switch (value.Type())
+    {
+    case CellType::Number:
+        if (!m_numbers)
+            m_numbers = std::make_unique<double[]>(kRows);
+        m_numbers[slot] = value.AsNumber();
+        m_number_bits[word] |= bit;
+        break;
+    case CellType::Bool:
+        m_bool_bits[word] |= bit;
+        if (value.AsBool())
+            m_bool_values[word] |= bit;
+        break;
+    case CellType::String:
+        if (!m_strings)
+            m_strings = std::make_unique<StringId[]>(kRows);
+        m_strings[slot] = value.AsString();
+        m_string_bits[word] |= bit;
+        break;
+    default:
+        if (existed)
+            m_count--;
+        return;
+    }
+    if (!existed)
+        m_count++;
+}
+
+uint32_t ColumnChunk::RowEnd() const
+{
+    for (uint32_t word = kWords; word-- > 0;)
+    {
+        uint64_t bits = m_number_bits[word] | m_bool_bits[word] | m_string_bits[word];
+        if (bits != 0)
+            return word * 64 + 64 - uint32_t(std::countl_zero(bits));
+    }
+    return 0;
+}
+
+size_t ColumnChunk::MemoryUsage() const
+{
+    size_t size = sizeof(ColumnChunk);
+    if (m_numbers)
+        size += kRows * sizeof(double);
+    if (m_strings)
+        size += kRows * sizeof(StringId);
+    return size;
+}
+
+Hash ColumnChunk::ContentHash() const
+{
+    if (m_hashed.load(std::memory_order_acquire))
+        return Hash{m_hash1.load(std::memory_order_relaxed), m_hash2.load(std::memory_order_relaxed)};
+
+    // 不是这种类型的位置在数组里总是 0 ，所以只要有这种类型的单元格就可以整个数组一起算；
+    // 没有时跳过数组，分配过但已经清空的数组不影响结果
+    Hasher128 hasher;
+    hasher.Update(m_number_bits, sizeof(m_number_bits));
+    hasher.Update(m_bool_bits, sizeof(m_bool_bits));
+    hasher.Update(m_bool_values, sizeof(m_bool_values));
+    hasher.Update(m_string_bits, sizeof(m_string_bits));
+    auto any = [](uint64_t const *bits) { return std::any_of(bits, bits + kWords, [](uint64_t w) { return w != 0; }); };
+    if (any(m_number_bits))
+        hasher.Update(m_numbers.get(), kRows * sizeof(double));
+    if (any(m_string_bits))
+        hasher.Update(m_strings.get(), kRows * sizeof(StringId));
+    Hash hash = hasher.Finish();
+
+    m_hash1.store(hash.Data1(), std::memory_order_relaxed);
+    m_hash2.store(hash.Data2(), std::memory_order_relaxed);
+    m_hashed.store(true, std::memory_order_release);
+    return hash;
+}
+
+bool ColumnChunk::Erase(uint32_t word, uint64_t bit, uint32_t slot)
+{
+    if (m_number_bits[word] & bit)
+    {
+        m_number_bits[word] &= ~bit;
+        m_numbers[slot] = 0;
+        return true;
+    }
+    if (m_string_bits[word] & bit)
+    {
+        m_string_bits[word] &= ~bit;
+        m_strings[slot] = 0;
+        return true;
+    }
+    if (m_bool_bits[word] & bit)
+    {
+        m_bool_bits[word] &= ~bit;
+        m_bool_values[word] &= ~bit;
+        return true;
+    }
+    return false;
+}
+
+void Column::Set(uint32_t row, CellValue value)
+{
+    size_t index = row / ColumnChunk::kRows;
+    if (index >= m_chunks.size() || !m_chunks[index])
+    {
+        if (value.Empty())
+            return;
+        if (index >= m_chunks.size())
+            m_chunks.resize(index + 1);
+        m_chunks[index] = std::make_shared<ColumnChunk>();
+    }
+    else if (!IsSoleOwner(m_chunks[index]))
+    {
+        // 别处还在用这一块，换成自己的副本再写
+        m_chunks[index] = std::make_shared<ColumnChunk>(*m_chunks[index]);
+    }
+
+    ColumnChunk &chunk = *m_chunks[index];
+    uint32_t before = chunk.Count();
+    chunk.Set(row % ColumnChunk::kRows, value);
+    m_count = m_count - before + chunk.Count();
+    if (chunk.Count() == 0)
+        m_chunks[index].reset();
+}
+
+void Column::SetChunk(size_t index, std::shared_ptr<ColumnChunk> chunk)
+{
+    if (chunk && chunk->Count() == 0)
+        chunk.reset();
+    if (index >= m_chunks.size())
+    {
+        if (!chunk)
+            return;
+        m_chunks.resize(index + 1);
+    }
+    if (m_chunks[index])
+        m_count -= m_chunks[index]->Count();
+    if (chunk)
+        m_count += chunk->Count();
+    m_chunks[index] = std::move(chunk);
+}
+
+std::shared_ptr<ColumnChunk> Column::TakeChunk(size_t index)
+{
+    if (index >= m_chunks.size() || !m_chunks[index])
+        return nullptr;
+    m_count -= m_chunks[index]->Count();
+    std::shared_ptr<ColumnChunk> chunk = std::move(m_chunks[index]);
+    if (!IsSoleOwner(chunk))
+        chunk = std::make_shared<ColumnChunk>(*chunk);
+    return chunk;
+}
+
+size_t Column::MemoryUsage() const
+{
+    size_t size = sizeof(Column) + m_chunks.capacity() * sizeof(m_chunks[0]);
+    for (auto const &chunk : m_chunks)
+    {
+        if (chunk)
+            size += chunk->MemoryUsage();
+    }
+    return size;
+}
+
+} // namespace llama
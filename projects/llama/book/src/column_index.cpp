@@ -0,0 +1,261 @@
+#include "book/column_index.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace llama
+{
+
+namespace
+{
+
+// 有序索引每块的行数。建立时每块装满一半，超过两倍时分裂
+constexpr size_t kBlockSize = 1024;
+// 日志短于这个长度时总是逐条合并
+constexpr size_t kMinBudget = 4096;
+
+bool Less(ColumnIndex::NumberEntry const &a, ColumnIndex::NumberEntry const &b)
+{
+    return a.number < b.number || (a.number == b.number && a.row < b.row);
+}
+
+bool Indexable(CellValue value)
+{
+    return value.Type() == CellType::Number && !std::isnan(value.AsNumber());
+}
+
+} // namespace
+
+std::optional<Hash> ColumnIndex::KeyOf(CellValue value)
+{
+    uint64_t bits = 0;
+    switch (value.Type())
+    {
+    case CellType::Number:
+        if (std::isnan(value.AsNumber()))
+            return std::nullopt;
+        // +0.0 把 -0 变成 0
+        bits = std::bit_cast<uint64_t>(value.AsNumber() + 0.0);
+        break;
+    case CellType::Bool:
+        bits = value.AsBool();
+        break;
+    case CellType::String:
+        bits = value.AsString();
+        break;
+    default:
+        return std::nullopt;
+    }
+    // 和 FormulaEngine 一样先打散再探测。异或的类型让不同类型的相同位模式落到不同的键上，
+    // 打散是双射，所以 Data1 和 Data2 一起唯一确定值
+    uint64_t x = bits ^ (uint64_t(value.Type()) * 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return Hash{x ^ (x >> 31), bits};
+}
+
+void ColumnIndex::Record(uint32_t row, CellValue before, CellValue after)
+{
+    if (before == after || (!m_hashed && !m_sorted))
+        return;
+    m_log.push_back({row, before, after});
+    // 一直没有查询时日志不能无限增长：长到重建更便宜时丢掉索引，下次查询再建
+    if (m_log.size() > std::max(m_cells, kMinBudget))
+    {
+        m_log.clear();
+        m_log.shrink_to_fit();
+        m_hashed = false;
+        m_rows.Clear();
+        m_sorted = false;
+        m_blocks = {};
+    }
+}
+
+std::span<const uint32_t> ColumnIndex::Find(Column const &column, CellValue value)
+{
+    EnsureHashed(column);
+    std::optional<Hash> key = KeyOf(value);
+    if (!key)
+        return {};
+    std::vector<uint32_t> const *rows = m_rows.Find(*key);
+    return rows ? std::span<const uint32_t>{*rows} : std::span<const uint32_t>{};
+}
+
+size_t ColumnIndex::MemoryUsage() const
+{
+    size_t size = sizeof(ColumnIndex) + m_log.capacity() * sizeof(Edit) + m_rows.MemoryUsage();
+    m_rows.ForEach(
+        [&](Hash const &, std::vector<uint32_t> const &rows) { size += rows.capacity() * sizeof(uint32_t); });
+    size += m_blocks.capacity() * sizeof(m_blocks[0]);
+    for (auto const &block : m_blocks)
+    {
+        size += block.capacity() * sizeof(NumberEntry);
+    }
+    return size;
+}
+
+void ColumnIndex::Sync(Column const &column)
+{
+    if (m_log.empty())
+        return;
+    size_t budget = std::max(2 * m_cells, kMinBudget);
+    size_t cost = 0;
+    for (Edit const &edit : m_log)
+    {
+        if (m_hashed)
+            cost += HashErase(edit.before, edit.row) + HashInsert(edit.after, edit.row);
+        if (m_sorted)
+        {
+            if (Indexable(edit.before))
+                cost += SortedErase({edit.before.AsNumber(), edit.row});
+            if (Indexable(edit.after))
+                cost += SortedInsert({edit.after.AsNumber(), edit.row});
+        }
+        if (cost > budget)
+        {
+            // 剩下的日志不必再看，列里已经是最新的值
+            if (m_hashed)
+                BuildHashed(column);
+            if (m_sorted)
+                BuildSorted(column);
+            break;
+        }
+    }
+    m_log.clear();
+    m_cells = column.Count();
+}
+
+void ColumnIndex::EnsureHashed(Column const &column)
+{
+    Sync(column);
+    if (!m_hashed)
+        BuildHashed(column);
+}
+
+void ColumnIndex::EnsureSorted(Column const &column)
+{
+    Sync(column);
+    if (!m_sorted)
+        BuildSorted(column);
+}
+
+void ColumnIndex::BuildHashed(Column const &column)
+{
+    m_rows.Clear();
+    column.ForEach([&](uint32_t row, CellValue value) {
+        if (std::optional<Hash> key = KeyOf(value))
+            m_rows.Insert(*key, {}).first->push_back(row);
+    });
+    m_hashed = true;
+    m_cells = column.Count();
+}
+
+void ColumnIndex::BuildSorted(Column const &column)
+{
+    std::vector<NumberEntry> entries;
+    column.ForEachNumber([&](uint32_t row, double number) {
+        if (!std::isnan(number))
+            entries.push_back({number + 0.0, row});
+    });
+    // 本来就按行号排好，稳定排序之后数字相同的仍按行号
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](NumberEntry const &a, NumberEntry const &b) { return a.number < b.number; });
+
+    m_blocks.clear();
+    for (size_t first = 0; first < entries.size(); first += kBlockSize)
+    {
+        size_t last = std::min(first + kBlockSize, entries.size());
+        m_blocks.emplace_back(entries.begin() + std::ptrdiff_t(first), entries.begin() + std::ptrdiff_t(last));
+    }
+    m_sorted = true;
+    m_cells = column.Count();
+}
+
+size_t ColumnIndex::HashInsert(CellValue value, uint32_t row)
+{
+    std::optional<Hash> key = KeyOf(value);
+    if (!key)
+        return 0;
+    std::vector<uint32_t> &rows = *m_rows.Insert(*key, {}).first;
+    auto it = std::lower_bound(rows.begin(), rows.end(), row);
+    size_t cost = size_t(rows.end() - it);
+    rows.insert(it, row);
+    return cost;
+}
+
+size_t ColumnIndex::HashErase(CellValue value, uint32_t row)
+{
+    std::optional<Hash> key = KeyOf(value);
+    if (!key)
+        return 0;
+    std::vector<uint32_t> *rows = m_rows.Find(*key);
+    if (!rows)
+        return 0;
+    auto it = std::lower_bound(rows->begin(), rows->end(), row);
+    size_t cost = size_t(rows->end() - it);
+    if (it != rows->end() && *it == row)
+        rows->erase(it);
+    if (rows->empty())
+        m_rows.Erase(*key);
+    return cost;
+}
+
+size_t ColumnIndex::SortedInsert(NumberEntry entry)
+{
+    entry.number += 0.0;
+    if (m_blocks.empty())
+    {
+        m_blocks.push_back({entry});
+        return 1;
+    }
+    // 第一个最大项不小于 entry 的块；都比它小时放进最后一块
+    auto block = std::partition_point(m_blocks.begin(), m_blocks.end(),
+                                      [&](std::vector<NumberEntry> const &b) { return Less(b.back(), entry); });
+    if (block == m_blocks.end())
+        block--;
+    block->insert(std::lower_bound(block->begin(), block->end(), entry, Less), entry);
+    size_t cost = block->size();
+    if (block->size() > 2 * kBlockSize)
+    {
+        std::vector<NumberEntry> upper(block->begin() + std::ptrdiff_t(kBlockSize), block->end());
+        block->resize(kBlockSize);
+        m_blocks.insert(block + 1, std::move(upper));
+        cost += m_blocks.size();
+    }
+    return cost;
+}
+
+size_t ColumnIndex::SortedErase(NumberEntry entry)
+{
+    entry.number += 0.0;
+    auto block = std::partition_point(m_blocks.begin(), m_blocks.end(),
+                                      [&](std::vector<NumberEntry> const &b) { return Less(b.back(), entry); });
+    if (block == m_blocks.end())
+        return 0;
+    auto it = std::lower_bound(block->begin(), block->end(), entry, Less);
+    size_t cost = block->size();
+    if (it != block->end() && it->number == entry.number && it->row == entry.row)
+        block->erase(it);
+    if (block->empty())
+    {
+        m_blocks.erase(block);
+        cost += m_blocks.size();
+    }
+    return cost;
+}
+
+size_t ColumnIndex::FirstBlock(double low) const
+{
+    auto block = std::partition_point(m_blocks.begin(), m_blocks.end(),
+                                      [&](std::vector<NumberEntry> const &b) { return b.back().number < low; });
+    return size_t(block - m_blocks.begin());
+}
+
+size_t ColumnIndex::FirstEntry(std::vector<NumberEntry> const &entries, double low)
+{
+    auto it =
+        std::partition_point(entries.begin(), entries.end(), [&](NumberEntry const &e) { return e.number < low; });
+    return size_t(it - entries.begin());
+}
+
+} // namespace llama
@@ -0,0 +1,1078 @@
+#include "book/formula.h"
+#include "foundation/exceptions.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace llama
+{
+
+namespace
+{
+
+// 错误的种类，也是 m_errors 的下标
+constexpr uint32_t kValueError = 0;
+constexpr uint32_t kDivideByZero = 1;
+constexpr uint32_t kNumberError = 2;
+constexpr uint32_t kCycle = 3;
+constexpr const char *kErrorText[] = {"#VALUE!", "#DIV/0!", "#NUM!", "#CYCLE!"};
+
+constexpr uint8_t kSum = 0;
+constexpr uint8_t kMin = 1;
+constexpr uint8_t kMax = 2;
+constexpr uint8_t kCount = 3;
+constexpr uint8_t kAverage = 4;
+constexpr uint8_t kAbs = 5;
+constexpr uint8_t kIf = 6;
+
+struct FunctionInfo
+{
+    std::string_view name;
+    uint8_t function;
+    uint16_t min_args;
+    uint16_t max_args;
+    // 参数能不能是区域
+    bool ranges;
+};
+
+constexpr FunctionInfo kFunctions[] = {
+    {"SUM", kSum, 1, 255, true},      {"MIN", kMin, 1, 255, true}, {"MAX", kMax, 1, 255, true},
+    {"COUNT", kCount, 1, 255, true},  {"AVERAGE", kAverage, 1, 255, true},
+    {"ABS", kAbs, 1, 1, false},       {"IF", kIf, 2, 3, false},
+};
+
+// 公式的嵌套层数上限，也是求值时放在栈上的数组的大小
+constexpr size_t kMaxDepth = 64;
+
+// 求值栈的深度上限。函数最多有 255 个参数，这里给几层这样的调用留出余地，更深的栈放在堆上
+constexpr size_t kMaxStack = 1024;
+
+// 一轮里的公式至少有两倍这么多才并行计算，每个任务算这么多个
+constexpr size_t kParallelGrain = 1024;
+
+bool IsAlpha(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+char Upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c;
+}
+
+// 逐列按行的顺序对区域里每个非空单元格调用 visit(row, column, value) ，用位图跳过空行
+template <typename F>
+void ForEachInRange(Worksheet const &sheet, uint32_t first_row, uint32_t last_row, uint32_t first_column,
+                    uint32_t last_column, F &&visit)
+{
+    constexpr uint32_t kRows = ColumnChunk::kRows;
+    uint32_t columns = std::min(last_column + 1, sheet.ColumnCount());
+    for (uint32_t c = first_column; c < columns; c++)
+    {
+        Column const &column = *sheet.FindColumn(c);
+        size_t chunks = std::min<size_t>(last_row / kRows + 1, column.ChunkCount());
+        for (size_t index = first_row / kRows; index < chunks; index++)
+        {
+            ColumnChunk const *chunk = column.Chunk(index);
+            if (!chunk)
+                continue;
+            uint64_t base = index * kRows;
+            uint32_t begin = uint32_t(std::max<uint64_t>(first_row, base) - base);
+            uint32_t end = uint32_t(std::min<uint64_t>(uint64_t{last_row} + 1 - base, kRows));
+            for (uint32_t word = begin / 64; word < (end + 63) / 64; word++)
+            {
+                uint64_t bits = chunk->NumberBits()[word] | chunk->BoolBits()[word] | chunk->StringBits()[word];
+                if (word == begin / 64)
+                    bits &= ~uint64_t{0} << (begin % 64);
+                if (word == (end - 1) / 64 && end % 64 != 0)
+                    bits &= ~uint64_t{0} >> (64 - end % 64);
+                for (; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                    visit(uint32_t(base + slot), c, chunk->Get(slot));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+// 求值时栈上的值。比单元格的值多了错误和区域两种
+struct FormulaEngine::Value
+{
+    enum Kind : uint8_t
+    {
+        Empty,
+        Number,
+        Bool,
+        String,
+        Error,
+        Range,
+    };
+
+    Kind kind = Empty;
+    // 字符串的编号、错误的种类，或者区域指令的位置
+    uint32_t index = 0;
+    // 数字，或者布尔值的 0 和 1
+    double number = 0;
+
+    static Value Of(double number)
+    {
+        return {Number, 0, number};
+    }
+
+    static Value OfBool(bool value)
+    {
+        return {Bool, 0, value ? 1.0 : 0.0};
+    }
+
+    static Value OfError(uint32_t error)
+    {
+        return {Error, error, 0};
+    }
+
+    // 转成数字：布尔值是 0 和 1 ，空是 0 ，字符串出错。结果是数字或者错误
+    static Value Numeric(Value const &value)
+    {
+        switch (value.kind)
+        {
+        case Number:
+        case Error:
+            return value;
+        case Bool:
+            return Of(value.number);
+        case Empty:
+            return Of(0);
+        default:
+            return OfError(kValueError);
+        }
+    }
+};
+
+// 递归下降地把公式编译成逆波兰式
+class FormulaEngine::Parser
+{
+  public:
+    explicit Parser(std::string_view text) : m_text{text}
+    {
+    }
+
+    std::vector<Op> Parse()
+    {
+        if (Peek() == '=')
+            m_pos++;
+        Comparison();
+        if (Peek() != '\0')
+            Fail("unexpected character in formula");
+        Check();
+        return std::move(m_code);
+    }
+
+    // `Parse` 之后，求值栈需要的深度
+    size_t StackSize() const
+    {
+        return m_stack_size;
+    }
+
+  private:
+    [[noreturn]] static void Fail(const char *what)
+    {
+        throw Exception{ExceptionKind::BadArgument, what};
+    }
+
+    char Peek()
+    {
+        while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t'))
+        {
+            m_pos++;
+        }
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    bool Accept(std::string_view token)
+    {
+        Peek();
+        if (m_text.substr(m_pos).starts_with(token))
+        {
+            m_pos += token.size();
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(char c)
+    {
+        if (Peek() != c)
+            Fail(m_pos < m_text.size() ? "unexpected character in formula" : "unexpected end of formula");
+        m_pos++;
+    }
+
+    Op &Emit(OpCode code)
+    {
+        Op op{};
+        op.code = code;
+        return m_code.emplace_back(op);
+    }
+
+    void Comparison()
+    {
+        Additive();
+        for (;;)
+        {
+            OpCode code;
+            if (Accept("<="))
+                code = OpCode::LessEqual;
+            else if (Accept(">="))
+                code = OpCode::GreaterEqual;
+            else if (Accept("<>"))
+                code = OpCode::NotEqual;
+            else if (Accept("<"))
+                code = OpCode::Less;
+            else if (Accept(">"))
+                code = OpCode::Greater;
+            else if (Accept("="))
+                code = OpCode::Equal;
+            else
+                return;
+            Additive();
+            Emit(code);
+        }
+    }
+
+    void Additive()
+    {
+        Term();
+        for (;;)
+        {
+            if (Accept("+"))
+            {
+                Term();
+                Emit(OpCode::Add);
+            }
+            else if (Accept("-"))
+            {
+                Term();
+                Emit(OpCode::Subtract);
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void Term()
+    {
+        Power();
+        for (;;)
+        {
+            if (Accept("*"))
+            {
+                Power();
+                Emit(OpCode::Multiply);
+            }
+            else if (Accept("/"))
+            {
+                Power();
+                Emit(OpCode::Divide);
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    // 乘方左结合，负号比乘方优先，作用在底数上，都和常见电子表格一样：2^3^2 是 64 ，-2^2 是 4 ，2^-2 是 0.25
+    void Power()
+    {
+        if (++m_depth > kMaxDepth)
+            Fail("formula is nested too deeply");
+        Unary();
+        while (Accept("^"))
+        {
+            Unary();
+            Emit(OpCode::Power);
+        }
+        m_depth--;
+    }
+
+    void Unary()
+    {
+        if (++m_depth > kMaxDepth)
+            Fail("formula is nested too deeply");
+        if (Accept("-"))
+        {
+            Unary();
+            Emit(OpCode::Negate);
+        }
+        else if (Accept("+"))
+        {
+            Unary();
+        }
+        else
+        {
+            Primary();
+        }
+        m_depth--;
+    }
+
+    void Primary()
+    {
+        char c = Peek();
+        if (c == '(')
+        {
+            m_pos++;
+            Comparison();
+            Expect(')');
+        }
+        else if (IsDigit(c) || c == '.')
+        {
+            double value;
+            auto [end, error] = std::from_chars(m_text.data() + m_pos, m_text.data() + m_text.size(), value);
+            if (error != std::errc{})
+                Fail("invalid number in formula");
+            m_pos = size_t(end - m_text.data());
+            Emit(OpCode::Number).number = value;
+        }
+        else if (IsAlpha(c) || c == '$')
+        {
+            Name();
+        }
+        else
+        {
+            Fail(c == '\0' ? "unexpected end of formula" : "unexpected character in formula");
+        }
+    }
+
+    // 单元格引用、区域、函数调用或者 TRUE 、FALSE
+    void Name()
+    {
+        uint32_t row, column;
+        if (Reference(row, column))
+        {
+            if (!Accept(":"))
+            {
+                Op &op = Emit(OpCode::Cell);
+                op.ref.row = row;
+                op.ref.column = column;
+                return;
+            }
+            uint32_t last_row, last_column;
+            Peek();
+            if (!Reference(last_row, last_column))
+                Fail("invalid range in formula");
+            Op &op = Emit(OpCode::Range);
+            op.ref.row = std::min(row, last_row);
+            op.ref.last_row = std::max(row, last_row);
+            op.ref.column = std::min(column, last_column);
+            op.ref.last_column = std::max(column, last_column);
+            return;
+        }
+
+        std::string name;
+        while (m_pos < m_text.size() && IsAlpha(m_text[m_pos]))
+        {
+            name.push_back(Upper(m_text[m_pos++]));
+        }
+        if (name.empty() || (m_pos < m_text.size() && (IsDigit(m_text[m_pos]) || m_text[m_pos] == '$')))
+            Fail("invalid cell reference in formula");
+
+        if (Peek() != '(')
+        {
+            if (name != "TRUE" && name != "FALSE")
+                Fail("unknown name in formula");
+            Emit(OpCode::Bool).number = name == "TRUE" ? 1 : 0;
+            return;
+        }
+
+        auto info = std::find_if(std::begin(kFunctions), std::end(kFunctions),
+                                 [&](FunctionInfo const &f) { return f.name == name; });
+        if (info == std::end(kFunctions))
+            Fail("unknown function in formula");
+        m_pos++;
+        size_t argc = 0;
+        if (!Accept(")"))
+        {
+            do
+            {
+                Comparison();
+                argc++;
+            } while (Accept(","));
+            Expect(')');
+        }
+        if (argc < info->min_args || argc > info->max_args)
+            Fail("wrong number of arguments in formula");
+        Op &op = Emit(OpCode::Call);
+        op.function = info->function;
+        op.argc = uint16_t(argc);
+    }
+
+    // 形如 $A$1 的引用。不是引用时不移动位置
+    bool Reference(uint32_t &row, uint32_t &column)
+    {
+        size_t pos = m_pos;
+        if (pos < m_text.size() && m_text[pos] == '$')
+            pos++;
+        uint64_t letters = 0, c = 0;
+        for (; pos < m_text.size() && IsAlpha(m_text[pos]); pos++, letters++)
+        {
+            c = c * 26 + uint64_t(Upper(m_text[pos]) - 'A' + 1);
+        }
+        if (letters == 0 || letters > 3)
+            return false;
+        if (pos < m_text.size() && m_text[pos] == '$')
+            pos++;
+        uint64_t digits = 0, r = 0;
+        for (; pos < m_text.size() && IsDigit(m_text[pos]); pos++, digits++)
+        {
+            r = std::min<uint64_t>(r * 10 + uint64_t(m_text[pos] - '0'), uint64_t{Worksheet::kMaxRows} + 1);
+        }
+        if (digits == 0 || (pos < m_text.size() && (IsAlpha(m_text[pos]) || m_text[pos] == '(')))
+            return false;
+        if (r == 0 || r > Worksheet::kMaxRows || c > Worksheet::kMaxColumns)
+            Fail("cell reference out of range in formula");
+        row = uint32_t(r - 1);
+        column = uint32_t(c - 1);
+        m_pos = pos;
+        return true;
+    }
+
+    // 检查区域只出现在允许的函数参数里，栈的深度不超过上限，并记下最大的深度
+    void Check()
+    {
+        std::vector<bool> ranges;
+        for (Op const &op : m_code)
+        {
+            switch (op.code)
+            {
+            case OpCode::Number:
+            case OpCode::Bool:
+            case OpCode::Cell:
+            case OpCode::Range:
+                ranges.push_back(op.code == OpCode::Range);
+                break;
+            case OpCode::Negate:
+                if (ranges.back())
+                    Fail("range is not allowed here");
+                break;
+            case OpCode::Call: {
+                bool allowed = std::find_if(std::begin(kFunctions), std::end(kFunctions), [&](FunctionInfo const &f) {
+                                   return f.function == op.function;
+                               })->ranges;
+                for (size_t i = 0; i < op.argc; i++)
+                {
+                    if (ranges.back() && !allowed)
+                        Fail("range is not allowed here");
+                    ranges.pop_back();
+                }
+                ranges.push_back(false);
+                break;
+            }
+            default:
+                if (ranges[ranges.size() - 1] || ranges[ranges.size() - 2])
+                    Fail("range is not allowed here");
+                ranges.pop_back();
+                break;
+            }
+            if (ranges.size() > kMaxStack)
+                Fail("formula is too complex");
+            m_stack_size = std::max(m_stack_size, ranges.size());
+        }
+        if (ranges.back())
+            Fail("range is not allowed here");
+    }
+
+  private:
+    std::string_view m_text;
+    size_t m_pos = 0;
+    size_t m_depth = 0;
+    size_t m_stack_size = 0;
+    std::vector<Op> m_code;
+};
+
+FormulaEngine::FormulaEngine(Worksheet &sheet, ThreadPool *pool) : m_sheet{&sheet}, m_pool{pool}
+{
+    for (uint32_t i = 0; i < std::size(m_errors); i++)
+    {
+        m_errors[i] = sheet.Strings().Intern(kErrorText[i]);
+    }
+}
+
+void FormulaEngine::SetFormula(uint32_t row, uint32_t column, std::string_view text)
+{
+    if (row >= Worksheet::kMaxRows || column >= Worksheet::kMaxColumns)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    Parser parser{text};
+    std::vector<Op> code = parser.Parse();
+
+    uint64_t cell = CellKey(row, column);
+    FormulaId id;
+    if (FormulaId const *existing = m_ids.Find(HashOf(cell)))
+    {
+        id = *existing;
+        Unlink(id);
+    }
+    else
+    {
+        if (!m_free.empty())
+        {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            if (m_formulas.size() >= std::numeric_limits<FormulaId>::max())
+                throw Exception{ExceptionKind::InvalidState, "too many formulas"};
+            id = FormulaId(m_formulas.size());
+            m_formulas.emplace_back();
+            m_pending.push_back(0);
+        }
+        m_ids.Insert(HashOf(cell), id);
+    }
+
+    Compiled &formula = m_formulas[id];
+    formula.text.assign(text);
+    formula.code = std::move(code);
+    formula.stack_size = parser.StackSize();
+    formula.cell = cell;
+    formula.live = true;
+    Link(id);
+    MarkFormulaDirty(id);
+    MarkDependents(cell);
+}
+
+void FormulaEngine::Set(uint32_t row, uint32_t column, CellValue value)
+{
+    if (row >= Worksheet::kMaxRows || column >= Worksheet::kMaxColumns)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    uint64_t cell = CellKey(row, column);
+    Remove(cell);
+    m_sheet->Set(row, column, value);
+    MarkDependents(cell);
+}
+
+void FormulaEngine::MarkDirty(uint32_t row, uint32_t column)
+{
+    MarkDependents(CellKey(row, column));
+}
+
+std::string_view FormulaEngine::Formula(uint32_t row, uint32_t column) const
+{
+    FormulaId const *id = m_ids.Find(HashOf(CellKey(row, column)));
+    return id ? std::string_view{m_formulas[*id].text} : std::string_view{};
+}
+
+size_t FormulaEngine::Recalculate()
+{
+    // 删除的公式留在 m_dirty 里，编号重用后可能出现两次；先去掉这些项
+    size_t count = 0;
+    for (FormulaId id : m_dirty)
+    {
+        Compiled &formula = m_formulas[id];
+        if (formula.live && formula.dirty)
+        {
+            formula.dirty = false;
+            m_dirty[count++] = id;
+        }
+    }
+    m_dirty.resize(count);
+    for (FormulaId id : m_dirty)
+    {
+        m_formulas[id].dirty = true;
+    }
+
+    // 脏的集合对下游封闭，所以只需要在它内部做拓扑排序
+    for (FormulaId id : m_dirty)
+    {
+        ForEachDependent(m_formulas[id].cell, [&](FormulaId dependent) {
+            if (m_formulas[dependent].dirty)
+                m_pending[dependent]++;
+        });
+    }
+
+    std::vector<FormulaId> wave, next;
+    for (FormulaId id : m_dirty)
+    {
+        if (m_pending[id] == 0)
+            wave.push_back(id);
+    }
+
+    size_t done = 0;
+    std::vector<Value> results;
+    while (!wave.empty())
+    {
+        // 同一轮的公式互不依赖，可以并行计算；写回工作表要串行
+        results.resize(wave.size());
+        auto evaluate = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                results[i] = Evaluate(m_formulas[wave[i]]);
+            }
+        };
+        if (m_pool && wave.size() >= 2 * kParallelGrain)
+        {
+            m_pool->ParallelFor((wave.size() + kParallelGrain - 1) / kParallelGrain, [&](size_t block) {
+                evaluate(block * kParallelGrain, std::min(wave.size(), (block + 1) * kParallelGrain));
+            });
+        }
+        else
+        {
+            evaluate(0, wave.size());
+        }
+
+        for (size_t i = 0; i < wave.size(); i++)
+        {
+            Compiled &formula = m_formulas[wave[i]];
+            m_sheet->Set(uint32_t(formula.cell), uint32_t(formula.cell >> 32), Store(results[i]));
+            formula.error = results[i].kind == Value::Error;
+            formula.dirty = false;
+        }
+        next.clear();
+        for (FormulaId id : wave)
+        {
+            ForEachDependent(m_formulas[id].cell, [&](FormulaId dependent) {
+                if (m_formulas[dependent].dirty && --m_pending[dependent] == 0)
+                    next.push_back(dependent);
+            });
+        }
+        done += wave.size();
+        std::swap(wave, next);
+    }
+
+    // 剩下的公式在环上，或者依赖环上的公式
+    for (FormulaId id : m_dirty)
+    {
+        Compiled &formula = m_formulas[id];
+        if (!formula.dirty)
+            continue;
+        m_sheet->Set(uint32_t(formula.cell), uint32_t(formula.cell >> 32), CellValue::String(m_errors[kCycle]));
+        formula.error = true;
+        formula.dirty = false;
+        m_pending[id] = 0;
+        done++;
+    }
+    m_dirty.clear();
+    return done;
+}
+
+Hash FormulaEngine::HashOf(uint64_t cell)
+{
+    // 哈希表直接用 Data1 探测，先打散；Data2 放原值，不同的单元格一定是不同的键
+    uint64_t x = cell;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return Hash{x ^ (x >> 31), cell};
+}
+
+std::vector<uint64_t> FormulaEngine::ReferencedCells(std::vector<Op> const &code)
+{
+    std::vector<uint64_t> cells;
+    for (Op const &op : code)
+    {
+        if (op.code == OpCode::Cell)
+            cells.push_back(CellKey(op.ref.row, op.ref.column));
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    return cells;
+}
+
+void FormulaEngine::Link(FormulaId id)
+{
+    Compiled const &formula = m_formulas[id];
+    for (uint64_t cell : ReferencedCells(formula.code))
+    {
+        m_dependents.Insert(HashOf(cell), {}).first->push_back(id);
+    }
+    for (Op const &op : formula.code)
+    {
+        if (op.code != OpCode::Range)
+            continue;
+        if (op.ref.last_column >= m_ranges.size())
+            m_ranges.resize(size_t(op.ref.last_column) + 1);
+        for (uint32_t c = op.ref.column; c <= op.ref.last_column; c++)
+        {
+            m_ranges[c].push_back({op.ref.row, op.ref.last_row, id});
+        }
+    }
+}
+
+void FormulaEngine::Unlink(FormulaId id)
+{
+    Compiled const &formula = m_formulas[id];
+    for (uint64_t cell : ReferencedCells(formula.code))
+    {
+        if (auto *dependents = m_dependents.Find(HashOf(cell)))
+        {
+            std::erase(*dependents, id);
+            if (dependents->empty())
+                m_dependents.Erase(HashOf(cell));
+        }
+    }
+    for (Op const &op : formula.code)
+    {
+        if (op.code != OpCode::Range)
+            continue;
+        for (uint32_t c = op.ref.column; c <= op.ref.last_column; c++)
+        {
+            std::erase_if(m_ranges[c], [&](RangeDependency const &range) { return range.formula == id; });
+        }
+    }
+}
+
+void FormulaEngine::Remove(uint64_t cell)
+{
+    FormulaId const *found = m_ids.Find(HashOf(cell));
+    if (!found)
+        return;
+    FormulaId id = *found;
+    Unlink(id);
+    m_ids.Erase(HashOf(cell));
+    // 还留在 m_dirty 里的话由 Recalculate 跳过
+    m_formulas[id] = Compiled{};
+    m_free.push_back(id);
+}
+
+void FormulaEngine::MarkFormulaDirty(FormulaId id)
+{
+    Compiled &formula = m_formulas[id];
+    if (!formula.dirty)
+    {
+        formula.dirty = true;
+        m_dirty.push_back(id);
+    }
+}
+
+void FormulaEngine::MarkDependents(uint64_t cell)
+{
+    std::vector<FormulaId> stack;
+    auto visit = [&](FormulaId id) {
+        if (!m_formulas[id].dirty)
+        {
+            MarkFormulaDirty(id);
+            stack.push_back(id);
+        }
+    };
+    ForEachDependent(cell, visit);
+    while (!stack.empty())
+    {
+        FormulaId id = stack.back();
+        stack.pop_back();
+        ForEachDependent(m_formulas[id].cell, visit);
+    }
+}
+
+template <typename F> void FormulaEngine::ForEachDependent(uint64_t cell, F &&visit) const
+{
+    if (auto const *dependents = m_dependents.Find(HashOf(cell)))
+    {
+        for (FormulaId id : *dependents)
+        {
+            visit(id);
+        }
+    }
+    uint32_t row = uint32_t(cell);
+    uint32_t column = uint32_t(cell >> 32);
+    if (column < m_ranges.size())
+    {
+        for (RangeDependency const &range : m_ranges[column])
+        {
+            if (row >= range.first_row && row <= range.last_row)
+                visit(range.formula);
+        }
+    }
+}
+
+FormulaEngine::Value FormulaEngine::Evaluate(Compiled const &formula) const
+{
+    // 参数很多的调用才需要在堆上分配
+    Value inline_stack[kMaxDepth];
+    std::vector<Value> heap_stack;
+    Value *stack = inline_stack;
+    if (formula.stack_size > kMaxDepth)
+    {
+        heap_stack.resize(formula.stack_size);
+        stack = heap_stack.data();
+    }
+    size_t top = 0;
+    std::vector<Op> const &code = formula.code;
+    for (size_t pc = 0; pc < code.size(); pc++)
+    {
+        Op const &op = code[pc];
+        switch (op.code)
+        {
+        case OpCode::Number:
+            stack[top++] = Value::Of(op.number);
+            break;
+        case OpCode::Bool:
+            stack[top++] = Value::OfBool(op.number != 0);
+            break;
+        case OpCode::Cell:
+            stack[top++] = Read(op.ref.row, op.ref.column);
+            break;
+        case OpCode::Range:
+            stack[top++] = Value{Value::Range, uint32_t(pc), 0};
+            break;
+        case OpCode::Negate: {
+            Value &value = stack[top - 1];
+            value = Value::Numeric(value);
+            value.number = -value.number;
+            break;
+        }
+        case OpCode::Call: {
+            top -= op.argc;
+            Value *args = &stack[top];
+            Value result;
+            if (op.function == kAbs)
+            {
+                result = Value::Numeric(args[0]);
+                result.number = std::fabs(result.number);
+            }
+            else if (op.function == kIf)
+            {
+                Value condition = Value::Numeric(args[0]);
+                if (condition.kind == Value::Error)
+                    result = condition;
+                else if (condition.number != 0)
+                    result = args[1];
+                else
+                    result = op.argc > 2 ? args[2] : Value::OfBool(false);
+            }
+            else
+            {
+                result = Aggregate(op.function, args, op.argc, code);
+            }
+            stack[top++] = result;
+            break;
+        }
+        default: {
+            Value right = stack[--top];
+            Value &left = stack[top - 1];
+            if (op.code >= OpCode::Equal)
+            {
+                if (left.kind == Value::Error)
+                    break;
+                if (right.kind == Value::Error)
+                {
+                    left = right;
+                    break;
+                }
+                int order = Compare(left, right);
+                bool result = false;
+                switch (op.code)
+                {
+                case OpCode::Equal:
+                    result = order == 0;
+                    break;
+                case OpCode::NotEqual:
+                    result = order != 0;
+                    break;
+                case OpCode::Less:
+                    result = order < 0;
+                    break;
+                case OpCode::LessEqual:
+                    result = order <= 0;
+                    break;
+                case OpCode::Greater:
+                    result = order > 0;
+                    break;
+                default:
+                    result = order >= 0;
+                    break;
+                }
+                left = Value::OfBool(result);
+                break;
+            }
+
+            Value a = Value::Numeric(left);
+            Value b = Value::Numeric(right);
+            if (a.kind == Value::Error || b.kind == Value::Error)
+            {
+                left = a.kind == Value::Error ? a : b;
+                break;
+            }
+            double result = 0;
+            switch (op.code)
+            {
+            case OpCode::Add:
+                result = a.number + b.number;
+                break;
+            case OpCode::Subtract:
+                result = a.number - b.number;
+                break;
+            case OpCode::Multiply:
+                result = a.number * b.number;
+                break;
+            case OpCode::Divide:
+                if (b.number == 0)
+                {
+                    left = Value::OfError(kDivideByZero);
+                    continue;
+                }
+                result = a.number / b.number;
+                break;
+            default:
+                result = std::pow(a.number, b.number);
+                break;
+            }
+            left = std::isfinite(result) ? Value::Of(result) : Value::OfError(kNumberError);
+            break;
+        }
+        }
+    }
+    return stack[0];
+}
+
+FormulaEngine::Value FormulaEngine::Read(uint32_t row, uint32_t column) const
+{
+    CellValue cell = m_sheet->Get(row, column);
+    switch (cell.Type())
+    {
+    case CellType::Number:
+        return Value::Of(cell.AsNumber());
+    case CellType::Bool:
+        return Value::OfBool(cell.AsBool());
+    case CellType::String:
+        if (std::optional<uint32_t> error = ErrorIn(row, column, cell))
+            return Value::OfError(*error);
+        return Value{Value::String, cell.AsString(), 0};
+    default:
+        return Value{};
+    }
+}
+
+std::optional<uint32_t> FormulaEngine::ErrorIn(uint32_t row, uint32_t column, CellValue cell) const
+{
+    // 先比字符串编号，绝大多数文本单元格到这里就结束了，不必查公式
+    auto text = std::find(std::begin(m_errors), std::end(m_errors), cell.AsString());
+    if (text == std::end(m_errors))
+        return std::nullopt;
+    FormulaId const *id = m_ids.Find(HashOf(CellKey(row, column)));
+    if (!id || !m_formulas[*id].error)
+        return std::nullopt;
+    return uint32_t(text - std::begin(m_errors));
+}
+
+FormulaEngine::Value FormulaEngine::Aggregate(uint8_t function, Value const *args, size_t argc,
+                                              std::vector<Op> const &code) const
+{
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    size_t count = 0;
+    auto add = [&](double number) {
+        sum += number;
+        min = std::min(min, number);
+        max = std::max(max, number);
+        count++;
+    };
+
+    // 区域里只算数字，跳过文本和布尔值，和常见的电子表格一样；COUNT 连错误也跳过
+    std::optional<Value> error;
+    for (size_t i = 0; i < argc; i++)
+    {
+        Value const &arg = args[i];
+        if (arg.kind == Value::Range)
+        {
+            Op const &range = code[arg.index];
+            ForEachInRange(*m_sheet, range.ref.row, range.ref.last_row, range.ref.column, range.ref.last_column,
+                           [&](uint32_t row, uint32_t column, CellValue cell) {
+                               if (cell.Type() == CellType::Number)
+                                   add(cell.AsNumber());
+                               else if (cell.Type() == CellType::String && !error)
+                               {
+                                   if (std::optional<uint32_t> e = ErrorIn(row, column, cell))
+                                       error = Value::OfError(*e);
+                               }
+                           });
+        }
+        else if (function == kCount)
+        {
+            if (arg.kind == Value::Number)
+                add(arg.number);
+        }
+        else
+        {
+            Value number = Value::Numeric(arg);
+            if (number.kind == Value::Error)
+                return number;
+            add(number.number);
+        }
+    }
+
+    if (error && function != kCount)
+        return *error;
+    switch (function)
+    {
+    case kSum:
+        return Value::Of(sum);
+    case kMin:
+        return Value::Of(count ? min : 0);
+    case kMax:
+        return Value::Of(count ? max : 0);
+    case kCount:
+        return Value::Of(double(count));
+    default:
+        return count ? Value::Of(sum / double(count)) : Value::OfError(kDivideByZero);
+    }
+}
+
+int FormulaEngine::Compare(Value const &a, Value const &b) const
+{
+    // 空单元格和另一边的零值相等：0 、FALSE 或者空字符串
+    auto fill = [](Value value, Value const &other) {
+        if (value.kind != Value::Empty || other.kind == Value::String)
+            return value;
+        return other.kind == Value::Bool ? Value::OfBool(false) : Value::Of(0);
+    };
+    Value x = fill(a, b);
+    Value y = fill(b, a);
+
+    // 不同类型之间：数字 < 文本 < 布尔值
+    auto rank = [](Value const &value) {
+        return value.kind == Value::Number ? 0 : value.kind == Value::Bool ? 2 : 1;
+    };
+    if (rank(x) != rank(y))
+        return rank(x) < rank(y) ? -1 : 1;
+    if (x.kind == Value::Number || x.kind == Value::Bool)
+        return x.number < y.number ? -1 : x.number > y.number ? 1 : 0;
+
+    // 字符串的编号相同，内容一定相同
+    if (x.kind == Value::String && y.kind == Value::String && x.index == y.index)
+        return 0;
+    std::string_view left = x.kind == Value::String ? m_sheet->Strings().Get(x.index) : std::string_view{};
+    std::string_view right = y.kind == Value::String ? m_sheet->Strings().Get(y.index) : std::string_view{};
+    int order = left.compare(right);
+    return order < 0 ? -1 : order > 0 ? 1 : 0;
+}
+
+CellValue FormulaEngine::Store(Value const &value) const
+{
+    switch (value.kind)
+    {
+    case Value::Number:
+        return CellValue::Number(value.number);
+    case Value::Bool:
+        return CellValue::Bool(value.number != 0);
+    case Value::String:
+        return CellValue::String(value.index);
+    case Value::Error:
+        return CellValue::String(m_errors[value.index]);
+    default:
+        // 引用空单元格的公式结果是 0
+        return CellValue::Number(0);
+    }
+}
+
+} // namespace llama
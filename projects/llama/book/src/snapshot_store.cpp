@@ -0,0 +1,343 @@
+#include "book/snapshot_store.h"
+#include "foundation/exceptions.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llama
+{
+
+namespace
+{
+
+// 每个字符串页的字符串数。写满的页不会再变，之后的版本直接共用
+constexpr size_t kStringsPerPage = 4096;
+
+constexpr uint8_t kChunkHasNumbers = 1;
+constexpr uint8_t kChunkHasStrings = 2;
+
+void WriteHash(ArchiveWriter &out, Hash const &hash)
+{
+    out.WriteU64(hash.Data1());
+    out.WriteU64(hash.Data2());
+}
+
+Hash ReadHash(ArchiveReader &in)
+{
+    uint64_t data1 = in.ReadU64();
+    return Hash{data1, in.ReadU64()};
+}
+
+// 一块单元格。对象的哈希就是块的 ContentHash
+class ChunkObject : public ArchiveObject
+{
+  public:
+    ChunkObject() = default;
+
+    explicit ChunkObject(std::shared_ptr<ColumnChunk const> chunk) : m_chunk{std::move(chunk)}
+    {
+    }
+
+    std::shared_ptr<ColumnChunk const> const &Chunk() const
+    {
+        return m_chunk;
+    }
+
+    Hash HashAsObject() const override
+    {
+        return m_chunk->ContentHash();
+    }
+
+    void WriteAsObject(ArchiveWriter &out) const override
+    {
+        ColumnChunk const &chunk = *m_chunk;
+        auto any = [](uint64_t const *bits) {
+            return std::any_of(bits, bits + ColumnChunk::kWords, [](uint64_t word) { return word != 0; });
+        };
+        bool numbers = any(chunk.NumberBits());
+        bool strings = any(chunk.StringBits());
+        out.WriteU8(uint8_t((numbers ? kChunkHasNumbers : 0) | (strings ? kChunkHasStrings : 0)));
+        for (uint64_t const *bits : {chunk.NumberBits(), chunk.BoolBits(), chunk.BoolValues(), chunk.StringBits()})
+        {
+            for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+            {
+                out.WriteU64(bits[word]);
+            }
+        }
+        for (uint32_t slot = 0; numbers && slot < ColumnChunk::kRows; slot++)
+        {
+            out.WriteF64(chunk.Numbers()[slot]);
+        }
+        for (uint32_t slot = 0; strings && slot < ColumnChunk::kRows; slot++)
+        {
+            out.WriteU32(chunk.Strings()[slot]);
+        }
+    }
+
+    void ReadAsObject(ArchiveReader &in) override
+    {
+        uint8_t flags = in.ReadU8();
+        uint64_t bits[4][ColumnChunk::kWords];
+        for (auto &bitmap : bits)
+        {
+            for (uint64_t &word : bitmap)
+            {
+                word = in.ReadU64();
+            }
+        }
+        std::vector<double> numbers((flags & kChunkHasNumbers) ? ColumnChunk::kRows : 0);
+        for (double &number : numbers)
+        {
+            number = in.ReadF64();
+        }
+        std::vector<StringId> strings((flags & kChunkHasStrings) ? ColumnChunk::kRows : 0);
+        for (StringId &id : strings)
+        {
+            id = in.ReadU32();
+        }
+
+        for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+        {
+            // 依次是数字、布尔、布尔值、字符串的位图：类型互斥，布尔值只能在布尔单元格上
+            bool overlap = (bits[0][word] & bits[1][word]) || (bits[0][word] & bits[3][word]) ||
+                           (bits[1][word] & bits[3][word]) || (bits[2][word] & ~bits[1][word]);
+            if (overlap || (numbers.empty() && bits[0][word]) || (strings.empty() && bits[3][word]))
+                throw Exception{ExceptionKind::InvalidArchive, "invalid chunk"};
+        }
+        ColumnChunkView view{bits[0], bits[1], bits[2], bits[3], numbers.empty() ? nullptr : numbers.data(),
+                             strings.empty() ? nullptr : strings.data()};
+        m_chunk = std::make_shared<ColumnChunk>(view);
+    }
+
+  private:
+    std::shared_ptr<ColumnChunk const> m_chunk;
+};
+
+// 一个工作表：名字，以及每个非空块的位置和哈希
+class SheetObject : public ArchiveObject
+{
+  public:
+    struct Entry
+    {
+        uint32_t column;
+        uint32_t index;
+        Hash chunk;
+    };
+
+    std::string name;
+    std::vector<Entry> chunks;
+
+    void WriteAsObject(ArchiveWriter &out) const override
+    {
+        out.WriteString(name);
+        out.WriteVarUint(chunks.size());
+        for (Entry const &entry : chunks)
+        {
+            out.WriteVarUint(entry.column);
+            out.WriteVarUint(entry.index);
+            WriteHash(out, entry.chunk);
+        }
+    }
+
+    void ReadAsObject(ArchiveReader &in) override
+    {
+        name = in.ReadString();
+        uint64_t count = in.ReadVarUint();
+        chunks.clear();
+        for (uint64_t i = 0; i < count; i++)
+        {
+            uint64_t column = in.ReadVarUint();
+            uint64_t index = in.ReadVarUint();
+            if (column >= Worksheet::kMaxColumns || index >= Worksheet::kMaxRows / ColumnChunk::kRows)
+                throw Exception{ExceptionKind::InvalidArchive, "invalid chunk position"};
+            chunks.push_back({uint32_t(column), uint32_t(index), ReadHash(in)});
+        }
+    }
+
+    void ForEachReference(std::function<void(Hash const &)> const &visit) const override
+    {
+        for (Entry const &entry : chunks)
+        {
+            visit(entry.chunk);
+        }
+    }
+};
+
+// 连续编号的一页字符串
+class StringPageObject : public ArchiveObject
+{
+  public:
+    std::vector<std::string> strings;
+
+    void WriteAsObject(ArchiveWriter &out) const override
+    {
+        out.WriteVarUint(strings.size());
+        for (std::string const &text : strings)
+        {
+            out.WriteString(text);
+        }
+    }
+
+    void ReadAsObject(ArchiveReader &in) override
+    {
+        uint64_t count = in.ReadVarUint();
+        if (count > kStringsPerPage)
+            throw Exception{ExceptionKind::InvalidArchive, "invalid string page"};
+        strings.clear();
+        for (uint64_t i = 0; i < count; i++)
+        {
+            strings.emplace_back(in.ReadString());
+        }
+    }
+};
+
+// 一个版本：字符串页和工作表，按顺序
+class VersionObject : public ArchiveObject
+{
+  public:
+    std::vector<Hash> pages;
+    std::vector<Hash> sheets;
+
+    void WriteAsObject(ArchiveWriter &out) const override
+    {
+        out.WriteVarUint(pages.size());
+        for (Hash const &page : pages)
+        {
+            WriteHash(out, page);
+        }
+        out.WriteVarUint(sheets.size());
+        for (Hash const &sheet : sheets)
+        {
+            WriteHash(out, sheet);
+        }
+    }
+
+    void ReadAsObject(ArchiveReader &in) override
+    {
+        pages.clear();
+        for (uint64_t count = in.ReadVarUint(); count > 0; count--)
+        {
+            pages.push_back(ReadHash(in));
+        }
+        sheets.clear();
+        for (uint64_t count = in.ReadVarUint(); count > 0; count--)
+        {
+            sheets.push_back(ReadHash(in));
+        }
+    }
+
+    void ForEachReference(std::function<void(Hash const &)> const &visit) const override
+    {
+        for (Hash const &page : pages)
+        {
+            visit(page);
+        }
+        for (Hash const &sheet : sheets)
+        {
+            visit(sheet);
+        }
+    }
+};
+
+// 仓库里没有同样的对象时才存放
+Hash Put(ObjectStore &store, sp<Object> object)
+{
+    Hash hash = object->HashAsObject();
+    if (!store.Contains(hash))
+        store.Store(std::move(object));
+    return hash;
+}
+
+template <typename T> sp<T> Fetch(ObjectStore &store, Hash const &hash)
+{
+    auto object = std::dynamic_pointer_cast<T>(store.Retrieve<Object>(hash));
+    if (!object)
+        throw Exception{ExceptionKind::InvalidArchive, "unexpected object type"};
+    return object;
+}
+
+} // namespace
+
+Hash StoreSnapshot(WorkbookSnapshot const &snapshot, ObjectStore &store)
+{
+    auto version = std::make_shared<VersionObject>();
+    StringPool const &strings = snapshot.Strings();
+    for (size_t first = 0; first < snapshot.StringCount(); first += kStringsPerPage)
+    {
+        auto page = std::make_shared<StringPageObject>();
+        size_t last = std::min(first + kStringsPerPage, snapshot.StringCount());
+        for (size_t id = first; id < last; id++)
+        {
+            page->strings.emplace_back(strings.Get(StringId(id)));
+        }
+        version->pages.push_back(Put(store, std::move(page)));
+    }
+
+    for (size_t i = 0; i < snapshot.SheetCount(); i++)
+    {
+        Worksheet const &sheet = snapshot.Sheet(i);
+        auto object = std::make_shared<SheetObject>();
+        object->name = sheet.Name();
+        for (uint32_t c = 0; c < sheet.ColumnCount(); c++)
+        {
+            Column const &column = *sheet.FindColumn(c);
+            for (size_t index = 0; index < column.ChunkCount(); index++)
+            {
+                std::shared_ptr<ColumnChunk const> chunk = column.SharedChunk(index);
+                if (!chunk)
+                    continue;
+                // 先查哈希，没改过的块不必创建对象
+                Hash hash = chunk->ContentHash();
+                if (!store.Contains(hash))
+                    store.Store(std::make_shared<ChunkObject>(std::move(chunk)));
+                object->chunks.push_back({c, uint32_t(index), hash});
+            }
+        }
+        version->sheets.push_back(Put(store, std::move(object)));
+    }
+    return Put(store, std::move(version));
+}
+
+Workbook LoadSnapshot(ObjectStore &store, Hash const &version)
+{
+    auto root = Fetch<VersionObject>(store, version);
+    Workbook book;
+    StringPool &strings = book.Strings();
+    for (Hash const &hash : root->pages)
+    {
+        for (std::string const &text : Fetch<StringPageObject>(store, hash)->strings)
+        {
+            // 字符串池里的字符串互不相同，按顺序放回去编号不变
+            if (strings.Intern(text) != strings.Size() - 1)
+                throw Exception{ExceptionKind::InvalidArchive, "duplicate string"};
+        }
+    }
+
+    for (Hash const &hash : root->sheets)
+    {
+        auto object = Fetch<SheetObject>(store, hash);
+        Worksheet &sheet = book.AddSheet(object->name);
+        for (SheetObject::Entry const &entry : object->chunks)
+        {
+            std::shared_ptr<ColumnChunk const> chunk = Fetch<ChunkObject>(store, entry.chunk)->Chunk();
+            bool valid = true;
+            for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+            {
+                for (uint64_t bits = chunk->StringBits()[word]; bits != 0; bits &= bits - 1)
+                {
+                    valid &= chunk->Strings()[word * 64 + uint32_t(std::countr_zero(bits))] < strings.Size();
+                }
+            }
+            if (!valid)
+                throw Exception{ExceptionKind::InvalidArchive, "string id out of range"};
+            // 仓库里的块不会被修改；工作表写到它之前会先复制，因为两边都持有它
+            sheet.SetChunk(entry.column, entry.index, std::const_pointer_cast<ColumnChunk>(chunk));
+        }
+    }
+    return book;
+}
+
+} // namespace llama
@@ -0,0 +1,384 @@
+#include "book/sort.h"
+#include "foundation/exceptions.h"
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+namespace llama
+{
+
+namespace
+{
+
+// 行数不到这么多时不并行
+constexpr size_t kParallelRows = size_t{1} << 18;
+// 并行归并时每份至少这么多行
+constexpr size_t kMergeRows = size_t{1} << 16;
+
+// 类别：升序时数字、文本、布尔值、空单元格；降序时前三种反过来，空单元格仍在最后
+constexpr uint8_t kEmptyKind = 3;
+
+uint8_t KindOf(CellType type, bool descending)
+{
+    switch (type)
+    {
+    case CellType::Number:
+        return descending ? 2 : 0;
+    case CellType::String:
+        return 1;
+    case CellType::Bool:
+        return descending ? 0 : 2;
+    default:
+        return kEmptyKind;
+    }
+}
+
+// 按无符号整数比较时和按值比较的顺序相同。+0.0 把 -0 变成 0
+uint64_t NumberCode(double number)
+{
+    uint64_t bits = std::bit_cast<uint64_t>(number + 0.0);
+    return (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+}
+
+// 一个键在区域每一行上的值，按行号减去区域首行索引。先比类别，再比编码
+struct KeyColumn
+{
+    std::vector<uint64_t> codes;
+    std::vector<uint8_t> kinds;
+
+    bool Less(uint32_t a, uint32_t b) const
+    {
+        if (kinds[a] != kinds[b])
+            return kinds[a] < kinds[b];
+        return codes[a] < codes[b];
+    }
+};
+
+// 基数排序的一项。row 是行号减去区域首行
+struct Entry
+{
+    uint64_t code;
+    uint32_t row;
+    uint8_t kind;
+};
+
+// 对 [first_row, last_row] 行里的一块取出编码和类别。字符串的编码暂时是编号
+void ExtractChunk(ColumnChunk const &chunk, uint32_t base, uint32_t first_row, uint32_t last_row, bool descending,
+                  KeyColumn &key)
+{
+    uint32_t begin = std::max(base, first_row) - base;
+    uint32_t end = uint32_t(std::min<uint64_t>(uint64_t{base} + ColumnChunk::kRows - 1, last_row) - base + 1);
+    for (uint32_t word = begin / 64; word * 64 < end; word++)
+    {
+        // 只看区域里的行
+        uint64_t mask = ~uint64_t{0};
+        if (word == begin / 64)
+            mask &= ~uint64_t{0} << (begin % 64);
+        if (word == (end - 1) / 64 && end % 64 != 0)
+            mask &= ~uint64_t{0} >> (64 - end % 64);
+        auto put = [&](uint64_t bits, CellType type, auto &&code) {
+            for (bits &= mask; bits != 0; bits &= bits - 1)
+            {
+                uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                size_t at = base + slot - first_row;
+                key.codes[at] = code(slot);
+                key.kinds[at] = KindOf(type, descending);
+            }
+        };
+        put(chunk.NumberBits()[word], CellType::Number,
+            [&](uint32_t slot) { return NumberCode(chunk.Numbers()[slot]); });
+        put(chunk.StringBits()[word], CellType::String,
+            [&](uint32_t slot) { return uint64_t{chunk.Strings()[slot]}; });
+        put(chunk.BoolBits()[word], CellType::Bool,
+            [&](uint32_t slot) { return (chunk.BoolValues()[word] >> (slot % 64)) & 1; });
+    }
+}
+
+KeyColumn Extract(Worksheet const &sheet, uint32_t first_row, uint32_t last_row, SortKey key, ThreadPool *pool)
+{
+    size_t rows = size_t(last_row) - first_row + 1;
+    KeyColumn result;
+    result.codes.assign(rows, 0);
+    result.kinds.assign(rows, kEmptyKind);
+    Column const *column = sheet.FindColumn(key.column);
+    if (!column)
+        return result;
+
+    size_t first_chunk = first_row / ColumnChunk::kRows;
+    size_t chunks = std::min<size_t>(last_row / ColumnChunk::kRows + 1, column->ChunkCount());
+    auto extract = [&](size_t i) {
+        size_t index = first_chunk + i;
+        if (ColumnChunk const *chunk = column->Chunk(index))
+            ExtractChunk(*chunk, uint32_t(index * ColumnChunk::kRows), first_row, last_row, key.descending, result);
+    };
+    size_t count = chunks > first_chunk ? chunks - first_chunk : 0;
+    if (pool && rows >= kParallelRows)
+    {
+        pool->ParallelFor(count, extract);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            extract(i);
+        }
+    }
+
+    // 字符串换成区域里出现过的字符串按文本排序后的名次。字符串池里的字符串互不相同，名次不会重复
+    uint8_t string_kind = KindOf(CellType::String, key.descending);
+    std::vector<uint32_t> rank;
+    std::vector<StringId> ids;
+    for (size_t i = 0; i < rows; i++)
+    {
+        if (result.kinds[i] != string_kind)
+            continue;
+        if (rank.empty())
+            rank.assign(sheet.Strings().Size(), UINT32_MAX);
+        uint32_t &seen = rank[result.codes[i]];
+        if (seen == UINT32_MAX)
+        {
+            seen = 0;
+            ids.push_back(StringId(result.codes[i]));
+        }
+    }
+    if (!ids.empty())
+    {
+        StringPool const &strings = sheet.Strings();
+        std::sort(ids.begin(), ids.end(), [&](StringId a, StringId b) { return strings.Get(a) < strings.Get(b); });
+        for (uint32_t i = 0; i < ids.size(); i++)
+        {
+            rank[ids[i]] = i;
+        }
+    }
+
+    for (size_t i = 0; i < rows; i++)
+    {
+        if (result.kinds[i] == string_kind)
+            result.codes[i] = rank[result.codes[i]];
+        // 降序时编码取反；空单元格的编码都是 0 ，彼此相同
+        if (key.descending && result.kinds[i] != kEmptyKind)
+            result.codes[i] = ~result.codes[i];
+    }
+    return result;
+}
+
+uint32_t DigitOf(Entry const &entry, int digit)
+{
+    return digit < 8 ? uint32_t(entry.code >> (8 * digit)) & 0xFF : entry.kind;
+}
+
+// 按 (kind, code) 做稳定的 LSD 基数排序。一次扫描统计全部 9 个数位，所有项都相同的数位直接跳过
+void RadixSort(std::span<Entry> entries, std::span<Entry> scratch)
+{
+    if (entries.size() < 2)
+        return;
+    size_t counts[9][256] = {};
+    for (Entry const &entry : entries)
+    {
+        for (int digit = 0; digit < 9; digit++)
+        {
+            counts[digit][DigitOf(entry, digit)]++;
+        }
+    }
+
+    Entry *from = entries.data();
+    Entry *to = scratch.data();
+    for (int digit = 0; digit < 9; digit++)
+    {
+        if (counts[digit][DigitOf(entries[0], digit)] == entries.size())
+            continue;
+        size_t offsets[256];
+        size_t sum = 0;
+        for (uint32_t value = 0; value < 256; value++)
+        {
+            offsets[value] = sum;
+            sum += counts[digit][value];
+        }
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            to[offsets[DigitOf(from[i], digit)]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != entries.data())
+        std::copy_n(from, entries.size(), entries.data());
+}
+
+// 从最后一个键开始，每个键对 rows 做一遍稳定的基数排序。rows 是行号减去区域首行
+void SortPart(std::span<const KeyColumn> keys, std::span<uint32_t> rows, std::span<Entry> entries,
+              std::span<Entry> scratch)
+{
+    for (size_t k = keys.size(); k-- > 0;)
+    {
+        KeyColumn const &key = keys[k];
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            entries[i] = {key.codes[rows[i]], rows[i], key.kinds[rows[i]]};
+        }
+        RadixSort(entries, scratch);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            rows[i] = entries[i].row;
+        }
+    }
+}
+
+} // namespace
+
+RowOrder::RowOrder(uint32_t first_row, uint32_t last_row) : m_first_row{first_row}, m_last_row{last_row}
+{
+    if (first_row >= Worksheet::kMaxRows || last_row >= Worksheet::kMaxRows)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    if (first_row <= last_row)
+    {
+        m_rows.resize(size_t(last_row) - first_row + 1);
+        std::iota(m_rows.begin(), m_rows.end(), first_row);
+    }
+}
+
+void RowOrder::Sort(Worksheet const &sheet, std::span<const SortKey> keys, ThreadPool *pool)
+{
+    for (SortKey const &key : keys)
+    {
+        if (key.column >= Worksheet::kMaxColumns)
+            throw Exception{ExceptionKind::IndexOutofRange};
+    }
+    if (m_rows.size() < 2 || keys.empty())
+        return;
+    if (pool && (pool->ThreadCount() < 2 || m_rows.size() < kParallelRows))
+        pool = nullptr;
+
+    std::vector<KeyColumn> columns;
+    for (SortKey const &key : keys)
+    {
+        columns.push_back(Extract(sheet, m_first_row, m_last_row, key, pool));
+    }
+    std::vector<uint32_t> rows(m_rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        rows[i] = m_rows[i] - m_first_row;
+    }
+
+    // 切成几段分别排序。不并行时只有一段
+    size_t parts = pool ? pool->ThreadCount() : 1;
+    std::vector<size_t> bounds(parts + 1);
+    for (size_t i = 0; i <= parts; i++)
+    {
+        bounds[i] = rows.size() * i / parts;
+    }
+    {
+        std::vector<Entry> entries(rows.size());
+        std::vector<Entry> scratch(rows.size());
+        auto sort = [&](size_t i) {
+            size_t begin = bounds[i];
+            size_t size = bounds[i + 1] - begin;
+            SortPart(columns, std::span{rows}.subspan(begin, size), std::span{entries}.subspan(begin, size),
+                     std::span{scratch}.subspan(begin, size));
+        };
+        if (pool)
+            pool->ParallelFor(parts, sort);
+        else
+            sort(0);
+    }
+
+    // 两两归并相邻的段。相同时取左边的，左边的段原来就排在前面，所以仍然稳定
+    auto less = [&](uint32_t a, uint32_t b) {
+        for (KeyColumn const &key : columns)
+        {
+            if (key.Less(a, b))
+                return true;
+            if (key.Less(b, a))
+                return false;
+        }
+        return false;
+    };
+    // 合并 a 和 b 时输出的前 d 项里有几项来自 a
+    auto co_rank = [&](std::span<const uint32_t> a, std::span<const uint32_t> b, size_t d) {
+        size_t low = d > b.size() ? d - b.size() : 0;
+        size_t high = std::min(d, a.size());
+        while (low < high)
+        {
+            size_t mid = (low + high) / 2;
+            if (!less(b[d - mid - 1], a[mid]))
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    };
+    struct Task
+    {
+        std::span<const uint32_t> a;
+        std::span<const uint32_t> b;
+        uint32_t *out;
+    };
+    std::vector<uint32_t> merged(rows.size());
+    while (bounds.size() > 2)
+    {
+        std::vector<Task> tasks;
+        std::vector<size_t> next;
+        size_t share = std::max(kMergeRows, rows.size() / (pool->ThreadCount() * 4));
+        for (size_t j = 0; j + 1 < bounds.size(); j += 2)
+        {
+            next.push_back(bounds[j]);
+            std::span<const uint32_t> a{rows.data() + bounds[j], rows.data() + bounds[j + 1]};
+            std::span<const uint32_t> b;
+            if (j + 2 < bounds.size())
+                b = {rows.data() + bounds[j + 1], rows.data() + bounds[j + 2]};
+            size_t total = a.size() + b.size();
+            size_t pieces = std::max<size_t>(1, total / share);
+            size_t i0 = 0;
+            for (size_t piece = 0; piece < pieces; piece++)
+            {
+                size_t d0 = total * piece / pieces;
+                size_t d1 = total * (piece + 1) / pieces;
+                size_t i1 = co_rank(a, b, d1);
+                tasks.push_back({a.subspan(i0, i1 - i0), b.subspan(d0 - i0, (d1 - i1) - (d0 - i0)),
+                                 merged.data() + bounds[j] + d0});
+                i0 = i1;
+            }
+        }
+        next.push_back(rows.size());
+        pool->ParallelFor(tasks.size(), [&](size_t i) {
+            std::merge(tasks[i].a.begin(), tasks[i].a.end(), tasks[i].b.begin(), tasks[i].b.end(), tasks[i].out, less);
+        });
+        rows.swap(merged);
+        bounds = std::move(next);
+    }
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        m_rows[i] = rows[i] + m_first_row;
+    }
+}
+
+void RowOrder::Apply(Worksheet &sheet, uint32_t first_column, uint32_t last_column) const
+{
+    if (first_column >= Worksheet::kMaxColumns || last_column >= Worksheet::kMaxColumns)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    if (m_first_row > m_last_row)
+        return;
+    uint32_t columns = std::min(last_column + 1, sheet.ColumnCount());
+    uint32_t end = std::min(m_last_row + 1, sheet.RowCount());
+    std::vector<CellValue> values(m_rows.size());
+    for (uint32_t column = first_column; column < columns; column++)
+    {
+        // 先按排列读出整列，再按顺序写回
+        for (size_t i = 0; i < m_rows.size(); i++)
+        {
+            values[i] = sheet.Get(m_rows[i], column);
+        }
+        for (size_t i = 0; i < m_rows.size(); i++)
+        {
+            uint32_t row = m_first_row + uint32_t(i);
+            if (!values[i].Empty() || !sheet.Get(row, column).Empty())
+                sheet.Set(row, column, values[i]);
+        }
+        for (uint32_t row = m_first_row + uint32_t(m_rows.size()); row < end; row++)
+        {
+            sheet.Clear(row, column);
+        }
+    }
+}
+
+} // namespace llama
@@ -0,0 +1,126 @@
+#include "book/string_pool.h"
+#include "foundation/exceptions.h"
+#include "foundation/hasher.h"
+#include <algorithm>
+#include <cstring>
+
+namespace llama
+{
+
+namespace
+{
+
+// 每块缓冲区的大小。比它的四分之一还长的字符串单独分配，免得浪费块尾
+constexpr size_t kBlockSize = 64 * 1024;
+// 编号表每页的项数
+constexpr size_t kPageSize = 4096;
+
+// 冲突时的下一个探测键。表里的槽位按 Data1 分布，所以改的是 Data1
+Hash NextKey(Hash const &key)
+{
+    return Hash{key.Data1() + 0x9e3779b97f4a7c15ull, key.Data2()};
+}
+
+} // namespace
+
+Hash StringPool::DefaultHash(std::string_view text)
+{
+    return Hasher128::Of(text.data(), text.size());
+}
+
+std::optional<StringId> StringPool::Lookup(std::string_view text, Hash &key) const
+{
+    // 字符串从不删除，探测键的序列上不会有空洞：遇到第一个不在表里的键就说明没有这个字符串
+    for (key = m_hasher(text);; key = NextKey(key))
+    {
+        StringId const *id = m_ids.Find(key);
+        if (!id)
+            return std::nullopt;
+        if (Get(*id) == text)
+            return *id;
+    }
+}
+
+StringId StringPool::Intern(std::string_view text)
+{
+    Hash key{0, 0};
+    if (std::optional<StringId> id = Lookup(text, key))
+        return *id;
+    size_t size = m_size.load(std::memory_order_relaxed);
+    if (size >= UINT32_MAX)
+        throw Exception{ExceptionKind::InvalidState, "too many strings"};
+
+    std::string_view *const *table = m_table.load(std::memory_order_relaxed);
+    if (size % kPageSize == 0)
+    {
+        size_t page = size / kPageSize;
+        if (page == m_table_capacity)
+        {
+            // 页表满了换一张两倍大的。读者只会用到已经发布的编号，旧页表里的那些项不变
+            size_t capacity = std::max<size_t>(m_table_capacity * 2, 16);
+            auto &grown = m_tables.emplace_back(std::make_unique<std::string_view *[]>(capacity));
+            std::copy_n(table, m_table_capacity, grown.get());
+            m_table_capacity = capacity;
+            table = grown.get();
+        }
+        m_tables.back()[page] = m_pages.emplace_back(std::make_unique<std::string_view[]>(kPageSize)).get();
+        m_table.store(table, std::memory_order_release);
+    }
+    table[size / kPageSize][size % kPageSize] = Store(text);
+    m_size.store(size + 1, std::memory_order_release);
+
+    StringId id = StringId(size);
+    m_ids.Insert(key, id);
+    return id;
+}
+
+std::optional<StringId> StringPool::Find(std::string_view text) const
+{
+    Hash key{0, 0};
+    return Lookup(text, key);
+}
+
+std::string_view StringPool::Get(StringId id) const
+{
+    if (id >= m_size.load(std::memory_order_acquire))
+        throw Exception{ExceptionKind::IndexOutofRange};
+    return m_table.load(std::memory_order_acquire)[id / kPageSize][id % kPageSize];
+}
+
+size_t StringPool::MemoryUsage() const
+{
+    size_t tables = 0;
+    for (size_t capacity = m_table_capacity; capacity >= 16; capacity /= 2)
+    {
+        tables += capacity * sizeof(std::string_view *);
+    }
+    return sizeof(StringPool) + m_allocated + m_blocks.capacity() * sizeof(m_blocks[0]) +
+           m_pages.size() * kPageSize * sizeof(std::string_view) + m_tables.capacity() * sizeof(m_tables[0]) +
+           m_pages.capacity() * sizeof(m_pages[0]) + tables + m_ids.MemoryUsage();
+}
+
+std::string_view StringPool::Store(std::string_view text)
+{
+    if (text.empty())
+        return {};
+    if (text.size() > kBlockSize / 4)
+    {
+        auto &block = m_blocks.emplace_back(std::make_unique_for_overwrite<char[]>(text.size()));
+        m_allocated += text.size();
+        std::memcpy(block.get(), text.data(), text.size());
+        return {block.get(), text.size()};
+    }
+    if (text.size() > m_remaining)
+    {
+        m_cursor = m_blocks.emplace_back(std::make_unique_for_overwrite<char[]>(kBlockSize)).get();
+        m_remaining = kBlockSize;
+        m_allocated += kBlockSize;
+    }
+    std::memcpy(m_cursor, text.data(), text.size());
+    std::string_view stored{m_cursor, text.size()};
+    m_cursor += text.size();
+    m_remaining -= text.size();
+    return stored;
+}
+
+} // namespace llama
@@ -0,0 +1,100 @@
+#include "book/workbook.h"
+#include "foundation/exceptions.h"
+#include <optional>
+#include <utility>
+
+namespace llama
+{
+
+Workbook::Workbook() : m_strings{std::make_shared<StringPool>()}
+{
+}
+
+Workbook::~Workbook() = default;
+Workbook::Workbook(Workbook &&) noexcept = default;
+Workbook &Workbook::operator=(Workbook &&) noexcept = default;
+
+Worksheet &Workbook::AddSheet(std::string name)
+{
+    if (FindSheet(name))
+        throw Exception{ExceptionKind::ElementAlreadyExists};
+    return *m_sheets.emplace_back(std::make_unique<Worksheet>(std::move(name), *m_strings));
+}
+
+void Workbook::RemoveSheet(size_t index)
+{
+    if (index >= m_sheets.size())
+        throw Exception{ExceptionKind::IndexOutofRange};
+    m_sheets.erase(m_sheets.begin() + std::ptrdiff_t(index));
+}
+
+Worksheet &Workbook::Sheet(size_t index)
+{
+    if (index >= m_sheets.size())
+        throw Exception{ExceptionKind::IndexOutofRange};
+    return *m_sheets[index];
+}
+
+Worksheet const &Workbook::Sheet(size_t index) const
+{
+    return const_cast<Workbook *>(this)->Sheet(index);
+}
+
+Worksheet *Workbook::FindSheet(std::string_view name)
+{
+    for (auto const &sheet : m_sheets)
+    {
+        if (sheet->Name() == name)
+            return sheet.get();
+    }
+    return nullptr;
+}
+
+WorkbookSnapshot Workbook::Snapshot() const
+{
+    WorkbookSnapshot snapshot;
+    snapshot.m_strings = m_strings;
+    snapshot.m_string_count = m_strings->Size();
+    snapshot.m_sheets.reserve(m_sheets.size());
+    for (auto const &sheet : m_sheets)
+    {
+        snapshot.m_sheets.push_back(sheet->Clone());
+    }
+    return snapshot;
+}
+
+CellValue Workbook::Lookup(size_t sheet, uint32_t key_column, CellValue key, uint32_t result_column) const
+{
+    Worksheet const &target = Sheet(sheet);
+    std::span<const uint32_t> rows = target.FindRows(key_column, key);
+    return rows.empty() ? CellValue{} : target.Get(rows.front(), result_column);
+}
+
+CellValue Workbook::Lookup(size_t sheet, uint32_t key_column, std::string_view key, uint32_t result_column) const
+{
+    if (sheet >= m_sheets.size())
+        throw Exception{ExceptionKind::IndexOutofRange};
+    std::optional<StringId> id = m_strings->Find(key);
+    if (!id)
+        return CellValue{};
+    return Lookup(sheet, key_column, CellValue::String(*id), result_column);
+}
+
+Worksheet const &WorkbookSnapshot::Sheet(size_t index) const
+{
+    if (index >= m_sheets.size())
+        throw Exception{ExceptionKind::IndexOutofRange};
+    return *m_sheets[index];
+}
+
+Worksheet const *WorkbookSnapshot::FindSheet(std::string_view name) const
+{
+    for (auto const &sheet : m_sheets)
+    {
+        if (sheet->Name() == name)
+            return sheet.get();
+    }
+    return nullptr;
+}
+
+} // namespace llama
@@ -0,0 +1,562 @@
+#include "book/workbook_proto.h"
+#include "foundation/mapped_file.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace llama
+{
+
+namespace
+{
+
+// protobuf 的线路类型
+constexpr uint32_t kVarint = 0;
+constexpr uint32_t kFixed64 = 1;
+constexpr uint32_t kLength = 2;
+constexpr uint32_t kFixed32 = 5;
+
+// workbook.proto 里的字段编号
+constexpr uint32_t kWorkbookSheets = 1;
+constexpr uint32_t kSheetName = 1;
+constexpr uint32_t kSheetCells = 2;
+constexpr uint32_t kCellRow = 1;
+constexpr uint32_t kCellColumn = 2;
+constexpr uint32_t kCellText = 3;
+constexpr uint32_t kCellNumber = 4;
+constexpr uint32_t kCellBoolean = 5;
+
+// 工作表长度预留的字节数。不足的高位用 0x80 补齐，protobuf 的解析器都接受这种写法
+constexpr size_t kLengthSize = 5;
+constexpr uint64_t kMaxSheetSize = (uint64_t{1} << (7 * kLengthSize)) - 1;
+
+struct Tag
+{
+    uint32_t field;
+    uint32_t wire;
+};
+
+Tag ReadTag(ArchiveReader &in)
+{
+    uint64_t tag = in.ReadVarUint();
+    if ((tag >> 3) == 0 || (tag >> 32) != 0)
+        throw Exception{ExceptionKind::InvalidFileFormat, "invalid protobuf field tag"};
+    return {uint32_t(tag >> 3), uint32_t(tag & 7)};
+}
+
+// 行号、列号。超出 32 位的值不能截断成别的单元格
+uint32_t ReadIndex(ArchiveReader &in)
+{
+    uint64_t index = in.ReadVarUint();
+    if ((index >> 32) != 0)
+        throw Exception{ExceptionKind::InvalidFileFormat, "cell index out of range"};
+    return uint32_t(index);
+}
+
+void SkipField(ArchiveReader &in, uint32_t wire)
+{
+    switch (wire)
+    {
+    case kVarint:
+        in.ReadVarUint();
+        break;
+    case kFixed64:
+        in.Skip(8);
+        break;
+    case kLength:
+        in.ReadBytes();
+        break;
+    case kFixed32:
+        in.Skip(4);
+        break;
+    default:
+        throw Exception{ExceptionKind::InvalidFileFormat, "unsupported protobuf wire type"};
+    }
+}
+
+// 读出工作表 sheet 的下一个单元格
+bool ReadCell(ArchiveReader &sheet, ProtoCell &cell)
+{
+    while (!sheet.AtEnd())
+    {
+        Tag tag = ReadTag(sheet);
+        if (tag.field != kSheetCells || tag.wire != kLength)
+        {
+            SkipField(sheet, tag.wire);
+            continue;
+        }
+
+        ArchiveReader in{sheet.ReadBytes()};
+        cell = ProtoCell{};
+        while (!in.AtEnd())
+        {
+            Tag field = ReadTag(in);
+            if (field.field == kCellRow && field.wire == kVarint)
+            {
+                cell.row = ReadIndex(in);
+            }
+            else if (field.field == kCellColumn && field.wire == kVarint)
+            {
+                cell.column = ReadIndex(in);
+            }
+            else if (field.field == kCellText && field.wire == kLength)
+            {
+                cell.type = CellType::String;
+                cell.text = in.ReadString();
+            }
+            else if (field.field == kCellNumber && field.wire == kFixed64)
+            {
+                cell.type = CellType::Number;
+                cell.number = in.ReadF64();
+            }
+            else if (field.field == kCellBoolean && field.wire == kVarint)
+            {
+                cell.type = CellType::Bool;
+                cell.boolean = in.ReadVarUint() != 0;
+            }
+            else
+            {
+                SkipField(in, field.wire);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void StoreCell(Worksheet &sheet, ProtoCell const &cell)
+{
+    switch (cell.type)
+    {
+    case CellType::Number:
+        sheet.SetNumber(cell.row, cell.column, cell.number);
+        break;
+    case CellType::Bool:
+        sheet.SetBool(cell.row, cell.column, cell.boolean);
+        break;
+    case CellType::String:
+        sheet.SetText(cell.row, cell.column, cell.text);
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename W> void WriteTag(W &out, uint32_t field, uint32_t wire)
+{
+    out.WriteVarUint((uint64_t{field} << 3) | wire);
+}
+
+// 把 cell 编码成一个 Sheet.cells 字段追加到 out 。空单元格不写。scratch 用来先编码单元格本身，好知道它的长度
+void EncodeCell(ArchiveWriter &out, ArchiveWriter &scratch, ProtoCell const &cell)
+{
+    scratch.Clear();
+    if (cell.row != 0)
+    {
+        WriteTag(scratch, kCellRow, kVarint);
+        scratch.WriteVarUint(cell.row);
+    }
+    if (cell.column != 0)
+    {
+        WriteTag(scratch, kCellColumn, kVarint);
+        scratch.WriteVarUint(cell.column);
+    }
+    switch (cell.type)
+    {
+    case CellType::Number:
+        WriteTag(scratch, kCellNumber, kFixed64);
+        scratch.WriteF64(cell.number);
+        break;
+    case CellType::Bool:
+        WriteTag(scratch, kCellBoolean, kVarint);
+        scratch.WriteVarUint(cell.boolean ? 1 : 0);
+        break;
+    case CellType::String:
+        WriteTag(scratch, kCellText, kLength);
+        scratch.WriteString(cell.text);
+        break;
+    default:
+        return;
+    }
+
+    WriteTag(out, kSheetCells, kLength);
+    out.WriteBytes(scratch.Bytes());
+}
+
+ProtoCell ToProtoCell(Worksheet const &sheet, uint32_t row, uint32_t column, CellValue value)
+{
+    ProtoCell cell;
+    cell.row = row;
+    cell.column = column;
+    cell.type = value.Type();
+    switch (value.Type())
+    {
+    case CellType::Number:
+        cell.number = value.AsNumber();
+        break;
+    case CellType::Bool:
+        cell.boolean = value.AsBool();
+        break;
+    case CellType::String:
+        cell.text = sheet.Strings().Get(value.AsString());
+        break;
+    default:
+        break;
+    }
+    return cell;
+}
+
+void WriteSheet(WorkbookProtoWriter &writer, Worksheet const &sheet)
+{
+    writer.BeginSheet(sheet.Name());
+    for (uint32_t c = 0; c < sheet.ColumnCount(); c++)
+    {
+        sheet.FindColumn(c)->ForEach(
+            [&](uint32_t row, CellValue value) { writer.WriteCell(ToProtoCell(sheet, row, c, value)); });
+    }
+    writer.EndSheet();
+}
+
+// 除了文本之外，一个单元格编码之后最多的字节数：字段的标签和长度，行、列、值各自的标签和内容
+constexpr size_t kMaxCellOverhead = 32;
+
+// 工作表里的一块单元格，并行写出时的最小单位
+struct ChunkPiece
+{
+    size_t sheet;
+    uint32_t column;
+    uint32_t index;
+    ColumnChunk const *chunk;
+    // 编码之后最多的字节数
+    size_t size;
+};
+
+// 把一块单元格编码成 Sheet.cells 字段追加到 out ，顺序和 WriteSheet 相同
+void EncodeChunk(ArchiveWriter &out, Worksheet const &sheet, ChunkPiece const &piece)
+{
+    ArchiveWriter scratch;
+    ColumnChunk const &chunk = *piece.chunk;
+    uint32_t base = piece.index * ColumnChunk::kRows;
+    for (uint32_t word = 0; word < ColumnChunk::kWords; word++)
+    {
+        uint64_t bits = chunk.NumberBits()[word] | chunk.BoolBits()[word] | chunk.StringBits()[word];
+        for (; bits != 0; bits &= bits - 1)
+        {
+            uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+            EncodeCell(out, scratch, ToProtoCell(sheet, base + slot, piece.column, chunk.Get(slot)));
+        }
+    }
+}
+
+} // namespace
+
+WorkbookProtoReader::WorkbookProtoReader(std::span<const std::byte> data) : m_workbook{data}
+{
+}
+
+bool WorkbookProtoReader::NextSheet()
+{
+    while (!m_workbook.AtEnd())
+    {
+        Tag tag = ReadTag(m_workbook);
+        if (tag.field != kWorkbookSheets || tag.wire != kLength)
+        {
+            SkipField(m_workbook, tag.wire);
+            continue;
+        }
+
+        auto bytes = m_workbook.ReadBytes();
+        m_sheet = ArchiveReader{bytes};
+        m_sheet_bytes = bytes;
+        m_sheet_name = {};
+        // 名字通常在最前面；不在的话往后找，单元格只看标签和长度，不解析
+        ArchiveReader scan{bytes};
+        while (!scan.AtEnd())
+        {
+            Tag field = ReadTag(scan);
+            if (field.field == kSheetName && field.wire == kLength)
+            {
+                m_sheet_name = scan.ReadString();
+                break;
+            }
+            SkipField(scan, field.wire);
+        }
+        return true;
+    }
+    m_sheet = ArchiveReader{{}};
+    m_sheet_bytes = {};
+    m_sheet_name = {};
+    return false;
+}
+
+bool WorkbookProtoReader::NextCell(ProtoCell &cell)
+{
+    return ReadCell(m_sheet, cell);
+}
+
+WorkbookProtoWriter::WorkbookProtoWriter(std::ostream &out) : m_out{out}, m_base{out.tellp()}
+{
+    if (m_base == std::streampos(-1))
+        throw Exception{ExceptionKind::BadArgument, "output stream is not seekable"};
+}
+
+void WorkbookProtoWriter::BeginSheet(std::string_view name)
+{
+    if (m_in_sheet)
+        throw Exception{ExceptionKind::InvalidState, "previous sheet is not ended"};
+
+    WriteTag(m_buffer, kWorkbookSheets, kLength);
+    m_length_offset = m_flushed + m_buffer.Size();
+    for (size_t i = 0; i < kLengthSize; i++)
+    {
+        m_buffer.WriteU8(0);
+    }
+    m_content_offset = m_flushed + m_buffer.Size();
+    if (!name.empty())
+    {
+        WriteTag(m_buffer, kSheetName, kLength);
+        m_buffer.WriteString(name);
+    }
+    m_in_sheet = true;
+}
+
+void WorkbookProtoWriter::WriteCell(ProtoCell const &cell)
+{
+    if (!m_in_sheet)
+        throw Exception{ExceptionKind::InvalidState, "no sheet to write to"};
+    EncodeCell(m_buffer, m_cell, cell);
+    if (m_buffer.Size() >= kBufferSize)
+        FlushBuffer();
+}
+
+void WorkbookProtoWriter::WriteEncodedCells(std::span<const std::byte> cells)
+{
+    if (!m_in_sheet)
+        throw Exception{ExceptionKind::InvalidState, "no sheet to write to"};
+    if (m_buffer.Size() + cells.size() < kBufferSize)
+    {
+        m_buffer.WriteRaw(cells.data(), cells.size());
+        return;
+    }
+    // 大的直接写到输出流，不经过缓冲区
+    FlushBuffer();
+    m_out.write(reinterpret_cast<const char *>(cells.data()), std::streamsize(cells.size()));
+    if (!m_out)
+        throw Exception{ExceptionKind::IoError, "cannot write workbook"};
+    m_flushed += cells.size();
+}
+
+void WorkbookProtoWriter::EndSheet()
+{
+    if (!m_in_sheet)
+        throw Exception{ExceptionKind::InvalidState, "no sheet to end"};
+    uint64_t length = m_flushed + m_buffer.Size() - m_content_offset;
+    if (length > kMaxSheetSize)
+        throw Exception{ExceptionKind::IoError, "sheet is too large"};
+    FlushBuffer();
+
+    char bytes[kLengthSize];
+    for (size_t i = 0; i < kLengthSize; i++)
+    {
+        uint8_t byte = (length >> (7 * i)) & 0x7F;
+        if (i + 1 < kLengthSize)
+            byte |= 0x80;
+        bytes[i] = char(byte);
+    }
+    m_out.seekp(m_base + std::streamoff(m_length_offset));
+    m_out.write(bytes, sizeof(bytes));
+    m_out.seekp(m_base + std::streamoff(m_flushed));
+    if (!m_out)
+        throw Exception{ExceptionKind::IoError, "cannot write sheet length"};
+    m_in_sheet = false;
+}
+
+void WorkbookProtoWriter::Finish()
+{
+    if (m_in_sheet)
+        throw Exception{ExceptionKind::InvalidState, "sheet is not ended"};
+    FlushBuffer();
+    m_out.flush();
+    if (!m_out)
+        throw Exception{ExceptionKind::IoError, "cannot write workbook"};
+}
+
+void WorkbookProtoWriter::FlushBuffer()
+{
+    m_out.write(reinterpret_cast<const char *>(m_buffer.Data()), std::streamsize(m_buffer.Size()));
+    if (!m_out)
+        throw Exception{ExceptionKind::IoError, "cannot write workbook"};
+    m_flushed += m_buffer.Size();
+    m_buffer.Clear();
+}
+
+void ReadSheetProto(std::span<const std::byte> bytes, Worksheet &sheet)
+{
+    ArchiveReader in{bytes};
+    ProtoCell cell;
+    while (ReadCell(in, cell))
+    {
+        StoreCell(sheet, cell);
+    }
+}
+
+void ReadWorkbookProto(std::span<const std::byte> data, Workbook &book, ThreadPool *pool)
+{
+    WorkbookProtoReader reader{data};
+    if (!pool || pool->ThreadCount() < 2)
+    {
+        ProtoCell cell;
+        while (reader.NextSheet())
+        {
+            Worksheet &sheet = book.AddSheet(std::string{reader.SheetName()});
+            while (reader.NextCell(cell))
+            {
+                StoreCell(sheet, cell);
+            }
+        }
+        return;
+    }
+
+    // 每个工作表先读到自己的字符串池里，并行的任务之间不共享任何可写的状态
+    struct Part
+    {
+        std::span<const std::byte> bytes;
+        std::unique_ptr<StringPool> strings;
+        std::unique_ptr<Worksheet> sheet;
+    };
+    std::vector<Part> parts;
+    std::unordered_set<std::string_view> names;
+    while (reader.NextSheet())
+    {
+        std::string_view name = reader.SheetName();
+        if (book.FindSheet(name) || !names.insert(name).second)
+            throw Exception{ExceptionKind::ElementAlreadyExists};
+        auto strings = std::make_unique<StringPool>();
+        auto sheet = std::make_unique<Worksheet>(std::string{name}, *strings);
+        parts.push_back({reader.SheetBytes(), std::move(strings), std::move(sheet)});
+    }
+    pool->ParallelFor(parts.size(), [&](size_t i) { ReadSheetProto(parts[i].bytes, *parts[i].sheet); });
+
+    std::vector<StringId> ids;
+    for (Part &part : parts)
+    {
+        Worksheet &sheet = book.AddSheet(part.sheet->Name());
+        ids.resize(part.strings->Size());
+        for (StringId id = 0; id < ids.size(); id++)
+        {
+            ids[id] = book.Strings().Intern(part.strings->Get(id));
+        }
+        for (uint32_t c = 0; c < part.sheet->ColumnCount(); c++)
+        {
+            size_t chunks = part.sheet->FindColumn(c)->ChunkCount();
+            for (size_t index = 0; index < chunks; index++)
+            {
+                std::shared_ptr<ColumnChunk> chunk = part.sheet->TakeChunk(c, index);
+                if (!chunk)
+                    continue;
+                chunk->RemapStrings([&](StringId id) { return ids[id]; });
+                sheet.SetChunk(c, index, std::move(chunk));
+            }
+        }
+        // 读完一个就释放，临时的字符串池不会全部同时留着
+        part = {};
+    }
+}
+
+Workbook LoadWorkbookProto(std::filesystem::path const &path, ThreadPool *pool)
+{
+    MappedFile file{path};
+    Workbook book;
+    ReadWorkbookProto(file.Bytes(), book, pool);
+    return book;
+}
+
+void WriteWorkbookProto(Workbook const &book, std::ostream &out, ThreadPool *pool)
+{
+    if (!pool || pool->ThreadCount() < 2)
+    {
+        WorkbookProtoWriter writer{out};
+        for (size_t i = 0; i < book.SheetCount(); i++)
+        {
+            WriteSheet(writer, book.Sheet(i));
+        }
+        writer.Finish();
+        return;
+    }
+
+    // 按块切分，每块最多 ColumnChunk::kRows 个单元格。块的编码大小用上界估计：文本按实际长度，其余按最长的算
+    std::vector<ChunkPiece> pieces;
+    for (size_t s = 0; s < book.SheetCount(); s++)
+    {
+        Worksheet const &sheet = book.Sheet(s);
+        for (uint32_t c = 0; c < sheet.ColumnCount(); c++)
+        {
+            Column const &column = *sheet.FindColumn(c);
+            for (size_t index = 0; index < column.ChunkCount(); index++)
+            {
+                ColumnChunk const *chunk = column.SharedChunk(index).get();
+                if (!chunk)
+                    continue;
+                size_t size = chunk->Count() * kMaxCellOverhead;
+                for (uint32_t word = 0; chunk->Strings() && word < ColumnChunk::kWords; word++)
+                {
+                    for (uint64_t bits = chunk->StringBits()[word]; bits != 0; bits &= bits - 1)
+                    {
+                        StringId id = chunk->Strings()[word * 64 + uint32_t(std::countr_zero(bits))];
+                        size += sheet.Strings().Get(id).size();
+                    }
+                }
+                pieces.push_back({s, c, uint32_t(index), chunk, size});
+            }
+        }
+    }
+
+    WorkbookProtoWriter writer{out};
+    // 开始第 sheet 个工作表，之前还没结束的都结束。没有单元格的工作表在这里顺带写出
+    size_t begun = 0;
+    auto begin = [&](size_t sheet) {
+        for (; begun <= sheet; begun++)
+        {
+            if (begun > 0)
+                writer.EndSheet();
+            writer.BeginSheet(book.Sheet(begun).Name());
+        }
+    };
+    std::vector<ArchiveWriter> encoded;
+    for (size_t first = 0; first < pieces.size();)
+    {
+        // 一批块的编码加起来不超过预算，所以同时在内存里的编码有上限，和工作表的大小无关
+        size_t last = first + 1;
+        size_t budget = pieces[first].size;
+        while (last < pieces.size() && budget + pieces[last].size <= kProtoWriteBudget)
+        {
+            budget += pieces[last++].size;
+        }
+        encoded.clear();
+        encoded.resize(last - first);
+        pool->ParallelFor(encoded.size(), [&](size_t i) {
+            ChunkPiece const &piece = pieces[first + i];
+            encoded[i].Reserve(piece.size);
+            EncodeChunk(encoded[i], book.Sheet(piece.sheet), piece);
+        });
+        for (size_t i = 0; i < encoded.size(); i++)
+        {
+            begin(pieces[first + i].sheet);
+            writer.WriteEncodedCells(encoded[i].Bytes());
+        }
+        first = last;
+    }
+    encoded.clear();
+    if (book.SheetCount() > 0)
+    {
+        begin(book.SheetCount() - 1);
+        writer.EndSheet();
+    }
+    writer.Finish();
+}
+
+} // namespace llama
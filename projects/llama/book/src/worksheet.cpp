@@ -0,0 +1,186 @@
+#include "book/worksheet.h"
+#include "foundation/exceptions.h"
+#include "foundation/pointers.h"
+#include <algorithm>
+#include <utility>
+
+namespace llama
+{
+
+Worksheet::Worksheet(std::string name, StringPool &strings)
+    : m_name{std::move(name)}, m_strings{&strings}, m_cells{std::make_shared<Cells>()}
+{
+}
+
+std::unique_ptr<Worksheet> Worksheet::Clone() const
+{
+    auto copy = std::make_unique<Worksheet>(m_name, *m_strings);
+    copy->m_cells = m_cells;
+    return copy;
+}
+
+void Worksheet::Set(uint32_t row, uint32_t column, CellValue value)
+{
+    if (row >= kMaxRows || column >= kMaxColumns)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    if (column >= m_cells->columns.size() && value.Empty())
+        return;
+    Cells &cells = Mutable();
+    if (column >= cells.columns.size())
+        cells.columns.resize(size_t(column) + 1);
+    if (column < m_indexes.size() && m_indexes[column])
+        m_indexes[column]->Record(row, cells.columns[column].Get(row), value);
+    cells.columns[column].Set(row, value);
+    if (!value.Empty())
+        cells.row_count = std::max(cells.row_count, row + 1);
+}
+
+void Worksheet::SetChunk(uint32_t column, size_t index, std::shared_ptr<ColumnChunk> chunk)
+{
+    if (column >= kMaxColumns || index >= kMaxRows / ColumnChunk::kRows)
+        throw Exception{ExceptionKind::IndexOutofRange};
+    bool empty = !chunk || chunk->Count() == 0;
+    if (column >= m_cells->columns.size() && empty)
+        return;
+    Cells &cells = Mutable();
+    if (column >= cells.columns.size())
+        cells.columns.resize(size_t(column) + 1);
+    if (!empty)
+        cells.row_count = std::max(cells.row_count, uint32_t(index * ColumnChunk::kRows) + chunk->RowEnd());
+    if (column < m_indexes.size())
+        m_indexes[column].reset();
+    cells.columns[column].SetChunk(index, std::move(chunk));
+}
+
+std::shared_ptr<ColumnChunk> Worksheet::TakeChunk(uint32_t column, size_t index)
+{
+    if (column >= m_cells->columns.size())
+        return nullptr;
+    if (column < m_indexes.size())
+        m_indexes[column].reset();
+    return Mutable().columns[column].TakeChunk(index);
+}
+
+std::string_view Worksheet::Text(uint32_t row, uint32_t column) const
+{
+    CellValue value = Get(row, column);
+    if (value.Type() != CellType::String)
+        return {};
+    return m_strings->Get(value.AsString());
+}
+
+RangeAggregate Worksheet::Aggregate(CellRange const &range, ThreadPool *pool) const
+{
+    // 每个任务最多这么多行，按块对齐
+    constexpr uint64_t kTaskRows = 16 * ColumnChunk::kRows;
+    struct Task
+    {
+        uint32_t column;
+        uint32_t first_row;
+        uint32_t last_row;
+    };
+
+    Cells const &cells = *m_cells;
+    std::vector<Task> tasks;
+    uint64_t columns = std::min<uint64_t>(uint64_t{range.last_column} + 1, cells.columns.size());
+    for (uint64_t c = range.first_column; c < columns; c++)
+    {
+        uint64_t end =
+            std::min<uint64_t>(uint64_t{range.last_row} + 1, cells.columns[c].ChunkCount() * ColumnChunk::kRows);
+        for (uint64_t row = range.first_row; row < end; row = (row / kTaskRows + 1) * kTaskRows)
+        {
+            uint64_t last = std::min(end, (row / kTaskRows + 1) * kTaskRows) - 1;
+            tasks.push_back({uint32_t(c), uint32_t(row), uint32_t(last)});
+        }
+    }
+
+    std::vector<RangeAggregate> parts(tasks.size());
+    auto run = [&](size_t i) {
+        AggregateColumn(cells.columns[tasks[i].column], tasks[i].first_row, tasks[i].last_row, parts[i]);
+    };
+    if (pool && tasks.size() > 1)
+    {
+        pool->ParallelFor(tasks.size(), run);
+    }
+    else
+    {
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            run(i);
+        }
+    }
+
+    RangeAggregate result;
+    for (auto const &part : parts)
+    {
+        result.Merge(part);
+    }
+    return result;
+}
+
+std::span<const uint32_t> Worksheet::FindRows(uint32_t column, CellValue value) const
+{
+    if (column >= m_cells->columns.size())
+        return {};
+    return IndexOf(column).Find(m_cells->columns[column], value);
+}
+
+std::vector<uint32_t> Worksheet::FindRowsBetween(uint32_t column, double low, double high) const
+{
+    std::vector<uint32_t> rows;
+    if (column >= m_cells->columns.size())
+        return rows;
+    IndexOf(column).ForEachBetween(m_cells->columns[column], low, high,
+                                   [&](ColumnIndex::NumberEntry const &entry) { rows.push_back(entry.row); });
+    return rows;
+}
+
+Worksheet::Cells &Worksheet::Mutable()
+{
+    // 只有这个工作表在用时才原地修改。别的线程不可能再拿到它；它们之前的读由 IsSoleOwner 的栅栏排在这之前
+    if (!IsSoleOwner(m_cells))
+        m_cells = std::make_shared<Cells>(*m_cells);
+    return *m_cells;
+}
+
+ColumnIndex &Worksheet::IndexOf(uint32_t column) const
+{
+    if (column >= m_indexes.size())
+        m_indexes.resize(m_cells->columns.size());
+    if (!m_indexes[column])
+        m_indexes[column] = std::make_unique<ColumnIndex>();
+    return *m_indexes[column];
+}
+
+size_t Worksheet::CellCount() const
+{
+    size_t count = 0;
+    for (auto const &column : m_cells->columns)
+    {
+        count += column.Count();
+    }
+    return count;
+}
+
+size_t Worksheet::MemoryUsage() const
+{
+    size_t size = sizeof(Worksheet) + (m_cells->columns.capacity() - m_cells->columns.size()) * sizeof(Column);
+    for (auto const &column : m_cells->columns)
+    {
+        size += column.MemoryUsage();
+    }
+    return size;
+}
+
+size_t Worksheet::IndexMemoryUsage() const
+{
+    size_t size = m_indexes.capacity() * sizeof(m_indexes[0]);
+    for (auto const &index : m_indexes)
+    {
+        if (index)
+            size += index->MemoryUsage();
+    }
+    return size;
+}
+
+} // namespace llama
@@ -0,0 +1,133 @@
+#include "book/aggregate.h"
+#include "book/workbook.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+#include <utility>
+
+using namespace llama;
+
+namespace
+{
+
+RangeAggregate Naive(Worksheet const &sheet, CellRange const &range)
+{
+    RangeAggregate result;
+    for (uint32_t c = range.first_column; c <= range.last_column; c++)
+    {
+        for (uint32_t row = range.first_row; row <= range.last_row; row++)
+        {
+            CellValue value = sheet.Get(row, c);
+            if (value.Type() != CellType::Number)
+                continue;
+            result.sum += value.AsNumber();
+            result.min = std::min(result.min, value.AsNumber());
+            result.max = std::max(result.max, value.AsNumber());
+            result.count++;
+        }
+    }
+    return result;
+}
+
+void ExpectSame(RangeAggregate const &actual, RangeAggregate const &expected)
+{
+    EXPECT_EQ(actual.count, expected.count);
+    EXPECT_NEAR(actual.sum, expected.sum, 1e-9 * std::max(1.0, std::abs(expected.sum)));
+    EXPECT_EQ(actual.min, expected.min);
+    EXPECT_EQ(actual.max, expected.max);
+}
+
+} // namespace
+
+TEST(AggregateTest, MatchesPerCellLoop)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    uint64_t state = 7;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        for (uint32_t row = 0; row < 30000; row++)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            uint32_t kind = uint32_t(state >> 60);
+            // 第 0 列是稠密的数字，其余列混着空行、文本和布尔值
+            if (c == 0 || kind < 8)
+                sheet.SetNumber(row, c, double(int64_t(state >> 40) % 1000) / 8);
+            else if (kind < 10)
+                sheet.SetText(row, c, "x");
+            else if (kind < 11)
+                sheet.SetBool(row, c, true);
+        }
+    }
+
+    ThreadPool pool{4};
+    for (CellRange range : {CellRange{0, 0, 29999, 3}, CellRange{5, 0, 70, 0}, CellRange{63, 1, 64, 2},
+                            CellRange{4000, 0, 9000, 3}, CellRange{100, 2, 100, 2}, CellRange{0, 3, 50000, 9}})
+    {
+        RangeAggregate expected = Naive(sheet, range);
+        ExpectSame(sheet.Aggregate(range), expected);
+        ExpectSame(book.Aggregate(0, range, &pool), expected);
+    }
+
+    // 并行和串行的结果逐位相同
+    CellRange all{0, 0, 29999, 3};
+    EXPECT_EQ(sheet.Aggregate(all).sum, sheet.Aggregate(all, &pool).sum);
+}
+
+TEST(AggregateTest, EmptyAndOutOfRange)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    sheet.SetText(0, 0, "x");
+    RangeAggregate empty = sheet.Aggregate({0, 0, 1000, 1000});
+    EXPECT_EQ(empty.count, 0);
+    EXPECT_EQ(empty.sum, 0);
+    EXPECT_TRUE(std::isnan(empty.Average()));
+
+    sheet.SetNumber(Worksheet::kMaxRows - 1, 0, -3);
+    sheet.SetNumber(Worksheet::kMaxRows - 2, 0, 5);
+    RangeAggregate tail = sheet.Aggregate({0, 0, Worksheet::kMaxRows - 1, 0});
+    EXPECT_EQ(tail.count, 2);
+    EXPECT_EQ(tail.Average(), 1);
+    EXPECT_EQ(tail.min, -3);
+    EXPECT_EQ(tail.max, 5);
+    EXPECT_EQ(sheet.Aggregate({10, 0, 5, 0}).count, 0);
+    EXPECT_THROW(book.Aggregate(1, {}), Exception);
+}
+
+TEST(AggregateTest, NaNSkippedByMinAndMax)
+{
+    // NaN 在整字都是数字的地方、只有部分数字的字里，以及第一个位置
+    ColumnChunk chunk;
+    for (uint32_t slot = 0; slot < 300; slot++)
+    {
+        if (slot < 128 || slot % 3 != 0)
+            chunk.Set(slot, CellValue::Number(double(slot % 50) - 20));
+    }
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    for (uint32_t slot : {0u, 5u, 77u, 130u, 131u, 299u})
+    {
+        chunk.Set(slot, CellValue::Number(nan));
+    }
+
+    for (auto [begin, end] : {std::pair{0u, 300u}, std::pair{0u, 1u}, std::pair{64u, 200u}, std::pair{130u, 132u}})
+    {
+        RangeAggregate scalar, dispatched;
+        AggregateChunkScalar(chunk.View(), begin, end, scalar);
+        AggregateChunk(chunk.View(), begin, end, dispatched);
+        EXPECT_EQ(dispatched.count, scalar.count);
+        EXPECT_EQ(std::isnan(dispatched.sum), std::isnan(scalar.sum));
+        EXPECT_EQ(dispatched.min, scalar.min) << begin;
+        EXPECT_EQ(dispatched.max, scalar.max) << begin;
+    }
+
+    RangeAggregate all;
+    AggregateChunk(chunk.View(), 0, 300, all);
+    EXPECT_TRUE(std::isnan(all.sum));
+    EXPECT_EQ(all.min, -20);
+    EXPECT_EQ(all.max, 29);
+    RangeAggregate only;
+    AggregateChunk(chunk.View(), 0, 1, only);
+    EXPECT_EQ(only.count, 1);
+    EXPECT_EQ(only.min, std::numeric_limits<double>::infinity());
+}
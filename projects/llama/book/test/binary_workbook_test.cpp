@@ -0,0 +1,188 @@
+#include "book/binary_workbook.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <tuple>
+
+using namespace llama;
+
+namespace
+{
+
+Workbook MakeBook()
+{
+    Workbook book;
+    Worksheet &data = book.AddSheet("data");
+    for (uint32_t row = 0; row < 10000; row++)
+    {
+        data.SetNumber(row, 0, row * 0.5);
+    }
+    data.SetBool(1, 1, true);
+    data.SetBool(2, 1, false);
+    data.SetText(3, 2, "north");
+    data.SetText(9000, 2, "south");
+    data.SetText(70000, 5, "north");
+    book.AddSheet("empty");
+    book.AddSheet("notes").SetText(0, 0, "hello");
+    return book;
+}
+
+// 调用 f 抛出的异常的种类，没有抛出时为空
+template <typename F> std::optional<ExceptionKind> KindOf(F &&f)
+{
+    try
+    {
+        f();
+    }
+    catch (Exception const &e)
+    {
+        return e.Kind();
+    }
+    return std::nullopt;
+}
+
+// 在文件的 offset 处原样写入 size 字节
+void Overwrite(std::filesystem::path const &path, uint64_t offset, void const *data, size_t size)
+{
+    std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+    file.seekp(std::streamoff(offset));
+    file.write(static_cast<const char *>(data), std::streamsize(size));
+}
+
+} // namespace
+
+TEST(BinaryWorkbookTest, RoundTrip)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-binary-workbook-test.llbook";
+    SaveBinaryWorkbook(MakeBook(), path);
+
+    Workbook book = MappedWorkbook{path}.Load();
+    ASSERT_EQ(book.SheetCount(), 3);
+    Worksheet const &data = book.Sheet(0);
+    EXPECT_EQ(data.Name(), "data");
+    EXPECT_EQ(data.CellCount(), 10005);
+    EXPECT_EQ(data.RowCount(), 70001);
+    EXPECT_EQ(data.Get(9999, 0), CellValue::Number(4999.5));
+    EXPECT_EQ(data.Get(1, 1), CellValue::Bool(true));
+    EXPECT_EQ(data.Get(2, 1), CellValue::Bool(false));
+    EXPECT_EQ(data.Text(3, 2), "north");
+    EXPECT_EQ(data.Text(9000, 2), "south");
+    EXPECT_EQ(data.Text(70000, 5), "north");
+    EXPECT_TRUE(data.Get(4, 2).Empty());
+    EXPECT_EQ(book.Sheet(1).CellCount(), 0);
+    EXPECT_EQ(book.Sheet(2).Text(0, 0), "hello");
+
+    // 加载出来的工作簿可以照常修改和保存
+    book.Sheet(0).SetNumber(9999, 0, -1);
+    SaveBinaryWorkbook(book, path);
+    EXPECT_EQ(MappedWorkbook{path}.Sheet(0).Get(9999, 0), CellValue::Number(-1));
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryWorkbookTest, ReadsSheetsInPlace)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-binary-workbook-test.llbook";
+    SaveBinaryWorkbook(MakeBook(), path);
+
+    MappedWorkbook mapped{path};
+    auto sheet = mapped.FindSheet("data");
+    ASSERT_TRUE(sheet.has_value());
+    EXPECT_FALSE(mapped.FindSheet("missing").has_value());
+    EXPECT_EQ(sheet->Get(123, 0), CellValue::Number(61.5));
+    EXPECT_EQ(sheet->Text(9000, 2), "south");
+    EXPECT_TRUE(sheet->Get(0, 1000).Empty());
+    EXPECT_TRUE(sheet->Get(1 << 20, 0).Empty());
+
+    // 块直接指向映射的文件，对齐后可以当数组用
+    MappedColumn column = sheet->Column(0);
+    ASSERT_EQ(column.ChunkCount(), 3);
+    ColumnChunkView chunk = column.Chunk(1);
+    ASSERT_TRUE(chunk);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(chunk.numbers) % 64, 0);
+    EXPECT_EQ(chunk.strings, nullptr);
+    EXPECT_EQ(chunk.numbers[10], (ColumnChunk::kRows + 10) * 0.5);
+    EXPECT_FALSE(sheet->Column(5).Chunk(0));
+    EXPECT_THROW(mapped.Sheet(3), Exception);
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryWorkbookTest, LoadSheetRemapsStrings)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-binary-workbook-test.llbook";
+    SaveBinaryWorkbook(MakeBook(), path);
+
+    Workbook book;
+    book.AddSheet("other").SetText(0, 0, "south");
+    MappedWorkbook mapped{path};
+    Worksheet &notes = mapped.LoadSheet(2, book);
+    Worksheet &data = mapped.LoadSheet(0, book);
+    EXPECT_EQ(notes.Text(0, 0), "hello");
+    EXPECT_EQ(data.Text(3, 2), "north");
+    EXPECT_EQ(data.Get(9000, 2), book.Sheet(0).Get(0, 0));
+    EXPECT_EQ(book.Strings().Size(), 3);
+    EXPECT_THROW(mapped.LoadSheet(0, book), Exception);
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryWorkbookTest, RejectsCorruptedFiles)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-binary-workbook-test.llbook";
+    {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << "not a workbook, just some text long enough to hold a header............";
+    }
+    EXPECT_THROW(MappedWorkbook{path}, Exception);
+
+    SaveBinaryWorkbook(MakeBook(), path);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    EXPECT_THROW(MappedWorkbook{path}, Exception);
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryWorkbookTest, RejectsCorruptedChunks)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-binary-workbook-test.llbook";
+    SaveBinaryWorkbook(MakeBook(), path);
+
+    // 块里的位图在文件里的位置：从映射的指针换算，第 0 个字符串在文件头记录的字符串数据的起点
+    uint64_t number_bools_offset = 0;
+    uint64_t bool_values_offset = 0;
+    {
+        uint64_t string_data = 0;
+        std::ifstream file{path, std::ios::binary};
+        file.seekg(40);
+        file.read(reinterpret_cast<char *>(&string_data), sizeof(string_data));
+        MappedWorkbook mapped{path};
+        const char *base = mapped.String(0).data() - string_data;
+        MappedSheet sheet = mapped.Sheet(0);
+        number_bools_offset = reinterpret_cast<const char *>(sheet.Column(0).Chunk(0).bool_bits) - base;
+        bool_values_offset = reinterpret_cast<const char *>(sheet.Column(1).Chunk(0).bool_values) - base;
+
+        MappedColumn column = sheet.Column(0);
+        EXPECT_EQ(KindOf([&] { column.Chunk(column.ChunkCount()); }), ExceptionKind::IndexOutofRange);
+    }
+
+    // 第 0 行既是数字又是布尔；布尔值标在不是布尔的第 5 行上
+    uint64_t const bit0 = 1, bit5 = 1 << 5;
+    uint64_t const bool_values = 1 << 1;
+    for (auto [offset, word, restore] : {std::tuple{number_bools_offset, bit0, uint64_t{0}},
+                                         std::tuple{bool_values_offset, bool_values | bit5, bool_values}})
+    {
+        Overwrite(path, offset, &word, sizeof(word));
+        {
+            MappedWorkbook mapped{path};
+            uint32_t column = offset == number_bools_offset ? 0 : 1;
+            EXPECT_EQ(KindOf([&] { mapped.Sheet(0).Column(column).Chunk(0); }), ExceptionKind::InvalidFileFormat);
+            EXPECT_EQ(KindOf([&] { mapped.Sheet(0).Get(2, column); }), ExceptionKind::InvalidFileFormat);
+            Workbook book;
+            EXPECT_EQ(KindOf([&] { mapped.LoadSheet(0, book); }), ExceptionKind::InvalidFileFormat);
+            // 别的工作表不受影响
+            EXPECT_EQ(mapped.LoadSheet(2, book).Text(0, 0), "hello");
+        }
+        Overwrite(path, offset, &restore, sizeof(restore));
+    }
+    EXPECT_EQ(MappedWorkbook{path}.Load().Sheet(0).Get(1, 1), CellValue::Bool(true));
+    std::filesystem::remove(path);
+}
@@ -1,5 +1,66 @@
+#include "book/book.h"
+#include <gtest/gtest.h>
+#include <string>
 
-int main()
+using namespace llama;
+
+TEST(WorkbookTest, SheetsAndCells)
 {
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    book.AddSheet("summary");
+    EXPECT_THROW(book.AddSheet("data"), Exception);
+    EXPECT_EQ(book.SheetCount(), 2);
+    EXPECT_EQ(book.FindSheet("summary"), &book.Sheet(1));
+    EXPECT_EQ(book.FindSheet("missing"), nullptr);
+
+    sheet.SetNumber(0, 0, 1.5);
+    sheet.SetBool(1, 0, true);
+    sheet.SetText(2, 0, "north");
+    sheet.SetText(100000, 3, "north");
+    EXPECT_EQ(sheet.Get(0, 0), CellValue::Number(1.5));
+    EXPECT_EQ(sheet.Get(1, 0), CellValue::Bool(true));
+    EXPECT_EQ(sheet.Text(2, 0), "north");
+    EXPECT_EQ(sheet.Get(2, 0), sheet.Get(100000, 3));
+    EXPECT_EQ(book.Strings().Size(), 1);
+    EXPECT_TRUE(sheet.Get(5, 5).Empty());
+    EXPECT_TRUE(sheet.Get(5, 50000).Empty());
+    EXPECT_EQ(sheet.Text(0, 0), "");
+
+    EXPECT_EQ(sheet.CellCount(), 4);
+    EXPECT_EQ(sheet.RowCount(), 100001);
+    EXPECT_EQ(sheet.ColumnCount(), 4);
 
-}
\ No newline at end of file
+    // 改变类型和清除
+    sheet.SetText(0, 0, "south");
+    EXPECT_EQ(sheet.Text(0, 0), "south");
+    sheet.Clear(1, 0);
+    EXPECT_TRUE(sheet.Get(1, 0).Empty());
+    EXPECT_EQ(sheet.CellCount(), 3);
+    EXPECT_THROW(sheet.SetNumber(Worksheet::kMaxRows, 0, 1), Exception);
+    EXPECT_THROW(sheet.SetNumber(0, Worksheet::kMaxColumns, 1), Exception);
+
+    Workbook moved{std::move(book)};
+    EXPECT_EQ(moved.Sheet(0).Text(2, 0), "north");
+    moved.RemoveSheet(0);
+    EXPECT_EQ(moved.Sheet(0).Name(), "summary");
+    EXPECT_THROW(moved.Sheet(1), Exception);
+}
+
+TEST(WorkbookTest, DenseNumericSheetIsCompact)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("numbers");
+    constexpr uint32_t kRows = 200000;
+    for (uint32_t column = 0; column < 10; column++)
+    {
+        for (uint32_t row = 0; row < kRows; row++)
+        {
+            sheet.SetNumber(row, column, row * 0.25 + column);
+        }
+    }
+    EXPECT_EQ(sheet.CellCount(), kRows * 10);
+    EXPECT_EQ(sheet.Get(123456, 7).AsNumber(), 123456 * 0.25 + 7);
+    // 每个数字单元格 8 字节，加上位图和块的开销
+    EXPECT_LT(sheet.MemoryUsage(), kRows * 10 * 9);
+}
@@ -0,0 +1,146 @@
+#include "book/workbook.h"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+std::vector<uint32_t> ScanEqual(Worksheet const &sheet, uint32_t column, CellValue value)
+{
+    std::vector<uint32_t> rows;
+    for (uint32_t row = 0; row < sheet.RowCount(); row++)
+    {
+        if (!value.Empty() && sheet.Get(row, column) == value)
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+std::vector<uint32_t> ScanBetween(Worksheet const &sheet, uint32_t column, double low, double high)
+{
+    std::vector<std::pair<double, uint32_t>> entries;
+    for (uint32_t row = 0; row < sheet.RowCount(); row++)
+    {
+        CellValue value = sheet.Get(row, column);
+        if (value.Type() == CellType::Number && value.AsNumber() >= low && value.AsNumber() <= high)
+            entries.push_back({value.AsNumber(), row});
+    }
+    std::sort(entries.begin(), entries.end());
+    std::vector<uint32_t> rows;
+    for (auto const &entry : entries)
+    {
+        rows.push_back(entry.second);
+    }
+    return rows;
+}
+
+std::vector<uint32_t> ToVector(std::span<const uint32_t> rows)
+{
+    return {rows.begin(), rows.end()};
+}
+
+} // namespace
+
+TEST(ColumnIndexTest, FollowsEdits)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    uint64_t state = 11;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return uint32_t(state >> 33);
+    };
+    auto edit = [&] {
+        uint32_t row = next() % 20000;
+        uint32_t kind = next() % 10;
+        if (kind < 6)
+            sheet.SetNumber(row, 0, double(next() % 500) / 4);
+        else if (kind < 8)
+            sheet.SetText(row, 0, "k" + std::to_string(next() % 50));
+        else if (kind < 9)
+            sheet.SetBool(row, 0, next() % 2 == 0);
+        else
+            sheet.Clear(row, 0);
+    };
+    for (int i = 0; i < 30000; i++)
+    {
+        edit();
+    }
+
+    // 先建好索引，之后的编辑有时少量、有时多到需要重建，每轮都和扫描对比
+    for (int round = 0; round < 6; round++)
+    {
+        for (int i = 0; i < (round % 3 == 2 ? 50000 : round * 37); i++)
+        {
+            edit();
+        }
+        for (double number : {0.0, 12.5, 124.75, 7.25})
+        {
+            CellValue value = CellValue::Number(number);
+            ASSERT_EQ(ToVector(sheet.FindRows(0, value)), ScanEqual(sheet, 0, value));
+        }
+        StringId k7 = book.Strings().Intern("k7");
+        ASSERT_EQ(ToVector(sheet.FindRows(0, CellValue::String(k7))), ScanEqual(sheet, 0, CellValue::String(k7)));
+        ASSERT_EQ(ToVector(sheet.FindRows(0, CellValue::Bool(true))), ScanEqual(sheet, 0, CellValue::Bool(true)));
+        ASSERT_EQ(sheet.FindRowsBetween(0, 10, 20.5), ScanBetween(sheet, 0, 10, 20.5));
+        ASSERT_EQ(sheet.FindRowsBetween(0, -1, 1000), ScanBetween(sheet, 0, -1, 1000));
+        ASSERT_TRUE(sheet.FindRowsBetween(0, 200, 100).empty());
+    }
+    EXPECT_GT(sheet.IndexMemoryUsage(), 0);
+    sheet.DropIndexes();
+    EXPECT_EQ(sheet.IndexMemoryUsage(), 0);
+}
+
+TEST(ColumnIndexTest, NumbersCompareByValue)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    sheet.SetNumber(0, 0, -0.0);
+    sheet.SetNumber(1, 0, 0.0);
+    sheet.SetNumber(2, 0, std::nan(""));
+    sheet.SetNumber(3, 0, 1);
+    sheet.SetBool(4, 0, true);
+    sheet.SetText(5, 0, "1");
+    EXPECT_EQ(ToVector(sheet.FindRows(0, CellValue::Number(0))), (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(ToVector(sheet.FindRows(0, CellValue::Number(-0.0))), (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(ToVector(sheet.FindRows(0, CellValue::Number(1))), (std::vector<uint32_t>{3}));
+    EXPECT_TRUE(sheet.FindRows(0, CellValue::Number(std::nan(""))).empty());
+    EXPECT_TRUE(sheet.FindRows(0, CellValue{}).empty());
+    EXPECT_TRUE(sheet.FindRows(7, CellValue::Number(1)).empty());
+    EXPECT_EQ(sheet.FindRowsBetween(0, -1, 1), (std::vector<uint32_t>{0, 1, 3}));
+
+    // 整块换掉单元格之后重新建立索引
+    auto chunk = sheet.TakeChunk(0, 0);
+    EXPECT_TRUE(sheet.FindRows(0, CellValue::Number(1)).empty());
+    sheet.SetChunk(0, 0, std::move(chunk));
+    EXPECT_EQ(ToVector(sheet.FindRows(0, CellValue::Number(1))), (std::vector<uint32_t>{3}));
+}
+
+TEST(ColumnIndexTest, WorkbookLookup)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("prices");
+    for (uint32_t row = 0; row < 100000; row++)
+    {
+        sheet.SetText(row, 0, "sku" + std::to_string(row));
+        sheet.SetNumber(row, 1, row * 1.5);
+    }
+    sheet.SetText(99999, 0, "sku10");
+    EXPECT_EQ(book.Lookup(0, 0, "sku77777", 1), CellValue::Number(77777 * 1.5));
+    EXPECT_EQ(book.Lookup(0, 0, "sku10", 1), CellValue::Number(15));
+    EXPECT_TRUE(book.Lookup(0, 0, "missing", 1).Empty());
+    EXPECT_FALSE(book.Strings().Find("missing"));
+    EXPECT_EQ(book.Lookup(0, 1, CellValue::Number(30), 0), CellValue::String(*book.Strings().Find("sku20")));
+    EXPECT_EQ(book.FindRowsBetween(0, 1, 0, 4.5), (std::vector<uint32_t>{0, 1, 2, 3}));
+
+    sheet.SetNumber(77777, 1, -1);
+    EXPECT_EQ(book.Lookup(0, 0, "sku77777", 1), CellValue::Number(-1));
+    EXPECT_EQ(book.FindRowsBetween(0, 1, -5, 0), (std::vector<uint32_t>{77777, 0}));
+    EXPECT_THROW(book.Lookup(1, 0, "sku1", 1), Exception);
+    EXPECT_THROW(book.FindRows(1, 0, CellValue::Number(1)), Exception);
+}
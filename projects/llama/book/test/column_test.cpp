@@ -0,0 +1,110 @@
+#include "book/column.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+using namespace llama;
+
+TEST(ColumnTest, ChunkKeepsTypesApart)
+{
+    ColumnChunk chunk;
+    EXPECT_EQ(chunk.Numbers(), nullptr);
+    chunk.Set(0, CellValue::Number(2));
+    chunk.Set(1, CellValue::Bool(false));
+    chunk.Set(64, CellValue::String(7));
+    EXPECT_EQ(chunk.Count(), 3);
+    EXPECT_EQ(chunk.Get(1), CellValue::Bool(false));
+    EXPECT_EQ(chunk.Get(64), CellValue::String(7));
+    EXPECT_EQ(chunk.NumberBits()[0], 1);
+    EXPECT_EQ(chunk.BoolBits()[0], 2);
+    EXPECT_EQ(chunk.StringBits()[1], 1);
+
+    // 换成别的类型之后，数字数组里这一行回到 0
+    chunk.Set(0, CellValue::Bool(true));
+    EXPECT_EQ(chunk.Numbers()[0], 0);
+    EXPECT_EQ(chunk.Get(0), CellValue::Bool(true));
+    chunk.Set(0, CellValue{});
+    chunk.Set(0, CellValue{});
+    EXPECT_EQ(chunk.Count(), 2);
+}
+
+TEST(ColumnTest, SparseRowsAgreeWithMap)
+{
+    Column column;
+    std::map<uint32_t, CellValue> reference;
+    uint64_t state = 1;
+    for (int i = 0; i < 20000; i++)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t row = uint32_t(state >> 40) % 1000000;
+        CellValue value;
+        switch ((state >> 20) % 4)
+        {
+        case 0:
+            value = CellValue::Number(double(i));
+            break;
+        case 1:
+            value = CellValue::Bool(i % 2);
+            break;
+        case 2:
+            value = CellValue::String(uint32_t(i));
+            break;
+        }
+        column.Set(row, value);
+        if (value.Empty())
+            reference.erase(row);
+        else
+            reference[row] = value;
+    }
+    EXPECT_EQ(column.Count(), reference.size());
+
+    std::vector<uint32_t> rows;
+    column.ForEach([&](uint32_t row, CellValue value) {
+        EXPECT_EQ(reference.at(row), value);
+        rows.push_back(row);
+    });
+    EXPECT_EQ(rows.size(), reference.size());
+    EXPECT_TRUE(std::is_sorted(rows.begin(), rows.end()));
+
+    size_t numbers = 0;
+    column.ForEachNumber([&](uint32_t row, double value) {
+        EXPECT_EQ(reference.at(row), CellValue::Number(value));
+        numbers++;
+    });
+    EXPECT_EQ(numbers, std::count_if(reference.begin(), reference.end(),
+                                     [](auto const &pair) { return pair.second.Type() == CellType::Number; }));
+
+    // 清空之后块都释放
+    for (auto const &[row, value] : reference)
+    {
+        column.Set(row, CellValue{});
+    }
+    EXPECT_EQ(column.Count(), 0);
+    for (size_t i = 0; i < column.ChunkCount(); i++)
+    {
+        EXPECT_EQ(column.Chunk(i), nullptr);
+    }
+}
+
+TEST(ColumnTest, ContentHashFollowsEdits)
+{
+    ColumnChunk a;
+    ColumnChunk b;
+    a.Set(3, CellValue::String(7));
+    a.Set(4, CellValue::Number(1));
+    b.Set(4, CellValue::Number(1));
+    b.Set(3, CellValue::String(9));
+    Hash before = b.ContentHash();
+    EXPECT_NE(a.ContentHash(), before);
+
+    // 换字符串编号之后缓存的哈希作废
+    b.RemapStrings([](StringId id) { return id - 2; });
+    EXPECT_EQ(b.ContentHash(), a.ContentHash());
+
+    // 清掉的字符串不留在数组里，内容相同的块哈希相同
+    a.Set(5, CellValue::String(1));
+    a.Set(5, CellValue{});
+    EXPECT_EQ(a.ContentHash(), b.ContentHash());
+    EXPECT_EQ(ColumnChunk{a}.ContentHash(), b.ContentHash());
+}
@@ -0,0 +1,242 @@
+#include "book/formula.h"
+#include "book/workbook.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace llama;
+
+TEST(FormulaTest, EvaluatesExpressions)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    engine.SetNumber(0, 0, 2);
+    engine.SetNumber(1, 0, 3);
+    engine.SetNumber(2, 0, 4);
+    engine.SetText(3, 0, "north");
+    engine.SetFormula(0, 1, "=A1+A2*A3");
+    engine.SetFormula(1, 1, "=-(A1 + A2) ^ 2");
+    engine.SetFormula(2, 1, "SUM(A1:A4) + COUNT($A$1:A4) + average(a1:a3)");
+    engine.SetFormula(3, 1, "=IF(A1 < A2, MAX(A1:A3), MIN(A1:A3))");
+    engine.SetFormula(4, 1, "=A4 = A4");
+    engine.SetFormula(5, 1, "=A9");
+    engine.SetFormula(6, 1, "=ABS(1 - A3) >= 3");
+    EXPECT_EQ(engine.FormulaCount(), 7);
+    EXPECT_EQ(engine.Recalculate(), 7);
+
+    EXPECT_EQ(sheet.Get(0, 1), CellValue::Number(14));
+    EXPECT_EQ(sheet.Get(1, 1), CellValue::Number(25));
+    EXPECT_EQ(sheet.Get(2, 1), CellValue::Number(9 + 3 + 3));
+    EXPECT_EQ(sheet.Get(3, 1), CellValue::Number(4));
+    EXPECT_EQ(sheet.Get(4, 1), CellValue::Bool(true));
+    EXPECT_EQ(sheet.Get(5, 1), CellValue::Number(0));
+    EXPECT_EQ(sheet.Get(6, 1), CellValue::Bool(true));
+    EXPECT_EQ(engine.Formula(0, 1), "=A1+A2*A3");
+    EXPECT_EQ(engine.Formula(0, 0), "");
+    EXPECT_EQ(engine.Recalculate(), 0);
+}
+
+TEST(FormulaTest, NegationBindsTighterThanPower)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    engine.SetNumber(0, 0, 3);
+    char const *formulas[] = {"=-2^2", "=2^-2", "=-(2^2)", "=3-2^2", "=-A1^2", "=2^3^2", "=--2^2", "=-2^2*3"};
+    double expected[] = {4, 0.25, -4, -1, 9, 64, 4, 12};
+    for (uint32_t row = 0; row < std::size(formulas); row++)
+    {
+        engine.SetFormula(row, 1, formulas[row]);
+    }
+    engine.Recalculate();
+    for (uint32_t row = 0; row < std::size(formulas); row++)
+    {
+        EXPECT_EQ(sheet.Get(row, 1), CellValue::Number(expected[row])) << formulas[row];
+    }
+}
+
+TEST(FormulaTest, ReportsErrors)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    engine.SetText(0, 0, "text");
+    engine.SetFormula(0, 1, "=A1 + 1");
+    engine.SetFormula(1, 1, "=1 / 0");
+    engine.SetFormula(2, 1, "=B2 * 2");
+    engine.SetFormula(3, 1, "=SUM(B1:B3)");
+    engine.SetFormula(4, 1, "=COUNT(B1:B3)");
+    engine.SetFormula(5, 1, "=B7 + 1");
+    engine.SetFormula(6, 1, "=B6 + 1");
+    engine.SetFormula(7, 1, "=B7");
+    engine.SetFormula(8, 1, "=SUM(A1)");
+    engine.Recalculate();
+    EXPECT_EQ(sheet.Text(0, 1), "#VALUE!");
+    EXPECT_EQ(sheet.Text(1, 1), "#DIV/0!");
+    EXPECT_EQ(sheet.Text(2, 1), "#DIV/0!");
+    EXPECT_EQ(sheet.Text(3, 1), "#VALUE!");
+    EXPECT_EQ(sheet.Get(4, 1), CellValue::Number(0));
+    EXPECT_EQ(sheet.Text(5, 1), "#CYCLE!");
+    EXPECT_EQ(sheet.Text(6, 1), "#CYCLE!");
+    EXPECT_EQ(sheet.Text(7, 1), "#CYCLE!");
+    EXPECT_EQ(sheet.Text(8, 1), "#VALUE!");
+
+    // 打破循环之后恢复正常
+    engine.SetNumber(6, 1, 1);
+    engine.Recalculate();
+    EXPECT_EQ(sheet.Get(5, 1), CellValue::Number(2));
+    EXPECT_EQ(sheet.Get(7, 1), CellValue::Number(1));
+
+    for (char const *text : {"", "=", "=1 +", "=A1:A2", "=-A1:A2", "=FOO(1)", "=ABS(A1:A2)", "=IF(1)", "=SUM(A1",
+                             "=A0", "=ZZZZ1", "=A1 B1", "=(((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((1"
+                             "))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))"})
+    {
+        EXPECT_THROW(engine.SetFormula(9, 1, text), Exception) << text;
+    }
+    EXPECT_EQ(engine.Formula(9, 1), "");
+}
+
+TEST(FormulaTest, ManyArguments)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    for (uint32_t row = 0; row < 200; row++)
+    {
+        engine.SetNumber(row, 0, row + 1);
+    }
+
+    // 参数个数只受函数的上限限制，和嵌套层数无关
+    std::string ranges;
+    for (uint32_t row = 1; row <= 200; row++)
+    {
+        ranges += (row > 1 ? ",A" : "A") + std::to_string(row) + ":A" + std::to_string(row);
+    }
+    std::string ones;
+    for (int i = 0; i < 255; i++)
+    {
+        ones += i > 0 ? ",1" : "1";
+    }
+    engine.SetFormula(0, 1, "=SUM(" + ranges + ")");
+    engine.SetFormula(1, 1, "=COUNT(" + ranges + ")");
+    engine.SetFormula(2, 1, "=SUM(" + ones + ")");
+    engine.SetFormula(3, 1, "=1+SUM(" + ranges + ",MAX(" + ranges + "))");
+    engine.Recalculate();
+    EXPECT_EQ(sheet.Get(0, 1), CellValue::Number(20100));
+    EXPECT_EQ(sheet.Get(1, 1), CellValue::Number(200));
+    EXPECT_EQ(sheet.Get(2, 1), CellValue::Number(255));
+    EXPECT_EQ(sheet.Get(3, 1), CellValue::Number(20301));
+
+    EXPECT_THROW(engine.SetFormula(4, 1, "=SUM(" + ones + ",1)"), Exception);
+
+    // 求值栈仍有上限：几层都带着很多参数的调用
+    std::string nested = "1";
+    for (int i = 0; i < 6; i++)
+    {
+        nested = "SUM(" + ranges + "," + nested + ")";
+    }
+    EXPECT_THROW(engine.SetFormula(4, 1, "=" + nested), Exception);
+}
+
+TEST(FormulaTest, ErrorTextIsNotAnError)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    // 内容和错误相同的普通文本按文本处理：算术得到 #VALUE! ，区域里跳过
+    engine.SetText(0, 0, "#DIV/0!");
+    engine.SetNumber(1, 0, 5);
+    engine.SetFormula(0, 1, "=A1");
+    engine.SetFormula(1, 1, "=B1 + 1");
+    engine.SetFormula(2, 1, "=A1 + 1");
+    engine.SetFormula(3, 1, "=SUM(A1:A2)");
+    engine.SetFormula(4, 1, "=A1 = B1");
+    // 公式算出的错误照常传播
+    engine.SetFormula(5, 1, "=1 / 0");
+    engine.SetFormula(6, 1, "=SUM(B6:B6)");
+    engine.SetFormula(7, 1, "=B6 + 1");
+    engine.Recalculate();
+    EXPECT_EQ(sheet.Text(0, 1), "#DIV/0!");
+    EXPECT_EQ(sheet.Text(1, 1), "#VALUE!");
+    EXPECT_EQ(sheet.Text(2, 1), "#VALUE!");
+    EXPECT_EQ(sheet.Get(3, 1), CellValue::Number(5));
+    EXPECT_EQ(sheet.Get(4, 1), CellValue::Bool(true));
+    EXPECT_EQ(sheet.Text(6, 1), "#DIV/0!");
+    EXPECT_EQ(sheet.Text(7, 1), "#DIV/0!");
+
+    // 公式换成同样内容的文本之后，引用它的公式不再得到错误
+    engine.SetText(5, 1, "#DIV/0!");
+    engine.Recalculate();
+    EXPECT_EQ(sheet.Get(6, 1), CellValue::Number(0));
+    EXPECT_EQ(sheet.Text(7, 1), "#VALUE!");
+}
+
+TEST(FormulaTest, RecalculatesOnlyAffectedCells)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    FormulaEngine engine{sheet};
+    constexpr uint32_t kRows = 20000;
+    for (uint32_t row = 0; row < kRows; row++)
+    {
+        engine.SetNumber(row, 0, row);
+        engine.SetFormula(row, 1, "=A" + std::to_string(row + 1) + " * 2");
+        // C 列是 B 列的累加
+        engine.SetFormula(row, 2, row == 0 ? "=B1" : "=C" + std::to_string(row) + " + B" + std::to_string(row + 1));
+    }
+    engine.SetFormula(0, 3, "=SUM(B1:B100)");
+    EXPECT_EQ(engine.Recalculate(), 2 * kRows + 1);
+    EXPECT_EQ(sheet.Get(kRows - 1, 2), CellValue::Number(double(kRows) * (kRows - 1)));
+    EXPECT_EQ(sheet.Get(0, 3), CellValue::Number(9900));
+
+    // 最后一行只影响它自己的两个公式
+    engine.SetNumber(kRows - 1, 0, 0);
+    EXPECT_EQ(engine.Recalculate(), 2);
+    EXPECT_EQ(sheet.Get(kRows - 1, 2), CellValue::Number(double(kRows - 1) * (kRows - 2)));
+
+    // 区域里的单元格
+    engine.SetNumber(10, 0, 1000);
+    EXPECT_EQ(engine.Recalculate(), 1 + (kRows - 10) + 1);
+    EXPECT_EQ(sheet.Get(0, 3), CellValue::Number(9900 + 2 * (1000 - 10)));
+
+    // 换掉公式之后不再依赖原来的单元格
+    engine.SetFormula(0, 3, "=B1");
+    engine.Recalculate();
+    engine.SetNumber(20, 0, 0);
+    EXPECT_EQ(engine.Recalculate(), 1 + (kRows - 20));
+    EXPECT_EQ(sheet.Get(0, 3), CellValue::Number(0));
+
+    // 直接改过工作表之后标记一下
+    engine.Clear(5, 1);
+    engine.Recalculate();
+    sheet.SetNumber(5, 1, 100);
+    engine.MarkDirty(5, 1);
+    EXPECT_EQ(engine.Recalculate(), kRows - 5);
+    EXPECT_EQ(engine.FormulaCount(), 2 * kRows);
+}
+
+TEST(FormulaTest, ParallelWavesMatchSerial)
+{
+    Workbook book;
+    Worksheet &serial = book.AddSheet("serial");
+    Worksheet &parallel = book.AddSheet("parallel");
+    ThreadPool pool{4};
+    FormulaEngine a{serial};
+    FormulaEngine b{parallel, &pool};
+    for (FormulaEngine *engine : {&a, &b})
+    {
+        for (uint32_t row = 0; row < 10000; row++)
+        {
+            engine->SetNumber(row, 0, row % 17);
+            engine->SetFormula(row, 1, "=A" + std::to_string(row + 1) + " * 3 - 1");
+            engine->SetFormula(row, 2, "=B" + std::to_string(row + 1) + " / (A" + std::to_string(row + 1) + " + 1)");
+        }
+        engine->SetFormula(0, 3, "=SUM(C1:C10000)");
+        EXPECT_EQ(engine->Recalculate(), 20001);
+    }
+    for (uint32_t row = 0; row < 10000; row++)
+    {
+        ASSERT_EQ(serial.Get(row, 2), parallel.Get(row, 2));
+    }
+    EXPECT_EQ(serial.Get(0, 3), parallel.Get(0, 3));
+}
@@ -0,0 +1,215 @@
+#include "book/snapshot_store.h"
+#include "book/workbook.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace llama;
+
+namespace
+{
+
+// 每个工作表 3 列，第 0 列数字、第 1 列文本、第 2 列布尔，行数跨越几个块
+void Fill(Workbook &book, uint32_t rows)
+{
+    for (char const *name : {"first", "second"})
+    {
+        Worksheet &sheet = book.AddSheet(name);
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            sheet.SetNumber(row, 0, row * 0.5);
+            sheet.SetText(row, 1, "t" + std::to_string(row % 100));
+            if (row % 3 == 0)
+                sheet.SetBool(row, 2, row % 2 == 0);
+        }
+    }
+}
+
+void ExpectSameCells(Workbook const &actual, Workbook const &expected)
+{
+    ASSERT_EQ(actual.SheetCount(), expected.SheetCount());
+    for (size_t i = 0; i < expected.SheetCount(); i++)
+    {
+        Worksheet const &a = actual.Sheet(i);
+        Worksheet const &e = expected.Sheet(i);
+        ASSERT_EQ(a.Name(), e.Name());
+        for (uint32_t row = 0; row < std::max(a.RowCount(), e.RowCount()); row++)
+        {
+            for (uint32_t column = 0; column < 3; column++)
+            {
+                CellValue x = a.Get(row, column);
+                CellValue y = e.Get(row, column);
+                ASSERT_EQ(x.Type(), y.Type());
+                if (x.Type() == CellType::String)
+                    ASSERT_EQ(actual.Strings().Get(x.AsString()), expected.Strings().Get(y.AsString()));
+                else
+                    ASSERT_EQ(x, y);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(SnapshotTest, KeepsOldValues)
+{
+    Workbook book;
+    Fill(book, 10000);
+    WorkbookSnapshot snapshot = book.Snapshot();
+    Worksheet const &old = snapshot.Sheet(0);
+
+    // 快照和工作簿共用所有块，写到一块时只复制这一块
+    Column const &before = *old.FindColumn(0);
+    book.Sheet(0).SetNumber(5, 0, -1);
+    book.Sheet(0).SetText(20000, 1, "new");
+    book.AddSheet("third");
+
+    EXPECT_EQ(old.Get(5, 0), CellValue::Number(2.5));
+    EXPECT_EQ(book.Sheet(0).Get(5, 0), CellValue::Number(-1));
+    EXPECT_TRUE(old.Get(20000, 1).Empty());
+    EXPECT_EQ(old.RowCount(), 10000u);
+    EXPECT_EQ(snapshot.SheetCount(), 2u);
+    EXPECT_EQ(snapshot.FindSheet("third"), nullptr);
+    EXPECT_THROW(snapshot.Sheet(2), Exception);
+
+    Column const &after = *book.Sheet(0).FindColumn(0);
+    EXPECT_NE(before.SharedChunk(0), after.SharedChunk(0));
+    EXPECT_EQ(before.SharedChunk(1), after.SharedChunk(1));
+    EXPECT_EQ(old.FindColumn(1)->SharedChunk(0), book.Sheet(0).FindColumn(1)->SharedChunk(0));
+    EXPECT_EQ(snapshot.FindSheet("second")->FindColumn(0)->SharedChunk(0),
+              book.Sheet(1).FindColumn(0)->SharedChunk(0));
+
+    // 快照之后加进字符串池的字符串不算在快照里，已有的编号不变
+    EXPECT_EQ(book.Strings().Find("new").value(), snapshot.StringCount());
+    EXPECT_EQ(snapshot.StringCount(), book.Strings().Size() - 1);
+    EXPECT_EQ(snapshot.Strings().Get(old.Get(7, 1).AsString()), "t7");
+}
+
+TEST(SnapshotTest, ReadWhileEditing)
+{
+    Workbook book;
+    Fill(book, 20000);
+    WorkbookSnapshot snapshot = book.Snapshot();
+    std::atomic<bool> ok{true};
+    std::thread reader{[&] {
+        Worksheet const &sheet = snapshot.Sheet(0);
+        for (int round = 0; round < 5; round++)
+        {
+            for (uint32_t row = 0; row < 20000; row++)
+            {
+                if (sheet.Get(row, 0) != CellValue::Number(row * 0.5) ||
+                    snapshot.Strings().Get(sheet.Get(row, 1).AsString()) != "t" + std::to_string(row % 100))
+                    ok = false;
+            }
+        }
+    }};
+    for (uint32_t row = 0; row < 20000; row += 7)
+    {
+        book.Sheet(0).SetNumber(row, 0, -double(row));
+        book.Sheet(0).SetText(row, 1, "edited" + std::to_string(row));
+    }
+    reader.join();
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(book.Sheet(0).Get(7, 0), CellValue::Number(-7));
+}
+
+TEST(SnapshotTest, ReleaseOnReaderWhileEditing)
+{
+    // 快照在读的线程上销毁，工作簿随后原地改同样的块，不能和读冲突
+    Workbook book;
+    Fill(book, 2 * ColumnChunk::kRows);
+    std::mutex mutex;
+    std::optional<WorkbookSnapshot> slot;
+    std::atomic<bool> done{false};
+    std::atomic<bool> ok{true};
+    std::thread reader{[&] {
+        while (!done)
+        {
+            std::optional<WorkbookSnapshot> snapshot;
+            {
+                std::lock_guard lock{mutex};
+                snapshot.swap(slot);
+            }
+            if (!snapshot)
+                continue;
+            Worksheet const &sheet = snapshot->Sheet(0);
+            CellValue first = sheet.Get(0, 0);
+            for (uint32_t row = 0; row < 2 * ColumnChunk::kRows; row += 97)
+            {
+                if (sheet.Get(row, 0) != first)
+                    ok = false;
+            }
+        }
+    }};
+    for (int round = 0; round < 2000; round++)
+    {
+        Worksheet &sheet = book.Sheet(0);
+        for (uint32_t row = 0; row < 2 * ColumnChunk::kRows; row += 97)
+            sheet.SetNumber(row, 0, round);
+        WorkbookSnapshot snapshot = book.Snapshot();
+        std::lock_guard lock{mutex};
+        slot = std::move(snapshot);
+    }
+    done = true;
+    reader.join();
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(book.Sheet(0).Get(97, 0), CellValue::Number(1999));
+}
+
+TEST(SnapshotTest, StoreSharesUnchangedChunks)
+{
+    Workbook book;
+    Fill(book, 3 * ColumnChunk::kRows);
+    ObjectStore store;
+    Hash first = StoreSnapshot(book.Snapshot(), store);
+    size_t size = store.Size();
+    // 两个工作表结构相同：块按内容去重，第二个工作表只多一个工作表对象
+    EXPECT_EQ(size, 9u + 2 + 1 + 1);
+
+    EXPECT_EQ(StoreSnapshot(book.Snapshot(), store), first);
+    EXPECT_EQ(store.Size(), size);
+
+    // 改一个单元格只多出一个块、一个工作表和一个版本
+    book.Sheet(1).SetNumber(5000, 0, 42);
+    Hash second = StoreSnapshot(book.Snapshot(), store);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(store.Size(), size + 3);
+
+    // 新的字符串只多出最后一页
+    book.Sheet(1).SetText(0, 1, "fresh");
+    StoreSnapshot(book.Snapshot(), store);
+    EXPECT_EQ(store.Size(), size + 3 + 4);
+
+    Workbook loaded = LoadSnapshot(store, second);
+    EXPECT_EQ(loaded.Sheet(1).Get(5000, 0), CellValue::Number(42));
+    EXPECT_EQ(loaded.Sheet(1).Get(0, 1), CellValue::String(*loaded.Strings().Find("t0")));
+    EXPECT_FALSE(loaded.Strings().Find("fresh"));
+
+    store.AddRoot(second);
+    store.Collect();
+    Workbook kept = LoadSnapshot(store, second);
+    EXPECT_EQ(kept.Sheet(1).Get(5000, 0), CellValue::Number(42));
+    EXPECT_THROW(LoadSnapshot(store, first), Exception);
+}
+
+TEST(SnapshotTest, LoadRoundTrip)
+{
+    Workbook book;
+    Fill(book, 10000);
+    book.Sheet(0).Clear(9999, 0);
+    book.Sheet(0).SetNumber(100, 2, -0.0);
+    ObjectStore store;
+    Hash version = StoreSnapshot(book.Snapshot(), store);
+    Workbook loaded = LoadSnapshot(store, version);
+    ExpectSameCells(loaded, book);
+    EXPECT_EQ(loaded.Strings().Size(), book.Strings().Size());
+
+    // 取回的块和仓库共用，编辑时复制，不影响仓库里的版本
+    loaded.Sheet(0).SetNumber(1, 0, 1000);
+    Workbook again = LoadSnapshot(store, version);
+    EXPECT_EQ(again.Sheet(0).Get(1, 0), CellValue::Number(0.5));
+    EXPECT_THROW(LoadSnapshot(store, Hash{1, 2}), Exception);
+}
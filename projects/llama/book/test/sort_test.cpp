@@ -0,0 +1,219 @@
+#include "book/sort.h"
+#include "book/workbook.h"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+// 升序时的类别：数字、文本、布尔值、空单元格
+int Rank(CellValue value, bool descending)
+{
+    switch (value.Type())
+    {
+    case CellType::Number:
+        return descending ? 2 : 0;
+    case CellType::String:
+        return 1;
+    case CellType::Bool:
+        return descending ? 0 : 2;
+    default:
+        return 3;
+    }
+}
+
+// 按单元格的值比较，用来和 RowOrder::Sort 对照
+int Compare(Worksheet const &sheet, uint32_t a, uint32_t b, SortKey key)
+{
+    CellValue x = sheet.Get(a, key.column);
+    CellValue y = sheet.Get(b, key.column);
+    if (Rank(x, key.descending) != Rank(y, key.descending))
+        return Rank(x, key.descending) < Rank(y, key.descending) ? -1 : 1;
+    int order = 0;
+    switch (x.Type())
+    {
+    case CellType::Number:
+        order = x.AsNumber() < y.AsNumber() ? -1 : y.AsNumber() < x.AsNumber() ? 1 : 0;
+        break;
+    case CellType::String:
+        order = sheet.Text(a, key.column).compare(sheet.Text(b, key.column));
+        order = order < 0 ? -1 : order > 0 ? 1 : 0;
+        break;
+    case CellType::Bool:
+        order = int(x.AsBool()) - int(y.AsBool());
+        break;
+    default:
+        return 0;
+    }
+    return key.descending ? -order : order;
+}
+
+std::vector<uint32_t> StableSort(Worksheet const &sheet, std::vector<uint32_t> rows, std::vector<SortKey> const &keys)
+{
+    std::stable_sort(rows.begin(), rows.end(), [&](uint32_t a, uint32_t b) {
+        for (SortKey const &key : keys)
+        {
+            if (int order = Compare(sheet, a, b, key))
+                return order < 0;
+        }
+        return false;
+    });
+    return rows;
+}
+
+std::vector<uint32_t> ToVector(std::span<const uint32_t> rows)
+{
+    return {rows.begin(), rows.end()};
+}
+
+// 第 0 列混合各种类型，第 1 列是重复很多的文本，第 2 列是数字，第 3 列少数几个值
+void Fill(Worksheet &sheet, uint32_t first_row, uint32_t rows)
+{
+    uint64_t state = 5;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return uint32_t(state >> 33);
+    };
+    for (uint32_t row = first_row; row < first_row + rows; row++)
+    {
+        switch (next() % 6)
+        {
+        case 0:
+        case 1:
+            sheet.SetNumber(row, 0, double(int(next() % 2001) - 1000) / 8);
+            break;
+        case 2:
+            sheet.SetText(row, 0, "s" + std::to_string(next() % 300));
+            break;
+        case 3:
+            sheet.SetBool(row, 0, next() % 2 == 0);
+            break;
+        case 4:
+            sheet.SetNumber(row, 0, next() % 2 ? -0.0 : 0.0);
+            break;
+        default:
+            break;
+        }
+        sheet.SetText(row, 1, std::string(1, char('a' + next() % 26)) + std::to_string(next() % 40));
+        sheet.SetNumber(row, 2, double(next()) * (next() % 2 ? 1 : -1));
+        sheet.SetNumber(row, 3, double(next() % 4));
+    }
+}
+
+} // namespace
+
+TEST(SortTest, MatchesStableSort)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    Fill(sheet, 3, 20000);
+    std::vector<std::vector<SortKey>> cases = {
+        {{0}},
+        {{0, true}},
+        {{1}},
+        {{3}, {1, true}},
+        {{3, true}, {0}, {2}},
+        {{9}},
+        {{2, true}},
+    };
+    for (auto const &keys : cases)
+    {
+        // 区域从块的中间开始、到块的中间结束
+        RowOrder order{100, 15000};
+        order.Sort(sheet, keys);
+        ASSERT_EQ(ToVector(order.Rows()), StableSort(sheet, ToVector(RowOrder{100, 15000}.Rows()), keys));
+    }
+}
+
+TEST(SortTest, StableAcrossSorts)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    Fill(sheet, 0, 5000);
+    SortKey minor[] = {{1}};
+    SortKey major[] = {{3, true}};
+    RowOrder order{0, 4999};
+    order.Sort(sheet, minor);
+    order.Sort(sheet, major);
+
+    RowOrder once{0, 4999};
+    SortKey both[] = {{3, true}, {1}};
+    once.Sort(sheet, both);
+    EXPECT_EQ(ToVector(order.Rows()), ToVector(once.Rows()));
+}
+
+TEST(SortTest, ParallelMatchesSerial)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    Fill(sheet, 0, 600000);
+    ThreadPool pool{4};
+    for (auto const &keys : std::vector<std::vector<SortKey>>{{{3}, {1}}, {{0, true}}, {{2}}})
+    {
+        RowOrder serial{0, 599999};
+        serial.Sort(sheet, keys);
+        RowOrder parallel{0, 599999};
+        parallel.Sort(sheet, keys, &pool);
+        ASSERT_EQ(ToVector(parallel.Rows()), ToVector(serial.Rows()));
+    }
+    // 筛选之后再排序，只排留下的行
+    RowOrder order{0, 599999};
+    order.Filter([&](uint32_t row) { return sheet.Get(row, 3) == CellValue::Number(1); });
+    std::vector<uint32_t> kept = ToVector(order.Rows());
+    SortKey keys[] = {{1, true}, {2}};
+    order.Sort(sheet, keys, &pool);
+    EXPECT_EQ(ToVector(order.Rows()), StableSort(sheet, kept, {{1, true}, {2}}));
+}
+
+TEST(SortTest, FilterAndApply)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("data");
+    for (uint32_t row = 0; row < 10; row++)
+    {
+        sheet.SetText(row, 0, "name" + std::to_string(row));
+        sheet.SetNumber(row, 1, double((row * 7) % 10));
+    }
+    sheet.SetText(12, 1, "outside");
+
+    RowOrder order{1, 8};
+    SortKey keys[] = {{1, true}};
+    order.Sort(sheet, keys);
+    order.Filter([&](uint32_t row) { return sheet.Get(row, 1).AsNumber() >= 3; });
+    ASSERT_EQ(ToVector(order.Rows()), (std::vector<uint32_t>{7, 4, 1, 8, 5, 2}));
+    EXPECT_EQ(order.Get(sheet, 0, 1), CellValue::Number(9));
+    // 读取是惰性的，工作表还没有变
+    EXPECT_EQ(sheet.Text(1, 0), "name1");
+
+    order.Apply(sheet, 0, 1);
+    std::vector<std::string> names;
+    std::vector<double> numbers;
+    for (uint32_t row = 1; row <= 6; row++)
+    {
+        names.emplace_back(sheet.Text(row, 0));
+        numbers.push_back(sheet.Get(row, 1).AsNumber());
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"name7", "name4", "name1", "name8", "name5", "name2"}));
+    EXPECT_EQ(numbers, (std::vector<double>{9, 8, 7, 6, 5, 4}));
+    for (uint32_t row = 7; row <= 8; row++)
+    {
+        EXPECT_TRUE(sheet.Get(row, 0).Empty());
+        EXPECT_TRUE(sheet.Get(row, 1).Empty());
+    }
+    EXPECT_EQ(sheet.Text(0, 0), "name0");
+    EXPECT_EQ(sheet.Text(9, 0), "name9");
+    EXPECT_EQ(sheet.Text(12, 1), "outside");
+
+    EXPECT_EQ(RowOrder{}.Size(), 0u);
+    RowOrder{}.Apply(sheet, 0, 1);
+    EXPECT_EQ(sheet.Text(0, 0), "name0");
+    EXPECT_THROW((RowOrder{0, Worksheet::kMaxRows}), Exception);
+    SortKey bad[] = {{Worksheet::kMaxColumns}};
+    EXPECT_THROW(order.Sort(sheet, bad), Exception);
+    EXPECT_THROW(order.Apply(sheet, 0, Worksheet::kMaxColumns), Exception);
+}
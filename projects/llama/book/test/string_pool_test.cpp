@@ -0,0 +1,84 @@
+#include "book/string_pool.h"
+#include "book/workbook.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+TEST(StringPoolTest, InternAndLookup)
+{
+    StringPool pool;
+    EXPECT_FALSE(pool.Find("north").has_value());
+    StringId north = pool.Intern("north");
+    StringId empty = pool.Intern("");
+    EXPECT_EQ(pool.Intern(std::string{"nor"} + "th"), north);
+    EXPECT_EQ(pool.Intern(""), empty);
+    EXPECT_EQ(pool.Find("north"), north);
+    EXPECT_EQ(pool.Get(north), "north");
+    EXPECT_EQ(pool.Get(empty), "");
+    EXPECT_EQ(pool.Size(), 2);
+    EXPECT_THROW(pool.Get(2), Exception);
+
+    // 超过一块的字符串单独存放，之前的视图不受影响
+    std::string_view view = pool.Get(north);
+    std::string large(100000, 'x');
+    StringId id = pool.Intern(large);
+    EXPECT_EQ(pool.Get(id), large);
+    EXPECT_EQ(view.data(), pool.Get(north).data());
+}
+
+TEST(StringPoolTest, HashCollisions)
+{
+    // 只看长度的哈希：同样长的字符串全都冲突
+    StringPool pool{[](std::string_view text) { return Hash{text.size(), 0}; }};
+    StringId ab = pool.Intern("ab");
+    StringId cd = pool.Intern("cd");
+    StringId ef = pool.Intern("ef");
+    StringId x = pool.Intern("x");
+    EXPECT_NE(ab, cd);
+    EXPECT_NE(cd, ef);
+    EXPECT_EQ(pool.Size(), 4);
+    EXPECT_EQ(pool.Intern("cd"), cd);
+    EXPECT_EQ(pool.Intern("ef"), ef);
+    EXPECT_EQ(pool.Find("ab"), ab);
+    EXPECT_EQ(pool.Find("x"), x);
+    EXPECT_EQ(pool.Get(ef), "ef");
+    EXPECT_FALSE(pool.Find("gh").has_value());
+    EXPECT_EQ(pool.Size(), 4);
+}
+
+TEST(StringPoolTest, ManyStringsKeepIds)
+{
+    StringPool pool;
+    for (int i = 0; i < 100000; i++)
+    {
+        ASSERT_EQ(pool.Intern("label-" + std::to_string(i)), StringId(i));
+    }
+    for (int i = 0; i < 100000; i += 997)
+    {
+        EXPECT_EQ(pool.Get(StringId(i)), "label-" + std::to_string(i));
+        EXPECT_EQ(pool.Find("label-" + std::to_string(i)), StringId(i));
+    }
+    // 每个字符串的开销是编号表和哈希表里各一项，加上内容本身
+    EXPECT_LT(pool.MemoryUsage(), 100000 * 80);
+}
+
+TEST(StringPoolTest, RepetitiveColumnGroupsByIds)
+{
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("orders");
+    char const *regions[] = {"north", "south", "east", "west"};
+    for (uint32_t row = 0; row < 100000; row++)
+    {
+        sheet.SetText(row, 0, regions[row % 7 % 4]);
+    }
+    EXPECT_EQ(book.Strings().Size(), 4);
+
+    std::map<StringId, size_t> groups;
+    sheet.FindColumn(0)->ForEachString([&](uint32_t, StringId id) { groups[id]++; });
+    ASSERT_EQ(groups.size(), 4);
+    size_t north = groups[*book.Strings().Find("north")];
+    EXPECT_EQ(north, 28572);
+}
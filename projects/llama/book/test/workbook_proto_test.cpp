@@ -0,0 +1,347 @@
+#include "book/workbook_proto.h"
+#include "foundation/mapped_file.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+// 记录堆内存的用量，用来检查写出时最多缓冲了多少
+std::atomic<size_t> g_allocated{0};
+std::atomic<size_t> g_peak{0};
+
+// 丢弃写入的内容，只记位置的输出流缓冲区。可以定位，写出本身不占内存
+class DiscardBuffer : public std::streambuf
+{
+  public:
+    std::streamoff Size() const
+    {
+        return m_size;
+    }
+
+  protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override
+    {
+        Advance(count);
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        Advance(1);
+        return traits_type::not_eof(c);
+    }
+
+    pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override
+    {
+        m_position = (dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? m_position : m_size) + offset;
+        return m_position;
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode) override
+    {
+        m_position = position;
+        return m_position;
+    }
+
+  private:
+    void Advance(std::streamoff count)
+    {
+        m_position += count;
+        m_size = std::max(m_size, m_position);
+    }
+
+    std::streamoff m_position = 0;
+    std::streamoff m_size = 0;
+};
+
+std::span<const std::byte> Bytes(std::string const &text)
+{
+    return std::as_bytes(std::span{text.data(), text.size()});
+}
+
+} // namespace
+
+// 每次分配前面多留 16 字节记大小，对齐不变
+void *operator new(size_t size)
+{
+    auto *block = static_cast<char *>(std::malloc(size + 16));
+    if (!block)
+        throw std::bad_alloc{};
+    *reinterpret_cast<size_t *>(block) = size;
+    size_t now = g_allocated.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = g_peak.load(std::memory_order_relaxed);
+    while (now > peak && !g_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+    {
+    }
+    return block + 16;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (!pointer)
+        return;
+    char *block = static_cast<char *>(pointer) - 16;
+    g_allocated.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// 不抛异常的版本也要换掉：ThreadSanitizer 这类工具会拦下默认的版本，分配的块前面就没有记大小的 16 字节
+void *operator new(size_t size, std::nothrow_t const &) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (std::bad_alloc const &)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void *pointer, std::nothrow_t const &) noexcept
+{
+    operator delete(pointer);
+}
+
+TEST(WorkbookProtoTest, RoundTrip)
+{
+    Workbook book;
+    Worksheet &data = book.AddSheet("data");
+    data.SetNumber(0, 0, 3.25);
+    data.SetBool(1, 0, false);
+    data.SetText(2, 1, "north");
+    data.SetText(70000, 2, "");
+    book.AddSheet("empty");
+
+    std::stringstream out;
+    WriteWorkbookProto(book, out);
+
+    Workbook loaded;
+    std::string bytes = out.str();
+    ReadWorkbookProto(Bytes(bytes), loaded);
+    ASSERT_EQ(loaded.SheetCount(), 2);
+    Worksheet &sheet = loaded.Sheet(0);
+    EXPECT_EQ(sheet.Name(), "data");
+    EXPECT_EQ(sheet.CellCount(), 4);
+    EXPECT_EQ(sheet.Get(0, 0), CellValue::Number(3.25));
+    EXPECT_EQ(sheet.Get(1, 0), CellValue::Bool(false));
+    EXPECT_EQ(sheet.Text(2, 1), "north");
+    EXPECT_EQ(sheet.Get(70000, 2).Type(), CellType::String);
+    EXPECT_EQ(loaded.Sheet(1).Name(), "empty");
+    EXPECT_EQ(loaded.Sheet(1).CellCount(), 0);
+}
+
+TEST(WorkbookProtoTest, StreamsLargeSheetsThroughFile)
+{
+    auto path = std::filesystem::temp_directory_path() / "llama-workbook-proto-test.pb";
+    {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        WorkbookProtoWriter writer{file};
+        for (int s = 0; s < 3; s++)
+        {
+            writer.BeginSheet("sheet" + std::to_string(s));
+            EXPECT_THROW(writer.BeginSheet("nested"), Exception);
+            // 远大于缓冲区，工作表的长度要回头补
+            for (uint32_t row = 0; row < 50000; row++)
+            {
+                ProtoCell cell;
+                cell.row = row;
+                cell.column = uint32_t(s);
+                cell.type = CellType::Number;
+                cell.number = row + s;
+                writer.WriteCell(cell);
+            }
+            writer.EndSheet();
+        }
+        writer.Finish();
+    }
+
+    {
+        MappedFile file{path};
+        WorkbookProtoReader reader{file.Bytes()};
+        ProtoCell cell;
+        ASSERT_TRUE(reader.NextSheet());
+        EXPECT_EQ(reader.SheetName(), "sheet0");
+        ASSERT_TRUE(reader.NextCell(cell));
+        EXPECT_EQ(cell.number, 0);
+        // 没读完的单元格直接跳过
+        ASSERT_TRUE(reader.NextSheet());
+        EXPECT_EQ(reader.SheetName(), "sheet1");
+        size_t count = 0;
+        while (reader.NextCell(cell))
+        {
+            EXPECT_EQ(cell.number, cell.row + 1);
+            count++;
+        }
+        EXPECT_EQ(count, 50000);
+        ASSERT_TRUE(reader.NextSheet());
+        EXPECT_FALSE(reader.NextSheet());
+    }
+
+    Workbook book = LoadWorkbookProto(path);
+    EXPECT_EQ(book.Sheet(2).Get(49999, 2), CellValue::Number(50001));
+    std::filesystem::remove(path);
+}
+
+TEST(WorkbookProtoTest, AcceptsAnyFieldOrder)
+{
+    // 手写的编码：未知字段、名字在单元格后面、行号为默认值 0 时省略
+    std::string cell = std::string{"\x10\x03\x21", 3} + std::string(8, '\0') + "\x38\x07";
+    std::string sheet = "\x12" + std::string(1, char(cell.size())) + cell + "\x0a\x03" + "abc";
+    std::string book = "\x15\x01\x02\x03\x04" + std::string{"\x0a"} + std::string(1, char(sheet.size())) + sheet;
+
+    WorkbookProtoReader reader{Bytes(book)};
+    ASSERT_TRUE(reader.NextSheet());
+    EXPECT_EQ(reader.SheetName(), "abc");
+    ProtoCell parsed;
+    ASSERT_TRUE(reader.NextCell(parsed));
+    EXPECT_EQ(parsed.row, 0);
+    EXPECT_EQ(parsed.column, 3);
+    EXPECT_EQ(parsed.type, CellType::Number);
+    EXPECT_EQ(parsed.number, 0);
+    EXPECT_FALSE(reader.NextCell(parsed));
+    EXPECT_FALSE(reader.NextSheet());
+}
+
+TEST(WorkbookProtoTest, RejectsBrokenData)
+{
+    Workbook book;
+    book.AddSheet("s").SetText(0, 0, "some text");
+    std::stringstream out;
+    WriteWorkbookProto(book, out);
+    std::string bytes = out.str();
+
+    Workbook truncated;
+    EXPECT_THROW(ReadWorkbookProto(Bytes(bytes.substr(0, bytes.size() - 3)), truncated), Exception);
+
+    // 线路类型 3（group）不支持
+    std::string group = "\x0b";
+    Workbook broken;
+    EXPECT_THROW(ReadWorkbookProto(Bytes(group), broken), Exception);
+
+    // 一个工作表、一个单元格：行号、列号，数字 2
+    auto single = [](std::string index) {
+        std::string cell = "\x08" + index + std::string{"\x10\x01\x21\0\0\0\0\0\0\0\x40", 11};
+        std::string sheet = "\x12" + std::string(1, char(cell.size())) + cell;
+        return "\x0a" + std::string(1, char(sheet.size())) + sheet;
+    };
+    Workbook valid;
+    ReadWorkbookProto(Bytes(single("\x05")), valid);
+    EXPECT_EQ(valid.Sheet(0).Get(5, 1), CellValue::Number(2));
+
+    // 行号 2^32 不能截断成 0
+    Workbook wide;
+    try
+    {
+        ReadWorkbookProto(Bytes(single("\x80\x80\x80\x80\x10")), wide);
+        FAIL() << "row 2^32 accepted";
+    }
+    catch (Exception const &e)
+    {
+        EXPECT_EQ(e.Kind(), ExceptionKind::InvalidFileFormat);
+    }
+}
+
+TEST(WorkbookProtoTest, ParallelMatchesSerial)
+{
+    Workbook book;
+    for (uint32_t s = 0; s < 11; s++)
+    {
+        Worksheet &sheet = book.AddSheet("sheet" + std::to_string(s));
+        for (uint32_t row = 0; row < 3000 * (s % 4); row++)
+        {
+            sheet.SetNumber(row, 0, row * 0.5 + s);
+            // 有的字符串各个工作表共用，有的只在一个工作表里出现
+            sheet.SetText(row, 1 + s % 3, "shared" + std::to_string(row % 7));
+            if (row % 5 == 0)
+                sheet.SetText(row * 3, 4, "own" + std::to_string(s) + "-" + std::to_string(row));
+            if (row % 11 == 0)
+                sheet.SetBool(row, 5, row % 2 == 0);
+        }
+    }
+
+    ThreadPool pool{4};
+    std::stringstream serial_out, parallel_out;
+    WriteWorkbookProto(book, serial_out);
+    WriteWorkbookProto(book, parallel_out, &pool);
+    std::string bytes = serial_out.str();
+    ASSERT_EQ(parallel_out.str(), bytes);
+
+    Workbook serial, parallel;
+    serial.AddSheet("existing").SetText(0, 0, "shared3");
+    parallel.AddSheet("existing").SetText(0, 0, "shared3");
+    ReadWorkbookProto(Bytes(bytes), serial);
+    ReadWorkbookProto(Bytes(bytes), parallel, &pool);
+    ASSERT_EQ(parallel.SheetCount(), serial.SheetCount());
+    ASSERT_EQ(parallel.Strings().Size(), serial.Strings().Size());
+    for (StringId id = 0; id < serial.Strings().Size(); id++)
+    {
+        ASSERT_EQ(parallel.Strings().Get(id), serial.Strings().Get(id));
+    }
+    for (size_t s = 0; s < serial.SheetCount(); s++)
+    {
+        Worksheet const &expected = serial.Sheet(s);
+        Worksheet const &actual = parallel.Sheet(s);
+        EXPECT_EQ(actual.Name(), expected.Name());
+        EXPECT_EQ(actual.CellCount(), expected.CellCount());
+        EXPECT_EQ(actual.RowCount(), expected.RowCount());
+        ASSERT_EQ(actual.ColumnCount(), expected.ColumnCount());
+        for (uint32_t c = 0; c < expected.ColumnCount(); c++)
+        {
+            expected.FindColumn(c)->ForEach(
+                [&](uint32_t row, CellValue value) { ASSERT_EQ(actual.Get(row, c), value) << s << " " << row; });
+        }
+    }
+
+    // 重名时什么都不添加
+    Workbook clash;
+    clash.AddSheet("sheet7");
+    EXPECT_THROW(ReadWorkbookProto(Bytes(bytes), clash, &pool), Exception);
+    EXPECT_EQ(clash.SheetCount(), 1);
+    Workbook truncated;
+    EXPECT_THROW(ReadWorkbookProto(Bytes(bytes.substr(0, bytes.size() - 3)), truncated, &pool), Exception);
+    EXPECT_EQ(truncated.SheetCount(), 0);
+}
+
+TEST(WorkbookProtoTest, ParallelWriteBuffersWithinBudget)
+{
+    // 一个工作表的编码是预算的好几倍，按工作表缓冲的话全都要放在内存里
+    Workbook book;
+    Worksheet &sheet = book.AddSheet("large");
+    for (uint32_t row = 0; row < 1200000; row++)
+    {
+        sheet.SetNumber(row, 0, row * 0.25);
+        sheet.SetNumber(row, 1, -double(row));
+        if (row % 64 == 0)
+            sheet.SetText(row, 2, std::string(40, char('a' + row % 26)));
+    }
+    book.AddSheet("after").SetBool(3, 3, true);
+
+    ThreadPool pool{4};
+    DiscardBuffer serial_buffer, parallel_buffer;
+    std::ostream serial{&serial_buffer}, parallel{&parallel_buffer};
+    WriteWorkbookProto(book, serial);
+    size_t base = g_allocated.load();
+    g_peak = base;
+    WriteWorkbookProto(book, parallel, &pool);
+    size_t peak = g_peak.load() - base;
+
+    EXPECT_EQ(parallel_buffer.Size(), serial_buffer.Size());
+    EXPECT_GT(size_t(parallel_buffer.Size()), 4 * kProtoWriteBudget);
+    EXPECT_LT(peak, kProtoWriteBudget + kProtoWriteBudget / 2);
+}
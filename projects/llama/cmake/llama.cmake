@@ -91,7 +91,14 @@ function(llama_target name type)
 	target_compile_definitions("${name}" ${PUB_VIS} "${PLAT_DEF}")
 
 	add_executable("${name}-test" "${TEST_SOURCE_LIST}")
-	target_link_libraries("${name}-test" PUBLIC "${name}" GTest::gtest GTest::gtest_main)
+	if(type STREQUAL EXECUTABLE)
+		# 可执行文件不能被链接，测试目标只能拿到它的公有头文件。其他依赖需要调用者自己链接。
+		target_include_directories("${name}-test" PRIVATE "${CMAKE_CURRENT_LIST_DIR}/include")
+		target_compile_definitions("${name}-test" PRIVATE "${PLAT_DEF}")
+		target_link_libraries("${name}-test" PUBLIC GTest::gtest GTest::gtest_main)
+	else()
+		target_link_libraries("${name}-test" PUBLIC "${name}" GTest::gtest GTest::gtest_main)
+	endif()
 	add_test(NAME "${name}-test" COMMAND "${name}-test")
 
 	# Protobuf
@@ -0,0 +1,204 @@
+/// @file
+/// 基准测试用的语料生成器。同样的参数总是生成同样的语料，以便不同版本之间比较。
+/// 生成器不依赖被测的 codex ，以免被测代码的错误同时影响语料。
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llama::bench
+{
+
+/// 确定性的伪随机数发生器（splitmix64）。不用 `<random>` 是因为标准没有规定各分布的实现，
+/// 换个标准库语料就变了。
+class SplitMix64
+{
+  public:
+    explicit SplitMix64(uint64_t seed) : m_state{seed}
+    {
+    }
+
+    uint64_t Next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// 返回 [lo, hi] 区间内的整数
+    uint32_t Range(uint32_t lo, uint32_t hi)
+    {
+        return lo + uint32_t(Next() % (uint64_t(hi) - lo + 1));
+    }
+
+  private:
+    uint64_t m_state;
+};
+
+/// 把代码点 `cp` 以 UTF-8 追加到 `out` 末尾
+inline void AppendUtf8(std::string &out, uint32_t cp)
+{
+    if (cp <= 0x7F)
+    {
+        out += char(cp);
+    }
+    else if (cp <= 0x7FF)
+    {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    }
+    else if (cp <= 0xFFFF)
+    {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+/// 把代码点 `cp` 以 UTF-16 追加到 `out` 末尾
+inline void AppendUtf16(std::u16string &out, uint32_t cp)
+{
+    if (cp <= 0xFFFF)
+    {
+        out += char16_t(cp);
+    }
+    else
+    {
+        cp -= 0x10000;
+        out += char16_t(0xD800 + (cp >> 10));
+        out += char16_t(0xDC00 + (cp & 0x3FF));
+    }
+}
+
+/// 语料的种类
+enum class CorpusKind : uint32_t
+{
+    // 可打印 ASCII
+    Ascii,
+    // 以 ASCII 为主，夹杂带重音的拉丁字母
+    Latin,
+    // 以汉字为主，夹杂全角标点
+    Cjk,
+    // 以 emoji 为主，夹杂 ASCII
+    Emoji,
+    // 混合文本，带有不合法的代码单元
+    Malformed,
+};
+
+inline constexpr uint32_t kCorpusKindCount = 5;
+
+inline const char *CorpusKindName(CorpusKind kind)
+{
+    switch (kind)
+    {
+    case CorpusKind::Ascii:
+        return "ascii";
+    case CorpusKind::Latin:
+        return "latin";
+    case CorpusKind::Cjk:
+        return "cjk";
+    case CorpusKind::Emoji:
+        return "emoji";
+    case CorpusKind::Malformed:
+        return "malformed";
+    }
+    return "unknown";
+}
+
+/// 按语料种类抽一个合法的代码点。`Malformed` 按混合文本抽取。
+inline uint32_t RandomCodePoint(CorpusKind kind, SplitMix64 &rng)
+{
+    uint32_t dice = rng.Range(0, 99);
+    switch (kind)
+    {
+    case CorpusKind::Ascii:
+        return rng.Range(0x20, 0x7E);
+    case CorpusKind::Latin:
+        return dice < 80 ? rng.Range(0x20, 0x7E) : rng.Range(0xC0, 0x17F);
+    case CorpusKind::Cjk:
+        return dice < 90 ? rng.Range(0x4E00, 0x9FFF) : rng.Range(0x3000, 0x303F);
+    case CorpusKind::Emoji:
+        return dice < 70 ? rng.Range(0x1F300, 0x1F64F) : rng.Range(0x20, 0x7E);
+    default:
+        if (dice < 60)
+            return rng.Range(0x20, 0x7E);
+        else if (dice < 75)
+            return rng.Range(0xC0, 0x17F);
+        else if (dice < 95)
+            return rng.Range(0x4E00, 0x9FFF);
+        else
+            return rng.Range(0x1F600, 0x1F64F);
+    }
+}
+
+/// 生成约 `bytes` 字节的合法 UTF-8 文本，混合了 ASCII 、拉丁字母、汉字和 emoji 。
+inline std::string GenerateMixedText(size_t bytes, uint64_t seed = 0)
+{
+    SplitMix64 rng{seed};
+    std::string text;
+    text.reserve(bytes + 4);
+    while (text.size() < bytes)
+    {
+        AppendUtf8(text, RandomCodePoint(CorpusKind::Malformed, rng));
+    }
+    return text;
+}
+
+/// 生成约 `bytes` 字节的 UTF-8 语料。
+/// `Malformed` 语料在末尾放了一个落单的续字节：解码器要扫描完整个缓冲区才会报错。
+inline std::string GenerateUtf8(CorpusKind kind, size_t bytes, uint64_t seed = 0)
+{
+    SplitMix64 rng{seed};
+    std::string text;
+    text.reserve(bytes + 4);
+    while (text.size() < bytes)
+    {
+        AppendUtf8(text, RandomCodePoint(kind, rng));
+    }
+    if (kind == CorpusKind::Malformed)
+        text.push_back(char(0x80));
+    return text;
+}
+
+/// 生成约 `bytes` 字节的 UTF-16 语料。`Malformed` 语料在末尾放了一个落单的高代理。
+inline std::u16string GenerateUtf16(CorpusKind kind, size_t bytes, uint64_t seed = 0)
+{
+    SplitMix64 rng{seed};
+    std::u16string text;
+    text.reserve(bytes / sizeof(char16_t) + 2);
+    while (text.size() * sizeof(char16_t) < bytes)
+    {
+        AppendUtf16(text, RandomCodePoint(kind, rng));
+    }
+    if (kind == CorpusKind::Malformed)
+        text.push_back(char16_t(0xD800));
+    return text;
+}
+
+/// 生成 `count` 个代码点，供编码器使用。
+/// `Malformed` 语料里约有 1% 是落单的代理或超出 Unicode 范围的值，编码器不会报错，但要走慢速路径。
+inline std::vector<uint32_t> GenerateCodePoints(CorpusKind kind, size_t count, uint64_t seed = 0)
+{
+    SplitMix64 rng{seed};
+    std::vector<uint32_t> codes(count);
+    for (auto &code : codes)
+    {
+        code = RandomCodePoint(kind, rng);
+        if (kind == CorpusKind::Malformed && rng.Range(0, 99) == 0)
+            code = rng.Range(0, 1) ? rng.Range(0xD800, 0xDFFF) : rng.Range(0x110000, 0x7FFFFFFF);
+    }
+    return codes;
+}
+
+} // namespace llama::bench
@@ -0,0 +1,10 @@
+list(APPEND SOURCE_LIST "src/archive_bench.cpp")
+list(APPEND SOURCE_LIST "src/codex_bench.cpp")
+list(APPEND SOURCE_LIST "src/codex_parallel_bench.cpp")
+list(APPEND SOURCE_LIST "src/concurrent_object_store_bench.cpp")
+list(APPEND SOURCE_LIST "src/hasher_bench.cpp")
+list(APPEND SOURCE_LIST "src/main.cpp")
+list(APPEND SOURCE_LIST "src/object_store_bench.cpp")
+list(APPEND SOURCE_LIST "src/pack_object_store_bench.cpp")
+list(APPEND SOURCE_LIST "include/foundation-bench/corpus.h")
+list(APPEND TEST_SOURCE_LIST "test/corpus.cpp")
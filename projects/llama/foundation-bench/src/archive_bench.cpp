@@ -0,0 +1,245 @@
+// 对象序列化的吞吐：二进制归档和 iostream 的对比。
+// 每条记录有几个整数、一个浮点数和一个短字符串，和表格里一行的规模差不多。
+#include "foundation-bench/corpus.h"
+#include "foundation/archive.h"
+#include "foundation/memory_stream.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+struct Record
+{
+    uint64_t id;
+    int64_t delta;
+    uint32_t flags;
+    double value;
+    std::string name;
+};
+
+constexpr size_t kRecordCount = 10000;
+
+std::vector<Record> const &Records()
+{
+    static std::vector<Record> records = [] {
+        bench::SplitMix64 rng{37};
+        std::vector<Record> result;
+        result.reserve(kRecordCount);
+        for (size_t i = 0; i < kRecordCount; i++)
+        {
+            Record record;
+            record.id = i;
+            record.delta = int64_t(rng.Range(0, 2000)) - 1000;
+            record.flags = rng.Range(0, 15);
+            record.value = double(rng.Next() % 1000000) / 100;
+            record.name = bench::GenerateMixedText(rng.Range(4, 24), rng.Next());
+            result.push_back(std::move(record));
+        }
+        return result;
+    }();
+    return records;
+}
+
+// iostream 版本按原样写定长字段，字符串前面是 64 位长度
+void WriteStream(std::ostream &out, Record const &record)
+{
+    out.write(reinterpret_cast<const char *>(&record.id), sizeof(record.id));
+    out.write(reinterpret_cast<const char *>(&record.delta), sizeof(record.delta));
+    out.write(reinterpret_cast<const char *>(&record.flags), sizeof(record.flags));
+    out.write(reinterpret_cast<const char *>(&record.value), sizeof(record.value));
+    uint64_t size = record.name.size();
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(record.name.data(), std::streamsize(size));
+}
+
+void ReadStream(std::istream &in, Record &record)
+{
+    in.read(reinterpret_cast<char *>(&record.id), sizeof(record.id));
+    in.read(reinterpret_cast<char *>(&record.delta), sizeof(record.delta));
+    in.read(reinterpret_cast<char *>(&record.flags), sizeof(record.flags));
+    in.read(reinterpret_cast<char *>(&record.value), sizeof(record.value));
+    uint64_t size;
+    in.read(reinterpret_cast<char *>(&size), sizeof(size));
+    record.name.resize(size);
+    in.read(record.name.data(), std::streamsize(size));
+}
+
+void WriteArchive(ArchiveWriter &out, Record const &record)
+{
+    out.WriteVarUint(record.id);
+    out.WriteVarInt(record.delta);
+    out.WriteVarUint(record.flags);
+    out.WriteF64(record.value);
+    out.WriteString(record.name);
+}
+
+void ReadArchive(ArchiveReader &in, Record &record)
+{
+    record.id = in.ReadVarUint();
+    record.delta = in.ReadVarInt();
+    record.flags = static_cast<uint32_t>(in.ReadVarUint());
+    record.value = in.ReadF64();
+    record.name = in.ReadString();
+}
+
+size_t StreamSize()
+{
+    std::ostringstream out{std::ios::binary};
+    for (auto const &record : Records())
+    {
+        WriteStream(out, record);
+    }
+    return out.str().size();
+}
+
+} // namespace
+
+static void BM_SerializeStream(benchmark::State &state)
+{
+    auto const &records = Records();
+    for (auto _ : state)
+    {
+        std::ostringstream out{std::ios::binary};
+        for (auto const &record : records)
+        {
+            WriteStream(out, record);
+        }
+        benchmark::DoNotOptimize(out.tellp());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+    state.SetBytesProcessed(int64_t(state.iterations() * StreamSize()));
+}
+BENCHMARK(BM_SerializeStream);
+
+static void BM_SerializeArchive(benchmark::State &state)
+{
+    auto const &records = Records();
+    ArchiveWriter out;
+    for (auto _ : state)
+    {
+        out.Clear();
+        for (auto const &record : records)
+        {
+            WriteArchive(out, record);
+        }
+        benchmark::DoNotOptimize(out.Data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+    state.SetBytesProcessed(int64_t(state.iterations() * out.Size()));
+}
+BENCHMARK(BM_SerializeArchive);
+
+// 每个对象单独序列化，和 PackObjectStore::Store 的用法一样
+static void BM_SerializeStreamPerObject(benchmark::State &state)
+{
+    auto const &records = Records();
+    for (auto _ : state)
+    {
+        for (auto const &record : records)
+        {
+            std::ostringstream out{std::ios::binary};
+            WriteStream(out, record);
+            benchmark::DoNotOptimize(out.tellp());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SerializeStreamPerObject);
+
+static void BM_SerializeArchivePerObject(benchmark::State &state)
+{
+    auto const &records = Records();
+    ArchiveWriter out;
+    for (auto _ : state)
+    {
+        for (auto const &record : records)
+        {
+            out.Clear();
+            WriteArchive(out, record);
+            benchmark::DoNotOptimize(out.Data());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SerializeArchivePerObject);
+
+static void BM_DeserializeStream(benchmark::State &state)
+{
+    auto const &records = Records();
+    std::ostringstream out{std::ios::binary};
+    for (auto const &record : records)
+    {
+        WriteStream(out, record);
+    }
+    auto bytes = std::move(out).str();
+    Record record;
+    for (auto _ : state)
+    {
+        MemoryInputStream in{std::as_bytes(std::span{bytes})};
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            ReadStream(in, record);
+        }
+        benchmark::DoNotOptimize(record.id);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+    state.SetBytesProcessed(int64_t(state.iterations() * bytes.size()));
+}
+BENCHMARK(BM_DeserializeStream);
+
+static void BM_DeserializeArchive(benchmark::State &state)
+{
+    auto const &records = Records();
+    ArchiveWriter out;
+    for (auto const &record : records)
+    {
+        WriteArchive(out, record);
+    }
+    Record record;
+    for (auto _ : state)
+    {
+        ArchiveReader in{out.Bytes()};
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            ReadArchive(in, record);
+        }
+        benchmark::DoNotOptimize(record.id);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+    state.SetBytesProcessed(int64_t(state.iterations() * out.Size()));
+}
+BENCHMARK(BM_DeserializeArchive);
+
+// 原地读取：字符串只取视图，不拷贝
+static void BM_DeserializeArchiveInPlace(benchmark::State &state)
+{
+    auto const &records = Records();
+    ArchiveWriter out;
+    for (auto const &record : records)
+    {
+        WriteArchive(out, record);
+    }
+    for (auto _ : state)
+    {
+        ArchiveReader in{out.Bytes()};
+        uint64_t checksum = 0;
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            checksum += in.ReadVarUint();
+            checksum += uint64_t(in.ReadVarInt());
+            checksum += in.ReadVarUint();
+            checksum += uint64_t(in.ReadF64());
+            checksum += in.ReadString().size();
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+    state.SetBytesProcessed(int64_t(state.iterations() * out.Size()));
+}
+BENCHMARK(BM_DeserializeArchiveInPlace);
@@ -0,0 +1,222 @@
+// codex 各函数和各转换路径的单线程吞吐量。
+// 每个函数都在每种语料上跑一遍，报告按输入字节计的 bytes_per_second 和 code_points_per_second 。
+#include "foundation-bench/corpus.h"
+#include "foundation/codex.h"
+#include "foundation/exceptions.h"
+#include "foundation/text_view.h"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+
+using namespace llama;
+using bench::CorpusKind;
+
+static constexpr size_t kCorpusBytes = 16 * 1024 * 1024;
+
+namespace
+{
+
+struct Corpus
+{
+    std::string utf8;
+    std::u16string utf16;
+    std::wstring wide;
+    std::vector<uint32_t> code_points;
+
+    // 各输入所含的代码点数
+    size_t utf8_code_points = 0;
+    size_t utf16_code_points = 0;
+    size_t wide_code_points = 0;
+};
+
+// 不借助被测代码数代码点：UTF-8 数非续字节，UTF-16 数非低代理
+size_t CountCodePoints(std::string const &text)
+{
+    size_t count = 0;
+    for (char ch : text)
+    {
+        count += (uint8_t(ch) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+size_t CountCodePoints(std::u16string const &text)
+{
+    size_t count = 0;
+    for (char16_t unit : text)
+    {
+        count += !(unit >= 0xDC00 && unit <= 0xDFFF);
+    }
+    return count;
+}
+
+Corpus const &GetCorpus(CorpusKind kind)
+{
+    static std::array<std::unique_ptr<Corpus>, bench::kCorpusKindCount> corpora;
+    auto &corpus = corpora[size_t(kind)];
+    if (!corpus)
+    {
+        corpus = std::make_unique<Corpus>();
+        corpus->utf8 = bench::GenerateUtf8(kind, kCorpusBytes, 29);
+        corpus->utf16 = bench::GenerateUtf16(kind, kCorpusBytes, 29);
+        corpus->code_points = bench::GenerateCodePoints(kind, kCorpusBytes / sizeof(uint32_t), 29);
+        if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+            corpus->wide.assign(corpus->utf16.begin(), corpus->utf16.end());
+        else
+            corpus->wide.assign(corpus->code_points.begin(), corpus->code_points.end());
+
+        corpus->utf8_code_points = CountCodePoints(corpus->utf8);
+        corpus->utf16_code_points = CountCodePoints(corpus->utf16);
+        corpus->wide_code_points =
+            sizeof(wchar_t) == sizeof(char16_t) ? corpus->utf16_code_points : corpus->code_points.size();
+    }
+    return *corpus;
+}
+
+void SetThroughput(benchmark::State &state, size_t bytes, size_t code_points)
+{
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+    state.counters["code_points_per_second"] =
+        benchmark::Counter(double(state.iterations()) * double(code_points), benchmark::Counter::kIsRate);
+}
+
+// 不合法的语料会让解码器抛出异常。抛出异常之前要扫描整个缓冲区，测的就是这段时间。
+template <typename F> void Swallow(F &&f)
+{
+    try
+    {
+        benchmark::DoNotOptimize(f());
+    }
+    catch (Exception const &)
+    {
+    }
+}
+
+void BM_DecodeUtf8(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return DecodeUtf8(corpus.utf8.data(), corpus.utf8.size()); });
+    }
+    SetThroughput(state, corpus.utf8.size(), corpus.utf8_code_points);
+}
+
+void BM_DecodeUtf16(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return DecodeUtf16(corpus.utf16.data(), corpus.utf16.size()); });
+    }
+    SetThroughput(state, corpus.utf16.size() * sizeof(char16_t), corpus.utf16_code_points);
+}
+
+void BM_EncodeUtf8(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(EncodeUtf8(corpus.code_points.data(), corpus.code_points.size()));
+    }
+    SetThroughput(state, corpus.code_points.size() * sizeof(uint32_t), corpus.code_points.size());
+}
+
+void BM_EncodeUtf16(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(EncodeUtf16(corpus.code_points.data(), corpus.code_points.size()));
+    }
+    SetThroughput(state, corpus.code_points.size() * sizeof(uint32_t), corpus.code_points.size());
+}
+
+void BM_ToUtf16FromUtf8(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return ToUtf16(std::string_view{corpus.utf8}); });
+    }
+    SetThroughput(state, corpus.utf8.size(), corpus.utf8_code_points);
+}
+
+void BM_ToUtf16FromWide(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return ToUtf16(std::wstring_view{corpus.wide}); });
+    }
+    SetThroughput(state, corpus.wide.size() * sizeof(wchar_t), corpus.wide_code_points);
+}
+
+void BM_ToUtf8FromUtf16(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return ToUtf8(std::u16string_view{corpus.utf16}); });
+    }
+    SetThroughput(state, corpus.utf16.size() * sizeof(char16_t), corpus.utf16_code_points);
+}
+
+void BM_ToUtf8FromWide(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        Swallow([&] { return ToUtf8(std::wstring_view{corpus.wide}); });
+    }
+    SetThroughput(state, corpus.wide.size() * sizeof(wchar_t), corpus.wide_code_points);
+}
+
+void BM_TextViewUtf8FromUtf16(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        TextView view{std::u16string_view{corpus.utf16}};
+        Swallow([&] { return view.Utf8().size(); });
+    }
+    SetThroughput(state, corpus.utf16.size() * sizeof(char16_t), corpus.utf16_code_points);
+}
+
+void BM_TextViewHashUtf8(benchmark::State &state, CorpusKind kind)
+{
+    auto const &corpus = GetCorpus(kind);
+    for (auto _ : state)
+    {
+        TextView view{std::string_view{corpus.utf8}};
+        benchmark::DoNotOptimize(view.Hash());
+    }
+    SetThroughput(state, corpus.utf8.size(), corpus.utf8_code_points);
+}
+
+void RegisterForEachCorpus(const char *name, void (*function)(benchmark::State &, CorpusKind))
+{
+    for (uint32_t i = 0; i < bench::kCorpusKindCount; i++)
+    {
+        auto kind = CorpusKind(i);
+        std::string full_name = std::string{name} + "/" + bench::CorpusKindName(kind);
+        benchmark::RegisterBenchmark(full_name.c_str(), function, kind)->Unit(benchmark::kMicrosecond);
+    }
+}
+
+[[maybe_unused]] const bool registered = [] {
+    RegisterForEachCorpus("DecodeUtf8", BM_DecodeUtf8);
+    RegisterForEachCorpus("DecodeUtf16", BM_DecodeUtf16);
+    RegisterForEachCorpus("EncodeUtf8", BM_EncodeUtf8);
+    RegisterForEachCorpus("EncodeUtf16", BM_EncodeUtf16);
+    RegisterForEachCorpus("ToUtf16/utf8", BM_ToUtf16FromUtf8);
+    RegisterForEachCorpus("ToUtf16/wide", BM_ToUtf16FromWide);
+    RegisterForEachCorpus("ToUtf8/utf16", BM_ToUtf8FromUtf16);
+    RegisterForEachCorpus("ToUtf8/wide", BM_ToUtf8FromWide);
+    RegisterForEachCorpus("TextView/Utf8/utf16", BM_TextViewUtf8FromUtf16);
+    RegisterForEachCorpus("TextView/Hash/utf8", BM_TextViewHashUtf8);
+    return true;
+}();
+
+} // namespace
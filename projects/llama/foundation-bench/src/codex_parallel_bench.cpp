@@ -0,0 +1,57 @@
+// 并行转码的扩展性测试：同一份语料，线程数从 1 增加到硬件并发数。
+#include "foundation-bench/corpus.h"
+#include "foundation/codex.h"
+#include "foundation/thread_pool.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <thread>
+
+using namespace llama;
+
+static constexpr size_t kCorpusBytes = 256 * 1024 * 1024;
+
+static std::string const &Utf8Corpus()
+{
+    static std::string corpus = bench::GenerateMixedText(kCorpusBytes, 26);
+    return corpus;
+}
+
+static std::u16string const &Utf16Corpus()
+{
+    static std::u16string corpus = ToUtf16(Utf8Corpus());
+    return corpus;
+}
+
+static void ThreadCounts(benchmark::internal::Benchmark *b)
+{
+    int max_threads = std::max(1, int(std::thread::hardware_concurrency()));
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        b->Arg(threads);
+    }
+    b->Arg(max_threads);
+}
+
+static void BM_ParallelToUtf16(benchmark::State &state)
+{
+    auto const &corpus = Utf8Corpus();
+    ThreadPool pool{size_t(state.range(0))};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ToUtf16(corpus, pool));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size()));
+}
+BENCHMARK(BM_ParallelToUtf16)->Apply(ThreadCounts)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ParallelToUtf8(benchmark::State &state)
+{
+    auto const &corpus = Utf16Corpus();
+    ThreadPool pool{size_t(state.range(0))};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ToUtf8(corpus, pool));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_ParallelToUtf8)->Apply(ThreadCounts)->Unit(benchmark::kMillisecond)->UseRealTime();
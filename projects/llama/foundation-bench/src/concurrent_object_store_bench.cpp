@@ -0,0 +1,123 @@
+// 多线程查找的扩展性：分片的 ConcurrentObjectStore 和整个 ObjectStore 包一把互斥锁对比。
+#include "foundation-bench/corpus.h"
+#include "foundation/concurrent_object_store.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+class HashOnly : public Object
+{
+  public:
+    explicit HashOnly(Hash hash) : m_hash{hash}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return m_hash;
+    }
+
+    void SerializeAsObject(std::ostream &) const override
+    {
+    }
+
+    void DeserializeAsObject(std::istream &) override
+    {
+    }
+
+  private:
+    Hash m_hash;
+};
+
+constexpr size_t kObjectCount = 1'000'000;
+constexpr size_t kLookupsPerIteration = 1024;
+
+std::vector<Hash> const &Keys()
+{
+    static std::vector<Hash> keys = [] {
+        bench::SplitMix64 rng{32};
+        std::vector<Hash> result(kObjectCount, Hash{0, 0});
+        for (auto &key : result)
+        {
+            key = Hash{rng.Next(), rng.Next()};
+        }
+        return result;
+    }();
+    return keys;
+}
+
+// 原先的用法：整个仓库一把锁
+struct LockedObjectStore
+{
+    LockedObjectStore()
+    {
+        for (auto const &key : Keys())
+        {
+            store.Store(std::make_shared<HashOnly>(key));
+        }
+    }
+
+    std::mutex mtx;
+    ObjectStore store;
+};
+
+struct ShardedObjectStore
+{
+    ShardedObjectStore()
+    {
+        store.Reserve(kObjectCount);
+        for (auto const &key : Keys())
+        {
+            store.Store(std::make_shared<HashOnly>(key));
+        }
+    }
+
+    ConcurrentObjectStore store;
+};
+
+int MaxThreads()
+{
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+} // namespace
+
+static void BM_RetrieveLocked(benchmark::State &state)
+{
+    static LockedObjectStore locked;
+    auto const &keys = Keys();
+    bench::SplitMix64 rng{uint64_t(state.thread_index())};
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < kLookupsPerIteration; i++)
+        {
+            std::lock_guard lock{locked.mtx};
+            benchmark::DoNotOptimize(locked.store.Retrieve<HashOnly>(keys[rng.Next() % kObjectCount]).get());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(kLookupsPerIteration));
+}
+BENCHMARK(BM_RetrieveLocked)->ThreadRange(1, MaxThreads())->UseRealTime();
+
+static void BM_RetrieveSharded(benchmark::State &state)
+{
+    static ShardedObjectStore sharded;
+    auto const &keys = Keys();
+    bench::SplitMix64 rng{uint64_t(state.thread_index())};
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < kLookupsPerIteration; i++)
+        {
+            benchmark::DoNotOptimize(sharded.store.Retrieve<HashOnly>(keys[rng.Next() % kObjectCount]).get());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(kLookupsPerIteration));
+}
+BENCHMARK(BM_RetrieveSharded)->ThreadRange(1, MaxThreads())->UseRealTime();
@@ -0,0 +1,77 @@
+// 128 位内容哈希的吞吐，以及对象哈希时流式计算和先序列化到缓冲区再计算的对比。
+#include "foundation-bench/corpus.h"
+#include "foundation/hasher.h"
+#include "foundation/object.h"
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+
+using namespace llama;
+
+namespace
+{
+
+class Blob : public Object
+{
+  public:
+    explicit Blob(std::string bytes) : m_bytes{std::move(bytes)}
+    {
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out.write(m_bytes.data(), std::streamsize(m_bytes.size()));
+    }
+
+    void DeserializeAsObject(std::istream &) override
+    {
+    }
+
+  private:
+    std::string m_bytes;
+};
+
+void Sizes(benchmark::internal::Benchmark *b)
+{
+    b->Arg(16)->Arg(256)->Arg(4 << 10)->Arg(1 << 20);
+}
+
+} // namespace
+
+static void BM_Hasher128(benchmark::State &state)
+{
+    auto text = bench::GenerateMixedText(size_t(state.range(0)), 35);
+    text.resize(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Hasher128::Of(text.data(), text.size()));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Hasher128)->Apply(Sizes);
+
+static void BM_HashAsObjectStreaming(benchmark::State &state)
+{
+    Blob blob{bench::GenerateMixedText(size_t(state.range(0)), 35)};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(blob.HashAsObject());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_HashAsObjectStreaming)->Apply(Sizes);
+
+// 对照：先序列化到临时缓冲区再求哈希
+static void BM_HashAsObjectBuffered(benchmark::State &state)
+{
+    Blob blob{bench::GenerateMixedText(size_t(state.range(0)), 35)};
+    for (auto _ : state)
+    {
+        std::ostringstream out{std::ios::binary};
+        blob.SerializeAsObject(out);
+        auto bytes = std::move(out).str();
+        benchmark::DoNotOptimize(Hasher128::Of(bytes.data(), bytes.size()));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_HashAsObjectBuffered)->Apply(Sizes);
@@ -0,0 +1,388 @@
+// 对象仓库的存取：开放寻址的 HashTable 和原先的 std::map 对比，规模到一千万个对象；
+// 以及批量接口和逐个调用的对比。
+#include "foundation-bench/corpus.h"
+#include "foundation/concurrent_object_store.h"
+#include "foundation/object.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+// 只带哈希的最小对象，基准里只看容器本身的开销
+class HashOnly : public Object
+{
+  public:
+    explicit HashOnly(Hash hash) : m_hash{hash}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return m_hash;
+    }
+
+    void SerializeAsObject(std::ostream &) const override
+    {
+    }
+
+    void DeserializeAsObject(std::istream &) override
+    {
+    }
+
+  private:
+    Hash m_hash;
+};
+
+constexpr size_t kMaxObjects = 10'000'000;
+
+std::vector<sp<Object>> const &Objects()
+{
+    static std::vector<sp<Object>> objects = [] {
+        bench::SplitMix64 rng{31};
+        std::vector<sp<Object>> result;
+        result.reserve(kMaxObjects);
+        for (size_t i = 0; i < kMaxObjects; i++)
+        {
+            result.push_back(std::make_shared<HashOnly>(Hash{rng.Next(), rng.Next()}));
+        }
+        return result;
+    }();
+    return objects;
+}
+
+// 查找顺序和插入顺序无关，避免顺序访问带来的缓存优势
+std::vector<Hash> LookupKeys(size_t count)
+{
+    auto const &objects = Objects();
+    bench::SplitMix64 rng{count};
+    std::vector<Hash> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        keys.push_back(objects[rng.Next() % count]->HashAsObject());
+    }
+    return keys;
+}
+
+void Sizes(benchmark::internal::Benchmark *b)
+{
+    b->Arg(1'000'000)->Arg(int64_t(kMaxObjects));
+}
+
+} // namespace
+
+static void BM_StoreMap(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        std::map<Hash, sp<Object>> map;
+        for (size_t i = 0; i < count; i++)
+        {
+            map.emplace(objects[i]->HashAsObject(), objects[i]);
+        }
+        benchmark::DoNotOptimize(map.size());
+        state.PauseTiming();
+        map.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_StoreMap)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_StoreHashTable(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        ObjectStore store;
+        for (size_t i = 0; i < count; i++)
+        {
+            store.Store(objects[i]);
+        }
+        benchmark::DoNotOptimize(store.Size());
+        state.PauseTiming();
+        store = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_StoreHashTable)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_RetrieveMap(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    std::map<Hash, sp<Object>> map;
+    for (size_t i = 0; i < count; i++)
+    {
+        map.emplace(objects[i]->HashAsObject(), objects[i]);
+    }
+    auto keys = LookupKeys(count);
+    for (auto _ : state)
+    {
+        for (auto const &key : keys)
+        {
+            benchmark::DoNotOptimize(map.find(key)->second.get());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_RetrieveMap)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_RetrieveHashTable(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    ObjectStore store;
+    for (size_t i = 0; i < count; i++)
+    {
+        store.Store(objects[i]);
+    }
+    auto keys = LookupKeys(count);
+    for (auto _ : state)
+    {
+        for (auto const &key : keys)
+        {
+            benchmark::DoNotOptimize(store.Retrieve<HashOnly>(key).get());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_RetrieveHashTable)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+// 批量接口：同样的对象数，和上面逐个调用的版本对比
+static void BM_StoreBatch(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        ObjectStore store;
+        benchmark::DoNotOptimize(store.StoreBatch(std::span{objects.data(), count}));
+        state.PauseTiming();
+        store = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_StoreBatch)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_RetrieveBatch(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    ObjectStore store;
+    store.StoreBatch(std::span{objects.data(), count});
+    auto keys = LookupKeys(count);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.RetrieveBatch<HashOnly>(keys));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_RetrieveBatch)->Apply(Sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_ConcurrentStore(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        auto store = std::make_unique<ConcurrentObjectStore>();
+        for (size_t i = 0; i < count; i++)
+        {
+            store->Store(objects[i]);
+        }
+        state.PauseTiming();
+        store.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ConcurrentStore)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_ConcurrentStoreBatch(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        auto store = std::make_unique<ConcurrentObjectStore>();
+        benchmark::DoNotOptimize(store->StoreBatch(std::span{objects.data(), count}));
+        state.PauseTiming();
+        store.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ConcurrentStoreBatch)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_ConcurrentRetrieve(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    ConcurrentObjectStore store;
+    store.StoreBatch(std::span{objects.data(), count});
+    auto keys = LookupKeys(count);
+    for (auto _ : state)
+    {
+        for (auto const &key : keys)
+        {
+            benchmark::DoNotOptimize(store.Retrieve<HashOnly>(key).get());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ConcurrentRetrieve)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_ConcurrentRetrieveBatch(benchmark::State &state)
+{
+    auto const &objects = Objects();
+    size_t count = size_t(state.range(0));
+    ConcurrentObjectStore store;
+    store.StoreBatch(std::span{objects.data(), count});
+    auto keys = LookupKeys(count);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.RetrieveBatch<HashOnly>(keys));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ConcurrentRetrieveBatch)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+// 单元格大小的对象：每个都单独分配的 sp<Object> ，和按值连续存放在 arena 里的小对象对比
+namespace
+{
+
+class BoxedCell : public Object
+{
+  public:
+    BoxedCell(uint64_t id, double value) : m_value{value}, m_id{id}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{m_id * 0x9E3779B97F4A7C15ull, m_id};
+    }
+
+    void SerializeAsObject(std::ostream &) const override
+    {
+    }
+
+    void DeserializeAsObject(std::istream &) override
+    {
+    }
+
+    double m_value;
+
+  private:
+    uint64_t m_id;
+};
+
+struct SmallCell
+{
+    uint64_t id;
+    double value;
+
+    Hash HashAsObject() const
+    {
+        return Hash{id * 0x9E3779B97F4A7C15ull, id};
+    }
+};
+
+} // namespace
+
+static void BM_StoreBoxedCells(benchmark::State &state)
+{
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        ObjectStore store;
+        for (size_t i = 0; i < count; i++)
+        {
+            store.Store(std::make_shared<BoxedCell>(i, double(i)));
+        }
+        benchmark::DoNotOptimize(store.Size());
+        state.PauseTiming();
+        store = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_StoreBoxedCells)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_StoreSmallCells(benchmark::State &state)
+{
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        ObjectStore store;
+        for (size_t i = 0; i < count; i++)
+        {
+            store.StoreSmall(SmallCell{i, double(i)});
+        }
+        benchmark::DoNotOptimize(store.Size());
+        state.PauseTiming();
+        store = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_StoreSmallCells)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+// 扫描全部单元格求和：持有的 sp 指向分散的堆内存，arena 是顺序访问
+static void BM_ScanBoxedCells(benchmark::State &state)
+{
+    size_t count = size_t(state.range(0));
+    std::vector<sp<BoxedCell>> cells;
+    cells.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cells.push_back(std::make_shared<BoxedCell>(i, double(i)));
+    }
+    // 打乱分配顺序，接近长时间运行后的堆
+    bench::SplitMix64 rng{40};
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        std::swap(cells[i], cells[rng.Next() % (i + 1)]);
+    }
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (auto const &cell : cells)
+        {
+            sum += cell->m_value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ScanBoxedCells)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_ScanSmallCells(benchmark::State &state)
+{
+    size_t count = size_t(state.range(0));
+    ObjectStore store;
+    for (size_t i = 0; i < count; i++)
+    {
+        store.StoreSmall(SmallCell{i, double(i)});
+    }
+    for (auto _ : state)
+    {
+        double sum = 0;
+        store.ForEachSmall<SmallCell>([&](ObjectHandle, SmallCell const &cell) { sum += cell.value; });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_ScanSmallCells)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,156 @@
+// 持久化对象仓库：打开已有仓库的耗时（应当和仓库大小无关），从映射区域反序列化的吞吐，
+// 以及每个对象都同步磁盘和后台成批同步的写入对比。
+#include "foundation-bench/corpus.h"
+#include "foundation/pack_object_store.h"
+#include "foundation/write_behind_object_store.h"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+class Blob : public Object
+{
+  public:
+    Blob() = default;
+
+    Blob(Hash hash, std::string bytes) : m_hash{hash}, m_bytes{std::move(bytes)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return m_hash;
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out.write(m_bytes.data(), std::streamsize(m_bytes.size()));
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        m_bytes.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+
+  private:
+    Hash m_hash = {0, 0};
+    std::string m_bytes;
+};
+
+// 生成有 `count` 个对象的仓库，同一进程内只生成一次
+struct PackFixture
+{
+    explicit PackFixture(size_t count)
+        : directory{std::filesystem::temp_directory_path() / ("llama-bench-pack-" + std::to_string(count))}
+    {
+        std::filesystem::remove_all(directory);
+        bench::SplitMix64 rng{33};
+        PackObjectStore store{directory};
+        for (size_t i = 0; i < count; i++)
+        {
+            Hash key{rng.Next(), rng.Next()};
+            keys.push_back(key);
+            store.Store(Blob{key, bench::GenerateMixedText(64, i)});
+        }
+        store.Flush();
+    }
+
+    ~PackFixture()
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::filesystem::path directory;
+    std::vector<Hash> keys;
+};
+
+PackFixture const &Fixture(size_t count)
+{
+    static PackFixture small{10'000};
+    static PackFixture large{1'000'000};
+    return count == small.keys.size() ? small : large;
+}
+
+void Sizes(benchmark::internal::Benchmark *b)
+{
+    b->Arg(10'000)->Arg(1'000'000);
+}
+
+} // namespace
+
+static void BM_PackOpen(benchmark::State &state)
+{
+    auto const &fixture = Fixture(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        PackObjectStore store{fixture.directory};
+        benchmark::DoNotOptimize(store.Size());
+    }
+}
+BENCHMARK(BM_PackOpen)->Apply(Sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_PackRetrieve(benchmark::State &state)
+{
+    auto const &fixture = Fixture(size_t(state.range(0)));
+    PackObjectStore store{fixture.directory};
+    bench::SplitMix64 rng{0};
+    for (auto _ : state)
+    {
+        auto const &key = fixture.keys[rng.Next() % fixture.keys.size()];
+        benchmark::DoNotOptimize(store.Retrieve<Blob>(key));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_PackRetrieve)->Apply(Sizes);
+
+// 每个对象都要落盘时的写入：每次 Store 之后同步，和后台成批同步对比
+constexpr size_t kDurableBatch = 200;
+
+static void BM_StoreSyncEach(benchmark::State &state)
+{
+    auto directory = std::filesystem::temp_directory_path() / "llama-bench-sync-each";
+    std::filesystem::remove_all(directory);
+    {
+        PackObjectStore store{directory};
+        bench::SplitMix64 rng{41};
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < kDurableBatch; i++)
+            {
+                store.Store(Blob{Hash{rng.Next(), rng.Next()}, bench::GenerateMixedText(64, i)});
+                store.Sync();
+            }
+        }
+    }
+    std::filesystem::remove_all(directory);
+    state.SetItemsProcessed(int64_t(state.iterations() * kDurableBatch));
+}
+BENCHMARK(BM_StoreSyncEach)->Unit(benchmark::kMillisecond);
+
+static void BM_StoreWriteBehind(benchmark::State &state)
+{
+    auto directory = std::filesystem::temp_directory_path() / "llama-bench-write-behind";
+    std::filesystem::remove_all(directory);
+    {
+        PackObjectStore backing{directory};
+        WriteBehindObjectStore store{backing};
+        bench::SplitMix64 rng{41};
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < kDurableBatch; i++)
+            {
+                store.Store(std::make_shared<Blob>(Hash{rng.Next(), rng.Next()}, bench::GenerateMixedText(64, i)));
+            }
+            store.Flush();
+        }
+    }
+    std::filesystem::remove_all(directory);
+    state.SetItemsProcessed(int64_t(state.iterations() * kDurableBatch));
+}
+BENCHMARK(BM_StoreWriteBehind)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,59 @@
+#include "foundation-bench/corpus.h"
+#include "foundation/codex.h"
+#include "foundation/exceptions.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+using namespace llama;
+
+TEST(CorpusTest, MixedTextIsDeterministic)
+{
+    EXPECT_EQ(bench::GenerateMixedText(4096, 1), bench::GenerateMixedText(4096, 1));
+    EXPECT_NE(bench::GenerateMixedText(4096, 1), bench::GenerateMixedText(4096, 2));
+}
+
+TEST(CorpusTest, MixedTextIsValidUtf8)
+{
+    std::string text = bench::GenerateMixedText(64 * 1024);
+    EXPECT_GE(text.size(), 64 * 1024);
+    auto codes = DecodeUtf8(text.data(), text.size());
+    EXPECT_EQ(EncodeUtf8(codes.data(), codes.size()), text);
+}
+
+TEST(CorpusTest, ValidKindsDecode)
+{
+    for (uint32_t i = 0; i < bench::kCorpusKindCount; i++)
+    {
+        auto kind = bench::CorpusKind(i);
+        if (kind == bench::CorpusKind::Malformed)
+            continue;
+        std::string utf8 = bench::GenerateUtf8(kind, 16 * 1024, 3);
+        std::u16string utf16 = bench::GenerateUtf16(kind, 16 * 1024, 3);
+        EXPECT_EQ(bench::GenerateUtf8(kind, 16 * 1024, 3), utf8) << bench::CorpusKindName(kind);
+        // 同一个种子抽出的代码点序列相同，只是长度按各自的字节数截断
+        std::u16string converted = ToUtf16(std::string_view{utf8});
+        size_t common = std::min(converted.size(), utf16.size()) - 2;
+        EXPECT_EQ(converted.substr(0, common), utf16.substr(0, common)) << bench::CorpusKindName(kind);
+        EXPECT_NO_THROW(DecodeUtf16(utf16.data(), utf16.size())) << bench::CorpusKindName(kind);
+    }
+}
+
+TEST(CorpusTest, MalformedKindIsRejected)
+{
+    std::string utf8 = bench::GenerateUtf8(bench::CorpusKind::Malformed, 16 * 1024);
+    std::u16string utf16 = bench::GenerateUtf16(bench::CorpusKind::Malformed, 16 * 1024);
+    EXPECT_THROW(DecodeUtf8(utf8.data(), utf8.size()), Exception);
+    EXPECT_THROW(DecodeUtf16(utf16.data(), utf16.size()), Exception);
+}
+
+TEST(CorpusTest, CodePoints)
+{
+    auto ascii = bench::GenerateCodePoints(bench::CorpusKind::Ascii, 1000);
+    EXPECT_EQ(ascii.size(), 1000);
+    for (uint32_t code : ascii)
+    {
+        EXPECT_LT(code, 0x80u);
+    }
+    auto malformed = bench::GenerateCodePoints(bench::CorpusKind::Malformed, 10000);
+    EXPECT_TRUE(std::any_of(malformed.begin(), malformed.end(), [](uint32_t code) { return code > 0x10FFFF; }));
+}
@@ -0,0 +1,509 @@
+/// @file
+/// 连续缓冲区上的二进制归档。
+
+#pragma once
+
+#include "foundation/exceptions.h"
+#include "foundation/memory_stream.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string_view>
+#include <type_traits>
+
+namespace llama
+{
+
+namespace archive_detail
+{
+
+template <typename U> constexpr U ByteSwap(U value)
+{
+    U result = 0;
+    for (size_t i = 0; i < sizeof(U); i++)
+    {
+        result = static_cast<U>((result << 8) | ((value >> (i * 8)) & 0xFF));
+    }
+    return result;
+}
+
+// 在本机字节序和小端序之间转换，小端机器上什么也不做
+template <typename U> constexpr U LittleEndian(U value)
+{
+    if constexpr (std::endian::native == std::endian::little)
+        return value;
+    else
+        return ByteSwap(value);
+}
+
+} // namespace archive_detail
+
+/// 最长的变长整数的字节数
+inline constexpr size_t kMaxVarintSize = 10;
+
+/// 归档写入端的公共部分。格式：
+/// - 定长整数和浮点数按小端序原样写入；
+/// - 变长整数是 LEB128 ，每字节 7 位，最高位表示后面还有；有符号数先做 zigzag 变换；
+/// - 字节串和字符串先写变长的长度，再写内容。
+///
+/// 格式不记录类型和字段名，读取时必须按写入的顺序调用对应的 `Read` 。
+/// @tparam Derived 提供 `std::byte *Extend(size_t count)` ，返回接下来 `count` 个可写字节的位置
+template <typename Derived> class BasicArchiveWriter
+{
+  public:
+    void WriteU8(uint8_t value)
+    {
+        *Extend(1) = static_cast<std::byte>(value);
+    }
+
+    void WriteU16(uint16_t value)
+    {
+        WriteFixed(value);
+    }
+
+    void WriteU32(uint32_t value)
+    {
+        WriteFixed(value);
+    }
+
+    void WriteU64(uint64_t value)
+    {
+        WriteFixed(value);
+    }
+
+    void WriteI32(int32_t value)
+    {
+        WriteFixed(static_cast<uint32_t>(value));
+    }
+
+    void WriteI64(int64_t value)
+    {
+        WriteFixed(static_cast<uint64_t>(value));
+    }
+
+    void WriteF32(float value)
+    {
+        WriteFixed(std::bit_cast<uint32_t>(value));
+    }
+
+    void WriteF64(double value)
+    {
+        WriteFixed(std::bit_cast<uint64_t>(value));
+    }
+
+    void WriteBool(bool value)
+    {
+        WriteU8(value ? 1 : 0);
+    }
+
+    /// 写入变长的无符号整数，小于 128 的数只占一个字节
+    void WriteVarUint(uint64_t value)
+    {
+        if (value < 0x80)
+        {
+            WriteU8(static_cast<uint8_t>(value));
+            return;
+        }
+        std::byte buffer[kMaxVarintSize];
+        size_t size = 0;
+        while (value >= 0x80)
+        {
+            buffer[size++] = static_cast<std::byte>(value | 0x80);
+            value >>= 7;
+        }
+        buffer[size++] = static_cast<std::byte>(value);
+        std::memcpy(Extend(size), buffer, size);
+    }
+
+    /// 写入变长的有符号整数。绝对值小的负数也只占很少的字节。
+    void WriteVarInt(int64_t value)
+    {
+        WriteVarUint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    /// 原样写入 `count` 个字节，不带长度
+    void WriteRaw(const void *data, size_t count)
+    {
+        if (count != 0)
+            std::memcpy(Extend(count), data, count);
+    }
+
+    /// 写入带长度的字节串
+    void WriteBytes(std::span<const std::byte> bytes)
+    {
+        WriteVarUint(bytes.size());
+        WriteRaw(bytes.data(), bytes.size());
+    }
+
+    /// 写入带长度的字符串
+    void WriteString(std::string_view text)
+    {
+        WriteVarUint(text.size());
+        WriteRaw(text.data(), text.size());
+    }
+
+  private:
+    template <typename U> void WriteFixed(U value)
+    {
+        value = archive_detail::LittleEndian(value);
+        std::memcpy(Extend(sizeof(U)), &value, sizeof(U));
+    }
+
+    std::byte *Extend(size_t count)
+    {
+        return static_cast<Derived *>(this)->Extend(count);
+    }
+};
+
+/// 写入自己管理的、按需增长的缓冲区。`Clear` 之后可以重复使用，不会重新分配。
+class ArchiveWriter : public BasicArchiveWriter<ArchiveWriter>
+{
+  public:
+    ArchiveWriter() = default;
+
+    explicit ArchiveWriter(size_t capacity)
+    {
+        Reserve(capacity);
+    }
+
+    ArchiveWriter(ArchiveWriter &&other) noexcept
+        : m_data{std::move(other.m_data)}, m_size{other.m_size}, m_capacity{other.m_capacity}
+    {
+        other.m_size = other.m_capacity = 0;
+    }
+
+    ArchiveWriter &operator=(ArchiveWriter &&other) noexcept
+    {
+        m_data = std::move(other.m_data);
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        other.m_size = other.m_capacity = 0;
+        return *this;
+    }
+
+    const std::byte *Data() const
+    {
+        return m_data.get();
+    }
+
+    /// 已经写入的字节数
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    /// 已经写入的字节
+    std::span<const std::byte> Bytes() const
+    {
+        return {m_data.get(), m_size};
+    }
+
+    /// 丢弃写入的内容，保留缓冲区
+    void Clear()
+    {
+        m_size = 0;
+    }
+
+    /// 预留空间，使得写入 `capacity` 个字节之前不会重新分配
+    void Reserve(size_t capacity)
+    {
+        if (capacity <= m_capacity)
+            return;
+        auto data = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        if (m_size != 0)
+            std::memcpy(data.get(), m_data.get(), m_size);
+        m_data = std::move(data);
+        m_capacity = capacity;
+    }
+
+  private:
+    friend class BasicArchiveWriter<ArchiveWriter>;
+
+    std::byte *Extend(size_t count)
+    {
+        if (m_capacity - m_size < count)
+            Reserve(std::max(m_capacity * 2, std::max(m_size + count, size_t(64))));
+        std::byte *position = m_data.get() + m_size;
+        m_size += count;
+        return position;
+    }
+
+  private:
+    std::unique_ptr<std::byte[]> m_data;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+/// 写入调用者提供的定长缓冲区，例如映射的文件区域。
+/// 空间不够时抛出异常，已经写入的部分保持不变。
+class SpanWriter : public BasicArchiveWriter<SpanWriter>
+{
+  public:
+    explicit SpanWriter(std::span<std::byte> buffer) : m_buffer{buffer}
+    {
+    }
+
+    /// 已经写入的字节数
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    /// 已经写入的字节
+    std::span<const std::byte> Bytes() const
+    {
+        return m_buffer.first(m_size);
+    }
+
+  private:
+    friend class BasicArchiveWriter<SpanWriter>;
+
+    /// @exception 如果缓冲区剩余的空间不够，抛出 ExceptionKind::IndexOutofRange
+    std::byte *Extend(size_t count)
+    {
+        if (m_buffer.size() - m_size < count)
+            throw Exception{ExceptionKind::IndexOutofRange, "archive buffer is full"};
+        std::byte *position = m_buffer.data() + m_size;
+        m_size += count;
+        return position;
+    }
+
+  private:
+    std::span<std::byte> m_buffer;
+    size_t m_size = 0;
+};
+
+/// 从一段连续内存读取归档，格式见 `BasicArchiveWriter` 。
+///
+/// 不拷贝缓冲区：`ReadBytes` 和 `ReadString` 返回的是指向缓冲区内部的视图，
+/// 缓冲区是映射的文件时，可以不经过任何中间拷贝直接使用其中的数据。缓冲区必须比读到的视图活得久。
+/// 定长字段不要求对齐。
+/// @exception 所有的 `Read` 在数据不够或者格式错误时，抛出 ExceptionKind::InvalidArchive
+class ArchiveReader
+{
+  public:
+    explicit ArchiveReader(std::span<const std::byte> bytes) : m_bytes{bytes}
+    {
+    }
+
+    uint8_t ReadU8()
+    {
+        return static_cast<uint8_t>(*Consume(1));
+    }
+
+    uint16_t ReadU16()
+    {
+        return ReadFixed<uint16_t>();
+    }
+
+    uint32_t ReadU32()
+    {
+        return ReadFixed<uint32_t>();
+    }
+
+    uint64_t ReadU64()
+    {
+        return ReadFixed<uint64_t>();
+    }
+
+    int32_t ReadI32()
+    {
+        return static_cast<int32_t>(ReadFixed<uint32_t>());
+    }
+
+    int64_t ReadI64()
+    {
+        return static_cast<int64_t>(ReadFixed<uint64_t>());
+    }
+
+    float ReadF32()
+    {
+        return std::bit_cast<float>(ReadFixed<uint32_t>());
+    }
+
+    double ReadF64()
+    {
+        return std::bit_cast<double>(ReadFixed<uint64_t>());
+    }
+
+    bool ReadBool()
+    {
+        uint8_t value = ReadU8();
+        if (value > 1)
+            throw Exception{ExceptionKind::InvalidArchive, "invalid boolean"};
+        return value != 0;
+    }
+
+    uint64_t ReadVarUint()
+    {
+        if (m_position < m_bytes.size())
+        {
+            auto first = std::to_integer<uint8_t>(m_bytes[m_position]);
+            if (first < 0x80)
+            {
+                m_position++;
+                return first;
+            }
+        }
+
+        uint64_t value = 0;
+        for (size_t i = 0; i < kMaxVarintSize; i++)
+        {
+            auto byte = ReadU8();
+            // 第十个字节只剩最高的一位可用
+            if (i == 9 && byte > 1)
+                throw Exception{ExceptionKind::InvalidArchive, "varint overflow"};
+            value |= uint64_t(byte & 0x7F) << (i * 7);
+            if (byte < 0x80)
+                return value;
+        }
+        throw Exception{ExceptionKind::InvalidArchive, "varint overflow"};
+    }
+
+    int64_t ReadVarInt()
+    {
+        uint64_t value = ReadVarUint();
+        return static_cast<int64_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    /// 原样读出 `count` 个字节，返回指向缓冲区内部的视图
+    std::span<const std::byte> ReadRaw(size_t count)
+    {
+        return {Consume(count), count};
+    }
+
+    /// 读出带长度的字节串，返回指向缓冲区内部的视图
+    std::span<const std::byte> ReadBytes()
+    {
+        return ReadRaw(ReadLength());
+    }
+
+    /// 读出带长度的字符串，返回指向缓冲区内部的视图。不检查编码。
+    std::string_view ReadString()
+    {
+        size_t length = ReadLength();
+        return {reinterpret_cast<const char *>(Consume(length)), length};
+    }
+
+    /// 跳过 `count` 个字节
+    void Skip(size_t count)
+    {
+        Consume(count);
+    }
+
+    /// 已经读过的字节数
+    size_t Position() const
+    {
+        return m_position;
+    }
+
+    /// 还没有读的字节
+    std::span<const std::byte> Remaining() const
+    {
+        return m_bytes.subspan(m_position);
+    }
+
+    /// 是否已经读完
+    bool AtEnd() const
+    {
+        return m_position == m_bytes.size();
+    }
+
+  private:
+    template <typename U> U ReadFixed()
+    {
+        U value;
+        std::memcpy(&value, Consume(sizeof(U)), sizeof(U));
+        return archive_detail::LittleEndian(value);
+    }
+
+    // 长度不可能超过剩下的字节数，提前检查，免得坏数据里的巨大长度溢出
+    size_t ReadLength()
+    {
+        uint64_t length = ReadVarUint();
+        if (length > m_bytes.size() - m_position)
+            throw Exception{ExceptionKind::InvalidArchive, "length exceeds archive"};
+        return static_cast<size_t>(length);
+    }
+
+    const std::byte *Consume(size_t count)
+    {
+        if (m_bytes.size() - m_position < count)
+            throw Exception{ExceptionKind::InvalidArchive, "unexpected end of archive"};
+        const std::byte *position = m_bytes.data() + m_position;
+        m_position += count;
+        return position;
+    }
+
+  private:
+    std::span<const std::byte> m_bytes;
+    size_t m_position = 0;
+};
+
+/// 写入 `ArchiveWriter` 的输出流。用来把只支持 iostream 的代码接到归档上：流里写的字节原样追加到归档里。
+class ArchiveOutputStream : public std::ostream
+{
+  public:
+    explicit ArchiveOutputStream(ArchiveWriter &writer) : std::ostream{nullptr}, m_buf{writer}
+    {
+        rdbuf(&m_buf);
+    }
+
+  private:
+    class Buffer : public std::streambuf
+    {
+      public:
+        explicit Buffer(ArchiveWriter &writer) : m_writer{writer}
+        {
+        }
+
+      protected:
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                m_writer.WriteU8(static_cast<uint8_t>(traits_type::to_char_type(ch)));
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char_type *data, std::streamsize count) override
+        {
+            m_writer.WriteRaw(data, static_cast<size_t>(count));
+            return count;
+        }
+
+      private:
+        ArchiveWriter &m_writer;
+    };
+
+    Buffer m_buf;
+};
+
+/// 读取 `ArchiveReader` 剩余部分的输入流，不拷贝缓冲区。
+/// 析构时把 `reader` 推进到流读到的位置，之后可以接着用 `reader` 读后面的字段。
+class ArchiveInputStream : public std::istream
+{
+  public:
+    explicit ArchiveInputStream(ArchiveReader &reader)
+        : std::istream{nullptr}, m_reader{reader}, m_buf{reader.Remaining()}
+    {
+        rdbuf(&m_buf);
+    }
+
+    ~ArchiveInputStream()
+    {
+        m_reader.Skip(m_buf.Consumed());
+    }
+
+  private:
+    ArchiveReader &m_reader;
+    MemoryStreamBuf m_buf;
+};
+
+} // namespace llama
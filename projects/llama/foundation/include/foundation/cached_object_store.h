@@ -0,0 +1,150 @@
+/// @file
+/// 容量有限的对象缓存，放在持久化对象仓库前面。
+
+#pragma once
+
+#include "config.h"
+#include "foundation/hash.h"
+#include "foundation/hash_table.h"
+#include "foundation/object.h"
+#include "foundation/pack_object_store.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <type_traits>
+
+namespace llama
+{
+
+/// 缓存的统计数据，用来调整容量。
+struct ObjectCacheStats
+{
+    // 在缓存里找到对象的次数
+    uint64_t hits = 0;
+    // 需要从后备仓库重新加载对象的次数
+    uint64_t misses = 0;
+    // 因为超出容量被逐出的对象数
+    uint64_t evictions = 0;
+    // 常驻对象的字节数（近似值）
+    size_t resident_bytes = 0;
+    // 常驻对象数
+    size_t resident_count = 0;
+};
+
+/// 放在 `PackObjectStore` 前面的对象缓存，常驻对象的总字节数不超过给定的容量。
+///
+/// 用 ARC（Adaptive Replacement Cache）逐出：常驻对象分为只访问过一次的 T1 和访问过多次的 T2 ，
+/// 另外为两者各记住一批最近逐出的键（B1 、B2 ，只有键没有对象）。访问落在 B1 说明 T1 太小，
+/// 落在 B2 说明 T2 太小，据此调整两者的目标大小。这样既不会被一次性的顺序扫描冲掉热点，
+/// 也能跟上访问模式的变化。大小以字节计，对象的字节数取它序列化后的大小加上固定的开销。
+///
+/// 存放的对象直接写入后备仓库；被逐出的对象在下次 `Retrieve` 时通过 `DeserializeAsObject` 重新加载。
+/// 被逐出的只是缓存里的引用，调用者仍然持有的对象不受影响。
+/// @note 不是线程安全的。后备仓库必须比缓存活得久。
+class LLAMA_FND_API CachedObjectStore
+{
+  public:
+    /// 每个常驻对象在序列化大小之外额外计入的字节数，粗略对应对象头、控制块和缓存自身的簿记。
+    static constexpr size_t kEntryOverhead = 96;
+
+    /// @param backing 后备仓库
+    /// @param capacity 常驻对象的总字节数上限
+    CachedObjectStore(PackObjectStore &backing, size_t capacity);
+
+    CachedObjectStore(CachedObjectStore const &) = delete;
+    CachedObjectStore &operator=(CachedObjectStore const &) = delete;
+
+    /// 存放 `object` ，同时放进缓存。
+    /// @return 对象的哈希
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    Hash Store(sp<Object> object);
+
+    /// 获取哈希值为 `hash` 的对象 `T` 。不在缓存里时从后备仓库加载。
+    /// @tparam T 必须为 `Object` 的子类，并且可以默认构造
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> sp<T> Retrieve(Hash const &hash)
+    {
+        static_assert(std::is_base_of_v<Object, T>);
+        if (sp<Object> const *cached = Hit(hash))
+        {
+            assert(std::dynamic_pointer_cast<T>(*cached));
+            return std::static_pointer_cast<T>(*cached);
+        }
+        sp<T> object = m_backing.Retrieve<T>(hash);
+        Admit(hash, object, m_backing.SizeOf(hash));
+        return object;
+    }
+
+    /// 是否存放了哈希值为 `hash` 的对象（不论是否在缓存里）
+    bool Contains(Hash const &hash) const
+    {
+        return m_entries.Contains(hash) || m_backing.Contains(hash);
+    }
+
+    /// 修改容量。缩小时立即逐出多出来的对象。
+    void SetCapacity(size_t capacity);
+
+    size_t Capacity() const
+    {
+        return m_capacity;
+    }
+
+    ObjectCacheStats Stats() const;
+
+    void ResetStats();
+
+  private:
+    enum class ListKind : uint8_t
+    {
+        T1,
+        T2,
+        B1,
+        B2,
+    };
+
+    struct Entry
+    {
+        Hash key;
+        // B1 、B2 里的条目没有对象
+        sp<Object> object;
+        size_t size;
+    };
+
+    struct List
+    {
+        // 头部是最近使用的
+        std::list<Entry> entries;
+        size_t bytes = 0;
+    };
+
+    struct Position
+    {
+        ListKind list;
+        std::list<Entry>::iterator iter;
+    };
+
+    // 命中时移到 T2 头部并返回对象；不在 T1 、T2 里时返回空并计一次未命中
+    sp<Object> const *Hit(Hash const &hash);
+    // 把刚加载或刚存放的对象放进缓存
+    void Admit(Hash const &hash, sp<Object> object, uint64_t serialized_size);
+
+    List &ListOf(ListKind kind);
+    void MoveTo(Position &position, ListKind to);
+    void Drop(ListKind from);
+    void Replace(bool hit_in_b2);
+
+  private:
+    PackObjectStore &m_backing;
+    size_t m_capacity;
+    // T1 的目标字节数，在 0 和容量之间自适应
+    size_t m_target_t1 = 0;
+
+    List m_t1, m_t2, m_b1, m_b2;
+    HashTable<Position> m_entries;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_evictions = 0;
+};
+
+} // namespace llama
@@ -5,25 +5,221 @@
 #pragma once
 
 #include "config.h"
+#include "foundation/exceptions.h"
 #include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
-#ifdef LLAMA_FND_EXPORT
-#define LLAMA_FND_API LLAMA_EXPORT_SYMBOL
-#else
-#define LLAMA_FND_API LLAMA_IMPORT_SYMBOL
-#endif
-
 namespace llama
 {
 
+class ThreadPool;
+
+/*  _____________________________  */
+/*        单字符编解码             */
+/*  _____________________________  */
+// 以下函数都是 constexpr 的，编译期和运行期共用同一份实现。
+// 在常量求值中抛出异常即为编译错误，所以不合法的字面量会在编译期被拒绝。
+
+/// 从 `data[index]` 开始解析一个 UTF-8 代码点。成功时把 `index` 移到下一个代码点的开头；
+/// 首字节或续字节不合法、序列被截断时返回 false ，`index` 不变。
+/// 超长编码（比如 `C0 80` ）、编码的代理（ 0xD800 ～ 0xDFFF ）和大于 0x10FFFF 的值也不合法。
+constexpr bool TryDecodeUtf8Char(const char *data, size_t length, size_t &index, uint32_t &code_point)
+{
+    uint8_t ch = static_cast<uint8_t>(data[index]);
+    if (ch < 0x80)
+    {
+        index += 1;
+        code_point = ch;
+        return true;
+    }
+
+    size_t trailing = 0;
+    uint32_t result = 0;
+    if ((ch & 0xE0) == 0xC0)
+    {
+        trailing = 1;
+        result = ch & 0x1F;
+    }
+    else if ((ch & 0xF0) == 0xE0)
+    {
+        trailing = 2;
+        result = ch & 0x0F;
+    }
+    else if ((ch & 0xF8) == 0xF0)
+    {
+        trailing = 3;
+        result = ch & 0x07;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (length - index <= trailing)
+        return false;
+    for (size_t i = 1; i <= trailing; i++)
+    {
+        uint8_t next = static_cast<uint8_t>(data[index + i]);
+        if ((next & 0xC0) != 0x80)
+            return false;
+        result = (result << 6) | (next & 0x3F);
+    }
+    // 每种长度能表示的最小值，更小的值应该用更短的序列
+    constexpr uint32_t kMinimum[] = {0, 0x80, 0x800, 0x10000};
+    if (result < kMinimum[trailing] || (result >= 0xD800 && result <= 0xDFFF) || result > 0x10FFFF)
+        return false;
+    index += trailing + 1;
+    code_point = result;
+    return true;
+}
+
+/// 从 `data[index]` 开始解析一个 UTF-8 代码点，并把 `index` 移到下一个代码点的开头。
+/// @exception 序列不合法时（见 `TryDecodeUtf8Char` ），抛出 ExceptionKind::InvalidByteSequence
+constexpr uint32_t DecodeUtf8Char(const char *data, size_t length, size_t &index)
+{
+    uint32_t code_point = 0;
+    if (!TryDecodeUtf8Char(data, length, index, code_point))
+        throw Exception(ExceptionKind::InvalidByteSequence);
+    return code_point;
+}
+
+/// 从 `data[index]` 开始解析一个 UTF-16 代码点。成功时把 `index` 移到下一个代码点的开头；
+/// 高代理后面没有低代理时返回 false ，`index` 不变。
+constexpr bool TryDecodeUtf16Char(const char16_t *data, size_t length, size_t &index, uint32_t &code_point)
+{
+    char16_t unit = data[index];
+    if (unit >= 0xD800 && unit <= 0xDBFF)
+    {
+        if (index + 1 >= length || data[index + 1] < 0xDC00 || data[index + 1] > 0xDFFF)
+            return false;
+        code_point = ((unit - 0xD800) << 10) + (data[index + 1] - 0xDC00) + 0x10000;
+        index += 2;
+        return true;
+    }
+    index += 1;
+    code_point = unit;
+    return true;
+}
+
+/// 从 `data[index]` 开始解析一个 UTF-16 代码点，并把 `index` 移到下一个代码点的开头。
+/// @exception 高代理后面没有低代理时，抛出 ExceptionKind::InvalidByteSequence
+constexpr uint32_t DecodeUtf16Char(const char16_t *data, size_t length, size_t &index)
+{
+    uint32_t code_point = 0;
+    if (!TryDecodeUtf16Char(data, length, index, code_point))
+        throw Exception(ExceptionKind::InvalidByteSequence);
+    return code_point;
+}
+
+/// 代码点编码为 UTF-16 后的代码单元数
+constexpr size_t EncodedUtf16Length(uint32_t code_point)
+{
+    return code_point <= 0xFFFF ? 1 : 2;
+}
+
+/// 代码点编码为 UTF-8 后的字节数。大于 0x10FFFF 的代码点不输出，长度为 0 。
+constexpr size_t EncodedUtf8Length(uint32_t code_point)
+{
+    if (code_point <= 0x7F)
+        return 1;
+    else if (code_point <= 0x7FF)
+        return 2;
+    else if (code_point <= 0xFFFF)
+        return 3;
+    else if (code_point <= 0x10FFFF)
+        return 4;
+    return 0;
+}
+
+/// 将一个代码点以 UTF-16 写到 `out` 。
+/// @return 写入的末尾
+constexpr char16_t *EncodeUtf16Char(uint32_t code_point, char16_t *out)
+{
+    if (code_point <= 0xFFFF)
+    {
+        *out++ = static_cast<char16_t>(code_point);
+    }
+    else
+    {
+        code_point -= 0x10000;
+        *out++ = static_cast<char16_t>((code_point >> 10) + 0xD800);
+        *out++ = static_cast<char16_t>((code_point & 0x3FF) + 0xDC00);
+    }
+    return out;
+}
+
+/// 将一个代码点以 UTF-8 写到 `out` 。大于 0x10FFFF 的代码点不输出。
+/// @return 写入的末尾
+constexpr char *EncodeUtf8Char(uint32_t code_point, char *out)
+{
+    if (code_point <= 0x7F)
+    {
+        *out++ = static_cast<char>(code_point);
+    }
+    else if (code_point <= 0x7FF)
+    {
+        *out++ = static_cast<char>((code_point >> 6) | 0xC0);
+        *out++ = static_cast<char>((code_point & 0x3F) | 0x80);
+    }
+    else if (code_point <= 0xFFFF)
+    {
+        *out++ = static_cast<char>((code_point >> 12) | 0xE0);
+        *out++ = static_cast<char>(((code_point >> 6) & 0x3F) | 0x80);
+        *out++ = static_cast<char>((code_point & 0x3F) | 0x80);
+    }
+    else if (code_point <= 0x10FFFF)
+    {
+        *out++ = static_cast<char>((code_point >> 18) | 0xF0);
+        *out++ = static_cast<char>(((code_point >> 12) & 0x3F) | 0x80);
+        *out++ = static_cast<char>(((code_point >> 6) & 0x3F) | 0x80);
+        *out++ = static_cast<char>((code_point & 0x3F) | 0x80);
+    }
+    return out;
+}
+
+/// 将 UTF-8 字符串转为 UTF-16 写到 `out` 。`out` 为空时只计算长度。可以在编译期使用。
+/// @return UTF-16 代码单元数
+/// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
+constexpr size_t Utf8ToUtf16(const char *data, size_t length, char16_t *out)
+{
+    size_t count = 0;
+    for (size_t index = 0; index < length;)
+    {
+        uint32_t code_point = DecodeUtf8Char(data, length, index);
+        if (out)
+            EncodeUtf16Char(code_point, out + count);
+        count += EncodedUtf16Length(code_point);
+    }
+    return count;
+}
+
+/// 将 UTF-8 字符串解析成代码点写到 `out` 。`out` 为空时只计算个数。可以在编译期使用。
+/// @return 代码点个数
+/// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
+constexpr size_t Utf8ToUtf32(const char *data, size_t length, char32_t *out)
+{
+    size_t count = 0;
+    for (size_t index = 0; index < length; count++)
+    {
+        uint32_t code_point = DecodeUtf8Char(data, length, index);
+        if (out)
+            out[count] = static_cast<char32_t>(code_point);
+    }
+    return count;
+}
+
+/*  _____________________________  */
+/*        字符串编解码             */
+/*  _____________________________  */
+
 /// 将 UTF-16 字符串解析成代码点。
 /// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
 LLAMA_FND_API std::vector<uint32_t> DecodeUtf16(const char16_t *data, size_t length);
 /// 将 UTF-8 字符串解析成代码点
+/// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
 LLAMA_FND_API std::vector<uint32_t> DecodeUtf8(const char *data, size_t length);
 
 /// 将代码点编码为 UTF-16 字符串
@@ -62,4 +258,14 @@ inline std::string ToUtf8(std::wstring_view str)
 #endif
 }
 
+/// 在线程池 `pool` 上并行地将 UTF-8 字符串转为 UTF-16 。
+/// 输入会在代码点边界处切块，各块独立转换后再拼接。对合法的输入，结果与 `ToUtf16(str)` 完全相同。
+/// 输入太短时直接在当前线程转换。
+/// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
+LLAMA_FND_API std::u16string ToUtf16(std::string_view str, ThreadPool &pool);
+
+/// 在线程池 `pool` 上并行地将 UTF-16 字符串转为 UTF-8 。对合法的输入，结果与 `ToUtf8(str)` 完全相同。
+/// @exception 如果解析失败，抛出 ExceptionKind::InvalidByteSequence
+LLAMA_FND_API std::string ToUtf8(std::u16string_view str, ThreadPool &pool);
+
 } // namespace llama
\ No newline at end of file
@@ -0,0 +1,98 @@
+/// @file
+/// 编译期字符串编码转换。
+/// 对字符串字面量用 `"..."_u16` 、`"..."_u32` 代替 `ToUtf16("...")` ，转换在编译期完成，运行期没有任何开销。
+/// 不合法的 UTF-8 字面量无法通过编译。
+/// ```
+/// using namespace llama::literals;
+/// static constexpr auto kTitle = "工作簿"_u16;
+/// std::u16string_view title = kTitle;
+/// ```
+
+#pragma once
+
+#include "codex.h"
+#include <cstddef>
+#include <string_view>
+
+namespace llama
+{
+
+/// 编译期生成的定长字符串。`N` 是代码单元数，末尾另有一个 0 。
+template <typename CharT, size_t N> class StaticString
+{
+  public:
+    constexpr const CharT *Data() const
+    {
+        return m_data;
+    }
+
+    constexpr CharT *Data()
+    {
+        return m_data;
+    }
+
+    constexpr size_t Size() const
+    {
+        return N;
+    }
+
+    constexpr CharT operator[](size_t index) const
+    {
+        return m_data[index];
+    }
+
+    constexpr std::basic_string_view<CharT> View() const
+    {
+        return {m_data, N};
+    }
+
+    constexpr operator std::basic_string_view<CharT>() const
+    {
+        return View();
+    }
+
+  private:
+    CharT m_data[N + 1] = {};
+};
+
+namespace literals
+{
+
+/// 字符串字面量作为模板参数的载体。成员必须是公有的，否则不能作为模板参数。
+template <size_t N> struct Utf8Literal
+{
+    consteval Utf8Literal(const char (&str)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            chars[i] = str[i];
+        }
+    }
+
+    // 不含末尾的 0
+    static constexpr size_t length = N - 1;
+
+    char chars[N] = {};
+};
+
+/// UTF-8 字面量转 UTF-16 。
+template <Utf8Literal Str> consteval auto operator""_u16()
+{
+    constexpr size_t length = Utf8ToUtf16(Str.chars, Str.length, nullptr);
+    StaticString<char16_t, length> result;
+    Utf8ToUtf16(Str.chars, Str.length, result.Data());
+    return result;
+}
+
+/// UTF-8 字面量转 UTF-32 。
+template <Utf8Literal Str> consteval auto operator""_u32()
+{
+    constexpr size_t length = Utf8ToUtf32(Str.chars, Str.length, nullptr);
+    StaticString<char32_t, length> result;
+    Utf8ToUtf32(Str.chars, Str.length, result.Data());
+    return result;
+}
+
+} // namespace literals
+
+} // namespace llama
@@ -0,0 +1,373 @@
+/// @file
+/// 线程安全的对象仓库。
+
+#pragma once
+#include "foundation/object.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace llama
+{
+
+/// 线程安全的对象仓库。接口和 `ObjectStore` 相同，可以从多个线程同时存取。
+///
+/// 对象按哈希的最高几位分到若干个分片，每个分片有自己的哈希表和读写锁。
+/// 不同分片上的操作互不影响；同一分片上的 `Retrieve` 只加共享锁，也可以同时进行。
+/// 哈希表探测用的是 `Hash::Data1()` 的低位，和分片用的高位不重叠，各分片内的分布仍然均匀。
+///
+/// 垃圾回收分成增量的标记和逐个分片的清除。标记期间仓库照常使用，只有清除某个分片时才独占那个分片。
+/// 回收由一个线程驱动（`BeginCollection` 、`CollectStep` 、`FinishCollection`），其他线程照常存取。
+/// 回收期间新存放的对象和新加的根一律存活；新存放的对象只能引用回收开始时可达的对象或者回收期间存放的对象。
+/// 存放之后还没有加为根、也没有被别的对象引用的对象，会在下一次回收时被回收。
+class ConcurrentObjectStore
+{
+  public:
+    /// 分片数。远多于核心数，使两个线程落到同一分片的概率很小。
+    static constexpr size_t kShardCount = 64;
+
+    ConcurrentObjectStore()
+    {
+    }
+
+    ConcurrentObjectStore(ConcurrentObjectStore const &) = delete;
+    ConcurrentObjectStore &operator=(ConcurrentObjectStore const &) = delete;
+
+    /// 存放 `object` 。
+    /// @return 对象的哈希
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    Hash Store(sp<Object> object)
+    {
+        Hash key = object->HashAsObject();
+        ShadeIfCollecting(std::span{&key, 1});
+        Shard &shard = ShardOf(key);
+        bool inserted;
+        {
+            std::unique_lock lock{shard.mtx};
+            inserted = shard.table.Insert(key, std::move(object)).second;
+        }
+        if (!inserted)
+            throw Exception{ExceptionKind::ElementAlreadyExists};
+        return key;
+    }
+
+    /// 获取哈希值为 `hash` 的对象 `T` 。
+    /// @tparam T 必须为 `Object` 的子类
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> sp<T> Retrieve(Hash const &hash) const
+    {
+        static_assert(std::is_base_of_v<Object, T>);
+        sp<Object> object = Find(hash);
+        if (!object)
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        assert(std::dynamic_pointer_cast<T>(object));
+        return std::static_pointer_cast<T>(std::move(object));
+    }
+
+    /// 批量存放 `objects` 。对象先按分片分组，每个分片只加一次锁，锁内边预取边插入。
+    /// @return 各对象的哈希，顺序和 `objects` 相同
+    /// @exception 如果有对象已经存在（包括同一批里重复的），将抛出 `ExceptionKind::ElementAlreadyExists` ，
+    /// 这时已经存放的这一批对象会被撤回。撤回之前，其他线程可能已经看到了其中一部分。
+    std::vector<Hash> StoreBatch(std::span<const sp<Object>> objects)
+    {
+        std::vector<Hash> keys;
+        keys.reserve(objects.size());
+        for (auto const &object : objects)
+        {
+            keys.push_back(object->HashAsObject());
+        }
+        ShadeIfCollecting(keys);
+
+        ShardGroups groups = GroupByShard(keys);
+        size_t inserted = 0;
+        bool duplicated = false;
+        for (size_t s = 0; s < kShardCount && !duplicated; s++)
+        {
+            size_t begin = groups.begin[s], end = groups.begin[s + 1];
+            if (begin == end)
+                continue;
+
+            Shard &shard = m_shards[s];
+            std::unique_lock lock{shard.mtx};
+            shard.table.Reserve(shard.table.Size() + (end - begin));
+            for (size_t i = begin; i < end; i++, inserted++)
+            {
+                if (i + ObjectStore::kPrefetchDistance < end)
+                    shard.table.Prefetch(keys[groups.order[i + ObjectStore::kPrefetchDistance]]);
+                size_t index = groups.order[i];
+                if (!shard.table.Insert(keys[index], objects[index]).second)
+                {
+                    duplicated = true;
+                    break;
+                }
+            }
+        }
+
+        if (duplicated)
+        {
+            // 按同样的顺序撤回已经插入的
+            for (size_t i = 0; i < inserted; i++)
+            {
+                Hash const &key = keys[groups.order[i]];
+                Shard &shard = ShardOf(key);
+                std::unique_lock lock{shard.mtx};
+                shard.table.Erase(key);
+            }
+            throw Exception{ExceptionKind::ElementAlreadyExists};
+        }
+        return keys;
+    }
+
+    /// 批量获取对象 `T` 。按分片分组，每个分片只加一次共享锁。
+    /// @return 各对象，顺序和 `hashes` 相同
+    /// @tparam T 必须为 `Object` 的子类
+    /// @exception 如果有对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> std::vector<sp<T>> RetrieveBatch(std::span<const Hash> hashes) const
+    {
+        static_assert(std::is_base_of_v<Object, T>);
+        std::vector<sp<T>> objects(hashes.size());
+        ShardGroups groups = GroupByShard(hashes);
+        for (size_t s = 0; s < kShardCount; s++)
+        {
+            size_t begin = groups.begin[s], end = groups.begin[s + 1];
+            if (begin == end)
+                continue;
+
+            Shard const &shard = m_shards[s];
+            std::shared_lock lock{shard.mtx};
+            for (size_t i = begin; i < end; i++)
+            {
+                if (i + ObjectStore::kPrefetchDistance < end)
+                    shard.table.Prefetch(hashes[groups.order[i + ObjectStore::kPrefetchDistance]]);
+                size_t index = groups.order[i];
+                sp<Object> const *object = shard.table.Find(hashes[index]);
+                if (!object)
+                    throw Exception{ExceptionKind::ElementDoesNotExist};
+                assert(std::dynamic_pointer_cast<T>(*object));
+                objects[index] = std::static_pointer_cast<T>(*object);
+            }
+        }
+        return objects;
+    }
+
+    /// 是否存放了哈希值为 `hash` 的对象
+    bool Contains(Hash const &hash) const
+    {
+        Shard const &shard = ShardOf(hash);
+        std::shared_lock lock{shard.mtx};
+        return shard.table.Contains(hash);
+    }
+
+    /// 存放的对象数。其他线程同时在存放时，结果只是某一时刻的近似值。
+    size_t Size() const
+    {
+        size_t size = 0;
+        for (auto const &shard : m_shards)
+        {
+            std::shared_lock lock{shard.mtx};
+            size += shard.table.Size();
+        }
+        return size;
+    }
+
+    /// 预留空间，使得存放 `count` 个对象之前（大致）不会重新分配。
+    void Reserve(size_t count)
+    {
+        for (auto &shard : m_shards)
+        {
+            std::unique_lock lock{shard.mtx};
+            shard.table.Reserve(count / kShardCount + 1);
+        }
+    }
+
+    /// 把 `hash` 加为垃圾回收的根。根按次数计数，加了几次就要 `RemoveRoot` 几次才会取消。
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    void AddRoot(Hash const &hash)
+    {
+        if (!Contains(hash))
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        std::lock_guard lock{m_gc_mtx};
+        ++*m_roots.Insert(hash, 0).first;
+        if (m_marker)
+            m_marker->Shade(hash);
+    }
+
+    /// 取消一次 `AddRoot` 。正在进行的回收仍然把它当作存活。
+    /// @exception 如果 `hash` 不是根，将抛出 `ExceptionKind::ElementDoesNotExist`
+    void RemoveRoot(Hash const &hash)
+    {
+        std::lock_guard lock{m_gc_mtx};
+        size_t *count = m_roots.Find(hash);
+        if (!count)
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        if (--*count == 0)
+            m_roots.Erase(hash);
+    }
+
+    /// 开始一次回收：标记当前所有的根，之后用 `CollectStep` 逐步标记。
+    /// @exception 如果上一次回收还没有结束，抛出 `ExceptionKind::InvalidState`
+    void BeginCollection()
+    {
+        std::lock_guard lock{m_gc_mtx};
+        if (m_marker)
+            throw Exception{ExceptionKind::InvalidState, "collection already in progress"};
+        m_marker = std::make_unique<ReachabilityMarker>([this](Hash const &hash) { return Find(hash); });
+        m_roots.ForEach([&](Hash const &hash, size_t &) { m_marker->Shade(hash); });
+        m_collecting.store(true);
+    }
+
+    /// 标记最多 `budget` 个对象。期间其他线程的 `Retrieve` 不受影响，`Store` 最多等这一步做完。
+    /// @return 是否已经标记完
+    /// @exception 如果没有在回收，抛出 `ExceptionKind::InvalidState`
+    bool CollectStep(size_t budget)
+    {
+        std::lock_guard driver{m_collect_mtx};
+        return MarkStep(budget);
+    }
+
+    /// 标记完剩下的对象，然后逐个分片清除不可达的对象。每个分片只在清除它的时候被独占。
+    /// @return 回收的对象数
+    /// @exception 如果没有在回收，抛出 `ExceptionKind::InvalidState`
+    size_t FinishCollection()
+    {
+        std::lock_guard driver{m_collect_mtx};
+        while (!MarkStep(kCollectStepBudget))
+        {
+        }
+
+        // 清除期间存放的对象也会被 Shade ，所以清除时要在分片锁里再拿 m_gc_mtx 查标记
+        size_t collected = 0;
+        for (auto &shard : m_shards)
+        {
+            std::unique_lock shard_lock{shard.mtx};
+            std::lock_guard lock{m_gc_mtx};
+            collected += shard.table.EraseIf([&](Hash const &hash, sp<Object> &) { return !m_marker->IsMarked(hash); });
+        }
+
+        std::lock_guard lock{m_gc_mtx};
+        m_collecting.store(false);
+        m_marker.reset();
+        return collected;
+    }
+
+    /// 完整地做一次回收。
+    /// @return 回收的对象数
+    size_t Collect()
+    {
+        BeginCollection();
+        return FinishCollection();
+    }
+
+    /// `FinishCollection` 每次持有标记锁时最多标记的对象数
+    static constexpr size_t kCollectStepBudget = 1024;
+
+  private:
+    // 每个分片独占缓存行，免得相邻分片的锁互相干扰
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mtx;
+        HashTable<sp<Object>> table;
+    };
+
+    static constexpr size_t kShardBits = 6;
+    static_assert(size_t(1) << kShardBits == kShardCount);
+
+    Shard &ShardOf(Hash const &hash)
+    {
+        return m_shards[ShardIndex(hash)];
+    }
+
+    Shard const &ShardOf(Hash const &hash) const
+    {
+        return m_shards[ShardIndex(hash)];
+    }
+
+    static size_t ShardIndex(Hash const &hash)
+    {
+        return hash.Data1() >> (64 - kShardBits);
+    }
+
+    // 按分片分组后的下标。第 s 个分片的元素是 order[begin[s]] 到 order[begin[s + 1] - 1]
+    struct ShardGroups
+    {
+        std::vector<uint32_t> order;
+        std::array<size_t, kShardCount + 1> begin;
+    };
+
+    // 计数排序，同一分片内保持原来的顺序
+    static ShardGroups GroupByShard(std::span<const Hash> keys)
+    {
+        ShardGroups groups;
+        groups.begin.fill(0);
+        for (auto const &key : keys)
+        {
+            groups.begin[ShardIndex(key) + 1]++;
+        }
+        for (size_t s = 0; s < kShardCount; s++)
+        {
+            groups.begin[s + 1] += groups.begin[s];
+        }
+        std::array<size_t, kShardCount> next;
+        std::copy_n(groups.begin.begin(), kShardCount, next.begin());
+        groups.order.resize(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            groups.order[next[ShardIndex(keys[i])]++] = static_cast<uint32_t>(i);
+        }
+        return groups;
+    }
+
+    bool MarkStep(size_t budget)
+    {
+        std::lock_guard lock{m_gc_mtx};
+        if (!m_marker)
+            throw Exception{ExceptionKind::InvalidState, "no collection in progress"};
+        return m_marker->Step(budget);
+    }
+
+    // 回收期间存放的对象一律存活。在插入之前标记，清除分片时就不会漏掉
+    void ShadeIfCollecting(std::span<const Hash> keys)
+    {
+        if (!m_collecting.load())
+            return;
+        std::lock_guard lock{m_gc_mtx};
+        if (!m_marker)
+            return;
+        for (auto const &key : keys)
+        {
+            m_marker->Shade(key);
+        }
+    }
+
+    sp<Object> Find(Hash const &hash) const
+    {
+        Shard const &shard = ShardOf(hash);
+        std::shared_lock lock{shard.mtx};
+        sp<Object> const *object = shard.table.Find(hash);
+        return object ? *object : nullptr;
+    }
+
+  private:
+    std::array<Shard, kShardCount> m_shards;
+
+    // 保证同一时刻只有一个线程在标记或清除。标记时拿着 m_gc_mtx 查分片，清除时在分片锁里拿 m_gc_mtx ，
+    // 两者错开才不会死锁
+    std::mutex m_collect_mtx;
+
+    // 垃圾回收。这个mutex管它下面的几个成员
+    mutable std::mutex m_gc_mtx;
+    HashTable<size_t> m_roots;
+    std::unique_ptr<ReachabilityMarker> m_marker;
+    // 不加锁就能判断是否在回收，不回收时 Store 不碰 m_gc_mtx
+    std::atomic<bool> m_collecting = false;
+};
+
+} // namespace llama
@@ -6,4 +6,10 @@
 #else
 #define LLAMA_EXPORT_SYMBOL __attribute__((visibility("default")))
 #define LLAMA_IMPORT_SYMBOL __attribute__((visibility("default")))
+#endif
+
+#ifdef LLAMA_FND_EXPORT
+#define LLAMA_FND_API LLAMA_EXPORT_SYMBOL
+#else
+#define LLAMA_FND_API LLAMA_IMPORT_SYMBOL
 #endif
\ No newline at end of file
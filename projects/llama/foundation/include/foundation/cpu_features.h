@@ -0,0 +1,43 @@
+/// @file
+/// 向量化内核共用的指令集检测。各内核按运行时检测的结果选择实现。
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LLAMA_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LLAMA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LLAMA_TARGET_AVX2
+#endif
+
+namespace llama::simd
+{
+
+#ifdef LLAMA_SIMD_X86
+
+// CPU 和操作系统是否都支持 AVX2
+inline bool HasAvx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (!os_saves_ymm)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#endif
+}
+
+#endif
+
+} // namespace llama::simd
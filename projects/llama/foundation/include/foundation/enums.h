@@ -27,6 +27,7 @@ enum class ExceptionKind : uint32_t
     // 通用
     NullPointer,
     BadArgument,
+    InvalidState,
 
     // 容器相关
     IndexOutofRange,
@@ -35,9 +36,22 @@ enum class ExceptionKind : uint32_t
 
     // 文件系统
     InvalidRelativePath,
+    IoError,
+    InvalidFileFormat,
 
     // 字符串
-    InvalidByteSequence
+    InvalidByteSequence,
+
+    // 序列化
+    InvalidArchive,
+};
+
+// 字符串的编码
+enum class TextEncoding : uint32_t
+{
+    Utf8,
+    Utf16,
+    Utf32,
 };
 
 // 表示协程的三种状态
@@ -51,4 +65,13 @@ enum class PromiseStatus : uint32_t
     HasResult,
 };
 
+// 表格单元格里值的类型
+enum class CellType : uint32_t
+{
+    Empty,
+    Number,
+    Bool,
+    String,
+};
+
 } // namespace llama
\ No newline at end of file
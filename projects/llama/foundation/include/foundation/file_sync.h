@@ -0,0 +1,21 @@
+/// @file
+/// 把文件和目录的改动写到磁盘。
+
+#pragma once
+
+#include "config.h"
+#include <filesystem>
+
+namespace llama
+{
+
+/// 把文件 `path` 在操作系统缓存里的数据写到磁盘。同一个文件的其他句柄写入的数据也包括在内。
+/// @return 是否成功
+LLAMA_FND_API bool SyncFile(std::filesystem::path const &path);
+
+/// 把目录 `path` 里的改名、删除写到磁盘。替换文件之后调用，改名才不会在断电后丢失。
+/// @return 是否成功
+/// @note Windows 上不能打开目录来同步，改名由文件系统的日志保证，总是返回 true
+LLAMA_FND_API bool SyncDirectory(std::filesystem::path const &path);
+
+} // namespace llama
@@ -0,0 +1,83 @@
+/// @file
+/// 128 位哈希值。
+
+#pragma once
+#include <cstdint>
+
+namespace llama
+{
+
+/// 128 位哈希。对象仓库用它作为对象的键。
+class Hash
+{
+  public:
+    constexpr Hash(uint64_t data1, uint64_t data2) : m_data1{data1}, m_data2(data2)
+    {
+    }
+
+    constexpr uint64_t Data1() const
+    {
+        return m_data1;
+    }
+
+    constexpr uint64_t Data2() const
+    {
+        return m_data2;
+    }
+
+    constexpr bool operator==(Hash const &other) const
+    {
+        return m_data1 == other.m_data1 && m_data2 == other.m_data2;
+    }
+
+    constexpr bool operator!=(Hash const &other) const
+    {
+        return m_data1 != other.m_data1 || m_data2 != other.m_data2;
+    }
+
+    constexpr bool operator<(Hash const &other) const
+    {
+        if (m_data1 < other.m_data1)
+            return true;
+        else if (m_data1 > other.m_data1)
+            return false;
+        else
+            return (m_data2 < other.m_data2);
+    }
+
+    constexpr bool operator>(Hash const &other) const
+    {
+        if (m_data1 > other.m_data1)
+            return true;
+        else if (m_data1 < other.m_data1)
+            return false;
+        else
+            return (m_data2 > other.m_data2);
+    }
+
+    constexpr bool operator<=(Hash const &other) const
+    {
+        if (m_data1 < other.m_data1)
+            return true;
+        else if (m_data1 > other.m_data1)
+            return false;
+        else
+            return (m_data2 <= other.m_data2);
+    }
+
+    constexpr bool operator>=(Hash const &other) const
+    {
+        if (m_data1 > other.m_data1)
+            return true;
+        else if (m_data1 < other.m_data1)
+            return false;
+        else
+            return (m_data2 >= other.m_data2);
+    }
+
+  private:
+    uint64_t m_data1;
+    uint64_t m_data2;
+};
+
+} // namespace llama
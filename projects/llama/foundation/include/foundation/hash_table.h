@@ -0,0 +1,411 @@
+/// @file
+/// 以 `Hash` 为键的开放寻址哈希表。
+
+#pragma once
+#include "foundation/hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LLAMA_HASH_TABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace llama
+{
+
+/// 以 `Hash` 为键的开放寻址哈希表（SwissTable 式）。
+///
+/// 每个槽位有一个控制字节：空、已删除，或者是键的低 7 位（H2）。探测时一次比较 16 个控制字节，
+/// 只有 H2 相同的槽位才需要比较完整的键，所以绝大多数查找只碰一条缓存行的控制字节和一个槽位。
+/// 键本身就是均匀分布的哈希，所以直接用 `Hash::Data1()` 作为探测用的哈希，不再混淆。
+///
+/// 不是线程安全的。插入或删除可能导致重新分配，之前拿到的指针随之失效。
+template <typename T> class HashTable
+{
+  public:
+    HashTable() = default;
+
+    HashTable(HashTable const &) = delete;
+    HashTable &operator=(HashTable const &) = delete;
+
+    HashTable(HashTable &&other) noexcept
+    {
+        Swap(other);
+    }
+
+    HashTable &operator=(HashTable &&other) noexcept
+    {
+        HashTable{std::move(other)}.Swap(*this);
+        return *this;
+    }
+
+    ~HashTable()
+    {
+        Destroy();
+    }
+
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    bool Empty() const
+    {
+        return m_size == 0;
+    }
+
+    /// 控制字节和槽位占用的堆内存字节数
+    size_t MemoryUsage() const
+    {
+        return m_capacity == 0 ? 0 : m_capacity + kGroupWidth + m_capacity * sizeof(Slot);
+    }
+
+    /// 查找键为 `key` 的值。
+    /// @return 找不到时为空
+    T *Find(Hash const &key)
+    {
+        size_t index = FindIndex(key);
+        return index == kNotFound ? nullptr : &m_slots[index].value;
+    }
+
+    T const *Find(Hash const &key) const
+    {
+        return const_cast<HashTable *>(this)->Find(key);
+    }
+
+    bool Contains(Hash const &key) const
+    {
+        return FindIndex(key) != kNotFound;
+    }
+
+    /// 插入 `key` 。如果键已存在，不会覆盖原来的值。
+    /// @return 键对应的值，以及是否新插入了
+    std::pair<T *, bool> Insert(Hash const &key, T value)
+    {
+        size_t index = FindIndex(key);
+        if (index != kNotFound)
+            return {&m_slots[index].value, false};
+
+        if (m_size + m_deleted + 1 > MaxLoad(m_capacity))
+        {
+            // 墓碑多时原地整理即可；否则扩容
+            Rehash(m_size + 1 > MaxLoad(m_capacity) / 2 ? std::max(m_capacity * 2, kGroupWidth) : m_capacity);
+        }
+
+        index = FindInsertIndex(key.Data1());
+        if (m_ctrl[index] == kDeleted)
+            m_deleted--;
+        std::construct_at(&m_slots[index], key, std::move(value));
+        SetCtrl(index, H2(key.Data1()));
+        m_size++;
+        return {&m_slots[index].value, true};
+    }
+
+    /// 删除键为 `key` 的值。
+    /// @return 键是否存在
+    bool Erase(Hash const &key)
+    {
+        size_t index = FindIndex(key);
+        if (index == kNotFound)
+            return false;
+        std::destroy_at(&m_slots[index]);
+        SetCtrl(index, kDeleted);
+        m_size--;
+        m_deleted++;
+        return true;
+    }
+
+    /// 预留空间，使得插入 `count` 个元素之前不会重新分配。
+    void Reserve(size_t count)
+    {
+        size_t capacity = kGroupWidth;
+        while (MaxLoad(capacity) < count)
+        {
+            capacity *= 2;
+        }
+        if (capacity > m_capacity)
+            Rehash(capacity);
+    }
+
+    /// 删除所有满足 `pred(Hash const &, T &)` 的元素。删掉的多时顺便缩小表。
+    /// @return 删除的个数
+    template <typename F> size_t EraseIf(F &&pred)
+    {
+        size_t erased = 0;
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            if (IsFull(m_ctrl[i]) && pred(std::as_const(m_slots[i].key), m_slots[i].value))
+            {
+                std::destroy_at(&m_slots[i]);
+                SetCtrl(i, kDeleted);
+                erased++;
+            }
+        }
+        m_size -= erased;
+        m_deleted += erased;
+        if (erased != 0)
+            ShrinkToFit();
+        return erased;
+    }
+
+    /// 按现有的元素数重新分配，释放多余的空间并清掉删除留下的墓碑。
+    void ShrinkToFit()
+    {
+        if (m_size == 0)
+        {
+            Clear();
+            return;
+        }
+        size_t capacity = kGroupWidth;
+        while (MaxLoad(capacity) < m_size)
+        {
+            capacity *= 2;
+        }
+        if (capacity < m_capacity || m_deleted != 0)
+            Rehash(capacity);
+    }
+
+    void Clear()
+    {
+        HashTable{}.Swap(*this);
+    }
+
+    /// 对每个元素调用 `f(Hash const &, T &)` 。调用期间不能修改表。
+    template <typename F> void ForEach(F &&f)
+    {
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            if (IsFull(m_ctrl[i]))
+                f(std::as_const(m_slots[i].key), m_slots[i].value);
+        }
+    }
+
+    /// 对每个元素调用 `f(Hash const &, T const &)` 。
+    template <typename F> void ForEach(F &&f) const
+    {
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            if (IsFull(m_ctrl[i]))
+                f(m_slots[i].key, m_slots[i].value);
+        }
+    }
+
+    /// 预取 `key` 所在的第一组控制字节和第一个候选槽位，供批量查找时提前发起访存。
+    void Prefetch(Hash const &key) const
+    {
+        if (m_capacity == 0)
+            return;
+        size_t index = H1(key.Data1()) & (m_capacity - 1);
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&m_ctrl[index]);
+        __builtin_prefetch(&m_slots[index]);
+#elif defined(LLAMA_HASH_TABLE_SSE2)
+        _mm_prefetch(reinterpret_cast<const char *>(&m_ctrl[index]), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char *>(&m_slots[index]), _MM_HINT_T0);
+#endif
+    }
+
+  private:
+    struct Slot
+    {
+        Slot(Hash const &key, T &&value) : key{key}, value{std::move(value)}
+        {
+        }
+
+        Hash key;
+        T value;
+    };
+
+    // 控制字节。满的槽位存 H2 ，最高位为 0 ；空和已删除的最高位为 1 。
+    static constexpr int8_t kEmpty = -128;  // 0b10000000
+    static constexpr int8_t kDeleted = -2; // 0b11111110
+
+    static constexpr size_t kGroupWidth = 16;
+    static constexpr size_t kNotFound = SIZE_MAX;
+
+    static bool IsFull(int8_t ctrl)
+    {
+        return ctrl >= 0;
+    }
+
+    static size_t H1(uint64_t hash)
+    {
+        return static_cast<size_t>(hash >> 7);
+    }
+
+    static int8_t H2(uint64_t hash)
+    {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    // 最大装载率 7/8
+    static size_t MaxLoad(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    // 一组 16 个控制字节的匹配结果，每一位对应一个槽位
+    struct Group
+    {
+        explicit Group(const int8_t *ctrl)
+        {
+#ifdef LLAMA_HASH_TABLE_SSE2
+            m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+            std::memcpy(m_ctrl, ctrl, kGroupWidth);
+#endif
+        }
+
+        uint32_t Match(int8_t h2) const
+        {
+#ifdef LLAMA_HASH_TABLE_SSE2
+            return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(m_ctrl, _mm_set1_epi8(h2))));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; i++)
+            {
+                mask |= uint32_t(m_ctrl[i] == h2) << i;
+            }
+            return mask;
+#endif
+        }
+
+        uint32_t MatchEmpty() const
+        {
+            return Match(kEmpty);
+        }
+
+        uint32_t MatchEmptyOrDeleted() const
+        {
+#ifdef LLAMA_HASH_TABLE_SSE2
+            // 空和已删除的最高位都是 1
+            return uint32_t(_mm_movemask_epi8(m_ctrl));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; i++)
+            {
+                mask |= uint32_t(m_ctrl[i] < 0) << i;
+            }
+            return mask;
+#endif
+        }
+
+#ifdef LLAMA_HASH_TABLE_SSE2
+        __m128i m_ctrl;
+#else
+        int8_t m_ctrl[kGroupWidth];
+#endif
+    };
+
+    size_t FindIndex(Hash const &key) const
+    {
+        if (m_capacity == 0)
+            return kNotFound;
+
+        size_t mask = m_capacity - 1;
+        size_t pos = H1(key.Data1()) & mask;
+        int8_t h2 = H2(key.Data1());
+        // 以组为单位做三角数探测，容量为 2 的幂时能走遍所有组
+        for (size_t step = kGroupWidth;; step += kGroupWidth)
+        {
+            Group group{&m_ctrl[pos]};
+            for (uint32_t match = group.Match(h2); match; match &= match - 1)
+            {
+                size_t index = (pos + std::countr_zero(match)) & mask;
+                if (m_slots[index].key == key)
+                    return index;
+            }
+            if (group.MatchEmpty())
+                return kNotFound;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_t FindInsertIndex(uint64_t hash) const
+    {
+        size_t mask = m_capacity - 1;
+        size_t pos = H1(hash) & mask;
+        for (size_t step = kGroupWidth;; step += kGroupWidth)
+        {
+            uint32_t match = Group{&m_ctrl[pos]}.MatchEmptyOrDeleted();
+            if (match)
+                return (pos + std::countr_zero(match)) & mask;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // 表头的 kGroupWidth - 1 个控制字节在表尾另存一份，这样从任意位置都能一次读出整组
+    void SetCtrl(size_t index, int8_t ctrl)
+    {
+        m_ctrl[index] = ctrl;
+        if (index < kGroupWidth - 1)
+            m_ctrl[m_capacity + index] = ctrl;
+    }
+
+    void Rehash(size_t capacity)
+    {
+        HashTable table;
+        table.Allocate(capacity);
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            if (IsFull(m_ctrl[i]))
+            {
+                Slot &slot = m_slots[i];
+                size_t index = table.FindInsertIndex(slot.key.Data1());
+                std::construct_at(&table.m_slots[index], slot.key, std::move(slot.value));
+                table.SetCtrl(index, m_ctrl[i]);
+                table.m_size++;
+            }
+        }
+        Swap(table);
+    }
+
+    void Allocate(size_t capacity)
+    {
+        if (capacity > PTRDIFF_MAX / sizeof(Slot))
+            throw std::bad_alloc{};
+        m_capacity = capacity;
+        m_ctrl = std::make_unique<int8_t[]>(capacity + kGroupWidth);
+        std::memset(m_ctrl.get(), kEmpty, capacity + kGroupWidth);
+        m_slots = std::allocator<Slot>{}.allocate(capacity);
+    }
+
+    void Destroy()
+    {
+        if (!m_slots)
+            return;
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            if (IsFull(m_ctrl[i]))
+                std::destroy_at(&m_slots[i]);
+        }
+        std::allocator<Slot>{}.deallocate(m_slots, m_capacity);
+        m_slots = nullptr;
+    }
+
+    void Swap(HashTable &other) noexcept
+    {
+        std::swap(m_ctrl, other.m_ctrl);
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+        std::swap(m_deleted, other.m_deleted);
+    }
+
+  private:
+    std::unique_ptr<int8_t[]> m_ctrl = {};
+    Slot *m_slots = nullptr;
+    // 槽位数，为 0 或者 2 的幂且不小于 kGroupWidth
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+    size_t m_deleted = 0;
+};
+
+} // namespace llama
@@ -0,0 +1,93 @@
+/// @file
+/// 128 位内容哈希。
+
+#pragma once
+
+#include "config.h"
+#include "foundation/hash.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+
+namespace llama
+{
+
+/// 流式的 128 位非加密哈希，结构和 XXH3-128 相同：8 条 64 位累加器每次吃进 64 字节，
+/// 运行时选择 AVX2 、SSE2 或标量实现。常数和密钥是自己生成的，结果和 XXH3 不通用。
+///
+/// 输入可以任意切分多次 `Update` ，结果和一次性输入相同。
+/// 结果只由输入字节和种子决定，不随平台或指令集变化，可以持久化。
+/// @note 不能抵御刻意构造的碰撞，不要用于安全场景。
+class LLAMA_FND_API Hasher128
+{
+  public:
+    explicit Hasher128(uint64_t seed = 0);
+
+    /// 追加 `length` 字节的输入
+    void Update(const void *data, size_t length);
+
+    /// 到目前为止的输入的哈希。不影响状态，之后还可以继续 `Update` 。
+    Hash Finish() const;
+
+    /// 一次性计算 `data` 的哈希
+    static Hash Of(const void *data, size_t length, uint64_t seed = 0)
+    {
+        Hasher128 hasher{seed};
+        hasher.Update(data, length);
+        return hasher.Finish();
+    }
+
+    /// 每次吃进的字节数
+    static constexpr size_t kStripeSize = 64;
+    /// 密钥的字节数
+    static constexpr size_t kSecretSize = 192;
+
+  private:
+    void ConsumeStripes(const unsigned char *data, size_t stripes);
+
+  private:
+    alignas(32) uint64_t m_acc[8];
+    alignas(32) unsigned char m_secret[kSecretSize];
+    unsigned char m_buffer[kStripeSize];
+    size_t m_buffered = 0;
+    // 当前块里已经吃进的条数。吃满一块后扰乱累加器
+    size_t m_stripe = 0;
+    uint64_t m_total = 0;
+};
+
+/// 把写入的字节直接喂给 `Hasher128` 的输出流。
+/// 用来对 `Object::SerializeAsObject` 的输出求哈希，不需要先序列化到临时缓冲区。
+class LLAMA_FND_API HashingOutputStream : public std::ostream
+{
+  public:
+    explicit HashingOutputStream(uint64_t seed = 0);
+
+    /// 到目前为止写入的字节的哈希
+    Hash Finish();
+
+  private:
+    class Buffer : public std::streambuf
+    {
+      public:
+        explicit Buffer(uint64_t seed);
+
+        Hash Finish();
+
+      protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char_type *data, std::streamsize count) override;
+        int sync() override;
+
+      private:
+        void Drain();
+
+      private:
+        Hasher128 m_hasher;
+        char m_chunk[1024];
+    };
+
+    Buffer m_buf;
+};
+
+} // namespace llama
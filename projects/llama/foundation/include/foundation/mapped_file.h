@@ -0,0 +1,56 @@
+/// @file
+/// 只读的内存映射文件。
+
+#pragma once
+
+#include "config.h"
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace llama
+{
+
+/// 把整个文件只读地映射到内存。映射建立之后对文件的追加写入看不到，需要重新映射。
+/// 空文件没有映射，`Data()` 为空。
+class LLAMA_FND_API MappedFile
+{
+  public:
+    MappedFile() = default;
+
+    /// 映射 `path` 指向的文件。
+    /// @exception 如果文件无法打开或映射，抛出 ExceptionKind::IoError
+    explicit MappedFile(std::filesystem::path const &path);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    const std::byte *Data() const
+    {
+        return m_data;
+    }
+
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    std::span<const std::byte> Bytes() const
+    {
+        return {m_data, m_size};
+    }
+
+  private:
+    void Unmap();
+
+  private:
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace llama
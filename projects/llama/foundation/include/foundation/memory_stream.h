@@ -0,0 +1,80 @@
+/// @file
+/// 直接读取内存缓冲区的输入流。
+
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <span>
+#include <streambuf>
+
+namespace llama
+{
+
+/// 直接读取一段内存的流缓冲区，不拷贝缓冲区。缓冲区必须比它活得久。
+class MemoryStreamBuf : public std::streambuf
+{
+  public:
+    explicit MemoryStreamBuf(std::span<const std::byte> bytes)
+    {
+        // streambuf 的接口要求可写指针，但输入区只会被读取
+        auto begin = const_cast<char *>(reinterpret_cast<const char *>(bytes.data()));
+        setg(begin, begin, begin + bytes.size());
+    }
+
+    /// 已经读过的字节数
+    size_t Consumed() const
+    {
+        return static_cast<size_t>(gptr() - eback());
+    }
+
+    /// 还没有读的字节，可以直接在原地解析
+    std::span<const std::byte> Remaining() const
+    {
+        return {reinterpret_cast<const std::byte *>(gptr()), static_cast<size_t>(egptr() - gptr())};
+    }
+
+    /// 跳过 `count` 个字节，最多跳到末尾
+    void Advance(size_t count)
+    {
+        size_t remaining = static_cast<size_t>(egptr() - gptr());
+        setg(eback(), gptr() + (count < remaining ? count : remaining), egptr());
+    }
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        off_type base = dir == std::ios_base::beg   ? 0
+                        : dir == std::ios_base::cur ? gptr() - eback()
+                                                    : egptr() - eback();
+        off_type pos = base + off;
+        if (pos < 0 || pos > egptr() - eback())
+            return pos_type(off_type(-1));
+        setg(eback(), eback() + pos, egptr());
+        return pos_type(pos);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+/// 直接读取一段内存的输入流，不拷贝缓冲区。缓冲区必须比流活得久。
+/// 用于把映射进来的文件片段交给 `Object::DeserializeAsObject` 。
+class MemoryInputStream : public std::istream
+{
+  public:
+    explicit MemoryInputStream(std::span<const std::byte> bytes) : std::istream{nullptr}, m_buf{bytes}
+    {
+        rdbuf(&m_buf);
+    }
+
+  private:
+    MemoryStreamBuf m_buf;
+};
+
+} // namespace llama
@@ -1,89 +1,173 @@
 #pragma once
+#include "foundation/archive.h"
 #include "foundation/exceptions.h"
+#include "foundation/hash.h"
+#include "foundation/hash_table.h"
+#include "foundation/hasher.h"
+#include "foundation/memory_stream.h"
+#include "foundation/object_arena.h"
 #include "foundation/pointers.h"
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iostream>
-#include <map>
+#include <iterator>
+#include <memory>
 #include <ostream>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace llama
 {
 
-class Hash
+/// 对象。特点是能被对象仓库管理。
+class Object
 {
   public:
-    constexpr Hash(uint64_t data1, uint64_t data2) : m_data1{data1}, m_data2(data2)
+    virtual ~Object() = default;
+
+    /// 对象的哈希。默认是序列化结果的 `Hasher128` 哈希，边序列化边计算，不产生临时缓冲区。
+    /// 序列化结果不能完全代表对象内容，或者有更快的办法时，子类应当重写。
+    virtual Hash HashAsObject() const
     {
+        HashingOutputStream out;
+        SerializeAsObject(out);
+        return out.Finish();
     }
 
-    constexpr bool operator==(Hash const &other) const
+    virtual void SerializeAsObject(std::ostream &) const = 0;
+    virtual void DeserializeAsObject(std::istream &) = 0;
+
+    /// 对这个对象直接引用的每个对象的哈希调用 `visit` 。垃圾回收据此判断哪些对象可达。
+    /// 默认没有引用。引用了别的对象的子类必须重写，否则被引用的对象会被当作垃圾回收。
+    virtual void ForEachReference(std::function<void(Hash const &)> const &) const
     {
-        return m_data1 == other.m_data1 && m_data2 == other.m_data2;
     }
+};
 
-    constexpr bool operator!=(Hash const &other) const
+/// 用二进制归档序列化的对象。子类实现 `WriteAsObject` 和 `ReadAsObject` ，
+/// 对象仓库会直接把缓冲区或映射的内存交给它们，不经过 iostream 。
+///
+/// iostream 版本的接口由适配器实现，只认识 `Object` 的代码照样可以使用。
+/// 输入流是 `MemoryInputStream` 这类直接读内存的流时，`DeserializeAsObject` 也不拷贝数据。
+class ArchiveObject : public Object
+{
+  public:
+    /// 对象的哈希。默认是归档结果的 `Hasher128` 哈希。
+    Hash HashAsObject() const override
     {
-        return m_data1 != other.m_data1 || m_data2 != other.m_data2;
+        ArchiveWriter out;
+        WriteAsObject(out);
+        return Hasher128::Of(out.Data(), out.Size());
     }
 
-    constexpr bool operator<(Hash const &other) const
+    void SerializeAsObject(std::ostream &out) const final
     {
-        if (m_data1 < other.m_data1)
-            return true;
-        else if (m_data1 > other.m_data1)
-            return false;
-        else
-            return (m_data2 < other.m_data2);
+        ArchiveWriter writer;
+        WriteAsObject(writer);
+        out.write(reinterpret_cast<const char *>(writer.Data()), static_cast<std::streamsize>(writer.Size()));
     }
 
-    constexpr bool operator>(Hash const &other) const
+    /// 读取流里剩下的全部字节
+    void DeserializeAsObject(std::istream &in) final
     {
-        if (m_data1 > other.m_data1)
-            return true;
-        else if (m_data1 < other.m_data1)
-            return false;
-        else
-            return (m_data2 > other.m_data2);
+        if (auto memory = dynamic_cast<MemoryStreamBuf *>(in.rdbuf()))
+        {
+            ArchiveReader reader{memory->Remaining()};
+            ReadAsObject(reader);
+            memory->Advance(reader.Position());
+            return;
+        }
+        std::vector<char> bytes{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        ArchiveReader reader{std::as_bytes(std::span{bytes})};
+        ReadAsObject(reader);
     }
 
-    constexpr bool operator<=(Hash const &other) const
+    virtual void WriteAsObject(ArchiveWriter &out) const = 0;
+
+    /// 从 `in` 读出对象。`in` 的缓冲区可能是映射的文件，读到的视图不能在返回之后继续使用。
+    /// @exception 如果数据不完整或者格式错误，抛出 ExceptionKind::InvalidArchive
+    virtual void ReadAsObject(ArchiveReader &in) = 0;
+};
+
+/// 把 `object` 序列化到 `out` 的末尾。`ArchiveObject` 直接写入，其他对象经过输出流适配器。
+inline void WriteObject(Object const &object, ArchiveWriter &out)
+{
+    if (auto archived = dynamic_cast<ArchiveObject const *>(&object))
     {
-        if (m_data1 < other.m_data1)
-            return true;
-        else if (m_data1 > other.m_data1)
-            return false;
-        else
-            return (m_data2 <= other.m_data2);
+        archived->WriteAsObject(out);
+        return;
     }
+    ArchiveOutputStream stream{out};
+    object.SerializeAsObject(stream);
+}
 
-    constexpr bool operator>=(Hash const &other) const
+/// 可达性标记，用于对象仓库的垃圾回收。
+///
+/// 从根出发，沿着 `Object::ForEachReference` 找到所有可达的对象。标记是增量的：每次 `Step` 只处理
+/// 给定数量的对象，两次之间仓库可以照常使用。对象不可变，标记开始时可达的对象在标记期间一直可达，
+/// 所以只需要再 `Shade` 标记期间新加的根和新存放的对象，不需要写屏障。
+class ReachabilityMarker
+{
+  public:
+    /// @param resolve 根据哈希找到对象；找不到时返回空，这个引用被忽略
+    explicit ReachabilityMarker(std::function<sp<Object>(Hash const &)> resolve) : m_resolve{std::move(resolve)}
     {
-        if (m_data1 > other.m_data1)
-            return true;
-        else if (m_data1 < other.m_data1)
-            return false;
-        else
-            return (m_data2 >= other.m_data2);
     }
 
-  private:
-    uint64_t m_data1;
-    uint64_t m_data2;
-};
+    /// 把 `hash` 标记为存活，它引用的对象留到 `Step` 时处理。已经标记过的忽略。
+    void Shade(Hash const &hash)
+    {
+        if (m_marked.Insert(hash, true).second)
+            m_gray.push_back(hash);
+    }
 
-/// 对象。特点是能被对象仓库管理。
-class Object
-{
-  public:
-    virtual ~Object() = default;
-    virtual Hash HashAsObject() const = 0;
-    virtual void SerializeAsObject(std::ostream &) const = 0;
-    virtual void DeserializeAsObject(std::istream &) = 0;
+    /// 处理最多 `budget` 个已经标记、但还没有处理引用的对象。
+    /// @return 是否已经标记完
+    bool Step(size_t budget)
+    {
+        for (; budget != 0 && !m_gray.empty(); budget--)
+        {
+            Hash hash = m_gray.back();
+            m_gray.pop_back();
+            if (sp<Object> object = m_resolve(hash))
+                object->ForEachReference([this](Hash const &reference) { Shade(reference); });
+        }
+        return m_gray.empty();
+    }
+
+    bool Done() const
+    {
+        return m_gray.empty();
+    }
+
+    bool IsMarked(Hash const &hash) const
+    {
+        return m_marked.Contains(hash);
+    }
+
+    /// 已经标记的对象数
+    size_t MarkedCount() const
+    {
+        return m_marked.Size();
+    }
+
+  private:
+    std::function<sp<Object>(Hash const &)> m_resolve;
+    HashTable<bool> m_marked;
+    // 已经标记、还没有处理引用的对象
+    std::vector<Hash> m_gray;
 };
 
 /// 对象仓库。
+/// 对象以哈希为键存放在开放寻址的哈希表里，存取都是 O(1) 。
+/// 从根（`AddRoot`）不可达的对象可以用 `Collect` 回收。
+///
+/// 单元格这类很小的对象可以用 `StoreSmall` 按值存放：同类型的对象连续存放在各自的 `ObjectArena` 里，
+/// 哈希表里只记一个 8 字节的 `ObjectHandle` ，省掉每个对象单独的堆分配、虚函数表和 `shared_ptr` 控制块，
+/// 按类型扫描时也是顺序访问内存。两种对象共用一个哈希空间，`Contains` 、`AddRoot` 、`Collect` 对它们一视同仁。
 class ObjectStore
 {
   public:
@@ -97,39 +181,199 @@ class ObjectStore
     Hash Store(sp<Object> object)
     {
         Hash key = object->HashAsObject();
-        auto lower_bound = m_cache.lower_bound(key);
-        if (lower_bound != m_cache.end())
+        if (m_small.Contains(key) || !m_cache.Insert(key, std::move(object)).second)
+            throw Exception{ExceptionKind::ElementAlreadyExists};
+        return key;
+    }
+
+    /// 按值存放小对象 `object` ，和同类型的对象连续存放在一起。
+    /// @return 对象的句柄，用 `Get` 读取
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    template <SmallObject T> ObjectHandle StoreSmall(T const &object)
+    {
+        Hash key = object.HashAsObject();
+        if (m_cache.Contains(key) || m_small.Contains(key))
+            throw Exception{ExceptionKind::ElementAlreadyExists};
+        ObjectHandle handle{ObjectTypeTagOf<T>(), ArenaOf<T>().Insert(object)};
+        m_small.Insert(key, handle);
+        return handle;
+    }
+
+    /// 哈希值为 `hash` 的小对象的句柄。
+    /// @exception 如果小对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    ObjectHandle FindSmall(Hash const &hash) const
+    {
+        ObjectHandle const *handle = m_small.Find(hash);
+        if (!handle)
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        return *handle;
+    }
+
+    /// 句柄 `handle` 指向的小对象。引用在对象被回收之前一直有效。
+    /// @tparam T 必须是存放时的类型
+    template <SmallObject T> T const &Get(ObjectHandle handle) const
+    {
+        assert(handle.tag == ObjectTypeTagOf<T>() && handle.tag < m_arenas.size() && m_arenas[handle.tag]);
+        return static_cast<ObjectArena<T> const &>(*m_arenas[handle.tag])[handle.index];
+    }
+
+    /// 按存放位置的顺序对每个 `T` 类型的小对象调用 `visit(handle, object)` 。
+    template <SmallObject T, typename F> void ForEachSmall(F &&visit) const
+    {
+        ObjectTypeTag tag = ObjectTypeTagOf<T>();
+        if (tag >= m_arenas.size() || !m_arenas[tag])
+            return;
+        static_cast<ObjectArena<T> const &>(*m_arenas[tag]).ForEach([&](uint32_t index, T const &object) {
+            visit(ObjectHandle{tag, index}, object);
+        });
+    }
+
+    /// 获取哈希值为 `hash` 的对象 `T` 。小对象没有 `sp` ，要用 `FindSmall` 和 `Get` 读取。
+    /// @tparam T 必须为 `Object` 的子类
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> sp<T> Retrieve(Hash const &hash)
+    {
+        static_assert(std::is_base_of_v<Object, T>);
+        sp<Object> *object = m_cache.Find(hash);
+        if (!object)
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        assert(std::dynamic_pointer_cast<T>(*object));
+        return std::static_pointer_cast<T>(*object);
+    }
+
+    /// 批量存放 `objects` 。先算出全部哈希、一次预留好空间，再在软件流水线的循环里插入：
+    /// 插入第 i 个时预取第 i + kPrefetchDistance 个的槽位，缓存未命中的等待互相重叠。
+    /// @return 各对象的哈希，顺序和 `objects` 相同
+    /// @exception 如果有对象已经存在（包括同一批里重复的），将抛出 `ExceptionKind::ElementAlreadyExists` ，
+    /// 这时这一批对象都不会被存放
+    std::vector<Hash> StoreBatch(std::span<const sp<Object>> objects)
+    {
+        std::vector<Hash> keys;
+        keys.reserve(objects.size());
+        for (auto const &object : objects)
         {
-            auto less = m_cache.key_comp();
-            if (!less(key, lower_bound->first))
-            // 即 key >= lower bound
-            // 而根据定义 lower bound <= key
-            // 故 key == lower bound
+            keys.push_back(object->HashAsObject());
+        }
+
+        m_cache.Reserve(m_cache.Size() + keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (i + kPrefetchDistance < keys.size())
+                m_cache.Prefetch(keys[i + kPrefetchDistance]);
+            if (m_small.Contains(keys[i]) || !m_cache.Insert(keys[i], objects[i]).second)
             {
+                for (size_t j = 0; j < i; j++)
+                {
+                    m_cache.Erase(keys[j]);
+                }
                 throw Exception{ExceptionKind::ElementAlreadyExists};
             }
         }
-        else
-        {
-            m_cache.insert(lower_bound, {key, object});
-        }
-        return key;
+        return keys;
     }
 
-    /// 获取哈希值为 `hash` 的对象 `T` 。
+    /// 批量获取对象 `T` ，和 `StoreBatch` 一样边预取边查找。
+    /// @return 各对象，顺序和 `hashes` 相同
     /// @tparam T 必须为 `Object` 的子类
-    /// @exception Exception
-    template <typename T> sp<T> Retrieve(Hash const &hash)
+    /// @exception 如果有对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> std::vector<sp<T>> RetrieveBatch(std::span<const Hash> hashes)
     {
-        auto iter = m_cache.find(hash);
-        if (iter != m_cache.end())
+        static_assert(std::is_base_of_v<Object, T>);
+        std::vector<sp<T>> objects;
+        objects.reserve(hashes.size());
+        for (size_t i = 0; i < hashes.size(); i++)
         {
-            return iter->second;
+            if (i + kPrefetchDistance < hashes.size())
+                m_cache.Prefetch(hashes[i + kPrefetchDistance]);
+            sp<Object> *object = m_cache.Find(hashes[i]);
+            if (!object)
+                throw Exception{ExceptionKind::ElementDoesNotExist};
+            assert(std::dynamic_pointer_cast<T>(*object));
+            objects.push_back(std::static_pointer_cast<T>(*object));
         }
+        return objects;
+    }
+
+    /// 是否存放了哈希值为 `hash` 的对象（包括小对象）
+    bool Contains(Hash const &hash) const
+    {
+        return m_cache.Contains(hash) || m_small.Contains(hash);
+    }
+
+    /// 存放的对象数（包括小对象）
+    size_t Size() const
+    {
+        return m_cache.Size() + m_small.Size();
+    }
+
+    /// 预留空间，使得存放 `count` 个对象之前不会重新分配。
+    void Reserve(size_t count)
+    {
+        m_cache.Reserve(count);
+    }
+
+    /// 把 `hash` 加为垃圾回收的根。根按次数计数，加了几次就要 `RemoveRoot` 几次才会取消。
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    void AddRoot(Hash const &hash)
+    {
+        if (!Contains(hash))
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        ++*m_roots.Insert(hash, 0).first;
+    }
+
+    /// 取消一次 `AddRoot` 。
+    /// @exception 如果 `hash` 不是根，将抛出 `ExceptionKind::ElementDoesNotExist`
+    void RemoveRoot(Hash const &hash)
+    {
+        size_t *count = m_roots.Find(hash);
+        if (!count)
+            throw Exception{ExceptionKind::ElementDoesNotExist};
+        if (--*count == 0)
+            m_roots.Erase(hash);
+    }
+
+    /// 回收从根不可达的对象。仓库不是线程安全的，一次做完标记和清除。
+    /// 调用者仍然持有的对象不受影响，只是不再能从仓库里取到；回收的小对象的句柄随之失效。
+    /// @return 回收的对象数
+    size_t Collect()
+    {
+        ReachabilityMarker marker{[this](Hash const &hash) {
+            sp<Object> *object = m_cache.Find(hash);
+            return object ? *object : nullptr;
+        }};
+        m_roots.ForEach([&](Hash const &hash, size_t &) { marker.Shade(hash); });
+        marker.Step(SIZE_MAX);
+        size_t collected = m_cache.EraseIf([&](Hash const &hash, sp<Object> &) { return !marker.IsMarked(hash); });
+        collected += m_small.EraseIf([&](Hash const &hash, ObjectHandle &handle) {
+            if (marker.IsMarked(hash))
+                return false;
+            m_arenas[handle.tag]->Erase(handle.index);
+            return true;
+        });
+        return collected;
+    }
+
+    /// 批量操作时提前预取的距离（个数）。太小来不及，太大预取的缓存行会在用到之前被挤出去。
+    static constexpr size_t kPrefetchDistance = 8;
+
+  private:
+    template <SmallObject T> ObjectArena<T> &ArenaOf()
+    {
+        ObjectTypeTag tag = ObjectTypeTagOf<T>();
+        if (tag >= m_arenas.size())
+            m_arenas.resize(size_t(tag) + 1);
+        if (!m_arenas[tag])
+            m_arenas[tag] = std::make_unique<ObjectArena<T>>();
+        return static_cast<ObjectArena<T> &>(*m_arenas[tag]);
     }
 
   private:
-    std::map<Hash, sp<Object>> m_cache;
+    HashTable<sp<Object>> m_cache;
+    // 小对象的句柄，以及按类型标记排列的 arena
+    HashTable<ObjectHandle> m_small;
+    std::vector<std::unique_ptr<ObjectArenaBase>> m_arenas;
+    // 垃圾回收的根和各自被加的次数
+    HashTable<size_t> m_roots;
 };
 
 } // namespace llama
\ No newline at end of file
@@ -0,0 +1,178 @@
+/// @file
+/// 按类型连续存放小对象的 arena 。
+
+#pragma once
+#include "config.h"
+#include "foundation/exceptions.h"
+#include "foundation/hash.h"
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace llama
+{
+
+/// 小对象的类型标记。每个类型第一次用到时分配，从 0 开始连续编号，只在当前进程里有效，不能持久化。
+using ObjectTypeTag = uint16_t;
+
+/// 分配一个新的类型标记。
+/// @exception 如果类型标记用完，抛出 `ExceptionKind::InvalidState`
+LLAMA_FND_API ObjectTypeTag NewObjectTypeTag();
+
+/// 类型 `T` 的类型标记
+template <typename T> ObjectTypeTag ObjectTypeTagOf()
+{
+    static ObjectTypeTag const tag = NewObjectTypeTag();
+    return tag;
+}
+
+/// 小对象的最大字节数。更大的对象单独分配的开销已经不明显，应该用 `sp<Object>` 存放。
+inline constexpr size_t kMaxSmallObjectSize = 64;
+
+/// 可以存放在 arena 里的小对象：值类型，没有虚函数表，可以按字节复制；
+/// 和 `Object` 一样用非虚的 `HashAsObject` 给出内容的哈希。
+///
+/// 小对象是垃圾回收里的叶子：它们不能引用其他对象。
+template <typename T>
+concept SmallObject = std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T> &&
+                      !std::is_polymorphic_v<T> && sizeof(T) <= kMaxSmallObjectSize && requires(T const &object) {
+                          {
+                              object.HashAsObject()
+                          } -> std::same_as<Hash>;
+                      };
+
+/// 小对象的句柄：类型标记加上它在同类对象里的序号，一共 8 字节。
+/// 对象被回收之后，它的句柄失效，序号可能分给新的对象。
+struct ObjectHandle
+{
+    ObjectTypeTag tag = 0;
+    uint32_t index = 0;
+
+    bool operator==(ObjectHandle const &) const = default;
+};
+
+/// 所有类型的 arena 的公共接口，供仓库按类型标记统一管理。
+class ObjectArenaBase
+{
+  public:
+    virtual ~ObjectArenaBase() = default;
+
+    /// 释放序号为 `index` 的对象，序号之后会被重复使用
+    virtual void Erase(uint32_t index) = 0;
+
+    /// 存放的对象数
+    virtual size_t Size() const = 0;
+};
+
+/// 连续存放同一类型 `T` 的小对象。
+///
+/// 对象按块存放，每块 `kChunkSize` 个，块一旦分配就不再移动，所以取到的引用在对象被释放之前一直有效。
+/// 每个对象只占 `sizeof(T)` 字节，外加每块一个存活位图；没有单独的堆分配、虚函数表和引用计数。
+/// 释放的位置记在空闲表里，下次存放时优先使用。
+/// @note 不是线程安全的。
+template <SmallObject T> class ObjectArena final : public ObjectArenaBase
+{
+  public:
+    /// 每块的对象数
+    static constexpr uint32_t kChunkSize = 4096;
+
+    /// 存放 `object` 的副本。
+    /// @return 它的序号
+    uint32_t Insert(T const &object)
+    {
+        uint32_t index;
+        if (!m_free.empty())
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            if (m_end % kChunkSize == 0)
+                m_chunks.push_back(std::make_unique<Chunk>());
+            index = m_end++;
+        }
+        Chunk &chunk = *m_chunks[index / kChunkSize];
+        uint32_t slot = index % kChunkSize;
+        ::new (static_cast<void *>(chunk.objects + slot)) T(object);
+        chunk.live[slot / 64] |= uint64_t{1} << (slot % 64);
+        m_size++;
+        return index;
+    }
+
+    /// 序号为 `index` 的对象。`index` 必须是存放着的对象。
+    T const &operator[](uint32_t index) const
+    {
+        assert(IsLive(index));
+        return *std::launder(reinterpret_cast<T const *>(m_chunks[index / kChunkSize]->objects + index % kChunkSize));
+    }
+
+    bool IsLive(uint32_t index) const
+    {
+        if (index >= m_end)
+            return false;
+        Chunk const &chunk = *m_chunks[index / kChunkSize];
+        uint32_t slot = index % kChunkSize;
+        return (chunk.live[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    void Erase(uint32_t index) override
+    {
+        assert(IsLive(index));
+        Chunk &chunk = *m_chunks[index / kChunkSize];
+        uint32_t slot = index % kChunkSize;
+        chunk.live[slot / 64] &= ~(uint64_t{1} << (slot % 64));
+        m_free.push_back(index);
+        m_size--;
+    }
+
+    size_t Size() const override
+    {
+        return m_size;
+    }
+
+    /// 按存放的位置顺序对每个对象调用 `visit(index, object)` 。
+    /// 扫描是顺序的内存访问，每次从位图里取出 64 个位置的存活情况。
+    template <typename F> void ForEach(F &&visit) const
+    {
+        for (size_t c = 0; c < m_chunks.size(); c++)
+        {
+            Chunk const &chunk = *m_chunks[c];
+            for (uint32_t word = 0; word < kChunkSize / 64; word++)
+            {
+                for (uint64_t bits = chunk.live[word]; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t slot = word * 64 + uint32_t(std::countr_zero(bits));
+                    visit(uint32_t(c * kChunkSize + slot),
+                          *std::launder(reinterpret_cast<T const *>(chunk.objects + slot)));
+                }
+            }
+        }
+    }
+
+  private:
+    struct Chunk
+    {
+        struct alignas(T) Storage
+        {
+            std::byte bytes[sizeof(T)];
+        };
+
+        Storage objects[kChunkSize];
+        uint64_t live[kChunkSize / 64] = {};
+    };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    // 用过的序号的上界
+    uint32_t m_end = 0;
+    size_t m_size = 0;
+    std::vector<uint32_t> m_free;
+};
+
+} // namespace llama
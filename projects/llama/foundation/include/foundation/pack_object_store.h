@@ -0,0 +1,268 @@
+/// @file
+/// 持久化到磁盘的对象仓库。
+
+#pragma once
+
+#include "config.h"
+#include "foundation/archive.h"
+#include "foundation/exceptions.h"
+#include "foundation/hash.h"
+#include "foundation/hash_table.h"
+#include "foundation/mapped_file.h"
+#include "foundation/memory_stream.h"
+#include "foundation/object.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace llama
+{
+
+class PackObjectStore;
+
+/// 包文件的一次压缩，由 `PackObjectStore::BeginCompaction` 创建。
+///
+/// 压缩分三步：`BeginCompaction` 记下索引的快照；`Run` 把快照里存活的对象写到新的包文件；
+/// `PackObjectStore::FinishCompaction` 补上期间新存放的对象，然后换上新文件。
+/// 耗时的 `Run` 只读取快照和自己映射的包文件，不访问仓库，可以放在别的线程，同时仓库照常存取。
+class LLAMA_FND_API PackCompaction
+{
+  public:
+    /// 没有完成的压缩会删掉临时文件。必须在使用仓库的线程上析构，并且不能晚于仓库。
+    ~PackCompaction();
+
+    PackCompaction(PackCompaction const &) = delete;
+    PackCompaction &operator=(PackCompaction const &) = delete;
+
+    /// 把快照里存活的对象写到新的包文件。
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void Run();
+
+    /// 去掉的对象数。`Run` 之后有效。
+    size_t RemovedCount() const
+    {
+        return m_removed_count;
+    }
+
+    /// 去掉的对象在包文件里占的字节数。`Run` 之后有效。
+    uint64_t ReclaimedBytes() const
+    {
+        return m_reclaimed_bytes;
+    }
+
+  private:
+    friend class PackObjectStore;
+
+    struct Entry
+    {
+        Hash key;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    PackCompaction() = default;
+
+  private:
+    PackObjectStore *m_store = nullptr;
+    std::function<bool(Hash const &)> m_is_live;
+    std::filesystem::path m_pack_path;
+
+    // 快照：开始时的索引条目，以及自己的一份包文件映射
+    std::vector<Entry> m_snapshot;
+    uint64_t m_snapshot_size = 0;
+    MappedFile m_source;
+
+    // Run 的结果：新包文件里的条目，按哈希排序
+    std::vector<Entry> m_live;
+    uint64_t m_output_size = 0;
+    bool m_ran = false;
+    size_t m_removed_count = 0;
+    uint64_t m_reclaimed_bytes = 0;
+
+    // 压缩期间又被存放的对象。它们已经存在，所以存放失败，但不能因为快照里判断为不可达就被去掉
+    HashTable<bool> m_revived;
+};
+
+/// 持久化到磁盘的对象仓库。对象按内容寻址，重启后不需要重建。
+///
+/// 仓库是一个目录，里面有两个文件：
+/// - `objects.pack` ：只追加的包文件，依次存放每个对象序列化后的字节；
+/// - `objects.idx` ：按哈希排序的索引，记录每个对象在包文件里的位置。
+///
+/// 两个文件都通过内存映射读取。打开仓库时只建立映射，不读取内容，所以耗时和仓库大小无关；
+/// `Retrieve` 时才二分查找索引，并从映射的区域反序列化出对象。
+///
+/// 新存放的对象立即追加到包文件，它们的位置先记在内存里，`Flush` 时才合并进索引。
+/// 如果进程在 `Flush` 之前退出，下次打开时会扫描包文件里索引没有覆盖的部分来恢复这些对象；
+/// 写了一半的记录会被截掉。
+///
+/// 包文件只追加，不再需要的对象用 `Compact` 去掉：先用 `ReachabilityMarker` 之类找出存活的对象，
+/// 再把它们重写到新的包文件里。
+/// @note 不是线程安全的。
+class LLAMA_FND_API PackObjectStore
+{
+  public:
+    /// 打开目录 `directory` 下的仓库。目录或文件不存在时创建空仓库。
+    /// @exception 如果文件无法读写，抛出 ExceptionKind::IoError
+    /// @exception 如果文件不是仓库文件或已经损坏，抛出 ExceptionKind::InvalidFileFormat
+    explicit PackObjectStore(std::filesystem::path directory);
+
+    /// 析构时会 `Flush` ，但忽略其中的错误。需要知道是否成功时应该先手动调用 `Flush` 。
+    ~PackObjectStore();
+
+    PackObjectStore(PackObjectStore const &) = delete;
+    PackObjectStore &operator=(PackObjectStore const &) = delete;
+
+    /// 序列化并存放 `object` 。
+    /// @return 对象的哈希
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    Hash Store(Object const &object);
+
+    Hash Store(sp<Object> const &object)
+    {
+        return Store(*object);
+    }
+
+    /// 存放已经序列化好的对象。`payload` 必须是哈希值为 `key` 的对象序列化后的字节。
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void Store(Hash const &key, std::span<const std::byte> payload);
+
+    /// 从包文件反序列化出哈希值为 `hash` 的对象 `T` 。每次调用都会得到一个新的对象。
+    /// `T` 是 `ArchiveObject` 时直接从映射的区域读取，不构造输入流。
+    /// @tparam T 必须为 `Object` 的子类，并且可以默认构造
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> sp<T> Retrieve(Hash const &hash)
+    {
+        static_assert(std::is_base_of_v<Object, T> && std::is_default_constructible_v<T>);
+        auto object = std::make_shared<T>();
+        if constexpr (std::is_base_of_v<ArchiveObject, T>)
+        {
+            ArchiveReader in{Lookup(hash)};
+            object->ReadAsObject(in);
+        }
+        else
+        {
+            MemoryInputStream in{Lookup(hash)};
+            object->DeserializeAsObject(in);
+        }
+        return object;
+    }
+
+    /// 哈希值为 `hash` 的对象序列化后的字节。它指向映射的区域，在下一次 `Store` 或 `Flush` 之前有效。
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    std::span<const std::byte> Lookup(Hash const &hash);
+
+    /// 是否存放了哈希值为 `hash` 的对象
+    bool Contains(Hash const &hash) const;
+
+    /// 哈希值为 `hash` 的对象序列化后的字节数。不需要读取对象本身。
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    uint64_t SizeOf(Hash const &hash) const;
+
+    /// 存放的对象数
+    size_t Size() const
+    {
+        return m_index_count + m_pending.Size();
+    }
+
+    /// 把包文件写到磁盘，并把新对象合并进索引。
+    ///
+    /// 包文件和新的索引都同步到磁盘之后才用新的索引替换旧的，所以崩溃之后索引不会覆盖包文件里不存在的部分。
+    /// 替换失败时按磁盘上的文件重新打开，仓库仍然可用，没有合并进索引的对象仍然可以从包文件里恢复。
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void Flush();
+
+    /// 把包文件里已经追加的记录同步到磁盘，返回之后即使进程或系统崩溃也不会丢失。
+    /// 不合并索引，开销和新写入的字节数成正比，比 `Flush` 便宜得多；
+    /// 这些记录下次打开仓库时从包文件里恢复。相当于 `FlushPack` 之后 `SyncPack` 。
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void Sync()
+    {
+        FlushPack();
+        SyncPack();
+    }
+
+    /// 把包文件里缓冲的记录交给操作系统，进程崩溃不会再丢失它们。不等待磁盘。
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void FlushPack();
+
+    /// 等待已经交给操作系统的记录写到磁盘。不访问仓库的其他状态，
+    /// 可以在别的线程使用仓库的同时调用，把等待磁盘的时间挪到锁外面。
+    /// @exception 如果同步失败，抛出 ExceptionKind::IoError
+    void SyncPack() const;
+
+    /// 开始压缩包文件，只保留 `is_live` 返回 true 的对象。先 `Flush` ，再记下当前的索引作为快照。
+    /// 之后在任意线程调用 `PackCompaction::Run` ，最后回到使用仓库的线程调用 `FinishCompaction` 。
+    /// 压缩期间仓库照常使用，新存放的对象都会保留。
+    /// @param is_live 在 `Run` 的线程上调用
+    /// @exception 如果已经有压缩在进行，抛出 `ExceptionKind::InvalidState`
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    std::unique_ptr<PackCompaction> BeginCompaction(std::function<bool(Hash const &)> is_live);
+
+    /// 换上压缩后的文件：把压缩期间新追加的对象复制过去，然后替换包文件和索引。
+    /// 之前 `Lookup` 得到的字节随之失效。中途崩溃时，下次打开会从包文件恢复，不会丢失对象；
+    /// 替换文件失败时仓库按磁盘上的文件重新打开，仍然可用，这次压缩作废。
+    /// @exception 如果 `compaction` 不是正在进行的压缩或者还没有 `Run` ，抛出 `ExceptionKind::InvalidState`
+    /// @exception 如果写入失败，抛出 ExceptionKind::IoError
+    void FinishCompaction(PackCompaction &compaction);
+
+    /// 在当前线程一次做完压缩。
+    /// @return 去掉的对象数
+    size_t Compact(std::function<bool(Hash const &)> is_live)
+    {
+        auto compaction = BeginCompaction(std::move(is_live));
+        compaction->Run();
+        FinishCompaction(*compaction);
+        return compaction->RemovedCount();
+    }
+
+  private:
+    friend class PackCompaction;
+
+    // 对象在包文件里的位置
+    struct Location
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    void OpenIndex();
+    void RecoverPack();
+    // 替换文件失败之后，丢掉内存里的状态，按磁盘上现在的包文件和索引重新打开
+    void Reopen();
+    Location Locate(Hash const &hash) const;
+    bool FindInIndex(Hash const &hash, Location &location) const;
+    Hash IndexKey(size_t index) const;
+    Location IndexLocation(size_t index) const;
+    // 存放的对象已经存在时调用
+    void Revive(Hash const &key);
+
+  private:
+    std::filesystem::path m_directory;
+
+    MappedFile m_index;
+    size_t m_index_count = 0;
+
+    MappedFile m_pack;
+    std::ofstream m_pack_out;
+    uint64_t m_pack_size = 0;
+
+    // 还没有合并进索引的对象
+    HashTable<Location> m_pending;
+
+    // 序列化对象用的缓冲区，每次 Store 重复使用
+    ArchiveWriter m_scratch;
+
+    // 正在进行的压缩
+    PackCompaction *m_compaction = nullptr;
+};
+
+} // namespace llama
@@ -3,6 +3,7 @@
 #include "foundation/enums.h"
 #include "foundation/exceptions.h"
 #include "foundation/path.h"
+#include "foundation/text_view.h"
 #include <fstream>
 #include <string>
 #include <string_view>
@@ -25,6 +26,11 @@ class RelativePath
     {
     }
 
+    /// 源字符串本身是 UTF-8 ，或者视图里已经缓存了 UTF-8 时，不需要再转换。
+    RelativePath(TextView const &path, PathOptions opt = PathOptions::None) : RelativePath{path.Utf8(), opt}
+    {
+    }
+
   private:
     std::vector<std::string> m_components;
 };
@@ -1,5 +1,6 @@
 #pragma once
 #include "exceptions.h"
+#include <atomic>
 #include <cstddef>
 #include <memory>
 namespace llama
@@ -310,4 +311,23 @@ template <typename T, typename U> bool operator <(np<T> p1, np<U> p2) { return s
 template<typename T>
 using sp = std::shared_ptr<T>;
 
+/// `owner` 是否是对象唯一的持有者，可以不复制、原地修改。写时复制的代码用它代替 `use_count() == 1` 。
+///
+/// `use_count` 只是宽松的读：别的线程刚刚释放它的 `shared_ptr` 时，这里看到 1 ，却不保证那个线程释放之前
+/// 对这个对象的读发生在这里之后的写之前。`shared_ptr` 释放时的减一带有释放语义，
+/// 所以看到 1 之后加一道获取栅栏，和它同步，之后原地修改就不会和那些读冲突。
+template <typename T> bool IsSoleOwner(std::shared_ptr<T> const &owner)
+{
+    if (owner.use_count() != 1)
+        return false;
+#if defined(__SANITIZE_THREAD__)
+    // ThreadSanitizer 不认单独的栅栏。复制一次：libstdc++ 的加一是获取-释放的读改写，它能看出这次同步
+    std::shared_ptr<T> probe = owner;
+    return probe.use_count() == 2;
+#else
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+#endif
+}
+
 }//namespace llama
@@ -0,0 +1,106 @@
+/// @file
+/// 带编码标签的字符串视图。
+
+#pragma once
+
+#include "config.h"
+#include "foundation/enums.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace llama
+{
+
+/// 带编码标签的字符串视图。
+/// 和 `std::string_view` 一样不拥有源字符串，源字符串必须比它活得久。
+/// 需要其他编码时才转换，转换结果缓存在视图里，之后的访问不再转换。
+///
+/// 相等比较和哈希都以代码点为准，所以不同编码的同一个字符串相等、哈希也相同。
+/// 两边编码相同时直接比较代码单元；编码不同时边解码边比较，都不会分配内存或转码。
+/// 不合法的代码单元按原值参与比较和哈希，不会抛出异常。
+/// @note 缓存没有加锁，不要在多个线程间共享同一个 `TextView` 对象。
+class LLAMA_FND_API TextView
+{
+  public:
+    TextView(std::string_view str) : m_data{str.data()}, m_length{str.size()}, m_encoding{TextEncoding::Utf8}
+    {
+    }
+
+    TextView(std::u16string_view str) : m_data{str.data()}, m_length{str.size()}, m_encoding{TextEncoding::Utf16}
+    {
+    }
+
+    TextView(std::u32string_view str) : m_data{str.data()}, m_length{str.size()}, m_encoding{TextEncoding::Utf32}
+    {
+    }
+
+    TextView(std::wstring_view str) : m_data{str.data()}, m_length{str.size()}, m_encoding{WideEncoding()}
+    {
+    }
+
+    /// 源字符串的编码
+    TextEncoding Encoding() const
+    {
+        return m_encoding;
+    }
+
+    /// 源字符串的代码单元数
+    size_t Length() const
+    {
+        return m_length;
+    }
+
+    bool Empty() const
+    {
+        return m_length == 0;
+    }
+
+    /// 以 UTF-8 访问。源字符串就是 UTF-8 时直接返回，否则第一次访问时转换并缓存。
+    /// @exception 如果转换失败，抛出 ExceptionKind::InvalidByteSequence
+    std::string_view Utf8() const;
+
+    /// 以 UTF-16 访问。源字符串就是 UTF-16 时直接返回，否则第一次访问时转换并缓存。
+    /// @exception 如果转换失败，抛出 ExceptionKind::InvalidByteSequence
+    std::u16string_view Utf16() const;
+
+    /// 代码点序列的哈希。第一次计算后缓存。
+    size_t Hash() const;
+
+    bool operator==(TextView const &other) const;
+
+    bool operator!=(TextView const &other) const
+    {
+        return !(*this == other);
+    }
+
+  private:
+    static constexpr TextEncoding WideEncoding()
+    {
+        return sizeof(wchar_t) == sizeof(char16_t) ? TextEncoding::Utf16 : TextEncoding::Utf32;
+    }
+
+    size_t UnitSize() const;
+
+  private:
+    const void *m_data;
+    size_t m_length;
+    TextEncoding m_encoding;
+
+    mutable std::optional<std::string> m_utf8 = {};
+    mutable std::optional<std::u16string> m_utf16 = {};
+    mutable std::optional<size_t> m_hash = {};
+};
+
+} // namespace llama
+
+template <> struct std::hash<llama::TextView>
+{
+    size_t operator()(llama::TextView const &view) const
+    {
+        return view.Hash();
+    }
+};
@@ -0,0 +1,64 @@
+/// @file
+/// 线程池。用于把可以切分的计算任务分摊到多个核心上。
+
+#pragma once
+
+#include "config.h"
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llama
+{
+
+/// 固定大小的线程池。
+/// 同一时刻只执行一批任务（一次 `ParallelFor` ），多个线程同时调用 `ParallelFor` 时会排队。
+class LLAMA_FND_API ThreadPool
+{
+  public:
+    /// 创建并发度为 `thread_count` 的线程池。调用 `ParallelFor` 的线程也参与计算，
+    /// 所以实际只会创建 `thread_count - 1` 个工作线程。
+    /// @param thread_count 为 0 时取 `std::thread::hardware_concurrency()`
+    explicit ThreadPool(size_t thread_count = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    /// 并发度，包括调用者线程。
+    size_t ThreadCount() const
+    {
+        return m_workers.size() + 1;
+    }
+
+    /// 执行 `task(0)` 到 `task(count - 1)` ，阻塞直到全部完成。
+    /// 在任务内部再次调用 `ParallelFor` 时，内层的任务会在当前线程上串行执行。
+    /// @exception 如果有任务抛出异常，等其余任务结束后重新抛出第一个异常
+    void ParallelFor(size_t count, std::function<void(size_t)> const &task);
+
+  private:
+    struct Batch;
+
+    void WorkerMain();
+    static void Drain(Batch &batch);
+
+  private:
+    std::vector<std::thread> m_workers;
+
+    // 保证同一时刻只有一批任务
+    std::mutex m_run_mtx;
+
+    // 这个mutex管它下面的几个成员
+    std::mutex m_mtx;
+    std::condition_variable m_wake;
+    Batch *m_batch = nullptr;
+    size_t m_generation = 0;
+    bool m_stopping = false;
+};
+
+} // namespace llama
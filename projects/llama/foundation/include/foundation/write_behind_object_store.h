@@ -0,0 +1,137 @@
+/// @file
+/// 后台写盘的对象仓库。
+
+#pragma once
+
+#include "config.h"
+#include "foundation/exceptions.h"
+#include "foundation/hash.h"
+#include "foundation/hash_table.h"
+#include "foundation/object.h"
+#include "foundation/pack_object_store.h"
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace llama
+{
+
+/// 后台写盘的统计数据。
+struct WriteBehindStats
+{
+    // 提交的次数，每次提交只同步一次磁盘
+    uint64_t commits = 0;
+    // 已经提交的对象数
+    uint64_t committed = 0;
+    // 还没有提交的对象数
+    size_t pending = 0;
+};
+
+/// 放在 `PackObjectStore` 前面、在后台写盘的对象仓库。
+///
+/// `Store` 只把对象放进内存就返回，不等待磁盘。一个专门的写盘线程把积攒的对象成批地序列化、
+/// 追加到后备仓库，然后只同步一次磁盘（group commit）：写盘线程忙的时候新来的对象自然越攒越多，
+/// 磁盘越慢每批越大，同步的次数不会随对象数增长。
+///
+/// 还没有提交的对象不超过给定的上限。达到上限时 `Store` 会阻塞，直到写盘线程腾出空间，
+/// 这样写入持续快于磁盘时内存不会无限增长。`Flush` 是屏障：返回时它之前存放的对象都已经落盘。
+///
+/// 序列化和同步磁盘都不持有后备仓库，`Store` 检查重复时只会和追加记录的那一小段互斥。
+///
+/// 写盘失败后不再写入，之后的 `Store` 和 `Flush` 都会重新抛出那个异常；已经存放的对象仍然可以读取。
+/// @note 可以和写盘线程同时使用，但 `Store` 、`Retrieve` 等接口本身不是线程安全的，只能从一个线程调用。
+/// 后备仓库必须比它活得久，并且在它存在期间不能直接使用。
+class LLAMA_FND_API WriteBehindObjectStore
+{
+  public:
+    /// @param backing 后备仓库
+    /// @param max_pending 还没有提交的对象数上限，达到时 `Store` 阻塞
+    /// @param max_batch 每次提交最多写入的对象数
+    explicit WriteBehindObjectStore(PackObjectStore &backing, size_t max_pending = 4096, size_t max_batch = 1024);
+
+    /// 析构时等待全部对象提交，但忽略其中的错误。需要知道是否成功时应该先手动调用 `Flush` 。
+    ~WriteBehindObjectStore();
+
+    WriteBehindObjectStore(WriteBehindObjectStore const &) = delete;
+    WriteBehindObjectStore &operator=(WriteBehindObjectStore const &) = delete;
+
+    /// 存放 `object` 。对象交给写盘线程之后就返回，之后不能再修改。
+    /// @return 对象的哈希
+    /// @exception 如果对象已经存在，将抛出 `ExceptionKind::ElementAlreadyExists`
+    /// @exception 如果之前写盘失败，重新抛出那次的异常
+    Hash Store(sp<Object> object);
+
+    /// 获取哈希值为 `hash` 的对象 `T` 。还没有提交的对象直接返回存放时的对象，否则从后备仓库加载。
+    /// @tparam T 必须为 `Object` 的子类，并且可以默认构造
+    /// @exception 如果对象不存在，将抛出 `ExceptionKind::ElementDoesNotExist`
+    template <typename T> sp<T> Retrieve(Hash const &hash)
+    {
+        static_assert(std::is_base_of_v<Object, T>);
+        if (sp<Object> object = FindPending(hash))
+        {
+            assert(std::dynamic_pointer_cast<T>(object));
+            return std::static_pointer_cast<T>(std::move(object));
+        }
+        std::lock_guard lock{m_backing_mtx};
+        return m_backing.Retrieve<T>(hash);
+    }
+
+    /// 是否存放了哈希值为 `hash` 的对象（不论是否已经提交）
+    bool Contains(Hash const &hash) const;
+
+    /// 等待调用之前存放的对象全部提交并同步到磁盘。
+    /// @exception 如果写盘失败，抛出那次的异常
+    void Flush();
+
+    WriteBehindStats Stats() const;
+
+  private:
+    struct Entry
+    {
+        Hash key;
+        sp<Object> object;
+    };
+
+    void WriterMain();
+    sp<Object> FindPending(Hash const &hash) const;
+    bool BackingContains(Hash const &hash) const;
+
+  private:
+    PackObjectStore &m_backing;
+    // 写盘线程追加记录时持有
+    mutable std::mutex m_backing_mtx;
+
+    size_t m_max_pending;
+    size_t m_max_batch;
+
+    // 这个mutex管它下面的几个成员
+    mutable std::mutex m_mtx;
+    // 通知写盘线程有新对象或者要停止
+    std::condition_variable m_wake;
+    // 通知等待空间的 Store 和等待提交的 Flush
+    std::condition_variable m_committed_cv;
+    // 还没有提交的对象，包括写盘线程正在写的那一批。提交之后才删掉，保证总能在这里或者后备仓库里找到
+    HashTable<sp<Object>> m_pending;
+    // 还没有交给写盘线程的对象，按存放的顺序
+    std::deque<Entry> m_queue;
+    uint64_t m_stored = 0;
+    uint64_t m_committed = 0;
+    uint64_t m_commits = 0;
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+
+    // 只由写盘线程使用：一批对象序列化后的字节，以及每个对象的起点
+    ArchiveWriter m_buffer;
+    std::vector<size_t> m_offsets;
+
+    std::thread m_writer;
+};
+
+} // namespace llama
@@ -1,13 +1,51 @@
+list(APPEND SOURCE_LIST "src/cached_object_store.cpp")
 list(APPEND SOURCE_LIST "src/codex.cpp")
+list(APPEND SOURCE_LIST "src/codex_parallel.cpp")
+list(APPEND SOURCE_LIST "src/codex_simd.cpp")
+list(APPEND SOURCE_LIST "src/codex_simd.h")
+list(APPEND SOURCE_LIST "src/file_sync.cpp")
+list(APPEND SOURCE_LIST "src/hasher.cpp")
+list(APPEND SOURCE_LIST "src/mapped_file.cpp")
+list(APPEND SOURCE_LIST "src/object_arena.cpp")
+list(APPEND SOURCE_LIST "src/pack_object_store.cpp")
 list(APPEND SOURCE_LIST "src/path.cpp")
+list(APPEND SOURCE_LIST "src/text_view.cpp")
+list(APPEND SOURCE_LIST "src/thread_pool.cpp")
+list(APPEND SOURCE_LIST "src/write_behind_object_store.cpp")
+list(APPEND SOURCE_LIST "include/foundation/archive.h")
+list(APPEND SOURCE_LIST "include/foundation/cached_object_store.h")
 list(APPEND SOURCE_LIST "include/foundation/codex.h")
+list(APPEND SOURCE_LIST "include/foundation/codex_literals.h")
+list(APPEND SOURCE_LIST "include/foundation/concurrent_object_store.h")
 list(APPEND SOURCE_LIST "include/foundation/config.h")
+list(APPEND SOURCE_LIST "include/foundation/cpu_features.h")
 list(APPEND SOURCE_LIST "include/foundation/enums.h")
 list(APPEND SOURCE_LIST "include/foundation/enum_bitwise_ops.h")
 list(APPEND SOURCE_LIST "include/foundation/exceptions.h")
+list(APPEND SOURCE_LIST "include/foundation/file_sync.h")
 list(APPEND SOURCE_LIST "include/foundation/foundation.h")
+list(APPEND SOURCE_LIST "include/foundation/hash.h")
+list(APPEND SOURCE_LIST "include/foundation/hash_table.h")
+list(APPEND SOURCE_LIST "include/foundation/hasher.h")
+list(APPEND SOURCE_LIST "include/foundation/mapped_file.h")
+list(APPEND SOURCE_LIST "include/foundation/memory_stream.h")
 list(APPEND SOURCE_LIST "include/foundation/object.h")
+list(APPEND SOURCE_LIST "include/foundation/object_arena.h")
+list(APPEND SOURCE_LIST "include/foundation/pack_object_store.h")
 list(APPEND SOURCE_LIST "include/foundation/path.h")
 list(APPEND SOURCE_LIST "include/foundation/pointers.h")
+list(APPEND SOURCE_LIST "include/foundation/text_view.h")
+list(APPEND SOURCE_LIST "include/foundation/thread_pool.h")
+list(APPEND SOURCE_LIST "include/foundation/write_behind_object_store.h")
+list(APPEND TEST_SOURCE_LIST "test/archive.cpp")
+list(APPEND TEST_SOURCE_LIST "test/cached_object_store.cpp")
 list(APPEND TEST_SOURCE_LIST "test/codex.cpp")
+list(APPEND TEST_SOURCE_LIST "test/concurrent_object_store.cpp")
+list(APPEND TEST_SOURCE_LIST "test/hasher.cpp")
+list(APPEND TEST_SOURCE_LIST "test/object.cpp")
+list(APPEND TEST_SOURCE_LIST "test/object_arena.cpp")
+list(APPEND TEST_SOURCE_LIST "test/pack_object_store.cpp")
 list(APPEND TEST_SOURCE_LIST "test/pointers.cpp")
+list(APPEND TEST_SOURCE_LIST "test/text_view.cpp")
+list(APPEND TEST_SOURCE_LIST "test/thread_pool.cpp")
+list(APPEND TEST_SOURCE_LIST "test/write_behind_object_store.cpp")
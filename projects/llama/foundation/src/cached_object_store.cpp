@@ -0,0 +1,162 @@
+#include "foundation/cached_object_store.h"
+#include <algorithm>
+
+namespace llama
+{
+
+CachedObjectStore::CachedObjectStore(PackObjectStore &backing, size_t capacity)
+    : m_backing{backing}, m_capacity{capacity}
+{
+}
+
+Hash CachedObjectStore::Store(sp<Object> object)
+{
+    Hash key = m_backing.Store(*object);
+    Admit(key, std::move(object), m_backing.SizeOf(key));
+    return key;
+}
+
+void CachedObjectStore::SetCapacity(size_t capacity)
+{
+    m_capacity = capacity;
+    m_target_t1 = std::min(m_target_t1, capacity);
+    Replace(false);
+    while (m_t1.bytes + m_b1.bytes > m_capacity && !m_b1.entries.empty())
+    {
+        Drop(ListKind::B1);
+    }
+    while (m_t1.bytes + m_t2.bytes + m_b1.bytes + m_b2.bytes > 2 * m_capacity && !m_b2.entries.empty())
+    {
+        Drop(ListKind::B2);
+    }
+}
+
+ObjectCacheStats CachedObjectStore::Stats() const
+{
+    ObjectCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.resident_bytes = m_t1.bytes + m_t2.bytes;
+    stats.resident_count = m_t1.entries.size() + m_t2.entries.size();
+    return stats;
+}
+
+void CachedObjectStore::ResetStats()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+sp<Object> const *CachedObjectStore::Hit(Hash const &hash)
+{
+    Position *position = m_entries.Find(hash);
+    if (!position || position->list == ListKind::B1 || position->list == ListKind::B2)
+    {
+        m_misses++;
+        return nullptr;
+    }
+    // 第二次访问起都算作常用
+    MoveTo(*position, ListKind::T2);
+    m_hits++;
+    return &position->iter->object;
+}
+
+void CachedObjectStore::Admit(Hash const &hash, sp<Object> object, uint64_t serialized_size)
+{
+    size_t size = static_cast<size_t>(serialized_size) + kEntryOverhead;
+
+    Position *position = m_entries.Find(hash);
+    if (position)
+    {
+        // 只有逐出后留下的键会走到这里。命中 B1 说明 T1 应该更大，命中 B2 则相反。
+        // 调整的步长和另一侧的大小成正比，和 ARC 原文一致，只是以字节计。
+        bool hit_in_b2 = position->list == ListKind::B2;
+        List &ghost = ListOf(position->list);
+        if (hit_in_b2)
+        {
+            size_t delta = size * std::max<size_t>(1, m_b1.bytes / std::max<size_t>(1, m_b2.bytes));
+            m_target_t1 = m_target_t1 > delta ? m_target_t1 - delta : 0;
+        }
+        else
+        {
+            size_t delta = size * std::max<size_t>(1, m_b2.bytes / std::max<size_t>(1, m_b1.bytes));
+            m_target_t1 = std::min(m_capacity, m_target_t1 + delta);
+        }
+
+        ghost.bytes = ghost.bytes - position->iter->size + size;
+        position->iter->size = size;
+        position->iter->object = std::move(object);
+        MoveTo(*position, ListKind::T2);
+        Replace(hit_in_b2);
+        return;
+    }
+
+    // 全新的键。先给幽灵列表腾地方：T1 + B1 不超过容量，四个列表合计不超过两倍容量
+    while (m_t1.bytes + m_b1.bytes + size > m_capacity && !m_b1.entries.empty())
+    {
+        Drop(ListKind::B1);
+    }
+    while (m_t1.bytes + m_t2.bytes + m_b1.bytes + m_b2.bytes + size > 2 * m_capacity && !m_b2.entries.empty())
+    {
+        Drop(ListKind::B2);
+    }
+
+    m_t1.entries.push_front(Entry{hash, std::move(object), size});
+    m_t1.bytes += size;
+    m_entries.Insert(hash, Position{ListKind::T1, m_t1.entries.begin()});
+    Replace(false);
+}
+
+CachedObjectStore::List &CachedObjectStore::ListOf(ListKind kind)
+{
+    switch (kind)
+    {
+    case ListKind::T1:
+        return m_t1;
+    case ListKind::T2:
+        return m_t2;
+    case ListKind::B1:
+        return m_b1;
+    default:
+        return m_b2;
+    }
+}
+
+void CachedObjectStore::MoveTo(Position &position, ListKind to)
+{
+    List &from_list = ListOf(position.list);
+    List &to_list = ListOf(to);
+    from_list.bytes -= position.iter->size;
+    to_list.bytes += position.iter->size;
+    // splice 不会使迭代器失效
+    to_list.entries.splice(to_list.entries.begin(), from_list.entries, position.iter);
+    position.list = to;
+}
+
+void CachedObjectStore::Drop(ListKind from)
+{
+    List &list = ListOf(from);
+    Entry &entry = list.entries.back();
+    list.bytes -= entry.size;
+    m_entries.Erase(entry.key);
+    list.entries.pop_back();
+}
+
+void CachedObjectStore::Replace(bool hit_in_b2)
+{
+    while (m_t1.bytes + m_t2.bytes > m_capacity)
+    {
+        bool from_t1 = !m_t1.entries.empty() &&
+                       (m_t2.entries.empty() || m_t1.bytes > m_target_t1 || (hit_in_b2 && m_t1.bytes == m_target_t1));
+        List &list = from_t1 ? m_t1 : m_t2;
+        Position *position = m_entries.Find(list.entries.back().key);
+        position->iter->object = nullptr;
+        MoveTo(*position, from_t1 ? ListKind::B1 : ListKind::B2);
+        // MoveTo 放到了头部：逐出的键在幽灵列表里是最近的
+        m_evictions++;
+    }
+}
+
+} // namespace llama
@@ -0,0 +1,81 @@
+#include "foundation/codex.h"
+#include "foundation/thread_pool.h"
+#include <algorithm>
+
+namespace llama
+{
+
+// 每块至少这么多个代码单元。块太小时调度开销会盖过转换本身。
+static constexpr size_t kMinChunkLength = 256 * 1024;
+// 每个线程分几块。多切几块可以缓和各块字符分布不均导致的负载不均。
+static constexpr size_t kChunksPerThread = 4;
+
+// 把切分点 `pos` 向后挪到 UTF-8 代码点的开头，即跳过续字节 10xxxxxx 。
+// 合法的代码点最多有 3 个续字节。
+static size_t AlignToCodePoint(std::string_view str, size_t pos)
+{
+    for (int step = 0; step < 3 && pos < str.size() && (uint8_t(str[pos]) & 0xC0) == 0x80; step++)
+    {
+        pos++;
+    }
+    return pos;
+}
+
+// 不在代理对的中间切开。
+static size_t AlignToCodePoint(std::u16string_view str, size_t pos)
+{
+    if (pos > 0 && pos < str.size() && str[pos - 1] >= 0xD800 && str[pos - 1] <= 0xDBFF && str[pos] >= 0xDC00 &&
+        str[pos] <= 0xDFFF)
+    {
+        pos++;
+    }
+    return pos;
+}
+
+// 在代码点边界切块，各块分别用 `convert` 转换，再按输出长度的前缀和拼接起来。
+template <typename Output, typename Input, typename Convert>
+static Output ParallelConvert(Input str, ThreadPool &pool, Convert convert)
+{
+    size_t chunk_count = std::min(pool.ThreadCount() * kChunksPerThread, str.size() / kMinChunkLength);
+    if (chunk_count <= 1)
+        return convert(str);
+
+    std::vector<size_t> bounds(chunk_count + 1);
+    bounds[0] = 0;
+    bounds[chunk_count] = str.size();
+    for (size_t i = 1; i < chunk_count; i++)
+    {
+        bounds[i] = std::max(bounds[i - 1], AlignToCodePoint(str, str.size() / chunk_count * i));
+    }
+
+    std::vector<Output> parts(chunk_count);
+    pool.ParallelFor(chunk_count, [&](size_t i) { parts[i] = convert(str.substr(bounds[i], bounds[i + 1] - bounds[i])); });
+
+    // 前缀和，得到每一块在结果中的位置
+    std::vector<size_t> offsets(chunk_count + 1);
+    offsets[0] = 0;
+    for (size_t i = 0; i < chunk_count; i++)
+    {
+        offsets[i + 1] = offsets[i] + parts[i].size();
+    }
+
+    Output result;
+    result.resize(offsets[chunk_count]);
+    pool.ParallelFor(chunk_count, [&](size_t i) {
+        std::copy(parts[i].begin(), parts[i].end(), result.begin() + offsets[i]);
+        Output{}.swap(parts[i]);
+    });
+    return result;
+}
+
+LLAMA_FND_API std::u16string ToUtf16(std::string_view str, ThreadPool &pool)
+{
+    return ParallelConvert<std::u16string>(str, pool, [](std::string_view chunk) { return ToUtf16(chunk); });
+}
+
+LLAMA_FND_API std::string ToUtf8(std::u16string_view str, ThreadPool &pool)
+{
+    return ParallelConvert<std::string>(str, pool, [](std::u16string_view chunk) { return ToUtf8(chunk); });
+}
+
+} // namespace llama
@@ -0,0 +1,321 @@
+#include "codex_simd.h"
+#include "foundation/cpu_features.h"
+#include "foundation/codex.h"
+#include <bit>
+
+namespace llama::simd
+{
+
+// 逐字符的编码见 codex.h 里的 EncodeUtf16Char 等函数。向量化的块处理不了时，退回到它们。
+
+#ifdef LLAMA_SIMD_X86
+
+/*  _____________________________  */
+/*             SSE2                */
+/*  _____________________________  */
+// x86-64 一定支持 SSE2 ，所以它是 x86 上的基线。
+
+// 每个 32 位通道是否（无符号）大于 `threshold` ，返回满足条件的通道数
+static inline size_t CountGreater(__m128i v, uint32_t threshold)
+{
+    const __m128i bias = _mm_set1_epi32(int32_t(0x80000000u));
+    __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(v, bias), _mm_set1_epi32(int32_t(threshold ^ 0x80000000u)));
+    return std::popcount(unsigned(_mm_movemask_ps(_mm_castsi128_ps(gt))));
+}
+
+static size_t Utf16LengthSse2(const uint32_t *data, size_t length)
+{
+    size_t result = length;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        result += CountGreater(_mm_loadu_si128((const __m128i *)(data + i)), 0xFFFF);
+    }
+    for (; i < length; i++)
+    {
+        result += EncodedUtf16Length(data[i]) - 1;
+    }
+    return result;
+}
+
+static char16_t *EncodeUtf16Sse2(const uint32_t *data, size_t length, char16_t *out)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + i + 4));
+        // 整块都在 BMP 内：直接收窄成 16 位
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(_mm_or_si128(a, b), 16), _mm_setzero_si128())) == 0xFFFF)
+        {
+            // SSE2 只有有符号饱和的 packs 。先平移到 int16 的范围，收窄后再平移回来
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+            packed = _mm_add_epi16(packed, _mm_set1_epi16(int16_t(0x8000)));
+            _mm_storeu_si128((__m128i *)out, packed);
+            out += 8;
+        }
+        else
+        {
+            for (size_t j = i; j < i + 8; j++)
+            {
+                out = EncodeUtf16Char(data[j], out);
+            }
+        }
+    }
+    for (; i < length; i++)
+    {
+        out = EncodeUtf16Char(data[i], out);
+    }
+    return out;
+}
+
+static size_t Utf8LengthSse2(const uint32_t *data, size_t length)
+{
+    size_t result = length;
+    size_t overflow = 0;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        result += CountGreater(v, 0x7F) + CountGreater(v, 0x7FF) + CountGreater(v, 0xFFFF);
+        overflow += CountGreater(v, 0x10FFFF);
+    }
+    // 超出范围的代码点被上面算成了 4 字节，实际上不输出
+    result -= overflow * 4;
+    for (; i < length; i++)
+    {
+        result += EncodedUtf8Length(data[i]) - 1;
+    }
+    return result;
+}
+
+static char *EncodeUtf8Sse2(const uint32_t *data, size_t length, char *out)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i *)(data + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i + 12));
+        __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        // 整块都是 ASCII ：直接收窄成 8 位
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(all, 7), _mm_setzero_si128())) == 0xFFFF)
+        {
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128((__m128i *)out, packed);
+            out += 16;
+        }
+        else
+        {
+            for (size_t j = i; j < i + 16; j++)
+            {
+                out = EncodeUtf8Char(data[j], out);
+            }
+        }
+    }
+    for (; i < length; i++)
+    {
+        out = EncodeUtf8Char(data[i], out);
+    }
+    return out;
+}
+
+/*  _____________________________  */
+/*             AVX2                */
+/*  _____________________________  */
+
+LLAMA_TARGET_AVX2 static inline size_t CountGreaterAvx2(__m256i v, uint32_t threshold)
+{
+    const __m256i bias = _mm256_set1_epi32(int32_t(0x80000000u));
+    __m256i gt = _mm256_cmpgt_epi32(_mm256_xor_si256(v, bias), _mm256_set1_epi32(int32_t(threshold ^ 0x80000000u)));
+    return std::popcount(unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(gt))));
+}
+
+LLAMA_TARGET_AVX2 static size_t Utf16LengthAvx2(const uint32_t *data, size_t length)
+{
+    size_t result = length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        result += CountGreaterAvx2(_mm256_loadu_si256((const __m256i *)(data + i)), 0xFFFF);
+    }
+    for (; i < length; i++)
+    {
+        result += EncodedUtf16Length(data[i]) - 1;
+    }
+    return result;
+}
+
+LLAMA_TARGET_AVX2 static char16_t *EncodeUtf16Avx2(const uint32_t *data, size_t length, char16_t *out)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(data + i + 8));
+        if (_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi32(int32_t(0xFFFF0000u))))
+        {
+            // packus 按 128 位通道交错，需要再把 64 位块排回原来的顺序
+            __m256i packed = _mm256_packus_epi32(a, b);
+            packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i *)out, packed);
+            out += 16;
+        }
+        else
+        {
+            for (size_t j = i; j < i + 16; j++)
+            {
+                out = EncodeUtf16Char(data[j], out);
+            }
+        }
+    }
+    return EncodeUtf16Sse2(data + i, length - i, out);
+}
+
+LLAMA_TARGET_AVX2 static size_t Utf8LengthAvx2(const uint32_t *data, size_t length)
+{
+    size_t result = length;
+    size_t overflow = 0;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        result += CountGreaterAvx2(v, 0x7F) + CountGreaterAvx2(v, 0x7FF) + CountGreaterAvx2(v, 0xFFFF);
+        overflow += CountGreaterAvx2(v, 0x10FFFF);
+    }
+    result -= overflow * 4;
+    for (; i < length; i++)
+    {
+        result += EncodedUtf8Length(data[i]) - 1;
+    }
+    return result;
+}
+
+LLAMA_TARGET_AVX2 static char *EncodeUtf8Avx2(const uint32_t *data, size_t length, char *out)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(data + i + 8));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(data + i + 16));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(data + i + 24));
+        __m256i all = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (_mm256_testz_si256(all, _mm256_set1_epi32(int32_t(0xFFFFFF80u))))
+        {
+            // 两次 pack 之后，每个 32 位块依次来自 a0 b0 c0 d0 a1 b1 c1 d1 （下标为 128 位通道）
+            __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+            packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            _mm256_storeu_si256((__m256i *)out, packed);
+            out += 32;
+        }
+        else
+        {
+            for (size_t j = i; j < i + 32; j++)
+            {
+                out = EncodeUtf8Char(data[j], out);
+            }
+        }
+    }
+    return EncodeUtf8Sse2(data + i, length - i, out);
+}
+
+#else
+
+/*  _____________________________  */
+/*          其他平台               */
+/*  _____________________________  */
+
+static size_t Utf16LengthPortable(const uint32_t *data, size_t length)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        result += EncodedUtf16Length(data[i]);
+    }
+    return result;
+}
+
+static char16_t *EncodeUtf16Portable(const uint32_t *data, size_t length, char16_t *out)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        out = EncodeUtf16Char(data[i], out);
+    }
+    return out;
+}
+
+static size_t Utf8LengthPortable(const uint32_t *data, size_t length)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        result += EncodedUtf8Length(data[i]);
+    }
+    return result;
+}
+
+static char *EncodeUtf8Portable(const uint32_t *data, size_t length, char *out)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        out = EncodeUtf8Char(data[i], out);
+    }
+    return out;
+}
+
+#endif
+
+/*  _____________________________  */
+/*             分 派               */
+/*  _____________________________  */
+
+struct Kernels
+{
+    size_t (*utf16_length)(const uint32_t *, size_t);
+    char16_t *(*encode_utf16)(const uint32_t *, size_t, char16_t *);
+    size_t (*utf8_length)(const uint32_t *, size_t);
+    char *(*encode_utf8)(const uint32_t *, size_t, char *);
+};
+
+static Kernels SelectKernels()
+{
+#ifdef LLAMA_SIMD_X86
+    if (HasAvx2())
+        return {Utf16LengthAvx2, EncodeUtf16Avx2, Utf8LengthAvx2, EncodeUtf8Avx2};
+    return {Utf16LengthSse2, EncodeUtf16Sse2, Utf8LengthSse2, EncodeUtf8Sse2};
+#else
+    return {Utf16LengthPortable, EncodeUtf16Portable, Utf8LengthPortable, EncodeUtf8Portable};
+#endif
+}
+
+// 第一次调用时检测 CPU ，之后不变
+static Kernels const &ActiveKernels()
+{
+    static const Kernels kernels = SelectKernels();
+    return kernels;
+}
+
+size_t Utf16Length(const uint32_t *data, size_t length)
+{
+    return ActiveKernels().utf16_length(data, length);
+}
+
+char16_t *EncodeUtf16(const uint32_t *data, size_t length, char16_t *out)
+{
+    return ActiveKernels().encode_utf16(data, length, out);
+}
+
+size_t Utf8Length(const uint32_t *data, size_t length)
+{
+    return ActiveKernels().utf8_length(data, length);
+}
+
+char *EncodeUtf8(const uint32_t *data, size_t length, char *out)
+{
+    return ActiveKernels().encode_utf8(data, length, out);
+}
+
+} // namespace llama::simd
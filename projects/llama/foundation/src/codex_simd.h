@@ -0,0 +1,23 @@
+// 编码器的向量化内核。运行时根据 CPU 支持的指令集选择实现，输出与逐字符的标量实现逐字节相同。
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace llama::simd
+{
+
+/// 代码点编码为 UTF-16 后的长度（代码单元数）
+size_t Utf16Length(const uint32_t *data, size_t length);
+
+/// 将代码点编码为 UTF-16 写到 `out` 。`out` 至少要有 `Utf16Length(data, length)` 个单元。
+/// @return 写入的末尾
+char16_t *EncodeUtf16(const uint32_t *data, size_t length, char16_t *out);
+
+/// 代码点编码为 UTF-8 后的长度（字节数）。大于 0x10FFFF 的代码点不输出任何字节。
+size_t Utf8Length(const uint32_t *data, size_t length);
+
+/// 将代码点编码为 UTF-8 写到 `out` 。`out` 至少要有 `Utf8Length(data, length)` 个字节。
+/// @return 写入的末尾
+char *EncodeUtf8(const uint32_t *data, size_t length, char *out);
+
+} // namespace llama::simd
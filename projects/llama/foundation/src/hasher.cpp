@@ -0,0 +1,408 @@
+#include "foundation/hasher.h"
+#include "foundation/cpu_features.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace llama
+{
+
+namespace
+{
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint64_t kPrime32_2 = 0x85EBCA77u;
+constexpr uint64_t kPrime32_3 = 0xC2B2AE3Du;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ull;
+
+constexpr size_t kStripeSize = Hasher128::kStripeSize;
+constexpr size_t kSecretSize = Hasher128::kSecretSize;
+// 每个块的条数：相邻两条的密钥错开 8 字节，最后 64 字节留给扰乱
+constexpr size_t kStripesPerBlock = (kSecretSize - kStripeSize) / 8;
+// 末尾不足一条的输入补零后使用的密钥，和块内各条的密钥错开
+constexpr size_t kLastStripeSecretOffset = kSecretSize - kStripeSize - 7;
+
+// 默认密钥由 splitmix64 生成，只要种子不变就不会变
+constexpr std::array<unsigned char, kSecretSize> MakeDefaultSecret()
+{
+    std::array<unsigned char, kSecretSize> secret{};
+    uint64_t state = 0x6C6C616D61ull;
+    for (size_t i = 0; i < kSecretSize; i += 8)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        for (size_t j = 0; j < 8; j++)
+        {
+            secret[i + j] = static_cast<unsigned char>(z >> (j * 8));
+        }
+    }
+    return secret;
+}
+
+constexpr std::array<unsigned char, kSecretSize> kDefaultSecret = MakeDefaultSecret();
+
+// 按小端序读取，保证结果不随平台变化
+inline uint64_t Read64(const unsigned char *data)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+inline void Write64(unsigned char *data, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        data[i] = static_cast<unsigned char>(value >> (i * 8));
+    }
+}
+
+// 64 × 64 → 128 位乘法，高低两半异或
+inline uint64_t Mul128Fold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high;
+    uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t low = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return low ^ high;
+#endif
+}
+
+inline uint64_t Avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+/*  _____________________________  */
+/*             标 量               */
+/*  _____________________________  */
+// 每条 64 字节分成 8 个 64 位的字。和密钥异或后高低 32 位相乘累加到本通道，原值累加到相邻通道。
+// 向量化的实现必须和它逐位相同。x86 上总有 SSE2 ，标量实现只在其他平台上使用。
+
+[[maybe_unused]] void AccumulateScalar(uint64_t *acc, const unsigned char *data, const unsigned char *secret, size_t stripes)
+{
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const unsigned char *in = data + s * kStripeSize;
+        const unsigned char *key = secret + s * 8;
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t value = Read64(in + i * 8);
+            uint64_t keyed = value ^ Read64(key + i * 8);
+            acc[i ^ 1] += value;
+            acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    }
+}
+
+[[maybe_unused]] void ScrambleScalar(uint64_t *acc, const unsigned char *secret)
+{
+    for (size_t i = 0; i < 8; i++)
+    {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= Read64(secret + i * 8);
+        a *= kPrime32_1;
+        acc[i] = a;
+    }
+}
+
+#ifdef LLAMA_SIMD_X86
+
+/*  _____________________________  */
+/*             SSE2                */
+/*  _____________________________  */
+
+void AccumulateSse2(uint64_t *acc, const unsigned char *data, const unsigned char *secret, size_t stripes)
+{
+    __m128i a[4];
+    for (size_t i = 0; i < 4; i++)
+    {
+        a[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(acc) + i);
+    }
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const unsigned char *in = data + s * kStripeSize;
+        const unsigned char *key = secret + s * 8;
+        for (size_t i = 0; i < 4; i++)
+        {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in) + i);
+            __m128i keyed = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + i));
+            // 每个 64 位通道的低 32 位乘以高 32 位
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            // 原值加到相邻通道：交换两个 64 位通道
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < 4; i++)
+    {
+        _mm_store_si128(reinterpret_cast<__m128i *>(acc) + i, a[i]);
+    }
+}
+
+void ScrambleSse2(uint64_t *acc, const unsigned char *secret)
+{
+    const __m128i prime = _mm_set1_epi32(int32_t(kPrime32_1));
+    for (size_t i = 0; i < 4; i++)
+    {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(acc) + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i *>(secret) + i));
+        // 64 位乘 32 位：低半和高半分别乘，高半的积左移 32 位再加
+        __m128i low = _mm_mul_epu32(a, prime);
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_store_si128(reinterpret_cast<__m128i *>(acc) + i, _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+    }
+}
+
+/*  _____________________________  */
+/*             AVX2                */
+/*  _____________________________  */
+
+LLAMA_TARGET_AVX2 void AccumulateAvx2(uint64_t *acc, const unsigned char *data, const unsigned char *secret,
+                                      size_t stripes)
+{
+    __m256i a0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc));
+    __m256i a1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc) + 1);
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const __m256i *in = reinterpret_cast<const __m256i *>(data + s * kStripeSize);
+        const __m256i *key = reinterpret_cast<const __m256i *>(secret + s * 8);
+        __m256i v0 = _mm256_loadu_si256(in);
+        __m256i v1 = _mm256_loadu_si256(in + 1);
+        __m256i k0 = _mm256_xor_si256(v0, _mm256_loadu_si256(key));
+        __m256i k1 = _mm256_xor_si256(v1, _mm256_loadu_si256(key + 1));
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_shuffle_epi32(k0, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_shuffle_epi32(k1, _MM_SHUFFLE(0, 3, 0, 1)));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(v0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(v1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i *>(acc), a0);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(acc) + 1, a1);
+}
+
+LLAMA_TARGET_AVX2 void ScrambleAvx2(uint64_t *acc, const unsigned char *secret)
+{
+    const __m256i prime = _mm256_set1_epi32(int32_t(kPrime32_1));
+    for (size_t i = 0; i < 2; i++)
+    {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc) + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret) + i));
+        __m256i low = _mm256_mul_epu32(a, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(acc) + i, _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+    }
+}
+
+#define LLAMA_HASHER_SIMD
+
+#endif
+
+/*  _____________________________  */
+/*             分 派               */
+/*  _____________________________  */
+
+struct Kernels
+{
+    void (*accumulate)(uint64_t *, const unsigned char *, const unsigned char *, size_t);
+    void (*scramble)(uint64_t *, const unsigned char *);
+};
+
+Kernels SelectKernels()
+{
+#ifdef LLAMA_HASHER_SIMD
+    if (simd::HasAvx2())
+        return {AccumulateAvx2, ScrambleAvx2};
+    return {AccumulateSse2, ScrambleSse2};
+#else
+    return {AccumulateScalar, ScrambleScalar};
+#endif
+}
+
+// 第一次调用时检测 CPU ，之后不变
+Kernels const &ActiveKernels()
+{
+    static const Kernels kernels = SelectKernels();
+    return kernels;
+}
+
+} // namespace
+
+/*  _____________________________  */
+/*           Hasher128             */
+/*  _____________________________  */
+
+Hasher128::Hasher128(uint64_t seed)
+    : m_acc{kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3, kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1}
+{
+    if (seed == 0)
+    {
+        std::memcpy(m_secret, kDefaultSecret.data(), kSecretSize);
+        return;
+    }
+    // 种子混进密钥：偶数字加、奇数字减
+    for (size_t i = 0; i < kSecretSize; i += 16)
+    {
+        Write64(m_secret + i, Read64(kDefaultSecret.data() + i) + seed);
+        Write64(m_secret + i + 8, Read64(kDefaultSecret.data() + i + 8) - seed);
+    }
+}
+
+void Hasher128::ConsumeStripes(const unsigned char *data, size_t stripes)
+{
+    Kernels const &kernels = ActiveKernels();
+    while (stripes > 0)
+    {
+        size_t count = std::min(stripes, kStripesPerBlock - m_stripe);
+        kernels.accumulate(m_acc, data, m_secret + m_stripe * 8, count);
+        data += count * kStripeSize;
+        stripes -= count;
+        m_stripe += count;
+        if (m_stripe == kStripesPerBlock)
+        {
+            kernels.scramble(m_acc, m_secret + kSecretSize - kStripeSize);
+            m_stripe = 0;
+        }
+    }
+}
+
+void Hasher128::Update(const void *data, size_t length)
+{
+    auto in = static_cast<const unsigned char *>(data);
+    m_total += length;
+
+    if (m_buffered > 0)
+    {
+        size_t take = std::min(length, kStripeSize - m_buffered);
+        std::memcpy(m_buffer + m_buffered, in, take);
+        m_buffered += take;
+        in += take;
+        length -= take;
+        if (m_buffered < kStripeSize)
+            return;
+        ConsumeStripes(m_buffer, 1);
+        m_buffered = 0;
+    }
+
+    size_t stripes = length / kStripeSize;
+    ConsumeStripes(in, stripes);
+    in += stripes * kStripeSize;
+    length -= stripes * kStripeSize;
+
+    std::memcpy(m_buffer, in, length);
+    m_buffered = length;
+}
+
+Hash Hasher128::Finish() const
+{
+    alignas(32) uint64_t acc[8];
+    std::memcpy(acc, m_acc, sizeof(acc));
+
+    if (m_buffered > 0)
+    {
+        // 末尾不足一条的部分补零。长度会混进最终结果，所以补零不会造成碰撞
+        unsigned char last[kStripeSize] = {};
+        std::memcpy(last, m_buffer, m_buffered);
+        ActiveKernels().accumulate(acc, last, m_secret + kLastStripeSecretOffset, 1);
+    }
+
+    uint64_t low = m_total * kPrime64_1;
+    uint64_t high = ~(m_total * kPrime64_2);
+    for (size_t i = 0; i < 4; i++)
+    {
+        const unsigned char *low_key = m_secret + 11 + i * 16;
+        const unsigned char *high_key = m_secret + kSecretSize - kStripeSize - 11 + i * 16;
+        low += Mul128Fold64(acc[2 * i] ^ Read64(low_key), acc[2 * i + 1] ^ Read64(low_key + 8));
+        high += Mul128Fold64(acc[2 * i] ^ Read64(high_key), acc[2 * i + 1] ^ Read64(high_key + 8));
+    }
+    return Hash{Avalanche(low), Avalanche(high)};
+}
+
+/*  _____________________________  */
+/*      HashingOutputStream        */
+/*  _____________________________  */
+
+HashingOutputStream::Buffer::Buffer(uint64_t seed) : m_hasher{seed}
+{
+    setp(m_chunk, m_chunk + sizeof(m_chunk));
+}
+
+void HashingOutputStream::Buffer::Drain()
+{
+    m_hasher.Update(pbase(), static_cast<size_t>(pptr() - pbase()));
+    setp(m_chunk, m_chunk + sizeof(m_chunk));
+}
+
+Hash HashingOutputStream::Buffer::Finish()
+{
+    Drain();
+    return m_hasher.Finish();
+}
+
+HashingOutputStream::Buffer::int_type HashingOutputStream::Buffer::overflow(int_type ch)
+{
+    Drain();
+    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize HashingOutputStream::Buffer::xsputn(const char_type *data, std::streamsize count)
+{
+    // 大块写入不经过缓冲区
+    if (count >= static_cast<std::streamsize>(sizeof(m_chunk)))
+    {
+        Drain();
+        m_hasher.Update(data, static_cast<size_t>(count));
+        return count;
+    }
+    return std::streambuf::xsputn(data, count);
+}
+
+int HashingOutputStream::Buffer::sync()
+{
+    Drain();
+    return 0;
+}
+
+HashingOutputStream::HashingOutputStream(uint64_t seed) : std::ostream{nullptr}, m_buf{seed}
+{
+    rdbuf(&m_buf);
+}
+
+Hash HashingOutputStream::Finish()
+{
+    return m_buf.Finish();
+}
+
+} // namespace llama
@@ -0,0 +1,123 @@
+#include "foundation/mapped_file.h"
+#include "foundation/exceptions.h"
+#include <utility>
+
+#ifdef LLAMA_WIN
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace llama
+{
+
+#ifdef LLAMA_WIN
+
+MappedFile::MappedFile(std::filesystem::path const &path)
+{
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw Exception{ExceptionKind::IoError, "cannot open file"};
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw Exception{ExceptionKind::IoError, "cannot stat file"};
+    }
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // 映射对象和视图都会引用文件，句柄可以马上关掉
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        throw Exception{ExceptionKind::IoError, "cannot map file"};
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        throw Exception{ExceptionKind::IoError, "cannot map file"};
+
+    m_data = static_cast<const std::byte *>(data);
+    m_size = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::Unmap()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(std::filesystem::path const &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw Exception{ExceptionKind::IoError, "cannot open file"};
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw Exception{ExceptionKind::IoError, "cannot stat file"};
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return;
+    }
+
+    // 映射会引用文件，描述符可以马上关掉
+    void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw Exception{ExceptionKind::IoError, "cannot map file"};
+
+    m_data = static_cast<const std::byte *>(data);
+    m_size = static_cast<size_t>(st.st_size);
+}
+
+void MappedFile::Unmap()
+{
+    if (m_data)
+        munmap(const_cast<std::byte *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    Unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data{std::exchange(other.m_data, nullptr)}, m_size{std::exchange(other.m_size, 0)}
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        Unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+} // namespace llama
@@ -0,0 +1,17 @@
+#include "foundation/object_arena.h"
+#include <atomic>
+#include <limits>
+
+namespace llama
+{
+
+ObjectTypeTag NewObjectTypeTag()
+{
+    static std::atomic<uint32_t> next = 0;
+    uint32_t tag = next.fetch_add(1, std::memory_order_relaxed);
+    if (tag > std::numeric_limits<ObjectTypeTag>::max())
+        throw Exception{ExceptionKind::InvalidState, "too many small object types"};
+    return ObjectTypeTag(tag);
+}
+
+} // namespace llama
@@ -0,0 +1,575 @@
+#include "foundation/pack_object_store.h"
+#include "foundation/file_sync.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llama
+{
+
+namespace
+{
+
+// 包文件：文件头，然后依次是每条记录。记录头之后紧跟对象序列化后的字节。
+constexpr char kPackMagic[8] = {'L', 'L', 'P', 'A', 'C', 'K', '0', '1'};
+// data1, data2, size
+constexpr size_t kRecordHeaderSize = 24;
+
+// 索引：文件头（魔数、条目数、覆盖到的包文件长度），然后是按哈希排序的条目。
+constexpr char kIndexMagic[8] = {'L', 'L', 'I', 'D', 'X', '0', '0', '1'};
+constexpr size_t kIndexHeaderSize = 24;
+// data1, data2, offset, size
+constexpr size_t kIndexEntrySize = 32;
+
+const char *kPackFileName = "objects.pack";
+const char *kIndexFileName = "objects.idx";
+
+// 文件里的整数都是小端序
+uint64_t Load64(const std::byte *data)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | std::to_integer<uint64_t>(data[i]);
+    }
+    return value;
+}
+
+void Store64(char *data, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        data[i] = static_cast<char>(value >> (i * 8));
+    }
+}
+
+void WriteRecord(std::ostream &out, Hash const &key, const void *payload, uint64_t size)
+{
+    char header[kRecordHeaderSize];
+    Store64(header, key.Data1());
+    Store64(header + 8, key.Data2());
+    Store64(header + 16, size);
+    out.write(header, sizeof(header));
+    out.write(static_cast<const char *>(payload), static_cast<std::streamsize>(size));
+}
+
+// 依次写出索引文件：文件头，然后是调用者按哈希排好序的条目
+class IndexFileWriter
+{
+  public:
+    IndexFileWriter(std::filesystem::path const &path, size_t count, uint64_t pack_size)
+        : m_out{path, std::ios::binary | std::ios::trunc}
+    {
+        char header[kIndexHeaderSize];
+        std::memcpy(header, kIndexMagic, sizeof(kIndexMagic));
+        Store64(header + 8, count);
+        Store64(header + 16, pack_size);
+        m_out.write(header, sizeof(header));
+    }
+
+    void Add(Hash const &key, uint64_t offset, uint64_t size)
+    {
+        char entry[kIndexEntrySize];
+        Store64(entry, key.Data1());
+        Store64(entry + 8, key.Data2());
+        Store64(entry + 16, offset);
+        Store64(entry + 24, size);
+        m_out.write(entry, sizeof(entry));
+    }
+
+    void Finish()
+    {
+        m_out.flush();
+        if (!m_out)
+            throw Exception{ExceptionKind::IoError, "cannot write index file"};
+    }
+
+  private:
+    std::ofstream m_out;
+};
+
+} // namespace
+
+PackObjectStore::PackObjectStore(std::filesystem::path directory) : m_directory{std::move(directory)}
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+        throw Exception{ExceptionKind::IoError, "cannot create store directory"};
+
+    auto pack_path = m_directory / kPackFileName;
+    if (!std::filesystem::exists(pack_path) || std::filesystem::file_size(pack_path) == 0)
+    {
+        std::ofstream out{pack_path, std::ios::binary | std::ios::trunc};
+        out.write(kPackMagic, sizeof(kPackMagic));
+        if (!out)
+            throw Exception{ExceptionKind::IoError, "cannot create pack file"};
+    }
+
+    m_pack = MappedFile{pack_path};
+    if (m_pack.Size() < sizeof(kPackMagic) || std::memcmp(m_pack.Data(), kPackMagic, sizeof(kPackMagic)) != 0)
+        throw Exception{ExceptionKind::InvalidFileFormat, "not a pack file"};
+
+    OpenIndex();
+    RecoverPack();
+
+    m_pack_out.open(pack_path, std::ios::binary | std::ios::app);
+    if (!m_pack_out)
+        throw Exception{ExceptionKind::IoError, "cannot open pack file"};
+}
+
+PackObjectStore::~PackObjectStore()
+{
+    if (m_compaction)
+    {
+        m_compaction->m_store = nullptr;
+        std::error_code ec;
+        std::filesystem::remove(m_compaction->m_pack_path, ec);
+    }
+    try
+    {
+        Flush();
+    }
+    catch (...)
+    {
+    }
+}
+
+void PackObjectStore::OpenIndex()
+{
+    auto index_path = m_directory / kIndexFileName;
+    if (!std::filesystem::exists(index_path))
+    {
+        m_index_count = 0;
+        m_pack_size = sizeof(kPackMagic);
+        return;
+    }
+
+    m_index = MappedFile{index_path};
+    const std::byte *data = m_index.Data();
+    if (m_index.Size() < kIndexHeaderSize || std::memcmp(data, kIndexMagic, sizeof(kIndexMagic)) != 0)
+        throw Exception{ExceptionKind::InvalidFileFormat, "not an index file"};
+
+    m_index_count = static_cast<size_t>(Load64(data + 8));
+    m_pack_size = Load64(data + 16);
+    if (m_index.Size() != kIndexHeaderSize + m_index_count * kIndexEntrySize || m_pack_size < sizeof(kPackMagic) ||
+        m_pack_size > m_pack.Size())
+        throw Exception{ExceptionKind::InvalidFileFormat, "index does not match pack file"};
+}
+
+void PackObjectStore::RecoverPack()
+{
+    // 索引只覆盖到 m_pack_size ，之后的记录是上次 Flush 之后写的
+    const std::byte *data = m_pack.Data();
+    uint64_t end = m_pack.Size();
+    uint64_t offset = m_pack_size;
+    while (offset + kRecordHeaderSize <= end)
+    {
+        Hash key{Load64(data + offset), Load64(data + offset + 8)};
+        uint64_t size = Load64(data + offset + 16);
+        if (size > end - offset - kRecordHeaderSize)
+            break;
+        m_pending.Insert(key, Location{offset + kRecordHeaderSize, size});
+        offset += kRecordHeaderSize + size;
+    }
+
+    if (offset < end)
+    {
+        // 写了一半的记录，丢掉
+        m_pack = {};
+        std::error_code ec;
+        std::filesystem::resize_file(m_directory / kPackFileName, offset, ec);
+        if (ec)
+            throw Exception{ExceptionKind::IoError, "cannot truncate pack file"};
+        m_pack = MappedFile{m_directory / kPackFileName};
+    }
+    m_pack_size = offset;
+}
+
+Hash PackObjectStore::Store(Object const &object)
+{
+    Hash key = object.HashAsObject();
+    if (Contains(key))
+    {
+        Revive(key);
+        throw Exception{ExceptionKind::ElementAlreadyExists};
+    }
+
+    m_scratch.Clear();
+    WriteObject(object, m_scratch);
+    Store(key, m_scratch.Bytes());
+    return key;
+}
+
+void PackObjectStore::Store(Hash const &key, std::span<const std::byte> payload)
+{
+    if (Contains(key))
+    {
+        Revive(key);
+        throw Exception{ExceptionKind::ElementAlreadyExists};
+    }
+
+    WriteRecord(m_pack_out, key, payload.data(), payload.size());
+    if (!m_pack_out)
+        throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+
+    m_pending.Insert(key, Location{m_pack_size + kRecordHeaderSize, payload.size()});
+    m_pack_size += kRecordHeaderSize + payload.size();
+}
+
+std::span<const std::byte> PackObjectStore::Lookup(Hash const &hash)
+{
+    Location location = Locate(hash);
+    if (location.offset + location.size > m_pack.Size())
+    {
+        // 映射之后追加的对象，重新映射才能看到
+        m_pack_out.flush();
+        if (!m_pack_out)
+            throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+        m_pack = MappedFile{m_directory / kPackFileName};
+        if (location.offset + location.size > m_pack.Size())
+            throw Exception{ExceptionKind::InvalidFileFormat, "index points past the end of pack file"};
+    }
+    return m_pack.Bytes().subspan(static_cast<size_t>(location.offset), static_cast<size_t>(location.size));
+}
+
+uint64_t PackObjectStore::SizeOf(Hash const &hash) const
+{
+    return Locate(hash).size;
+}
+
+bool PackObjectStore::Contains(Hash const &hash) const
+{
+    Location location;
+    return FindInIndex(hash, location) || m_pending.Contains(hash);
+}
+
+void PackObjectStore::FlushPack()
+{
+    m_pack_out.flush();
+    if (!m_pack_out)
+        throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+}
+
+void PackObjectStore::SyncPack() const
+{
+    if (!SyncFile(m_directory / kPackFileName))
+        throw Exception{ExceptionKind::IoError, "cannot sync pack file"};
+}
+
+void PackObjectStore::Flush()
+{
+    m_pack_out.flush();
+    if (!m_pack_out)
+        throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+    if (m_pending.Empty())
+        return;
+
+    std::vector<std::pair<Hash, Location>> added;
+    added.reserve(m_pending.Size());
+    m_pending.ForEach([&](Hash const &key, Location &location) { added.emplace_back(key, location); });
+    std::sort(added.begin(), added.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+
+    // 新旧条目归并成新的索引，写到临时文件里再替换，中途失败不会破坏原来的索引
+    auto index_path = m_directory / kIndexFileName;
+    auto temp_path = m_directory / (std::string{kIndexFileName} + ".tmp");
+    size_t count = m_index_count + added.size();
+    {
+        IndexFileWriter out{temp_path, count, m_pack_size};
+        auto write_entry = [&](Hash const &key, Location const &location) {
+            out.Add(key, location.offset, location.size);
+        };
+
+        size_t old_index = 0;
+        for (auto const &[key, location] : added)
+        {
+            for (; old_index < m_index_count && IndexKey(old_index) < key; old_index++)
+            {
+                write_entry(IndexKey(old_index), IndexLocation(old_index));
+            }
+            write_entry(key, location);
+        }
+        for (; old_index < m_index_count; old_index++)
+        {
+            write_entry(IndexKey(old_index), IndexLocation(old_index));
+        }
+        out.Finish();
+    }
+
+    // 新索引覆盖到 m_pack_size ，所以包文件和索引都要先到磁盘，再让新索引生效
+    SyncPack();
+    if (!SyncFile(temp_path))
+        throw Exception{ExceptionKind::IoError, "cannot sync index file"};
+
+    // Windows 上不能替换仍然映射着的文件
+    m_index = {};
+    std::error_code ec;
+    std::filesystem::rename(temp_path, index_path, ec);
+    if (ec)
+    {
+        // 旧的索引还在原处，新对象的记录也都在包文件里
+        Reopen();
+        throw Exception{ExceptionKind::IoError, "cannot replace index file"};
+    }
+    m_index = MappedFile{index_path};
+    m_index_count = count;
+    m_pending.Clear();
+    if (!SyncDirectory(m_directory))
+        throw Exception{ExceptionKind::IoError, "cannot sync store directory"};
+}
+
+void PackObjectStore::Reopen()
+{
+    // 先清空，即使下面又失败了，也不会留下指向已经解除映射的文件的条目
+    m_index = {};
+    m_index_count = 0;
+    m_pending.Clear();
+    m_pack_out.close();
+    m_pack_out.clear();
+
+    auto pack_path = m_directory / kPackFileName;
+    m_pack = MappedFile{pack_path};
+    OpenIndex();
+    RecoverPack();
+    m_pack_out.open(pack_path, std::ios::binary | std::ios::app);
+    if (!m_pack_out)
+        throw Exception{ExceptionKind::IoError, "cannot open pack file"};
+}
+
+std::unique_ptr<PackCompaction> PackObjectStore::BeginCompaction(std::function<bool(Hash const &)> is_live)
+{
+    if (m_compaction)
+        throw Exception{ExceptionKind::InvalidState, "compaction already in progress"};
+    Flush();
+
+    std::unique_ptr<PackCompaction> compaction{new PackCompaction};
+    compaction->m_store = this;
+    compaction->m_is_live = std::move(is_live);
+    compaction->m_pack_path = m_directory / (std::string{kPackFileName} + ".compact");
+    compaction->m_snapshot.reserve(m_index_count);
+    for (size_t i = 0; i < m_index_count; i++)
+    {
+        Location location = IndexLocation(i);
+        compaction->m_snapshot.push_back({IndexKey(i), location.offset, location.size});
+    }
+    compaction->m_snapshot_size = m_pack_size;
+    // 单独映射一份，Run 读取它时不会和仓库重新映射互相影响
+    compaction->m_source = MappedFile{m_directory / kPackFileName};
+    m_compaction = compaction.get();
+    return compaction;
+}
+
+void PackObjectStore::FinishCompaction(PackCompaction &compaction)
+{
+    using Entry = PackCompaction::Entry;
+    if (&compaction != m_compaction || !compaction.m_ran)
+        throw Exception{ExceptionKind::InvalidState, "compaction is not ready to finish"};
+
+    FlushPack();
+    if (m_pack.Size() < m_pack_size)
+        m_pack = MappedFile{m_directory / kPackFileName};
+
+    // 快照之后追加的对象，以及快照里判断为不可达、压缩期间又被存放的对象，跟在新包文件后面
+    auto key_less = [](Entry const &a, Entry const &b) { return a.key < b.key; };
+    std::vector<Entry> tail;
+    for (size_t i = 0; i < m_index_count; i++)
+    {
+        Location location = IndexLocation(i);
+        if (location.offset >= compaction.m_snapshot_size)
+            tail.push_back({IndexKey(i), location.offset, location.size});
+    }
+    m_pending.ForEach([&](Hash const &key, Location &location) { tail.push_back({key, location.offset, location.size}); });
+    compaction.m_revived.ForEach([&](Hash const &key, bool &) {
+        Location location = Locate(key);
+        if (location.offset < compaction.m_snapshot_size &&
+            !std::binary_search(compaction.m_live.begin(), compaction.m_live.end(), Entry{key, 0, 0}, key_less))
+            tail.push_back({key, location.offset, location.size});
+    });
+    std::sort(tail.begin(), tail.end(), [](Entry const &a, Entry const &b) { return a.offset < b.offset; });
+
+    auto pack_path = m_directory / kPackFileName;
+    auto index_path = m_directory / kIndexFileName;
+    auto temp_index_path = m_directory / (std::string{kIndexFileName} + ".compact");
+    uint64_t pack_size = compaction.m_output_size;
+    {
+        std::ofstream out{compaction.m_pack_path, std::ios::binary | std::ios::app};
+        for (auto &entry : tail)
+        {
+            WriteRecord(out, entry.key, m_pack.Data() + entry.offset, entry.size);
+            entry.offset = pack_size + kRecordHeaderSize;
+            pack_size += kRecordHeaderSize + entry.size;
+        }
+        out.flush();
+        if (!out)
+            throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+    }
+
+    std::vector<Entry> entries = std::move(compaction.m_live);
+    entries.insert(entries.end(), tail.begin(), tail.end());
+    std::sort(entries.begin(), entries.end(), key_less);
+    {
+        IndexFileWriter out{temp_index_path, entries.size(), pack_size};
+        for (auto const &entry : entries)
+        {
+            out.Add(entry.key, entry.offset, entry.size);
+        }
+        out.Finish();
+    }
+    if (!SyncFile(compaction.m_pack_path) || !SyncFile(temp_index_path))
+        throw Exception{ExceptionKind::IoError, "cannot sync compacted files"};
+
+    // 先删掉旧索引再换包文件：之后任何时候崩溃，包文件要么是旧的要么是新的，
+    // 没有索引时打开仓库会扫描整个包文件，不会丢失对象。Windows 上不能替换仍然映射着的文件。
+    compaction.m_source = {};
+    m_index = {};
+    m_pack = {};
+    m_pack_out.close();
+    std::error_code ec;
+    std::filesystem::remove(index_path, ec);
+    if (!ec)
+        std::filesystem::rename(compaction.m_pack_path, pack_path, ec);
+    if (!ec)
+        std::filesystem::rename(temp_index_path, index_path, ec);
+    if (ec)
+    {
+        // 停在哪一步，磁盘上的包文件都是完整的旧文件或者新文件，索引缺失时重新打开会扫描包文件。
+        // 这次压缩作废，不能再完成
+        m_compaction = nullptr;
+        compaction.m_store = nullptr;
+        std::filesystem::remove(compaction.m_pack_path, ec);
+        std::filesystem::remove(temp_index_path, ec);
+        Reopen();
+        throw Exception{ExceptionKind::IoError, "cannot replace pack file"};
+    }
+
+    m_compaction = nullptr;
+    compaction.m_store = nullptr;
+    // 新文件已经就位，接下来的失败和 Flush 一样由 Reopen 收拾
+    try
+    {
+        m_pack = MappedFile{pack_path};
+        m_index = MappedFile{index_path};
+        m_index_count = entries.size();
+        m_pack_size = pack_size;
+        m_pending.Clear();
+        m_pack_out.clear();
+        m_pack_out.open(pack_path, std::ios::binary | std::ios::app);
+        if (!m_pack_out)
+            throw Exception{ExceptionKind::IoError, "cannot open pack file"};
+    }
+    catch (...)
+    {
+        Reopen();
+        throw;
+    }
+    if (!SyncDirectory(m_directory))
+        throw Exception{ExceptionKind::IoError, "cannot sync store directory"};
+}
+
+void PackObjectStore::Revive(Hash const &key)
+{
+    if (m_compaction)
+        m_compaction->m_revived.Insert(key, true);
+}
+
+PackCompaction::~PackCompaction()
+{
+    if (m_store)
+    {
+        m_store->m_compaction = nullptr;
+        std::error_code ec;
+        std::filesystem::remove(m_pack_path, ec);
+    }
+}
+
+void PackCompaction::Run()
+{
+    std::vector<Entry> live;
+    live.reserve(m_snapshot.size());
+    for (auto const &entry : m_snapshot)
+    {
+        if (m_is_live(entry.key))
+        {
+            live.push_back(entry);
+        }
+        else
+        {
+            m_removed_count++;
+            m_reclaimed_bytes += kRecordHeaderSize + entry.size;
+        }
+    }
+    std::vector<Entry>{}.swap(m_snapshot);
+
+    // 按原来的顺序写，一起存放的对象仍然挨在一起
+    std::sort(live.begin(), live.end(), [](Entry const &a, Entry const &b) { return a.offset < b.offset; });
+    uint64_t offset = sizeof(kPackMagic);
+    {
+        std::ofstream out{m_pack_path, std::ios::binary | std::ios::trunc};
+        out.write(kPackMagic, sizeof(kPackMagic));
+        for (auto &entry : live)
+        {
+            WriteRecord(out, entry.key, m_source.Data() + entry.offset, entry.size);
+            entry.offset = offset + kRecordHeaderSize;
+            offset += kRecordHeaderSize + entry.size;
+        }
+        out.flush();
+        if (!out)
+            throw Exception{ExceptionKind::IoError, "cannot write pack file"};
+    }
+
+    std::sort(live.begin(), live.end(), [](Entry const &a, Entry const &b) { return a.key < b.key; });
+    m_live = std::move(live);
+    m_output_size = offset;
+    m_ran = true;
+}
+
+PackObjectStore::Location PackObjectStore::Locate(Hash const &hash) const
+{
+    Location location;
+    if (FindInIndex(hash, location))
+        return location;
+    Location const *pending = m_pending.Find(hash);
+    if (!pending)
+        throw Exception{ExceptionKind::ElementDoesNotExist};
+    return *pending;
+}
+
+bool PackObjectStore::FindInIndex(Hash const &hash, Location &location) const
+{
+    size_t lo = 0, hi = m_index_count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        Hash key = IndexKey(mid);
+        if (key < hash)
+        {
+            lo = mid + 1;
+        }
+        else if (hash < key)
+        {
+            hi = mid;
+        }
+        else
+        {
+            location = IndexLocation(mid);
+            return true;
+        }
+    }
+    return false;
+}
+
+Hash PackObjectStore::IndexKey(size_t index) const
+{
+    const std::byte *entry = m_index.Data() + kIndexHeaderSize + index * kIndexEntrySize;
+    return Hash{Load64(entry), Load64(entry + 8)};
+}
+
+PackObjectStore::Location PackObjectStore::IndexLocation(size_t index) const
+{
+    const std::byte *entry = m_index.Data() + kIndexHeaderSize + index * kIndexEntrySize;
+    return Location{Load64(entry + 16), Load64(entry + 24)};
+}
+
+} // namespace llama
@@ -0,0 +1,164 @@
+#include "foundation/text_view.h"
+#include "foundation/codex.h"
+#include <cstring>
+
+namespace llama
+{
+
+namespace
+{
+
+// 逐个读出代码点，不分配内存。
+// 不合法的代码单元不抛异常，而是原样读出。UTF-8 里落单的字节会加上 0x80000000 ，以免和真正的代码点混淆。
+class CodePointCursor
+{
+  public:
+    CodePointCursor(const void *data, size_t length, TextEncoding encoding)
+        : m_data{data}, m_length{length}, m_encoding{encoding}
+    {
+    }
+
+    bool Next(uint32_t &code_point)
+    {
+        if (m_index >= m_length)
+            return false;
+
+        switch (m_encoding)
+        {
+        case TextEncoding::Utf8:
+            code_point = NextUtf8();
+            break;
+        case TextEncoding::Utf16:
+            code_point = NextUtf16();
+            break;
+        default:
+            code_point = static_cast<const uint32_t *>(m_data)[m_index++];
+            break;
+        }
+        return true;
+    }
+
+  private:
+    // 解码用 codex.h 里的实现，只是不合法时不抛异常，跳过一个代码单元
+    uint32_t NextUtf8()
+    {
+        auto data = static_cast<const char *>(m_data);
+        uint32_t code_point = 0;
+        if (TryDecodeUtf8Char(data, m_length, m_index, code_point))
+            return code_point;
+        return 0x80000000u | static_cast<uint8_t>(data[m_index++]);
+    }
+
+    uint32_t NextUtf16()
+    {
+        auto data = static_cast<const char16_t *>(m_data);
+        uint32_t code_point = 0;
+        if (TryDecodeUtf16Char(data, m_length, m_index, code_point))
+            return code_point;
+        return data[m_index++];
+    }
+
+  private:
+    const void *m_data;
+    size_t m_length;
+    TextEncoding m_encoding;
+    size_t m_index = 0;
+};
+
+} // namespace
+
+size_t TextView::UnitSize() const
+{
+    switch (m_encoding)
+    {
+    case TextEncoding::Utf8:
+        return sizeof(char);
+    case TextEncoding::Utf16:
+        return sizeof(char16_t);
+    default:
+        return sizeof(uint32_t);
+    }
+}
+
+std::string_view TextView::Utf8() const
+{
+    switch (m_encoding)
+    {
+    case TextEncoding::Utf8:
+        return {static_cast<const char *>(m_data), m_length};
+    case TextEncoding::Utf16:
+        if (!m_utf8)
+            m_utf8 = ToUtf8(std::u16string_view{static_cast<const char16_t *>(m_data), m_length});
+        return *m_utf8;
+    default:
+        if (!m_utf8)
+            m_utf8 = EncodeUtf8(static_cast<const uint32_t *>(m_data), m_length);
+        return *m_utf8;
+    }
+}
+
+std::u16string_view TextView::Utf16() const
+{
+    switch (m_encoding)
+    {
+    case TextEncoding::Utf16:
+        return {static_cast<const char16_t *>(m_data), m_length};
+    case TextEncoding::Utf8:
+        if (!m_utf16)
+            m_utf16 = ToUtf16(std::string_view{static_cast<const char *>(m_data), m_length});
+        return *m_utf16;
+    default:
+        if (!m_utf16)
+            m_utf16 = EncodeUtf16(static_cast<const uint32_t *>(m_data), m_length);
+        return *m_utf16;
+    }
+}
+
+size_t TextView::Hash() const
+{
+    if (!m_hash)
+    {
+        // 以代码点为单位的 FNV-1a ，最后再做一次雪崩
+        uint64_t hash = 0xCBF29CE484222325ull;
+        CodePointCursor cursor{m_data, m_length, m_encoding};
+        uint32_t code_point;
+        while (cursor.Next(code_point))
+        {
+            hash = (hash ^ code_point) * 0x100000001B3ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        m_hash = static_cast<size_t>(hash);
+    }
+    return *m_hash;
+}
+
+bool TextView::operator==(TextView const &other) const
+{
+    if (m_encoding == other.m_encoding)
+    {
+        return m_length == other.m_length &&
+               (m_length == 0 || std::memcmp(m_data, other.m_data, m_length * UnitSize()) == 0);
+    }
+
+    if (m_hash && other.m_hash && *m_hash != *other.m_hash)
+        return false;
+
+    CodePointCursor left{m_data, m_length, m_encoding};
+    CodePointCursor right{other.m_data, other.m_length, other.m_encoding};
+    uint32_t left_code_point, right_code_point;
+    while (true)
+    {
+        bool left_has = left.Next(left_code_point);
+        bool right_has = right.Next(right_code_point);
+        if (left_has != right_has)
+            return false;
+        if (!left_has)
+            return true;
+        if (left_code_point != right_code_point)
+            return false;
+    }
+}
+
+} // namespace llama
@@ -0,0 +1,142 @@
+#include "foundation/thread_pool.h"
+#include <atomic>
+
+namespace llama
+{
+
+// 当前线程是否正在执行某个线程池里的任务。用来把嵌套的 ParallelFor 降级为串行执行，避免死锁。
+static thread_local bool t_inside_pool = false;
+
+struct ThreadPool::Batch
+{
+    std::function<void(size_t)> const *task;
+    size_t count;
+    std::atomic<size_t> next{0};
+
+    // 由 ThreadPool::m_mtx 保护
+    size_t active = 0;
+
+    std::mutex exception_mtx;
+    std::exception_ptr exception = {};
+};
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    if (thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0)
+        thread_count = 1;
+
+    m_workers.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; i++)
+    {
+        m_workers.emplace_back([this] { WorkerMain(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mtx};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> const &task)
+{
+    if (count == 0)
+        return;
+
+    if (m_workers.empty() || count == 1 || t_inside_pool)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock{m_run_mtx};
+
+    Batch batch;
+    batch.task = &task;
+    batch.count = count;
+    {
+        std::lock_guard<std::mutex> lock{m_mtx};
+        m_batch = &batch;
+        m_generation++;
+        batch.active++; // 调用者自己
+    }
+    m_wake.notify_all();
+
+    t_inside_pool = true;
+    Drain(batch);
+    t_inside_pool = false;
+
+    {
+        std::unique_lock<std::mutex> lock{m_mtx};
+        batch.active--;
+        // 迟到的工作线程看到 m_batch 为空就不会再碰 batch 了
+        m_batch = nullptr;
+        m_wake.wait(lock, [&] { return batch.active == 0; });
+    }
+
+    if (batch.exception)
+        std::rethrow_exception(batch.exception);
+}
+
+void ThreadPool::WorkerMain()
+{
+    t_inside_pool = true;
+    size_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock{m_mtx};
+    while (true)
+    {
+        m_wake.wait(lock, [&] { return m_stopping || (m_batch && m_generation != seen_generation); });
+        if (m_stopping)
+            return;
+
+        seen_generation = m_generation;
+        Batch &batch = *m_batch;
+        batch.active++;
+
+        lock.unlock();
+        Drain(batch);
+        lock.lock();
+
+        if (--batch.active == 0)
+        {
+            // 唤醒在 ParallelFor 里等待的调用者
+            m_wake.notify_all();
+        }
+    }
+}
+
+void ThreadPool::Drain(Batch &batch)
+{
+    while (true)
+    {
+        size_t index = batch.next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= batch.count)
+            return;
+        try
+        {
+            (*batch.task)(index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock{batch.exception_mtx};
+            if (!batch.exception)
+                batch.exception = std::current_exception();
+            // 放弃剩下的任务
+            batch.next.store(batch.count, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace llama
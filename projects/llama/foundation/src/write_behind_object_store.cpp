@@ -0,0 +1,148 @@
+#include "foundation/write_behind_object_store.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace llama
+{
+
+WriteBehindObjectStore::WriteBehindObjectStore(PackObjectStore &backing, size_t max_pending, size_t max_batch)
+    : m_backing{backing}, m_max_pending{std::max<size_t>(max_pending, 1)}, m_max_batch{std::max<size_t>(max_batch, 1)}
+{
+    m_writer = std::thread{[this] { WriterMain(); }};
+}
+
+WriteBehindObjectStore::~WriteBehindObjectStore()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mtx};
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+}
+
+Hash WriteBehindObjectStore::Store(sp<Object> object)
+{
+    Hash key = object->HashAsObject();
+    // 先查内存再查后备仓库：写盘线程总是先写进后备仓库再从内存删掉，这个顺序不会漏掉
+    if (FindPending(key) || BackingContains(key))
+        throw Exception{ExceptionKind::ElementAlreadyExists};
+
+    std::unique_lock<std::mutex> lock{m_mtx};
+    m_committed_cv.wait(lock, [&] { return m_pending.Size() < m_max_pending || m_error; });
+    if (m_error)
+        std::rethrow_exception(m_error);
+
+    m_pending.Insert(key, object);
+    m_queue.push_back(Entry{key, std::move(object)});
+    m_stored++;
+    lock.unlock();
+    m_wake.notify_one();
+    return key;
+}
+
+bool WriteBehindObjectStore::Contains(Hash const &hash) const
+{
+    return FindPending(hash) || BackingContains(hash);
+}
+
+void WriteBehindObjectStore::Flush()
+{
+    std::unique_lock<std::mutex> lock{m_mtx};
+    uint64_t target = m_stored;
+    m_committed_cv.wait(lock, [&] { return m_committed >= target || m_error; });
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+WriteBehindStats WriteBehindObjectStore::Stats() const
+{
+    std::lock_guard<std::mutex> lock{m_mtx};
+    WriteBehindStats stats;
+    stats.commits = m_commits;
+    stats.committed = m_committed;
+    stats.pending = m_pending.Size();
+    return stats;
+}
+
+void WriteBehindObjectStore::WriterMain()
+{
+    std::vector<Entry> batch;
+    std::unique_lock<std::mutex> lock{m_mtx};
+    while (true)
+    {
+        m_wake.wait(lock, [&] { return !m_queue.empty() || m_stopping; });
+        // 停止时先把剩下的写完；出错之后不再写
+        if (m_queue.empty() || m_error)
+            return;
+
+        size_t count = std::min(m_queue.size(), m_max_batch);
+        batch.assign(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.begin() + count));
+        m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+        lock.unlock();
+
+        // 序列化和等待磁盘都在锁外面，持有后备仓库的只有追加记录这一小段
+        std::exception_ptr error;
+        try
+        {
+            m_buffer.Clear();
+            m_offsets.clear();
+            for (auto const &entry : batch)
+            {
+                m_offsets.push_back(m_buffer.Size());
+                WriteObject(*entry.object, m_buffer);
+            }
+            m_offsets.push_back(m_buffer.Size());
+
+            {
+                std::lock_guard<std::mutex> backing_lock{m_backing_mtx};
+                for (size_t i = 0; i < batch.size(); i++)
+                {
+                    m_backing.Store(batch[i].key,
+                                    m_buffer.Bytes().subspan(m_offsets[i], m_offsets[i + 1] - m_offsets[i]));
+                }
+                m_backing.FlushPack();
+            }
+            m_backing.SyncPack();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (error)
+        {
+            // 这一批和之后的对象留在内存里，仍然可以读取
+            m_error = error;
+        }
+        else
+        {
+            for (auto const &entry : batch)
+            {
+                m_pending.Erase(entry.key);
+            }
+            m_committed += count;
+            m_commits++;
+        }
+        batch.clear();
+        m_committed_cv.notify_all();
+    }
+}
+
+sp<Object> WriteBehindObjectStore::FindPending(Hash const &hash) const
+{
+    std::lock_guard<std::mutex> lock{m_mtx};
+    sp<Object> const *object = m_pending.Find(hash);
+    return object ? *object : nullptr;
+}
+
+bool WriteBehindObjectStore::BackingContains(Hash const &hash) const
+{
+    std::lock_guard<std::mutex> lock{m_backing_mtx};
+    return m_backing.Contains(hash);
+}
+
+} // namespace llama
@@ -0,0 +1,268 @@
+#include "foundation/archive.h"
+#include "foundation/object.h"
+#include "foundation/pack_object_store.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+class Point : public ArchiveObject
+{
+  public:
+    Point() = default;
+
+    Point(int64_t x, int64_t y, std::string label) : m_x{x}, m_y{y}, m_label{std::move(label)}
+    {
+    }
+
+    void WriteAsObject(ArchiveWriter &out) const override
+    {
+        out.WriteVarInt(m_x);
+        out.WriteVarInt(m_y);
+        out.WriteString(m_label);
+    }
+
+    void ReadAsObject(ArchiveReader &in) override
+    {
+        m_x = in.ReadVarInt();
+        m_y = in.ReadVarInt();
+        m_label = in.ReadString();
+    }
+
+    int64_t m_x = 0;
+    int64_t m_y = 0;
+    std::string m_label;
+};
+
+std::vector<std::byte> ToBytes(std::initializer_list<int> values)
+{
+    std::vector<std::byte> bytes;
+    for (int value : values)
+    {
+        bytes.push_back(static_cast<std::byte>(value));
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST(ArchiveTest, FixedWidthIsLittleEndian)
+{
+    ArchiveWriter out;
+    out.WriteU16(0x0102);
+    out.WriteU32(0x03040506);
+    out.WriteU64(0x0708090A0B0C0D0Eull);
+    EXPECT_EQ(std::vector<std::byte>(out.Bytes().begin(), out.Bytes().end()),
+              ToBytes({0x02, 0x01, 0x06, 0x05, 0x04, 0x03, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x09, 0x08, 0x07}));
+
+    ArchiveReader in{out.Bytes()};
+    EXPECT_EQ(in.ReadU16(), 0x0102);
+    EXPECT_EQ(in.ReadU32(), 0x03040506u);
+    EXPECT_EQ(in.ReadU64(), 0x0708090A0B0C0D0Eull);
+    EXPECT_TRUE(in.AtEnd());
+}
+
+TEST(ArchiveTest, RoundTrip)
+{
+    ArchiveWriter out;
+    out.WriteU8(200);
+    out.WriteI32(-5);
+    out.WriteI64(std::numeric_limits<int64_t>::min());
+    out.WriteF32(1.5f);
+    out.WriteF64(-0.25);
+    out.WriteBool(true);
+    out.WriteString("你好, archive");
+    std::array<std::byte, 3> raw{std::byte{1}, std::byte{2}, std::byte{3}};
+    out.WriteBytes(raw);
+    out.WriteString("");
+
+    ArchiveReader in{out.Bytes()};
+    EXPECT_EQ(in.ReadU8(), 200);
+    EXPECT_EQ(in.ReadI32(), -5);
+    EXPECT_EQ(in.ReadI64(), std::numeric_limits<int64_t>::min());
+    EXPECT_EQ(in.ReadF32(), 1.5f);
+    EXPECT_EQ(in.ReadF64(), -0.25);
+    EXPECT_TRUE(in.ReadBool());
+    EXPECT_EQ(in.ReadString(), "你好, archive");
+    auto bytes = in.ReadBytes();
+    EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), raw.begin(), raw.end()));
+    EXPECT_EQ(in.ReadString(), "");
+    EXPECT_TRUE(in.AtEnd());
+}
+
+TEST(ArchiveTest, Varints)
+{
+    ArchiveWriter out;
+    out.WriteVarUint(0);
+    out.WriteVarUint(127);
+    out.WriteVarUint(128);
+    out.WriteVarUint(300);
+    EXPECT_EQ(std::vector<std::byte>(out.Bytes().begin(), out.Bytes().end()),
+              ToBytes({0x00, 0x7F, 0x80, 0x01, 0xAC, 0x02}));
+
+    // zigzag: 0, -1, 1, -2 依次编码成 0, 1, 2, 3
+    out.Clear();
+    out.WriteVarInt(0);
+    out.WriteVarInt(-1);
+    out.WriteVarInt(1);
+    out.WriteVarInt(-2);
+    EXPECT_EQ(std::vector<std::byte>(out.Bytes().begin(), out.Bytes().end()), ToBytes({0, 1, 2, 3}));
+
+    std::vector<uint64_t> unsigned_values{0, 1, 127, 128, 16383, 16384, uint64_t(1) << 35,
+                                          std::numeric_limits<uint64_t>::max()};
+    std::vector<int64_t> signed_values{0, -1, 63, -64, 64, std::numeric_limits<int64_t>::min(),
+                                       std::numeric_limits<int64_t>::max()};
+    out.Clear();
+    for (auto value : unsigned_values)
+    {
+        out.WriteVarUint(value);
+    }
+    for (auto value : signed_values)
+    {
+        out.WriteVarInt(value);
+    }
+    ArchiveReader in{out.Bytes()};
+    for (auto value : unsigned_values)
+    {
+        EXPECT_EQ(in.ReadVarUint(), value);
+    }
+    for (auto value : signed_values)
+    {
+        EXPECT_EQ(in.ReadVarInt(), value);
+    }
+    EXPECT_TRUE(in.AtEnd());
+}
+
+TEST(ArchiveTest, MalformedInput)
+{
+    auto expect_invalid = [](std::vector<std::byte> const &bytes, auto read) {
+        ArchiveReader in{bytes};
+        try
+        {
+            read(in);
+            FAIL();
+        }
+        catch (Exception const &e)
+        {
+            EXPECT_EQ(e.Kind(), ExceptionKind::InvalidArchive);
+        }
+    };
+
+    expect_invalid(ToBytes({1, 2, 3}), [](ArchiveReader &in) { in.ReadU32(); });
+    expect_invalid(ToBytes({0x80, 0x80}), [](ArchiveReader &in) { in.ReadVarUint(); });
+    // 超过 64 位
+    expect_invalid(ToBytes({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02}),
+                   [](ArchiveReader &in) { in.ReadVarUint(); });
+    expect_invalid(ToBytes({0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00}),
+                   [](ArchiveReader &in) { in.ReadVarUint(); });
+    // 长度超过剩下的字节
+    expect_invalid(ToBytes({5, 'a', 'b'}), [](ArchiveReader &in) { in.ReadString(); });
+    expect_invalid(ToBytes({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01}),
+                   [](ArchiveReader &in) { in.ReadBytes(); });
+    expect_invalid(ToBytes({2}), [](ArchiveReader &in) { in.ReadBool(); });
+}
+
+TEST(ArchiveTest, ReadsInPlace)
+{
+    ArchiveWriter out;
+    out.WriteString("borrowed");
+    ArchiveReader in{out.Bytes()};
+    auto text = in.ReadString();
+    EXPECT_EQ(reinterpret_cast<const std::byte *>(text.data()), out.Data() + 1);
+}
+
+TEST(ArchiveTest, SpanWriterRejectsOverflow)
+{
+    std::array<std::byte, 6> buffer{};
+    SpanWriter out{buffer};
+    out.WriteU32(7);
+    EXPECT_THROW(out.WriteU32(8), Exception);
+    EXPECT_EQ(out.Size(), 4);
+    out.WriteVarUint(300);
+    EXPECT_EQ(out.Size(), 6);
+
+    ArchiveReader in{out.Bytes()};
+    EXPECT_EQ(in.ReadU32(), 7u);
+    EXPECT_EQ(in.ReadVarUint(), 300u);
+}
+
+TEST(ArchiveTest, StreamAdapters)
+{
+    ArchiveWriter out;
+    out.WriteU32(1);
+    {
+        ArchiveOutputStream stream{out};
+        stream << "x= " << 42 << ' ';
+        stream.write("tail", 4);
+    }
+    out.WriteU32(2);
+
+    ArchiveReader in{out.Bytes()};
+    EXPECT_EQ(in.ReadU32(), 1u);
+    {
+        ArchiveInputStream stream{in};
+        std::string key;
+        int value;
+        stream >> key >> value;
+        EXPECT_EQ(key, "x=");
+        EXPECT_EQ(value, 42);
+        stream.ignore(1);
+        char tail[4];
+        stream.read(tail, 4);
+        EXPECT_EQ(std::string(tail, 4), "tail");
+    }
+    EXPECT_EQ(in.ReadU32(), 2u);
+    EXPECT_TRUE(in.AtEnd());
+}
+
+TEST(ArchiveTest, ArchiveObjectThroughStreams)
+{
+    Point point{-3, 1 << 20, "origin"};
+
+    std::stringstream stream{std::ios::in | std::ios::out | std::ios::binary};
+    point.SerializeAsObject(stream);
+    Point copy;
+    copy.DeserializeAsObject(stream);
+    EXPECT_EQ(copy.m_x, -3);
+    EXPECT_EQ(copy.m_y, 1 << 20);
+    EXPECT_EQ(copy.m_label, "origin");
+
+    // 内存输入流走原地读取的路径，读完停在对象末尾
+    ArchiveWriter out;
+    point.WriteAsObject(out);
+    out.WriteU8(0xAB);
+    MemoryInputStream memory{out.Bytes()};
+    Point again;
+    again.DeserializeAsObject(memory);
+    EXPECT_EQ(again.m_label, "origin");
+    EXPECT_EQ(memory.get(), 0xAB);
+
+    ArchiveWriter direct;
+    point.WriteAsObject(direct);
+    EXPECT_EQ(point.HashAsObject(), Hasher128::Of(direct.Data(), direct.Size()));
+}
+
+TEST(ArchiveTest, ArchiveObjectInPackStore)
+{
+    auto directory = std::filesystem::temp_directory_path() / "llama-archive-pack";
+    std::filesystem::remove_all(directory);
+    {
+        PackObjectStore store{directory};
+        Hash key = store.Store(Point{7, -7, "seven"});
+        auto point = store.Retrieve<Point>(key);
+        EXPECT_EQ(point->m_x, 7);
+        EXPECT_EQ(point->m_y, -7);
+        EXPECT_EQ(point->m_label, "seven");
+        EXPECT_EQ(store.SizeOf(key), 8u);
+    }
+    std::filesystem::remove_all(directory);
+}
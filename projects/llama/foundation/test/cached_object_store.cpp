@@ -0,0 +1,155 @@
+#include "foundation/cached_object_store.h"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+class Text : public Object
+{
+  public:
+    Text() = default;
+
+    explicit Text(std::string text) : m_text{std::move(text)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{std::hash<std::string>{}(m_text), m_text.size()};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out.write(m_text.data(), std::streamsize(m_text.size()));
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        m_text.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+
+    std::string m_text;
+};
+
+// 每个对象序列化后 100 字节，计入缓存的大小是固定的
+constexpr size_t kTextSize = 100;
+constexpr size_t kEntrySize = kTextSize + CachedObjectStore::kEntryOverhead;
+
+sp<Text> MakeText(int i)
+{
+    auto text = std::to_string(i);
+    text.resize(kTextSize, '.');
+    return std::make_shared<Text>(text);
+}
+
+class CachedObjectStoreTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        auto name = std::string{"llama-cache-"} + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_directory = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(m_directory);
+        m_backing.emplace(m_directory);
+    }
+
+    void TearDown() override
+    {
+        m_backing.reset();
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::filesystem::path m_directory;
+    std::optional<PackObjectStore> m_backing;
+};
+
+} // namespace
+
+TEST_F(CachedObjectStoreTest, HitsStoredObjects)
+{
+    CachedObjectStore cache{*m_backing, 10 * kEntrySize};
+    auto text = MakeText(1);
+    Hash key = cache.Store(text);
+    EXPECT_EQ(cache.Retrieve<Text>(key), text);
+    EXPECT_EQ(cache.Stats().hits, 1);
+    EXPECT_EQ(cache.Stats().misses, 0);
+    EXPECT_EQ(cache.Stats().resident_bytes, kEntrySize);
+    EXPECT_THROW(cache.Store(MakeText(1)), Exception);
+    EXPECT_THROW(cache.Retrieve<Text>(Hash{0, 0}), Exception);
+}
+
+TEST_F(CachedObjectStoreTest, StaysWithinCapacityAndReloads)
+{
+    CachedObjectStore cache{*m_backing, 10 * kEntrySize};
+    std::vector<Hash> keys;
+    for (int i = 0; i < 100; i++)
+    {
+        keys.push_back(cache.Store(MakeText(i)));
+        EXPECT_LE(cache.Stats().resident_bytes, cache.Capacity());
+    }
+    EXPECT_EQ(cache.Stats().resident_count, 10);
+    EXPECT_EQ(cache.Stats().evictions, 90);
+
+    // 被逐出的对象从后备仓库重新加载，内容不变
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(cache.Retrieve<Text>(keys[i])->m_text, MakeText(i)->m_text);
+        EXPECT_LE(cache.Stats().resident_bytes, cache.Capacity());
+    }
+    EXPECT_EQ(cache.Stats().hits + cache.Stats().misses, 100);
+    EXPECT_GE(cache.Stats().misses, 90);
+}
+
+TEST_F(CachedObjectStoreTest, HotSetSurvivesScan)
+{
+    CachedObjectStore cache{*m_backing, 20 * kEntrySize};
+    std::vector<Hash> hot, cold;
+    for (int i = 0; i < 10; i++)
+    {
+        hot.push_back(cache.Store(MakeText(i)));
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        cold.push_back(m_backing->Store(*MakeText(1000 + i)));
+    }
+
+    // 反复访问热点，使它们进入 T2
+    for (int round = 0; round < 3; round++)
+    {
+        for (auto const &key : hot)
+        {
+            cache.Retrieve<Text>(key);
+        }
+    }
+    // 一次性扫描大量冷数据
+    for (auto const &key : cold)
+    {
+        cache.Retrieve<Text>(key);
+    }
+
+    cache.ResetStats();
+    for (auto const &key : hot)
+    {
+        cache.Retrieve<Text>(key);
+    }
+    EXPECT_EQ(cache.Stats().hits, hot.size());
+}
+
+TEST_F(CachedObjectStoreTest, ShrinkingEvicts)
+{
+    CachedObjectStore cache{*m_backing, 10 * kEntrySize};
+    for (int i = 0; i < 10; i++)
+    {
+        cache.Store(MakeText(i));
+    }
+    cache.SetCapacity(3 * kEntrySize);
+    EXPECT_EQ(cache.Stats().resident_count, 3);
+    cache.SetCapacity(0);
+    EXPECT_EQ(cache.Stats().resident_bytes, 0);
+}
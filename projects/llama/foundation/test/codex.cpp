@@ -1,9 +1,12 @@
 #include "foundation/codex.h"
+#include "foundation/codex_literals.h"
 #include "foundation/exceptions.h"
+#include "foundation/thread_pool.h"
 #include <codecvt>
 #include <cstdint>
 #include <gtest/gtest.h>
 #include <locale>
+#include <random>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -149,6 +152,47 @@ TEST(DecodeUtf8Test, InvalidSequence)
     EXPECT_THROW({ std::vector<uint32_t> result = DecodeUtf8(data, length); }, Exception);
 }
 
+TEST(DecodeUtf8Test, TryDecodeKeepsIndexOnFailure)
+{
+    const char *data = "a\xE4\xB8\xAD\xE4\xB8";
+    size_t index = 0;
+    uint32_t code_point = 0;
+    EXPECT_TRUE(TryDecodeUtf8Char(data, 6, index, code_point));
+    EXPECT_EQ(code_point, U'a');
+    EXPECT_TRUE(TryDecodeUtf8Char(data, 6, index, code_point));
+    EXPECT_EQ(code_point, U'中');
+    EXPECT_EQ(index, 4);
+    // 截断的序列
+    EXPECT_FALSE(TryDecodeUtf8Char(data, 6, index, code_point));
+    EXPECT_EQ(index, 4);
+    EXPECT_THROW(DecodeUtf8Char(data, 6, index), Exception);
+}
+
+TEST(DecodeUtf8Test, RejectsOverlongSurrogatesAndOutOfRange)
+{
+    // 超长编码、编码的代理、大于 0x10FFFF 的值
+    std::string_view invalid[] = {"\xC0\x80",         "\xC1\xBF",         "\xE0\x80\x80", "\xE0\x9F\xBF",
+                                  "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", "\xED\xA0\x80", "\xED\xBF\xBF",
+                                  "\xF4\x90\x80\x80", "\xF7\xBF\xBF\xBF"};
+    for (std::string_view bytes : invalid)
+    {
+        size_t index = 0;
+        uint32_t code_point = 0;
+        EXPECT_FALSE(TryDecodeUtf8Char(bytes.data(), bytes.size(), index, code_point));
+        EXPECT_EQ(index, 0);
+        EXPECT_THROW(DecodeUtf8(bytes.data(), bytes.size()), Exception);
+    }
+
+    // 各个边界上最小、最大的合法值
+    std::string_view valid[] = {"\xC2\x80", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xF0\x90\x80\x80",
+                                "\xF4\x8F\xBF\xBF"};
+    uint32_t expected[] = {0x80, 0x800, 0xD7FF, 0xE000, 0x10000, 0x10FFFF};
+    for (size_t i = 0; i < std::size(valid); i++)
+    {
+        EXPECT_EQ(DecodeUtf8(valid[i].data(), valid[i].size()), std::vector<uint32_t>{expected[i]});
+    }
+}
+
 ///////////////////////////////
 
 // EncodeUtf16 tests
@@ -232,4 +276,227 @@ TEST(EncodingTest, EmojiCharacters)
     std::string expected = "\xf0\x9f\x98\x8d\xf0\x9f\x98\x98\xf0\x9f\x98\x82";
     std::string actual = EncodeUtf8(data, 3);
     EXPECT_EQ(expected, actual);
-}
\ No newline at end of file
+}
+
+///////////////////////////////
+// 并行转换
+// 生成约 `bytes` 字节、含 1~4 字节字符的 UTF-8 文本。
+static std::string MakeMixedUtf8(size_t bytes)
+{
+    const uint32_t samples[] = {'a', 'Z', ' ', 0x00E9, 0x0416, 0x4E16, 0x754C, 0x3053, 0x1F600, 0x1F30D};
+    std::vector<uint32_t> codes;
+    uint32_t state = 12345;
+    size_t approx = 0;
+    while (approx < bytes)
+    {
+        state = state * 1103515245 + 12345;
+        uint32_t code = samples[(state >> 16) % std::size(samples)];
+        codes.push_back(code);
+        approx += code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+    }
+    return EncodeUtf8(codes.data(), codes.size());
+}
+
+TEST(ParallelCodexTest, ToUtf16MatchesSequential)
+{
+    ThreadPool pool{4};
+    std::string input = MakeMixedUtf8(3 * 1024 * 1024 + 7);
+    EXPECT_EQ(ToUtf16(input, pool), ToUtf16(input));
+}
+
+TEST(ParallelCodexTest, ToUtf8MatchesSequential)
+{
+    ThreadPool pool{4};
+    std::u16string input = ToUtf16(MakeMixedUtf8(3 * 1024 * 1024 + 7));
+    EXPECT_EQ(ToUtf8(input, pool), ToUtf8(std::u16string_view{input}));
+}
+
+TEST(ParallelCodexTest, SmallInput)
+{
+    ThreadPool pool{4};
+    EXPECT_EQ(ToUtf16(std::string_view{"😀AB"}, pool), u"😀AB");
+    EXPECT_EQ(ToUtf8(std::u16string_view{u"😀AB"}, pool), "😀AB");
+    EXPECT_EQ(ToUtf16(std::string_view{}, pool), u"");
+}
+
+TEST(ParallelCodexTest, InvalidSequence)
+{
+    ThreadPool pool{4};
+    std::u16string input = ToUtf16(MakeMixedUtf8(2 * 1024 * 1024));
+    input[input.size() / 2] = 0xD83D;
+    input[input.size() / 2 + 1] = 'A';
+    EXPECT_THROW(ToUtf8(input, pool), Exception);
+}
+
+///////////////////////////////
+// 向量化编码器与逐字符实现的差分测试
+
+// 向量化之前的逐字符实现，作为参照
+static std::u16string ReferenceEncodeUtf16(const uint32_t *data, size_t length)
+{
+    std::u16string result;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint32_t codepoint = data[i];
+        if (codepoint <= 0xFFFF)
+        {
+            result.push_back(static_cast<char16_t>(codepoint));
+        }
+        else
+        {
+            codepoint -= 0x10000;
+            result.push_back(static_cast<char16_t>((codepoint >> 10) + 0xD800));
+            result.push_back(static_cast<char16_t>((codepoint & 0x3FF) + 0xDC00));
+        }
+    }
+    return result;
+}
+
+static std::string ReferenceEncodeUtf8(const uint32_t *data, size_t length)
+{
+    std::string result;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint32_t codePoint = data[i];
+        if (codePoint <= 0x7F)
+        {
+            result += static_cast<char>(codePoint);
+        }
+        else if (codePoint <= 0x7FF)
+        {
+            result += static_cast<char>((codePoint >> 6) | 0xC0);
+            result += static_cast<char>((codePoint & 0x3F) | 0x80);
+        }
+        else if (codePoint <= 0xFFFF)
+        {
+            result += static_cast<char>((codePoint >> 12) | 0xE0);
+            result += static_cast<char>(((codePoint >> 6) & 0x3F) | 0x80);
+            result += static_cast<char>((codePoint & 0x3F) | 0x80);
+        }
+        else if (codePoint <= 0x10FFFF)
+        {
+            result += static_cast<char>((codePoint >> 18) | 0xF0);
+            result += static_cast<char>(((codePoint >> 12) & 0x3F) | 0x80);
+            result += static_cast<char>(((codePoint >> 6) & 0x3F) | 0x80);
+            result += static_cast<char>((codePoint & 0x3F) | 0x80);
+        }
+    }
+    return result;
+}
+
+// 按 `max_code_point` 生成随机代码点。偶尔混入一个大字符，让向量化的块走回退路径。
+static std::vector<uint32_t> RandomCodePoints(std::mt19937 &rng, size_t length, uint32_t max_code_point)
+{
+    std::uniform_int_distribution<uint32_t> small{0, max_code_point};
+    std::uniform_int_distribution<uint32_t> any{0, 0x10FFFF};
+    std::uniform_int_distribution<uint32_t> dice{0, 99};
+    std::vector<uint32_t> codes(length);
+    for (auto &code : codes)
+    {
+        code = dice(rng) == 0 ? any(rng) : small(rng);
+    }
+    return codes;
+}
+
+TEST(EncodeDifferentialTest, RandomInputs)
+{
+    std::mt19937 rng{27};
+    for (uint32_t max_code_point : {0x7Fu, 0x7FFu, 0xFFFFu, 0x10FFFFu})
+    {
+        for (size_t length = 0; length < 200; length++)
+        {
+            auto codes = RandomCodePoints(rng, length, max_code_point);
+            ASSERT_EQ(EncodeUtf16(codes.data(), codes.size()), ReferenceEncodeUtf16(codes.data(), codes.size()));
+            ASSERT_EQ(EncodeUtf8(codes.data(), codes.size()), ReferenceEncodeUtf8(codes.data(), codes.size()));
+        }
+        auto codes = RandomCodePoints(rng, 100003, max_code_point);
+        EXPECT_EQ(EncodeUtf16(codes.data(), codes.size()), ReferenceEncodeUtf16(codes.data(), codes.size()));
+        EXPECT_EQ(EncodeUtf8(codes.data(), codes.size()), ReferenceEncodeUtf8(codes.data(), codes.size()));
+    }
+}
+
+TEST(EncodeDifferentialTest, PureBlocks)
+{
+    std::vector<uint32_t> ascii(1000, 'x');
+    std::vector<uint32_t> bmp(1000, 0xFFFF);
+    std::vector<uint32_t> surrogates(1000, 0xD800);
+    for (auto const *codes : {&ascii, &bmp, &surrogates})
+    {
+        EXPECT_EQ(EncodeUtf16(codes->data(), codes->size()), ReferenceEncodeUtf16(codes->data(), codes->size()));
+        EXPECT_EQ(EncodeUtf8(codes->data(), codes->size()), ReferenceEncodeUtf8(codes->data(), codes->size()));
+    }
+}
+
+TEST(EncodeDifferentialTest, OutOfRangeCodePoints)
+{
+    // 超出 Unicode 范围的代码点：UTF-8 不输出，UTF-16 保持原来的行为
+    std::vector<uint32_t> codes(64, 'a');
+    codes[3] = 0x110000;
+    codes[40] = 0xFFFFFFFF;
+    EXPECT_EQ(EncodeUtf16(codes.data(), codes.size()), ReferenceEncodeUtf16(codes.data(), codes.size()));
+    EXPECT_EQ(EncodeUtf8(codes.data(), codes.size()), ReferenceEncodeUtf8(codes.data(), codes.size()));
+    EXPECT_EQ(EncodeUtf8(codes.data(), codes.size()).size(), 62);
+}
+
+///////////////////////////////
+// 编译期转换
+
+using namespace llama::literals;
+
+static_assert("abc"_u16.View() == u"abc");
+static_assert("世界😀"_u16.View() == u"世界😀");
+static_assert("世界😀"_u16.Size() == 4);
+static_assert("世界😀"_u32.View() == U"世界😀");
+static_assert(""_u16.Size() == 0);
+
+static constexpr uint32_t DecodeFirst(const char *data, size_t length)
+{
+    size_t index = 0;
+    return DecodeUtf8Char(data, length, index);
+}
+static_assert(DecodeFirst("\xF0\x9F\x8C\x8D", 4) == 0x1F30D);
+
+static constexpr bool TryDecodeFirst(const char *data, size_t length)
+{
+    size_t index = 0;
+    uint32_t code_point = 0;
+    return TryDecodeUtf8Char(data, length, index, code_point);
+}
+static_assert(TryDecodeFirst("\xF4\x8F\xBF\xBF", 4));
+static_assert(!TryDecodeFirst("\xC0\x80", 2));
+static_assert(!TryDecodeFirst("\xE0\x80\x80", 3));
+static_assert(!TryDecodeFirst("\xED\xA0\x80", 3));
+static_assert(!TryDecodeFirst("\xF4\x90\x80\x80", 4));
+static_assert(!TryDecodeFirst("\xF7\xBF\xBF\xBF", 4));
+
+static constexpr std::u16string_view EncodeAtCompileTime()
+{
+    char16_t buffer[2] = {};
+    EncodeUtf16Char(0x1F600, buffer);
+    return buffer[0] == 0xD83D && buffer[1] == 0xDE00 ? u"ok" : u"bad";
+}
+static_assert(EncodeAtCompileTime() == u"ok");
+
+// 不合法的字面量无法通过编译，例如：
+// constexpr auto bad = "\xC0"_u16;
+
+TEST(CodexLiteralTest, MatchesRuntimeConversion)
+{
+    constexpr auto title = "工作簿 Workbook 📒"_u16;
+    EXPECT_EQ(std::u16string_view{title}, ToUtf16("工作簿 Workbook 📒"));
+    constexpr auto title32 = "工作簿 Workbook 📒"_u32;
+    EXPECT_EQ(title32.Size(), 14);
+    EXPECT_EQ(title32[13], U'📒');
+}
+
+TEST(DecodeUtf8Test, TruncatedSequence)
+{
+    // 以前会越界读取
+    EXPECT_THROW(DecodeUtf8("\xE4\xB8", 2), Exception);
+    EXPECT_THROW(DecodeUtf8("a\xF0", 2), Exception);
+}
+
+TEST(DecodeUtf8Test, InvalidContinuationByte)
+{
+    EXPECT_THROW(DecodeUtf8("\xE4" "ab", 3), Exception);
+}
@@ -0,0 +1,188 @@
+#include "foundation/concurrent_object_store.h"
+#include "foundation/thread_pool.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+class Number : public Object
+{
+  public:
+    explicit Number(uint64_t value) : m_value{value}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        // 高位要有变化，才能分散到各个分片
+        uint64_t z = (m_value + 1) * 0x9E3779B97F4A7C15ull;
+        return Hash{z ^ (z >> 29), m_value};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out << m_value;
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        in >> m_value;
+    }
+
+    uint64_t m_value;
+};
+
+// 引用前一个数的链表节点
+class Link : public Number
+{
+  public:
+    using Number::Number;
+
+    void ForEachReference(std::function<void(Hash const &)> const &visit) const override
+    {
+        if (m_value != 0)
+            visit(Number{m_value - 1}.HashAsObject());
+    }
+};
+
+} // namespace
+
+TEST(ConcurrentObjectStoreTest, StoreAndRetrieve)
+{
+    ConcurrentObjectStore store;
+    auto number = std::make_shared<Number>(5);
+    Hash key = store.Store(number);
+    EXPECT_TRUE(store.Contains(key));
+    EXPECT_EQ(store.Retrieve<Number>(key), number);
+    EXPECT_EQ(store.Size(), 1);
+    EXPECT_THROW(store.Store(std::make_shared<Number>(5)), Exception);
+    EXPECT_THROW(store.Retrieve<Number>(Hash{0, 0}), Exception);
+}
+
+TEST(ConcurrentObjectStoreTest, ConcurrentStoreAndRetrieve)
+{
+    constexpr size_t kCount = 20000;
+    ConcurrentObjectStore store;
+    ThreadPool pool{8};
+
+    // 一半线程存，一半线程反复取已经存好的
+    for (size_t i = 0; i < kCount / 2; i++)
+    {
+        store.Store(std::make_shared<Number>(i));
+    }
+    std::atomic<size_t> found = 0;
+    pool.ParallelFor(kCount / 2, [&](size_t i) {
+        store.Store(std::make_shared<Number>(kCount / 2 + i));
+        if (store.Retrieve<Number>(Number{i}.HashAsObject())->m_value == i)
+            found++;
+    });
+    EXPECT_EQ(found, kCount / 2);
+    EXPECT_EQ(store.Size(), kCount);
+
+    // 多个线程抢着存同一个对象，只有一个成功
+    std::atomic<size_t> stored = 0;
+    pool.ParallelFor(64, [&](size_t) {
+        try
+        {
+            store.Store(std::make_shared<Number>(kCount));
+            stored++;
+        }
+        catch (Exception const &e)
+        {
+            EXPECT_EQ(e.Kind(), ExceptionKind::ElementAlreadyExists);
+        }
+    });
+    EXPECT_EQ(stored, 1);
+
+    pool.ParallelFor(kCount, [&](size_t i) { EXPECT_EQ(store.Retrieve<Number>(Number{i}.HashAsObject())->m_value, i); });
+}
+
+TEST(ConcurrentObjectStoreTest, BatchStoreAndRetrieve)
+{
+    ConcurrentObjectStore store;
+    std::vector<sp<Object>> objects;
+    for (uint64_t i = 0; i < 5000; i++)
+    {
+        objects.push_back(std::make_shared<Number>(i));
+    }
+    auto keys = store.StoreBatch(objects);
+    EXPECT_EQ(store.Size(), objects.size());
+
+    // 结果的顺序和输入相同，不受分片分组影响
+    auto retrieved = store.RetrieveBatch<Number>(keys);
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        EXPECT_EQ(retrieved[i], objects[i]);
+    }
+
+    // 有一个重复时整批撤回
+    std::vector<sp<Object>> more;
+    for (uint64_t i = 10000; i < 10100; i++)
+    {
+        more.push_back(std::make_shared<Number>(i));
+    }
+    more.push_back(std::make_shared<Number>(42));
+    EXPECT_THROW(store.StoreBatch(more), Exception);
+    EXPECT_EQ(store.Size(), objects.size());
+    EXPECT_FALSE(store.Contains(Number{10000}.HashAsObject()));
+}
+
+TEST(ConcurrentObjectStoreTest, CollectUnreachable)
+{
+    ConcurrentObjectStore store;
+    for (uint64_t i = 0; i < 100; i++)
+    {
+        store.Store(std::make_shared<Link>(i));
+    }
+    for (uint64_t i = 1000; i < 1100; i++)
+    {
+        store.Store(std::make_shared<Number>(i));
+    }
+    store.AddRoot(Number{49}.HashAsObject());
+    EXPECT_EQ(store.Collect(), 150);
+    EXPECT_EQ(store.Size(), 50);
+    EXPECT_TRUE(store.Contains(Number{0}.HashAsObject()));
+    EXPECT_FALSE(store.Contains(Number{50}.HashAsObject()));
+    EXPECT_THROW(store.CollectStep(1), Exception);
+}
+
+TEST(ConcurrentObjectStoreTest, IncrementalCollectionKeepsNewObjects)
+{
+    ConcurrentObjectStore store;
+    constexpr uint64_t kChain = 5000;
+    for (uint64_t i = 0; i < kChain; i++)
+    {
+        store.Store(std::make_shared<Link>(i));
+    }
+    store.Store(std::make_shared<Number>(kChain + 1));
+    store.AddRoot(Number{kChain - 1}.HashAsObject());
+
+    store.BeginCollection();
+    EXPECT_THROW(store.BeginCollection(), Exception);
+    EXPECT_FALSE(store.CollectStep(10));
+
+    // 标记的同时别的线程照常存取；回收期间存放的对象都保留
+    std::atomic<uint64_t> retrieved = 0;
+    std::thread worker{[&] {
+        for (uint64_t i = 0; i < 1000; i++)
+        {
+            store.Store(std::make_shared<Number>(kChain + 10 + i));
+            retrieved += store.Retrieve<Number>(Number{i}.HashAsObject())->m_value;
+        }
+    }};
+    while (!store.CollectStep(64))
+    {
+    }
+    worker.join();
+    EXPECT_EQ(store.FinishCollection(), 1);
+    EXPECT_EQ(retrieved, 999 * 1000 / 2);
+    EXPECT_EQ(store.Size(), kChain + 1000);
+
+    // 新对象没有根，下一次回收就会去掉
+    EXPECT_EQ(store.Collect(), 1000);
+}
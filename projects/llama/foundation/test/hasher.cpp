@@ -0,0 +1,195 @@
+#include "foundation/hasher.h"
+#include "foundation/object.h"
+#include <algorithm>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+// 按设计逐字写成的标量参考实现，用来检验实际运行的向量化内核和流式切分
+Hash ReferenceHash(const unsigned char *data, size_t length, uint64_t seed)
+{
+    auto read64 = [](const unsigned char *p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--)
+            v = (v << 8) | p[i];
+        return v;
+    };
+    auto fold = [](uint64_t a, uint64_t b) {
+        unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    };
+    auto avalanche = [](uint64_t h) {
+        h ^= h >> 37;
+        h *= 0x165667919E3779F9ull;
+        return h ^ (h >> 32);
+    };
+
+    unsigned char secret[192];
+    uint64_t state = 0x6C6C616D61ull;
+    for (size_t i = 0; i < 192; i += 8)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        // 偶数字加种子，奇数字减种子
+        z = (i / 8) % 2 == 0 ? z + seed : z - seed;
+        for (size_t j = 0; j < 8; j++)
+            secret[i + j] = static_cast<unsigned char>(z >> (j * 8));
+    }
+
+    uint64_t acc[8] = {0xC2B2AE3Du,          0x9E3779B185EBCA87ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                       0x85EBCA77C2B2AE63ull, 0x85EBCA77u,           0x27D4EB2F165667C5ull, 0x9E3779B1u};
+    auto accumulate = [&](const unsigned char *stripe, const unsigned char *key) {
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t value = read64(stripe + i * 8);
+            uint64_t keyed = value ^ read64(key + i * 8);
+            acc[i ^ 1] += value;
+            acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    };
+
+    size_t stripes = length / 64;
+    for (size_t s = 0; s < stripes; s++)
+    {
+        accumulate(data + s * 64, secret + (s % 16) * 8);
+        if (s % 16 == 15)
+        {
+            for (size_t i = 0; i < 8; i++)
+            {
+                acc[i] ^= acc[i] >> 47;
+                acc[i] ^= read64(secret + 128 + i * 8);
+                acc[i] *= 0x9E3779B1u;
+            }
+        }
+    }
+    if (length % 64)
+    {
+        unsigned char last[64] = {};
+        std::memcpy(last, data + stripes * 64, length % 64);
+        accumulate(last, secret + 121);
+    }
+
+    uint64_t low = length * 0x9E3779B185EBCA87ull;
+    uint64_t high = ~(length * 0xC2B2AE3D27D4EB4Full);
+    for (size_t i = 0; i < 4; i++)
+    {
+        low += fold(acc[2 * i] ^ read64(secret + 11 + i * 16), acc[2 * i + 1] ^ read64(secret + 19 + i * 16));
+        high += fold(acc[2 * i] ^ read64(secret + 117 + i * 16), acc[2 * i + 1] ^ read64(secret + 125 + i * 16));
+    }
+    return Hash{avalanche(low), avalanche(high)};
+}
+
+std::vector<unsigned char> RandomBytes(size_t length, uint64_t seed)
+{
+    std::vector<unsigned char> bytes(length);
+    for (auto &byte : bytes)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        byte = static_cast<unsigned char>(seed >> 56);
+    }
+    return bytes;
+}
+
+class Blob : public Object
+{
+  public:
+    explicit Blob(std::string bytes) : m_bytes{std::move(bytes)}
+    {
+    }
+
+    // 故意分成很多次小写入
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        for (char ch : m_bytes)
+        {
+            out.put(ch);
+        }
+    }
+
+    void DeserializeAsObject(std::istream &) override
+    {
+    }
+
+    std::string m_bytes;
+};
+
+} // namespace
+
+TEST(HasherTest, MatchesReference)
+{
+    // 覆盖空输入、不足一条、整条、跨块（16 条一块）
+    for (size_t length : {0, 1, 7, 63, 64, 65, 127, 128, 1000, 1023, 1024, 1025, 4096, 100000})
+    {
+        auto bytes = RandomBytes(length, length);
+        for (uint64_t seed : {0ull, 1ull, 0xDEADBEEFull})
+        {
+            EXPECT_EQ(Hasher128::Of(bytes.data(), length, seed), ReferenceHash(bytes.data(), length, seed))
+                << "length " << length << " seed " << seed;
+        }
+    }
+}
+
+TEST(HasherTest, StreamingEqualsOneShot)
+{
+    auto bytes = RandomBytes(3000, 42);
+    Hash expected = Hasher128::Of(bytes.data(), bytes.size());
+    for (size_t chunk : {1, 3, 17, 63, 64, 65, 1000})
+    {
+        Hasher128 hasher;
+        for (size_t i = 0; i < bytes.size(); i += chunk)
+        {
+            hasher.Update(bytes.data() + i, std::min(chunk, bytes.size() - i));
+        }
+        EXPECT_EQ(hasher.Finish(), expected) << "chunk " << chunk;
+    }
+
+    // Finish 之后还能继续
+    Hasher128 hasher;
+    hasher.Update(bytes.data(), 100);
+    hasher.Finish();
+    hasher.Update(bytes.data() + 100, bytes.size() - 100);
+    EXPECT_EQ(hasher.Finish(), expected);
+}
+
+TEST(HasherTest, DistinguishesNearbyInputs)
+{
+    std::set<std::pair<uint64_t, uint64_t>> seen;
+    auto record = [&](Hash const &hash) { return seen.emplace(hash.Data1(), hash.Data2()).second; };
+
+    // 末尾补零不会和真正的 0 混淆
+    std::vector<unsigned char> zeros(200, 0);
+    for (size_t length = 0; length <= zeros.size(); length++)
+    {
+        EXPECT_TRUE(record(Hasher128::Of(zeros.data(), length)));
+    }
+    // 翻转任意一位
+    auto bytes = RandomBytes(256, 7);
+    for (size_t bit = 0; bit < bytes.size() * 8; bit++)
+    {
+        bytes[bit / 8] ^= 1 << (bit % 8);
+        EXPECT_TRUE(record(Hasher128::Of(bytes.data(), bytes.size())));
+        bytes[bit / 8] ^= 1 << (bit % 8);
+    }
+}
+
+TEST(HasherTest, DefaultObjectHashIsContentHash)
+{
+    std::string text(5000, 'x');
+    text[4321] = 'y';
+    Blob blob{text};
+    EXPECT_EQ(blob.HashAsObject(), Hasher128::Of(text.data(), text.size()));
+    EXPECT_NE(blob.HashAsObject(), Blob{std::string(5000, 'x')}.HashAsObject());
+
+    HashingOutputStream out;
+    out.write(text.data(), std::streamsize(text.size()));
+    EXPECT_EQ(out.Finish(), blob.HashAsObject());
+}
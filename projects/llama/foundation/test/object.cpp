@@ -0,0 +1,299 @@
+#include "foundation/hash_table.h"
+#include "foundation/object.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+// 低位相同、只有高位不同的哈希，会落到同一组并且 H2 相同，用来测试冲突
+Hash CollidingHash(uint64_t i)
+{
+    return Hash{i << 40, i};
+}
+
+Hash SpreadHash(uint64_t i)
+{
+    uint64_t z = (i + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    return Hash{z ^ (z >> 31), i};
+}
+
+class Text : public Object
+{
+  public:
+    explicit Text(std::string text) : m_text{std::move(text)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{std::hash<std::string>{}(m_text), m_text.size()};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out << m_text;
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        in >> m_text;
+    }
+
+    std::string m_text;
+};
+
+// 引用其他对象的节点，用来测试垃圾回收
+class Node : public Object
+{
+  public:
+    Node(std::string name, std::vector<Hash> children) : m_name{std::move(name)}, m_children{std::move(children)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{std::hash<std::string>{}(m_name), m_name.size()};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out << m_name;
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        in >> m_name;
+    }
+
+    void ForEachReference(std::function<void(Hash const &)> const &visit) const override
+    {
+        for (auto const &child : m_children)
+        {
+            visit(child);
+        }
+    }
+
+    std::string m_name;
+    std::vector<Hash> m_children;
+};
+
+} // namespace
+
+TEST(HashTableTest, InsertFindErase)
+{
+    HashTable<int> table;
+    EXPECT_TRUE(table.Empty());
+    EXPECT_EQ(table.Find(Hash{1, 2}), nullptr);
+
+    auto [value, inserted] = table.Insert(Hash{1, 2}, 10);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(*value, 10);
+
+    // 已存在的键不覆盖
+    auto [same, inserted_again] = table.Insert(Hash{1, 2}, 20);
+    EXPECT_FALSE(inserted_again);
+    EXPECT_EQ(*same, 10);
+    EXPECT_EQ(table.Size(), 1);
+
+    // 只有 Data2 不同也是不同的键
+    EXPECT_FALSE(table.Contains(Hash{1, 3}));
+    EXPECT_TRUE(table.Erase(Hash{1, 2}));
+    EXPECT_FALSE(table.Erase(Hash{1, 2}));
+    EXPECT_TRUE(table.Empty());
+}
+
+TEST(HashTableTest, ManyKeysAgreeWithMap)
+{
+    HashTable<uint64_t> table;
+    std::map<Hash, uint64_t> reference;
+    for (uint64_t i = 0; i < 100000; i++)
+    {
+        Hash key = i % 3 ? SpreadHash(i) : CollidingHash(i);
+        table.Insert(key, i);
+        reference.emplace(key, i);
+    }
+    for (uint64_t i = 0; i < 100000; i += 2)
+    {
+        Hash key = i % 3 ? SpreadHash(i) : CollidingHash(i);
+        EXPECT_EQ(table.Erase(key), reference.erase(key) == 1);
+    }
+
+    EXPECT_EQ(table.Size(), reference.size());
+    for (auto const &[key, value] : reference)
+    {
+        auto found = table.Find(key);
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(*found, value);
+    }
+    size_t visited = 0;
+    table.ForEach([&](Hash const &key, uint64_t &value) {
+        EXPECT_EQ(reference.at(key), value);
+        visited++;
+    });
+    EXPECT_EQ(visited, reference.size());
+}
+
+TEST(HashTableTest, ChurnReusesTombstones)
+{
+    HashTable<std::string> table;
+    table.Reserve(100);
+    for (uint64_t round = 0; round < 1000; round++)
+    {
+        for (uint64_t i = 0; i < 50; i++)
+        {
+            table.Insert(CollidingHash(round * 50 + i), std::to_string(i));
+        }
+        for (uint64_t i = 0; i < 50; i++)
+        {
+            EXPECT_TRUE(table.Erase(CollidingHash(round * 50 + i)));
+        }
+    }
+    EXPECT_TRUE(table.Empty());
+    table.Insert(Hash{7, 7}, "seven");
+    EXPECT_EQ(*table.Find(Hash{7, 7}), "seven");
+}
+
+TEST(HashTableTest, MoveAndClear)
+{
+    HashTable<sp<int>> table;
+    auto value = std::make_shared<int>(42);
+    table.Insert(Hash{1, 1}, value);
+    EXPECT_EQ(value.use_count(), 2);
+
+    HashTable<sp<int>> moved{std::move(table)};
+    EXPECT_EQ(**moved.Find(Hash{1, 1}), 42);
+
+    moved.Clear();
+    EXPECT_EQ(value.use_count(), 1);
+    EXPECT_TRUE(moved.Empty());
+}
+
+TEST(HashTableTest, EraseIfShrinks)
+{
+    HashTable<uint64_t> table;
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        table.Insert(SpreadHash(i), i);
+    }
+    EXPECT_EQ(table.EraseIf([](Hash const &, uint64_t &value) { return value % 100 != 0; }), 990);
+    EXPECT_EQ(table.Size(), 10);
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        uint64_t const *value = table.Find(SpreadHash(i));
+        EXPECT_EQ(value != nullptr, i % 100 == 0);
+    }
+    EXPECT_EQ(table.EraseIf([](Hash const &, uint64_t &) { return true; }), 10);
+    EXPECT_TRUE(table.Empty());
+}
+
+TEST(ObjectStoreTest, StoreAndRetrieve)
+{
+    ObjectStore store;
+    auto text = std::make_shared<Text>("hello");
+    Hash key = store.Store(text);
+    EXPECT_EQ(key, text->HashAsObject());
+    EXPECT_TRUE(store.Contains(key));
+    EXPECT_EQ(store.Size(), 1);
+    EXPECT_EQ(store.Retrieve<Text>(key), text);
+}
+
+TEST(ObjectStoreTest, DuplicateAndMissing)
+{
+    ObjectStore store;
+    store.Store(std::make_shared<Text>("a"));
+    try
+    {
+        store.Store(std::make_shared<Text>("a"));
+        FAIL();
+    }
+    catch (Exception const &e)
+    {
+        EXPECT_EQ(e.Kind(), ExceptionKind::ElementAlreadyExists);
+    }
+    try
+    {
+        store.Retrieve<Text>(Hash{0, 0});
+        FAIL();
+    }
+    catch (Exception const &e)
+    {
+        EXPECT_EQ(e.Kind(), ExceptionKind::ElementDoesNotExist);
+    }
+}
+
+TEST(ObjectStoreTest, BatchStoreAndRetrieve)
+{
+    ObjectStore store;
+    std::vector<sp<Object>> objects;
+    for (int i = 0; i < 1000; i++)
+    {
+        objects.push_back(std::make_shared<Text>(std::to_string(i)));
+    }
+    auto keys = store.StoreBatch(objects);
+    ASSERT_EQ(keys.size(), objects.size());
+    EXPECT_EQ(store.Size(), objects.size());
+
+    auto retrieved = store.RetrieveBatch<Text>(keys);
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        EXPECT_EQ(keys[i], objects[i]->HashAsObject());
+        EXPECT_EQ(retrieved[i], objects[i]);
+    }
+
+    keys.push_back(Hash{0, 0});
+    EXPECT_THROW(store.RetrieveBatch<Text>(keys), Exception);
+}
+
+TEST(ObjectStoreTest, BatchWithDuplicateStoresNothing)
+{
+    ObjectStore store;
+    store.Store(std::make_shared<Text>("existing"));
+
+    std::vector<sp<Object>> objects{std::make_shared<Text>("a"), std::make_shared<Text>("b"),
+                                    std::make_shared<Text>("existing")};
+    EXPECT_THROW(store.StoreBatch(objects), Exception);
+    EXPECT_EQ(store.Size(), 1);
+
+    // 同一批里重复
+    std::vector<sp<Object>> repeated{std::make_shared<Text>("a"), std::make_shared<Text>("a")};
+    EXPECT_THROW(store.StoreBatch(repeated), Exception);
+    EXPECT_EQ(store.Size(), 1);
+    EXPECT_FALSE(store.Contains(Text{"a"}.HashAsObject()));
+}
+
+TEST(ObjectStoreTest, CollectUnreachable)
+{
+    ObjectStore store;
+    Hash leaf = store.Store(std::make_shared<Node>("leaf", std::vector<Hash>{}));
+    Hash shared = store.Store(std::make_shared<Node>("shared", std::vector<Hash>{leaf}));
+    Hash root = store.Store(std::make_shared<Node>("root", std::vector<Hash>{shared, Hash{9, 9}}));
+    Hash orphan = store.Store(std::make_shared<Node>("orphan", std::vector<Hash>{shared}));
+    // 环也能回收
+    Hash a = Node{"a", {}}.HashAsObject();
+    Hash b = store.Store(std::make_shared<Node>("b", std::vector<Hash>{a}));
+    store.Store(std::make_shared<Node>("a", std::vector<Hash>{b}));
+
+    EXPECT_THROW(store.AddRoot(Hash{9, 9}), Exception);
+    store.AddRoot(root);
+    store.AddRoot(root);
+    EXPECT_EQ(store.Collect(), 3);
+    EXPECT_TRUE(store.Contains(root));
+    EXPECT_TRUE(store.Contains(shared));
+    EXPECT_TRUE(store.Contains(leaf));
+    EXPECT_FALSE(store.Contains(orphan));
+    EXPECT_FALSE(store.Contains(a));
+
+    // 根按次数计数
+    store.RemoveRoot(root);
+    EXPECT_EQ(store.Collect(), 0);
+    store.RemoveRoot(root);
+    EXPECT_THROW(store.RemoveRoot(root), Exception);
+    EXPECT_EQ(store.Collect(), 3);
+    EXPECT_EQ(store.Size(), 0);
+}
@@ -0,0 +1,116 @@
+#include "foundation/object.h"
+#include "foundation/object_arena.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+using namespace llama;
+
+namespace
+{
+
+struct Cell
+{
+    uint32_t row;
+    uint32_t column;
+    double value;
+
+    Hash HashAsObject() const
+    {
+        return Hash{(uint64_t(row) << 32 | column) * 0x9E3779B97F4A7C15ull, uint64_t(value)};
+    }
+};
+
+struct Flag
+{
+    bool value;
+
+    Hash HashAsObject() const
+    {
+        return Hash{value ? 1u : 2u, 0};
+    }
+};
+
+static_assert(SmallObject<Cell>);
+static_assert(!SmallObject<std::vector<int>>);
+
+} // namespace
+
+TEST(ObjectArenaTest, InsertEraseReuse)
+{
+    ObjectArena<Cell> arena;
+    std::vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        indexes.push_back(arena.Insert(Cell{i, i, double(i)}));
+    }
+    EXPECT_EQ(arena.Size(), 10000);
+    EXPECT_EQ(arena[indexes[5000]].row, 5000);
+
+    for (uint32_t i = 0; i < 10000; i += 2)
+    {
+        arena.Erase(indexes[i]);
+    }
+    EXPECT_EQ(arena.Size(), 5000);
+    EXPECT_FALSE(arena.IsLive(indexes[0]));
+    EXPECT_TRUE(arena.IsLive(indexes[1]));
+
+    // 释放的位置优先复用
+    uint32_t reused = arena.Insert(Cell{1, 2, 3});
+    EXPECT_LT(reused, 10000);
+    EXPECT_EQ(arena[reused].column, 2);
+
+    size_t visited = 0;
+    uint32_t last = 0;
+    arena.ForEach([&](uint32_t index, Cell const &cell) {
+        EXPECT_TRUE(visited == 0 || index > last);
+        EXPECT_EQ(&arena[index], &cell);
+        last = index;
+        visited++;
+    });
+    EXPECT_EQ(visited, 5001);
+}
+
+TEST(ObjectArenaTest, StoreSmallInObjectStore)
+{
+    EXPECT_NE(ObjectTypeTagOf<Cell>(), ObjectTypeTagOf<Flag>());
+    EXPECT_EQ(ObjectTypeTagOf<Cell>(), ObjectTypeTagOf<Cell>());
+
+    ObjectStore store;
+    std::map<uint32_t, ObjectHandle> handles;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        handles[i] = store.StoreSmall(Cell{i, 7, i * 0.5});
+    }
+    ObjectHandle flag = store.StoreSmall(Flag{true});
+    EXPECT_EQ(flag.tag, ObjectTypeTagOf<Flag>());
+    EXPECT_EQ(store.Size(), 1001);
+    EXPECT_THROW(store.StoreSmall(Cell{3, 7, 1.5}), Exception);
+
+    Hash key = Cell{42, 7, 21}.HashAsObject();
+    EXPECT_TRUE(store.Contains(key));
+    EXPECT_EQ(store.FindSmall(key), handles[42]);
+    EXPECT_EQ(store.Get<Cell>(handles[42]).value, 21);
+    EXPECT_TRUE(store.Get<Flag>(flag).value);
+    EXPECT_THROW(store.FindSmall(Hash{5, 5}), Exception);
+    EXPECT_THROW(store.Retrieve<Object>(key), Exception);
+
+    double sum = 0;
+    store.ForEachSmall<Cell>([&](ObjectHandle handle, Cell const &cell) {
+        EXPECT_EQ(handle.tag, ObjectTypeTagOf<Cell>());
+        sum += cell.value;
+    });
+    EXPECT_EQ(sum, 999 * 1000 / 2 * 0.5);
+
+    // 小对象和普通对象一样参与垃圾回收
+    store.AddRoot(key);
+    EXPECT_EQ(store.Collect(), 1000);
+    EXPECT_EQ(store.Size(), 1);
+    EXPECT_EQ(store.Get<Cell>(store.FindSmall(key)).row, 42);
+    EXPECT_THROW(store.FindSmall(Flag{true}.HashAsObject()), Exception);
+
+    // 回收的位置给新的对象
+    ObjectHandle again = store.StoreSmall(Cell{1, 1, 1});
+    EXPECT_NE(again, handles[42]);
+    EXPECT_EQ(store.Get<Cell>(again).row, 1);
+}
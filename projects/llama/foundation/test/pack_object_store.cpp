@@ -0,0 +1,268 @@
+#include "foundation/pack_object_store.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using namespace llama;
+
+namespace
+{
+
+class Text : public Object
+{
+  public:
+    Text() = default;
+
+    explicit Text(std::string text) : m_text{std::move(text)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{std::hash<std::string>{}(m_text), m_text.size()};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out.write(m_text.data(), std::streamsize(m_text.size()));
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        m_text.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+
+    std::string m_text;
+};
+
+class PackObjectStoreTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        auto name = std::string{"llama-pack-"} + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_directory = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(m_directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::filesystem::path m_directory;
+};
+
+} // namespace
+
+TEST_F(PackObjectStoreTest, StoreAndRetrieve)
+{
+    PackObjectStore store{m_directory};
+    Hash key = store.Store(Text{"hello"});
+    EXPECT_TRUE(store.Contains(key));
+    EXPECT_EQ(store.Size(), 1);
+    EXPECT_EQ(store.Retrieve<Text>(key)->m_text, "hello");
+    EXPECT_THROW(store.Store(Text{"hello"}), Exception);
+    EXPECT_THROW(store.Retrieve<Text>(Hash{0, 0}), Exception);
+
+    // 合并进索引之后仍然能取到，空对象也可以
+    Hash empty = store.Store(Text{""});
+    store.Flush();
+    EXPECT_EQ(store.Retrieve<Text>(key)->m_text, "hello");
+    EXPECT_EQ(store.Retrieve<Text>(empty)->m_text, "");
+}
+
+TEST_F(PackObjectStoreTest, PersistsAcrossReopen)
+{
+    std::vector<Hash> keys;
+    {
+        PackObjectStore store{m_directory};
+        for (int i = 0; i < 1000; i++)
+        {
+            keys.push_back(store.Store(Text{std::to_string(i)}));
+            // 分几次合并，让索引的归并也被测到
+            if (i % 300 == 0)
+                store.Flush();
+        }
+    }
+
+    PackObjectStore store{m_directory};
+    EXPECT_EQ(store.Size(), 1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        EXPECT_EQ(store.Retrieve<Text>(keys[i])->m_text, std::to_string(i));
+    }
+}
+
+TEST_F(PackObjectStoreTest, RecoversUnindexedAndTruncatedRecords)
+{
+    Hash first{0, 0}, second{0, 0};
+    {
+        PackObjectStore store{m_directory};
+        first = store.Store(Text{"first"});
+        store.Flush();
+        second = store.Store(Text{"second"});
+    }
+
+    // 索引丢失时，扫描整个包文件恢复
+    std::filesystem::remove(m_directory / "objects.idx");
+    {
+        PackObjectStore store{m_directory};
+        store.Flush();
+    }
+    // 模拟写到一半退出：包文件末尾有残缺的记录
+    {
+        std::ofstream pack{m_directory / "objects.pack", std::ios::binary | std::ios::app};
+        pack.write("\x01\x02\x03\x04\x05", 5);
+    }
+
+    PackObjectStore store{m_directory};
+    EXPECT_EQ(store.Size(), 2);
+    EXPECT_EQ(store.Retrieve<Text>(first)->m_text, "first");
+    EXPECT_EQ(store.Retrieve<Text>(second)->m_text, "second");
+
+    // 截掉残缺记录之后可以继续追加
+    Hash third = store.Store(Text{"third"});
+    EXPECT_EQ(store.Retrieve<Text>(third)->m_text, "third");
+}
+
+TEST_F(PackObjectStoreTest, FailedFlushLeavesStoreUsable)
+{
+    Hash first{0, 0}, second{0, 0};
+    {
+        PackObjectStore store{m_directory};
+        first = store.Store(Text{"first"});
+        store.Flush();
+        second = store.Store(Text{"second"});
+
+        // 索引的位置被一个非空目录占住，新索引换不上去，重新打开也读不了索引
+        std::filesystem::remove(m_directory / "objects.idx");
+        std::filesystem::create_directories(m_directory / "objects.idx" / "busy");
+        EXPECT_THROW(store.Flush(), Exception);
+        EXPECT_FALSE(store.Contains(first));
+        EXPECT_THROW(store.Retrieve<Text>(second), Exception);
+    }
+
+    // 对象都还在包文件里
+    std::filesystem::remove_all(m_directory / "objects.idx");
+    PackObjectStore store{m_directory};
+    EXPECT_EQ(store.Size(), 2);
+    EXPECT_EQ(store.Retrieve<Text>(first)->m_text, "first");
+    EXPECT_EQ(store.Retrieve<Text>(second)->m_text, "second");
+    store.Flush();
+    EXPECT_EQ(store.Retrieve<Text>(second)->m_text, "second");
+}
+
+TEST_F(PackObjectStoreTest, RejectsForeignFiles)
+{
+    std::filesystem::create_directories(m_directory);
+    std::ofstream{m_directory / "objects.pack"} << "definitely not a pack file";
+    try
+    {
+        PackObjectStore store{m_directory};
+        FAIL();
+    }
+    catch (Exception const &e)
+    {
+        EXPECT_EQ(e.Kind(), ExceptionKind::InvalidFileFormat);
+    }
+}
+
+TEST_F(PackObjectStoreTest, CompactRemovesDeadObjects)
+{
+    std::uintmax_t size_before;
+    {
+        PackObjectStore store{m_directory};
+        for (int i = 0; i < 1000; i++)
+        {
+            store.Store(Text{"object " + std::to_string(i)});
+        }
+        store.Flush();
+        size_before = std::filesystem::file_size(m_directory / "objects.pack");
+
+        auto is_live = [](Hash const &hash) {
+            for (int i = 0; i < 1000; i += 10)
+            {
+                if (Text{"object " + std::to_string(i)}.HashAsObject() == hash)
+                    return true;
+            }
+            return false;
+        };
+        EXPECT_EQ(store.Compact(is_live), 900);
+        EXPECT_EQ(store.Size(), 100);
+        EXPECT_EQ(store.Retrieve<Text>(Text{"object 990"}.HashAsObject())->m_text, "object 990");
+        EXPECT_FALSE(store.Contains(Text{"object 991"}.HashAsObject()));
+
+        // 压缩之后照常存放
+        store.Store(Text{"after"});
+        EXPECT_TRUE(store.Contains(Text{"after"}.HashAsObject()));
+    }
+    EXPECT_LT(std::filesystem::file_size(m_directory / "objects.pack"), size_before / 5);
+    EXPECT_FALSE(std::filesystem::exists(m_directory / "objects.pack.compact"));
+
+    PackObjectStore reopened{m_directory};
+    EXPECT_EQ(reopened.Size(), 101);
+    EXPECT_EQ(reopened.Retrieve<Text>(Text{"object 500"}.HashAsObject())->m_text, "object 500");
+    EXPECT_EQ(reopened.Retrieve<Text>(Text{"after"}.HashAsObject())->m_text, "after");
+}
+
+TEST_F(PackObjectStoreTest, FailedCompactionKeepsObjects)
+{
+    {
+        PackObjectStore store{m_directory};
+        for (int i = 0; i < 100; i++)
+        {
+            store.Store(Text{std::to_string(i)});
+        }
+        auto compaction = store.BeginCompaction([](Hash const &hash) { return hash.Data2() == 1; });
+        compaction->Run();
+
+        // 旧索引删不掉，换不上新文件：压缩作废，仓库不会留下失效的映射
+        std::filesystem::remove(m_directory / "objects.idx");
+        std::filesystem::create_directories(m_directory / "objects.idx" / "busy");
+        EXPECT_THROW(store.FinishCompaction(*compaction), Exception);
+        EXPECT_FALSE(std::filesystem::exists(m_directory / "objects.pack.compact"));
+        EXPECT_THROW(store.FinishCompaction(*compaction), Exception);
+        EXPECT_FALSE(store.Contains(Text{"5"}.HashAsObject()));
+    }
+
+    std::filesystem::remove_all(m_directory / "objects.idx");
+    PackObjectStore store{m_directory};
+    EXPECT_EQ(store.Size(), 100);
+    EXPECT_EQ(store.Retrieve<Text>(Text{"42"}.HashAsObject())->m_text, "42");
+}
+
+TEST_F(PackObjectStoreTest, CompactWhileStoring)
+{
+    PackObjectStore store{m_directory};
+    for (int i = 0; i < 1000; i++)
+    {
+        store.Store(Text{std::to_string(i)});
+    }
+    // 只保留两位数
+    auto compaction = store.BeginCompaction([](Hash const &hash) { return hash.Data2() % 2 == 0; });
+    EXPECT_THROW(store.BeginCompaction([](Hash const &) { return true; }), Exception);
+    EXPECT_THROW(store.FinishCompaction(*compaction), Exception);
+
+    // Run 在别的线程，这边照常读写
+    std::thread runner{[&] { compaction->Run(); }};
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(store.Retrieve<Text>(Text{std::to_string(i)}.HashAsObject())->m_text, std::to_string(i));
+        store.Store(Text{"new " + std::to_string(i)});
+    }
+    // 快照里不可达的对象在压缩期间又被存放，要保留下来
+    EXPECT_THROW(store.Store(Text{"1"}), Exception);
+    runner.join();
+
+    store.FinishCompaction(*compaction);
+    EXPECT_EQ(compaction->RemovedCount(), 910);
+    EXPECT_GT(compaction->ReclaimedBytes(), 0);
+    EXPECT_TRUE(store.Contains(Text{"1"}.HashAsObject()));
+    EXPECT_FALSE(store.Contains(Text{"3"}.HashAsObject()));
+    EXPECT_TRUE(store.Contains(Text{"10"}.HashAsObject()));
+    EXPECT_EQ(store.Retrieve<Text>(Text{"new 99"}.HashAsObject())->m_text, "new 99");
+    EXPECT_EQ(store.Size(), 90 + 1 + 100);
+}
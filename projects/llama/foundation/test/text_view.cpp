@@ -0,0 +1,108 @@
+#include "foundation/path.h"
+#include "foundation/text_view.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <unordered_set>
+
+using llama::TextEncoding;
+using llama::TextView;
+
+TEST(TextViewTest, Encoding)
+{
+    EXPECT_EQ(TextView{std::string_view{"a"}}.Encoding(), TextEncoding::Utf8);
+    EXPECT_EQ(TextView{std::u16string_view{u"a"}}.Encoding(), TextEncoding::Utf16);
+    EXPECT_EQ(TextView{std::u32string_view{U"a"}}.Encoding(), TextEncoding::Utf32);
+    EXPECT_EQ(TextView{std::wstring_view{L"a"}}.Encoding(),
+              sizeof(wchar_t) == 2 ? TextEncoding::Utf16 : TextEncoding::Utf32);
+}
+
+TEST(TextViewTest, SameEncodingIsZeroCopy)
+{
+    std::string utf8 = "世界😀";
+    TextView view{std::string_view{utf8}};
+    EXPECT_EQ(view.Utf8().data(), utf8.data());
+
+    std::u16string utf16 = u"世界😀";
+    TextView view16{std::u16string_view{utf16}};
+    EXPECT_EQ(view16.Utf16().data(), utf16.data());
+}
+
+TEST(TextViewTest, LazyConversionIsCached)
+{
+    std::u16string utf16 = u"世界😀";
+    TextView view{std::u16string_view{utf16}};
+    std::string_view first = view.Utf8();
+    EXPECT_EQ(first, "世界😀");
+    EXPECT_EQ(view.Utf8().data(), first.data());
+
+    std::u32string utf32 = U"世界😀";
+    TextView view32{std::u32string_view{utf32}};
+    EXPECT_EQ(view32.Utf8(), "世界😀");
+    EXPECT_EQ(view32.Utf16(), u"世界😀");
+}
+
+TEST(TextViewTest, EqualityAcrossEncodings)
+{
+    TextView utf8{std::string_view{"héllo, 世界😀"}};
+    TextView utf16{std::u16string_view{u"héllo, 世界😀"}};
+    TextView utf32{std::u32string_view{U"héllo, 世界😀"}};
+    EXPECT_EQ(utf8, utf16);
+    EXPECT_EQ(utf16, utf32);
+    EXPECT_EQ(utf8, utf32);
+    EXPECT_EQ(utf8.Hash(), utf16.Hash());
+    EXPECT_EQ(utf8.Hash(), utf32.Hash());
+
+    TextView other{std::u16string_view{u"héllo, 世界😁"}};
+    EXPECT_NE(utf8, other);
+    EXPECT_NE(TextView{std::string_view{"abc"}}, TextView{std::u16string_view{u"ab"}});
+    EXPECT_NE(TextView{std::string_view{"ab"}}, TextView{std::u16string_view{u"abc"}});
+}
+
+TEST(TextViewTest, MalformedInputDoesNotThrow)
+{
+    TextView bad8{std::string_view{"\x80\xC0"}};
+    TextView bad16{std::u16string_view{u"\xD83D" u"A"}};
+    EXPECT_NO_THROW(bad8.Hash());
+    EXPECT_NO_THROW(bad16.Hash());
+    EXPECT_NE(bad8, bad16);
+    EXPECT_EQ(bad8, TextView{std::string_view{"\x80\xC0"}});
+}
+
+TEST(TextViewTest, EqualityIsTransitive)
+{
+    // 超长编码和编码的代理不是合法的 UTF-8 ，不能等于同一个代码点的其他编码
+    TextView overlong{std::string_view{"\xC1\x81"}};
+    TextView utf16{std::u16string_view{u"A"}};
+    TextView utf8{std::string_view{"A"}};
+    EXPECT_EQ(utf16, utf8);
+    EXPECT_NE(overlong, utf8);
+    EXPECT_NE(overlong, utf16);
+    EXPECT_NE(overlong.Hash(), utf16.Hash());
+    EXPECT_EQ(utf16.Hash(), utf8.Hash());
+
+    TextView surrogate8{std::string_view{"\xED\xA0\x80"}};
+    TextView surrogate16{std::u16string_view{u"\xD800"}};
+    EXPECT_NE(surrogate8, surrogate16);
+    EXPECT_NE(surrogate8.Hash(), surrogate16.Hash());
+
+    std::unordered_set<TextView> set{overlong, utf8};
+    EXPECT_EQ(set.size(), 2);
+    EXPECT_EQ(set.count(utf16), 1);
+}
+
+TEST(TextViewTest, UnorderedSet)
+{
+    std::unordered_set<TextView> set;
+    set.insert(TextView{std::string_view{"alpha"}});
+    set.insert(TextView{std::string_view{"世界"}});
+    EXPECT_TRUE(set.contains(TextView{std::u16string_view{u"alpha"}}));
+    EXPECT_TRUE(set.contains(TextView{std::u32string_view{U"世界"}}));
+    EXPECT_FALSE(set.contains(TextView{std::u16string_view{u"beta"}}));
+}
+
+TEST(TextViewTest, RelativePath)
+{
+    std::u16string path = u"a/b/c";
+    EXPECT_NO_THROW(llama::RelativePath{TextView{std::u16string_view{path}}});
+    EXPECT_THROW(llama::RelativePath{TextView{std::u16string_view{u"/a/b"}}}, llama::Exception);
+}
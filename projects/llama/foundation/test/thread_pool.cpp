@@ -0,0 +1,61 @@
+#include "foundation/thread_pool.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+using llama::ThreadPool;
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce)
+{
+    ThreadPool pool{4};
+    EXPECT_EQ(pool.ThreadCount(), 4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.ParallelFor(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto &hit : hits)
+    {
+        EXPECT_EQ(hit, 1);
+    }
+}
+
+TEST(ThreadPoolTest, ReusableAcrossBatches)
+{
+    ThreadPool pool{3};
+    std::atomic<size_t> sum = 0;
+    for (int round = 0; round < 100; round++)
+    {
+        pool.ParallelFor(10, [&](size_t i) { sum += i; });
+    }
+    EXPECT_EQ(sum, 100 * 45);
+}
+
+TEST(ThreadPoolTest, SingleThread)
+{
+    ThreadPool pool{1};
+    std::vector<size_t> order;
+    pool.ParallelFor(5, [&](size_t i) { order.push_back(i); });
+    EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(ThreadPoolTest, NestedRunsSerially)
+{
+    ThreadPool pool{4};
+    std::atomic<int> count = 0;
+    pool.ParallelFor(8, [&](size_t) { pool.ParallelFor(8, [&](size_t) { count++; }); });
+    EXPECT_EQ(count, 64);
+}
+
+TEST(ThreadPoolTest, RethrowsException)
+{
+    ThreadPool pool{4};
+    EXPECT_THROW(pool.ParallelFor(100,
+                                  [](size_t i) {
+                                      if (i == 42)
+                                          throw std::runtime_error("42");
+                                  }),
+                 std::runtime_error);
+    // 抛过异常之后仍然可用
+    std::atomic<int> count = 0;
+    pool.ParallelFor(10, [&](size_t) { count++; });
+    EXPECT_EQ(count, 10);
+}
@@ -0,0 +1,213 @@
+#include "foundation/write_behind_object_store.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using namespace llama;
+
+namespace
+{
+
+class Text : public Object
+{
+  public:
+    Text() = default;
+
+    explicit Text(std::string text) : m_text{std::move(text)}
+    {
+    }
+
+    Hash HashAsObject() const override
+    {
+        return Hash{std::hash<std::string>{}(m_text), m_text.size()};
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        out.write(m_text.data(), std::streamsize(m_text.size()));
+    }
+
+    void DeserializeAsObject(std::istream &in) override
+    {
+        m_text.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+
+    std::string m_text;
+};
+
+// 序列化时停在闸门上，直到测试打开闸门。用来让写盘线程卡住
+class Gate : public Text
+{
+  public:
+    explicit Gate(std::shared_future<void> open) : Text{"gate"}, m_open{std::move(open)}
+    {
+    }
+
+    void SerializeAsObject(std::ostream &out) const override
+    {
+        m_entered.set_value();
+        m_open.wait();
+        Text::SerializeAsObject(out);
+    }
+
+    // 等到写盘线程开始写它
+    void WaitEntered()
+    {
+        m_entered.get_future().wait();
+    }
+
+  private:
+    std::shared_future<void> m_open;
+    mutable std::promise<void> m_entered;
+};
+
+class Broken : public Text
+{
+  public:
+    Broken() : Text{"broken"}
+    {
+    }
+
+    void SerializeAsObject(std::ostream &) const override
+    {
+        throw Exception{ExceptionKind::IoError, "disk full"};
+    }
+};
+
+class WriteBehindObjectStoreTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        auto name = std::string{"llama-write-behind-"} + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_directory = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(m_directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::filesystem::path m_directory;
+};
+
+} // namespace
+
+TEST_F(WriteBehindObjectStoreTest, StoreFlushAndReopen)
+{
+    {
+        PackObjectStore backing{m_directory};
+        WriteBehindObjectStore store{backing};
+        for (int i = 0; i < 1000; i++)
+        {
+            auto text = std::make_shared<Text>(std::to_string(i));
+            Hash key = store.Store(text);
+            // 还没有提交也能马上读到，而且就是存放的那个对象
+            EXPECT_EQ(store.Retrieve<Text>(key), text);
+        }
+        EXPECT_THROW(store.Store(std::make_shared<Text>("7")), Exception);
+
+        store.Flush();
+        auto stats = store.Stats();
+        EXPECT_EQ(stats.committed, 1000);
+        EXPECT_EQ(stats.pending, 0);
+        EXPECT_GE(stats.commits, 1);
+        EXPECT_EQ(backing.Size(), 1000);
+
+        // 已经提交的对象从后备仓库加载，重复存放照样能发现
+        EXPECT_EQ(store.Retrieve<Text>(Text{"42"}.HashAsObject())->m_text, "42");
+        EXPECT_THROW(store.Store(std::make_shared<Text>("42")), Exception);
+        EXPECT_TRUE(store.Contains(Text{"999"}.HashAsObject()));
+        EXPECT_FALSE(store.Contains(Text{"1000"}.HashAsObject()));
+    }
+
+    PackObjectStore reopened{m_directory};
+    EXPECT_EQ(reopened.Size(), 1000);
+    EXPECT_EQ(reopened.Retrieve<Text>(Text{"500"}.HashAsObject())->m_text, "500");
+}
+
+TEST_F(WriteBehindObjectStoreTest, DestructorDrainsQueue)
+{
+    {
+        PackObjectStore backing{m_directory};
+        WriteBehindObjectStore store{backing, 16, 4};
+        for (int i = 0; i < 100; i++)
+        {
+            store.Store(std::make_shared<Text>(std::to_string(i)));
+        }
+    }
+    PackObjectStore reopened{m_directory};
+    EXPECT_EQ(reopened.Size(), 100);
+}
+
+TEST_F(WriteBehindObjectStoreTest, GroupCommit)
+{
+    PackObjectStore backing{m_directory};
+    WriteBehindObjectStore store{backing};
+    std::promise<void> open;
+    auto gate = std::make_shared<Gate>(open.get_future().share());
+    store.Store(gate);
+    gate->WaitEntered();
+
+    // 写盘线程卡在第一批的时候，后面的对象都攒到下一批
+    for (int i = 0; i < 500; i++)
+    {
+        store.Store(std::make_shared<Text>(std::to_string(i)));
+    }
+    open.set_value();
+    store.Flush();
+
+    auto stats = store.Stats();
+    EXPECT_EQ(stats.committed, 501);
+    EXPECT_EQ(stats.commits, 2);
+}
+
+TEST_F(WriteBehindObjectStoreTest, Backpressure)
+{
+    PackObjectStore backing{m_directory};
+    WriteBehindObjectStore store{backing, 3};
+    std::promise<void> open;
+    store.Store(std::make_shared<Gate>(open.get_future().share()));
+    store.Store(std::make_shared<Text>("a"));
+    store.Store(std::make_shared<Text>("b"));
+
+    std::atomic<bool> stored = false;
+    std::thread producer{[&] {
+        store.Store(std::make_shared<Text>("c"));
+        stored = true;
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(stored);
+    EXPECT_EQ(store.Stats().pending, 3);
+
+    open.set_value();
+    producer.join();
+    EXPECT_TRUE(stored);
+    store.Flush();
+    EXPECT_EQ(store.Stats().committed, 4);
+}
+
+TEST_F(WriteBehindObjectStoreTest, WriteErrorIsReported)
+{
+    PackObjectStore backing{m_directory};
+    WriteBehindObjectStore store{backing};
+    Hash key = store.Store(std::make_shared<Broken>());
+    try
+    {
+        store.Flush();
+        FAIL();
+    }
+    catch (Exception const &e)
+    {
+        EXPECT_EQ(e.Kind(), ExceptionKind::IoError);
+    }
+    EXPECT_THROW(store.Store(std::make_shared<Text>("after")), Exception);
+
+    // 没写进去的对象还在内存里
+    EXPECT_EQ(store.Retrieve<Text>(key)->m_text, "broken");
+}